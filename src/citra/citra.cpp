@@ -9,6 +9,10 @@
 #include "core/system.h"
 #include "core/core.h"
 #include "core/loader.h"
+#include "core/arm/arm_profiler.h"
+#include "core/hle/service/service.h"
+
+#include "video_core/video_core.h"
 
 #include "citra/emu_window/emu_window_glfw.h"
 
@@ -20,18 +24,46 @@ int __cdecl main(int argc, char **argv) {
 
     LogManager::Init();
 
-    EmuWindow_GLFW* emu_window = new EmuWindow_GLFW;
+    std::string boot_filename;
+    bool headless = false;
+    Core::CPUCoreType cpu_core = Core::CPU_INTERPRETER;
+    Core::MultiCoreMode multicore_mode = Core::MULTICORE_DISABLED;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--jit")) {
+            cpu_core = Core::CPU_JIT;
+        } else if (!strcmp(argv[i], "--multicore")) {
+            multicore_mode = Core::MULTICORE_LOCKSTEP;
+        } else if (!strcmp(argv[i], "--multicore-relaxed")) {
+            multicore_mode = Core::MULTICORE_RELAXED;
+        } else if (!strcmp(argv[i], "--idle-loops")) {
+            Core::g_detect_idle_loops = true;
+        } else if (!strcmp(argv[i], "--gpu-thread")) {
+            VideoCore::g_use_gpu_thread = true;
+        } else if (!strcmp(argv[i], "--shader-interpreter")) {
+            VideoCore::g_use_shader_jit = false;
+        } else if (!strcmp(argv[i], "--sw-rasterizer")) {
+            VideoCore::g_use_hw_rasterizer = false;
+        } else if (!strcmp(argv[i], "--headless")) {
+            headless = true;
+        } else if (!strcmp(argv[i], "--dump-frames") && i + 1 < argc) {
+            VideoCore::g_frame_dump_path = argv[++i];
+        } else if (!strcmp(argv[i], "--profile")) {
+            Profiler::Enable();
+            Service::g_time_functions = true;
+        } else {
+            boot_filename = argv[i];
+        }
+    }
 
-    System::Init(emu_window);
+    // Without a window, frames are rendered by the software renderer
+    EmuWindow_GLFW* emu_window = headless ? NULL : new EmuWindow_GLFW;
 
-    std::string boot_filename;
+    System::Init(emu_window, cpu_core, multicore_mode);
 
-    if (argc < 2) {
+    if (boot_filename.empty()) {
         ERROR_LOG(BOOT, "Failed to load ROM: No ROM specified");
     }
-    else {
-        boot_filename = argv[1];
-    }
     std::string error_str;
 
     bool res = Loader::LoadFile(boot_filename, &error_str);
@@ -0,0 +1,158 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <string>
+
+#include "common/common.h"
+#include "common/cpu_detect.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CPU_DETECT_X86
+#endif
+
+#ifdef CPU_DETECT_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef CPU_DETECT_X86
+
+static inline void do_cpuid(unsigned int* regs, unsigned int function, unsigned int subfunction)
+{
+#ifdef _MSC_VER
+    __cpuidex((int*)regs, function, subfunction);
+#else
+    __cpuid_count(function, subfunction, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Reads XCR0, which tells which register states the OS saves on context switches
+static inline unsigned long long do_xgetbv()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+#endif // CPU_DETECT_X86
+
+CPUInfo cpu_info;
+
+CPUInfo::CPUInfo()
+{
+    Detect();
+}
+
+// Detects the various cpu features
+void CPUInfo::Detect()
+{
+    memset(this, 0, sizeof(*this));
+    vendor = VENDOR_OTHER;
+    num_cores = 1;
+    logical_cpu_count = 1;
+#if defined(_M_X64) || defined(__x86_64__)
+    Mode64bit = true;
+    OS64bit = true;
+#endif
+
+#ifdef CPU_DETECT_X86
+    unsigned int regs[4];
+
+    // Vendor string and highest standard function
+    do_cpuid(regs, 0, 0);
+    const unsigned int max_std_fn = regs[0];
+    memcpy(&cpu_string[0], &regs[1], 4);
+    memcpy(&cpu_string[4], &regs[3], 4);
+    memcpy(&cpu_string[8], &regs[2], 4);
+    cpu_string[12] = '\0';
+    if (!strcmp(cpu_string, "GenuineIntel"))
+        vendor = VENDOR_INTEL;
+    else if (!strcmp(cpu_string, "AuthenticAMD"))
+        vendor = VENDOR_AMD;
+
+    // Highest extended function
+    do_cpuid(regs, 0x80000000, 0);
+    const unsigned int max_ex_fn = regs[0];
+
+    if (max_std_fn >= 1)
+    {
+        do_cpuid(regs, 1, 0);
+        const unsigned int ecx = regs[2], edx = regs[3];
+        logical_cpu_count = (regs[1] >> 16) & 0xFF;
+        HTT = (edx >> 28) & 1;
+        bSSE = (edx >> 25) & 1;
+        bSSE2 = (edx >> 26) & 1;
+        bSSE3 = ecx & 1;
+        bSSSE3 = (ecx >> 9) & 1;
+        bSSE4_1 = (ecx >> 19) & 1;
+        bSSE4_2 = (ecx >> 20) & 1;
+        bPOPCNT = (ecx >> 23) & 1;
+        bAES = (ecx >> 25) & 1;
+
+        // AVX needs the OS to save the YMM registers as well as the CPU to support it
+        const bool os_saves_ymm = ((ecx >> 27) & 1) && (do_xgetbv() & 6) == 6;
+        bAVX = ((ecx >> 28) & 1) && os_saves_ymm;
+
+        if (max_std_fn >= 7)
+        {
+            do_cpuid(regs, 7, 0);
+            bAVX2 = bAVX && ((regs[1] >> 5) & 1);
+        }
+    }
+
+    if (max_ex_fn >= 0x80000004)
+    {
+        // Processor brand string
+        do_cpuid(regs, 0x80000002, 0);
+        memcpy(&brand_string[0], regs, 16);
+        do_cpuid(regs, 0x80000003, 0);
+        memcpy(&brand_string[16], regs, 16);
+        do_cpuid(regs, 0x80000004, 0);
+        memcpy(&brand_string[32], regs, 16);
+        brand_string[48] = '\0';
+    }
+    else
+    {
+        strcpy(brand_string, cpu_string);
+    }
+
+    if (max_ex_fn >= 0x80000001)
+    {
+        do_cpuid(regs, 0x80000001, 0);
+        bLAHFSAHF64 = regs[2] & 1;
+        bLZCNT = (regs[2] >> 5) & 1;
+        bSSE4A = (regs[2] >> 6) & 1;
+        bLongMode = (regs[3] >> 29) & 1;
+        CPU64bit = bLongMode;
+    }
+
+    num_cores = (logical_cpu_count == 0) ? 1 : logical_cpu_count;
+#endif // CPU_DETECT_X86
+}
+
+// Turn the cpu info into a string we can show
+std::string CPUInfo::Summarize()
+{
+    std::string sum = brand_string[0] ? brand_string : cpu_string;
+    if (bSSE) sum += ", SSE";
+    if (bSSE2) sum += ", SSE2";
+    if (bSSE3) sum += ", SSE3";
+    if (bSSSE3) sum += ", SSSE3";
+    if (bSSE4_1) sum += ", SSE4.1";
+    if (bSSE4_2) sum += ", SSE4.2";
+    if (HTT) sum += ", HTT";
+    if (bAVX) sum += ", AVX";
+    if (bAVX2) sum += ", AVX2";
+    if (bAES) sum += ", AES";
+    if (bLongMode) sum += ", 64-bit support";
+    return sum;
+}
@@ -41,6 +41,7 @@ struct CPUInfo
     bool bLZCNT;
     bool bSSE4A;
     bool bAVX;
+    bool bAVX2;
     bool bAES;
     bool bLAHFSAHF64;
     bool bLongMode;
@@ -78,4 +79,12 @@ private:
 
 extern CPUInfo cpu_info;
 
+// Marks a function that uses AVX2 intrinsics, so that it can be compiled without enabling AVX2
+// for the whole build. Only call it if cpu_info.bAVX2 is set.
+#if defined(_MSC_VER)
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
 #endif // _CPUDETECT_H_
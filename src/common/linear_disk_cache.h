@@ -7,17 +7,17 @@
 #define _LINEAR_DISKCACHE
 
 #include "common/common.h"
+#include "common/file_util.h"
+#include "common/scm_rev.h"
+#include <cstring>
 #include <fstream>
 
-// defined in Version.cpp
-extern const char *scm_rev_git_str;
-
 // On disk format:
 //header{
 // u32 'DCAC';
-// u32 version;  // svn_rev
 // u16 sizeof(key_type);
 // u16 sizeof(value_type);
+// char version[40];  // git revision
 //}
 
 //key_value_pair{
@@ -150,7 +150,7 @@ private:
 
     bool ValidateHeader()
     {
-        char file_header[sizeof(Header)];
+        char file_header[sizeof(Header)] = {};
 
         return (Read(file_header, sizeof(Header))
             && !memcmp((const char*)&m_header, file_header, sizeof(Header)));
@@ -175,7 +175,7 @@ private:
             , key_t_size(sizeof(K))
             , value_t_size(sizeof(V))
         {
-            memcpy(ver, scm_rev_git_str, 40);
+            strncpy(ver, Common::g_scm_rev, sizeof(ver));
         }
 
         const u32 id;
@@ -233,9 +233,15 @@ u8* MemArena::Find4GBBase()
     VirtualFree(base, 0, MEM_RELEASE);
     return base;
 #else
-    // Very precarious - mmap cannot return an error when trying to map already used pages.
-    // This makes the Windows approach above unusable on Linux, so we will simply pray...
-    return reinterpret_cast<u8*>(0x2300000000ULL);
+    // Reserve the whole 4 GB range without backing it. Views are mapped over the reservation with
+    // MAP_FIXED, and everything else in it stays inaccessible, so that the JIT can access guest
+    // memory directly at base + address and catch accesses to I/O or unmapped pages as faults.
+    void* base = mmap(0, 0x100000000ULL, PROT_NONE, MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        PanicAlert("Failed to reserve 4 GB of memory space: %s", strerror(errno));
+        return 0;
+    }
+    return static_cast<u8*>(base);
 #endif
 
 #else // 32 bit
@@ -273,6 +279,14 @@ u8* MemArena::Find4GBBase()
 #endif
 #endif
 }
+
+void MemArena::Release4GBBase(u8* base)
+{
+#if defined(_M_X64) && !defined(_WIN32)
+    if (base)
+        munmap(base, 0x100000000ULL);
+#endif
+}
 #endif
 
 
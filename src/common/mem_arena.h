@@ -45,6 +45,8 @@ public:
 #else
     // This only finds 1 GB in 32-bit
     static u8 *Find4GBBase();
+    // Frees the address space reserved by Find4GBBase, if any
+    static void Release4GBBase(u8 *base);
 #endif
 private:
 
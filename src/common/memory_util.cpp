@@ -172,6 +172,17 @@ void UnWriteProtectMemory(void* ptr, size_t size, bool allowExecute)
 #endif
 }
 
+void ReadWriteProtectMemory(void* ptr, size_t size)
+{
+#ifdef _WIN32
+    DWORD oldValue;
+    if (!VirtualProtect(ptr, size, PAGE_NOACCESS, &oldValue))
+        PanicAlert("ReadWriteProtectMemory failed!\n%s", GetLastErrorMsg());
+#else
+    mprotect(ptr, size, PROT_NONE);
+#endif
+}
+
 std::string MemUsage()
 {
 #ifdef _WIN32
@@ -18,6 +18,7 @@ void* AllocateAlignedMemory(size_t size,size_t alignment);
 void FreeAlignedMemory(void* ptr);
 void WriteProtectMemory(void* ptr, size_t size, bool executable = false);
 void UnWriteProtectMemory(void* ptr, size_t size, bool allowExecute = false);
+void ReadWriteProtectMemory(void* ptr, size_t size);
 std::string MemUsage();
 
 inline int GetPageSize() { return 4096; }
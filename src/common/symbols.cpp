@@ -2,6 +2,8 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "common/symbols.h"
 
 TSymbolsMap g_symbols;
@@ -40,6 +42,33 @@ namespace Symbols
 
         return symbol;
     }
+    TSymbol GetSymbolContaining(u32 _address)
+    {
+        TSymbolsMap::iterator foundSymbolItr = g_symbols.upper_bound(_address);
+        if (foundSymbolItr != g_symbols.begin())
+        {
+            --foundSymbolItr;
+            const TSymbol& symbol = (*foundSymbolItr).second;
+
+            // Symbols without a size only cover their own address
+            if (_address - symbol.address < std::max<u32>(symbol.size, 1))
+                return symbol;
+        }
+
+        return TSymbol();
+    }
+
+    TSymbol GetSymbolByName(const std::string& _name)
+    {
+        for (TSymbolsMap::iterator itr = g_symbols.begin(); itr != g_symbols.end(); ++itr)
+        {
+            if ((*itr).second.name == _name)
+                return (*itr).second;
+        }
+
+        return TSymbol();
+    }
+
     const std::string& GetName(u32 _address)
     {
         return GetSymbol(_address).name;
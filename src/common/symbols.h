@@ -32,6 +32,10 @@ namespace Symbols
 
     void Add(u32 _address, const std::string& _name, u32 _size, u32 _type);
     TSymbol GetSymbol(u32 _address);
+    /// Returns the symbol whose range contains an address, or an empty symbol if there is none
+    TSymbol GetSymbolContaining(u32 _address);
+    /// Returns the first symbol with a name, or an empty symbol if there is none
+    TSymbol GetSymbolByName(const std::string& _name);
     const std::string& GetName(u32 _address);
     void Remove(u32 _address);
     void Clear();
@@ -1,216 +1,177 @@
 // Copyright 2014 Citra Emulator Project / PPSSPP Project
 // Licensed under GPLv2
-// Refer to the license.txt file included.  
+// Refer to the license.txt file included.
 
 #pragma once
 
 #include "common/common.h"
+#include "common/math_util.h"
 
 namespace Common {
 
-template<class IdType>
+/// Links of an element of a ThreadQueueList, embedded in the element itself
+template<class T>
+struct ThreadQueueHook {
+    T*      prev;       ///< Previous element of the same priority, NULL for the first one
+    T*      next;       ///< Next element of the same priority, NULL for the last one
+    u32     priority;   ///< Priority of the queue the element is in
+    bool    queued;     ///< Whether the element is in a queue
+
+    ThreadQueueHook() : prev(NULL), next(NULL), priority(0), queued(false) {}
+};
+
+/**
+ * Queues of threads by priority, 0 being the best one. Each priority level is an intrusive FIFO
+ * linked through the ThreadQueueHook of its elements, and a bitmap of the non-empty levels finds
+ * the best one with a count of leading zeros, so that all operations are O(1).
+ * @tparam T Type of the elements
+ * @tparam hook Member of T holding its links
+ */
+template<class T, ThreadQueueHook<T> T::*hook>
 struct ThreadQueueList {
     // Number of queues (number of priority levels starting at 0.)
     static const int NUM_QUEUES = 128;
-    
-    // Initial number of threads a single queue can handle.
-    static const int INITIAL_CAPACITY = 32;
-
-    struct Queue {
-        // Next ever-been-used queue (worse priority.)
-        Queue *next;
-        // First valid item in data.
-        int first;
-        // One after last valid item in data.
-        int end;
-        // A too-large array with room on the front and end.
-        IdType *data;
-        // Size of data array.
-        int capacity;
-    };
 
     ThreadQueueList() {
-        memset(queues, 0, sizeof(queues));
-        first = invalid();
+        clear();
     }
 
-    ~ThreadQueueList() {
-        for (int i = 0; i < NUM_QUEUES; ++i)
-        {
-            if (queues[i].data != NULL)
-                free(queues[i].data);
-        }
+    // Returns the priority level of an element, -1 if it is not queued.
+    int contains(const T* t) const {
+        const ThreadQueueHook<T>& links = t->*hook;
+        return links.queued ? (int)links.priority : -1;
     }
 
-    // Only for debugging, returns priority level.
-    int contains(const IdType uid) {
-        for (int i = 0; i < NUM_QUEUES; ++i)
-        {
-            if (queues[i].data == NULL)
-                continue;
-
-            Queue *cur = &queues[i];
-            for (int j = cur->first; j < cur->end; ++j)
-            {
-                if (cur->data[j] == uid)
-                    return i;
-            }
-        }
-
-        return -1;
+    // Removes the first element of the best non-empty priority level, NULL if all are empty.
+    inline T* pop_first() {
+        const int priority = first_priority();
+        if (priority == NUM_QUEUES)
+            return NULL;
+        return pop(priority);
     }
 
-    inline IdType pop_first() {
-        Queue *cur = first;
-        while (cur != invalid())
-        {
-            if (cur->end - cur->first > 0)
-                return cur->data[cur->first++];
-            cur = cur->next;
-        }
-
-        //_dbg_assert_msg_(SCEKERNEL, false, "ThreadQueueList should not be empty.");
-        return 0;
+    // Same as pop_first, but only pops an element of a strictly better priority level.
+    inline T* pop_first_better(u32 priority) {
+        const int first = first_priority();
+        if ((u32)first >= priority)
+            return NULL;
+        return pop(first);
     }
 
-    inline IdType pop_first_better(u32 priority) {
-        Queue *cur = first;
-        Queue *stop = &queues[priority];
-        while (cur < stop)
-        {
-            if (cur->end - cur->first > 0)
-                return cur->data[cur->first++];
-            cur = cur->next;
-        }
-
-        return 0;
+    inline void push_front(u32 priority, T* t) {
+        ThreadQueueHook<T>& links = link(priority, t);
+        Queue* cur = &queues[priority];
+        links.prev = NULL;
+        links.next = cur->first;
+        if (cur->first != NULL)
+            (cur->first->*hook).prev = t;
+        else
+            cur->last = t;
+        cur->first = t;
     }
 
-    inline void push_front(u32 priority, const IdType threadID) {
-        Queue *cur = &queues[priority];
-        cur->data[--cur->first] = threadID;
-        if (cur->first == 0)
-            rebalance(priority);
+    inline void push_back(u32 priority, T* t) {
+        ThreadQueueHook<T>& links = link(priority, t);
+        Queue* cur = &queues[priority];
+        links.prev = cur->last;
+        links.next = NULL;
+        if (cur->last != NULL)
+            (cur->last->*hook).next = t;
+        else
+            cur->first = t;
+        cur->last = t;
     }
 
-    inline void push_back(u32 priority, const IdType threadID) {
-        Queue *cur = &queues[priority];
-        cur->data[cur->end++] = threadID;
-        if (cur->end == cur->capacity)
-            rebalance(priority);
-    }
+    // Removes an element from its queue, if it is in one.
+    inline void remove(T* t) {
+        ThreadQueueHook<T>& links = t->*hook;
+        if (!links.queued)
+            return;
 
-    inline void remove(u32 priority, const IdType threadID) {
-        Queue *cur = &queues[priority];
-        //_dbg_assert_msg_(SCEKERNEL, cur->next != NULL, "ThreadQueueList::Queue should already be linked up.");
-
-        for (int i = cur->first; i < cur->end; ++i)
-        {
-            if (cur->data[i] == threadID)
-            {
-                int remaining = --cur->end - i;
-                if (remaining > 0)
-                    memmove(&cur->data[i], &cur->data[i + 1], remaining * sizeof(IdType));
-                return;
-            }
-        }
+        Queue* cur = &queues[links.priority];
+        if (links.prev != NULL)
+            (links.prev->*hook).next = links.next;
+        else
+            cur->first = links.next;
+        if (links.next != NULL)
+            (links.next->*hook).prev = links.prev;
+        else
+            cur->last = links.prev;
 
-        // Wasn't there.
+        if (cur->first == NULL)
+            bitmap[links.priority / 64] &= ~priority_bit(links.priority);
+        links.prev = links.next = NULL;
+        links.queued = false;
     }
 
+    // Moves the first element of a priority level to its end.
     inline void rotate(u32 priority) {
-        Queue *cur = &queues[priority];
-        //_dbg_assert_msg_(SCEKERNEL, cur->next != NULL, "ThreadQueueList::Queue should already be linked up.");
-
-        if (cur->end - cur->first > 1)
-        {
-            cur->data[cur->end++] = cur->data[cur->first++];
-            if (cur->end == cur->capacity)
-                rebalance(priority);
-        }
+        Queue* cur = &queues[priority];
+        if (cur->first != cur->last)
+            push_back(priority, pop(priority));
     }
 
     inline void clear() {
-        for (int i = 0; i < NUM_QUEUES; ++i)
-        {
-            if (queues[i].data != NULL)
-                free(queues[i].data);
-        }
         memset(queues, 0, sizeof(queues));
-        first = invalid();
+        bitmap[0] = bitmap[1] = 0;
     }
 
     inline bool empty(u32 priority) const {
-        const Queue *cur = &queues[priority];
-        return cur->first == cur->end;
-    }
-
-    inline void prepare(u32 priority) {
-        Queue *cur = &queues[priority];
-        if (cur->next == NULL)
-            link(priority, INITIAL_CAPACITY);
+        return queues[priority].first == NULL;
     }
 
 private:
-    Queue *invalid() const {
-        return (Queue *) -1;
-    }
-
-    void link(u32 priority, int size) {
-        //_dbg_assert_msg_(SCEKERNEL, queues[priority].data == NULL, "ThreadQueueList::Queue should only be initialized once.");
+    struct Queue {
+        T* first;
+        T* last;
+    };
 
-        if (size <= INITIAL_CAPACITY)
-            size = INITIAL_CAPACITY;
-        else
-        {
-            int goal = size;
-            size = INITIAL_CAPACITY;
-            while (size < goal)
-                size *= 2;
-        }
-        Queue *cur = &queues[priority];
-        cur->data = (IdType *) malloc(sizeof(IdType) * size);
-        cur->capacity = size;
-        cur->first = size / 2;
-        cur->end = size / 2;
-
-        for (int i = (int) priority - 1; i >= 0; --i)
-        {
-            if (queues[i].next != NULL)
-            {
-                cur->next = queues[i].next;
-                queues[i].next = cur;
-                return;
-            }
-        }
+    // Bit of a priority level in its bitmap word, better levels are more significant.
+    static inline u64 priority_bit(u32 priority) {
+        return 1ULL << (63 - (priority & 63));
+    }
 
-        cur->next = first;
-        first = cur;
+    // Gets the best non-empty priority level, NUM_QUEUES if all are empty.
+    inline int first_priority() const {
+        if (bitmap[0] != 0)
+            return 63 - (int)Log2(bitmap[0]);
+        if (bitmap[1] != 0)
+            return 64 + 63 - (int)Log2(bitmap[1]);
+        return NUM_QUEUES;
     }
 
-    void rebalance(u32 priority) {
-        Queue *cur = &queues[priority];
-        int size = cur->end - cur->first;
-        if (size >= cur->capacity - 2)  {
-            IdType *new_data = (IdType *)realloc(cur->data, cur->capacity * 2 * sizeof(IdType));
-            if (new_data != NULL)  {
-                cur->capacity *= 2;
-                cur->data = new_data;
-            }
-        }
+    // Marks an element as queued at a priority level, whose links are then set up by the caller.
+    inline ThreadQueueHook<T>& link(u32 priority, T* t) {
+        ThreadQueueHook<T>& links = t->*hook;
+        _dbg_assert_msg_(COMMON, priority < NUM_QUEUES && !links.queued,
+            "ThreadQueueList: invalid priority or element already queued");
+        links.priority = priority;
+        links.queued = true;
+        bitmap[priority / 64] |= priority_bit(priority);
+        return links;
+    }
 
-        int newFirst = (cur->capacity - size) / 2;
-        if (newFirst != cur->first) {
-            memmove(&cur->data[newFirst], &cur->data[cur->first], size * sizeof(IdType));
-            cur->first = newFirst;
-            cur->end = newFirst + size;
+    // Removes the first element of a non-empty priority level.
+    inline T* pop(u32 priority) {
+        Queue* cur = &queues[priority];
+        T* t = cur->first;
+        ThreadQueueHook<T>& links = t->*hook;
+        cur->first = links.next;
+        if (links.next != NULL) {
+            (links.next->*hook).prev = NULL;
+        } else {
+            cur->last = NULL;
+            bitmap[priority / 64] &= ~priority_bit(priority);
         }
+        links.next = NULL;
+        links.queued = false;
+        return t;
     }
 
-    // The first queue that's ever been used.
-    Queue *first;
-    // The priority level queues of thread ids.
+    // The priority level queues.
     Queue queues[NUM_QUEUES];
+    // Non-empty priority levels, level 0 being the most significant bit of the first word.
+    u64 bitmap[2];
 };
 
 } // namespace
@@ -14,9 +14,10 @@ class ARM_Interface : NonCopyable {
 public:
     ARM_Interface() {
         num_instructions = 0;
+        down_count = 0;
     }
 
-    ~ARM_Interface() {
+    virtual ~ARM_Interface() {
     }
 
     /**
@@ -25,7 +26,6 @@ public:
      */
     void Run(int num_instructions) {
         ExecuteInstructions(num_instructions);
-        this->num_instructions += num_instructions;
     }
 
     /// Step CPU by one instruction
@@ -94,10 +94,21 @@ public:
         return num_instructions;
     }
 
+    /**
+     * Accounts for instructions that have been executed, called from ExecuteInstructions
+     * @param ticks Number of instructions executed
+     */
+    void AddTicks(int ticks) {
+        num_instructions += ticks;
+        down_count -= ticks;
+    }
+
+    int down_count; ///< Cycles left until the next CoreTiming event is due
+
 protected:
     
     /**
-     * Executes the given number of instructions
+     * Executes the given number of instructions, stopping early if HLE requests a reschedule
      * @param num_instructions Number of instructions to executes
      */
     virtual void ExecuteInstructions(int num_instructions) = 0;
@@ -0,0 +1,253 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include "common/common.h"
+#include "common/file_util.h"
+#include "common/string_util.h"
+#include "common/symbols.h"
+
+#include "core/arm/arm_profiler.h"
+
+namespace Profiler {
+
+enum {
+    LOOKUP_TABLE_BITS           = 12,
+    LOOKUP_TABLE_SIZE           = (1 << LOOKUP_TABLE_BITS),
+    LOOKUP_TABLE_MASK           = (LOOKUP_TABLE_SIZE - 1),
+
+    NUM_REPORTED_BLOCKS         = 100,  ///< Number of blocks listed in the text report
+    NUM_REPORTED_FUNCTIONS      = 50,   ///< Number of functions listed in the text report
+    NUM_REPORTED_INSTRUCTIONS   = 100,  ///< Number of instructions listed in the text report
+};
+
+/// Statistics of the runs of guest code starting at one address
+struct BlockStats {
+    BlockStats() : start(0), runs(0), instructions(0), cycles(0) {
+    }
+
+    u32 start;                      ///< Guest address of the first instruction
+    u64 runs;                       ///< Number of times the block was entered
+    u64 instructions;               ///< Total number of instructions executed
+    u64 cycles;                     ///< Total number of cycles taken
+    std::vector<u64> run_lengths;   ///< run_lengths[n - 1] counts the runs of n instructions
+};
+
+/// Statistics of all blocks contained in one symbol
+struct FunctionStats {
+    FunctionStats() : instructions(0), cycles(0) {
+    }
+
+    std::string name;
+    u64 instructions;
+    u64 cycles;
+};
+
+bool g_enabled = false;
+
+static std::string g_filename;                          ///< Base name of the report files
+static bool g_exit_handler_registered = false;
+static std::map<u32, BlockStats> g_blocks;              ///< All blocks, keyed by start address
+static BlockStats* g_lookup[LOOKUP_TABLE_SIZE];         ///< Direct-mapped cache in front of g_blocks
+
+void RecordBlock(u32 start, int num_instructions, u32 cycles) {
+    if (num_instructions <= 0)
+        return;
+
+    BlockStats*& entry = g_lookup[(start >> 2) & LOOKUP_TABLE_MASK];
+    if (entry == NULL || entry->start != start) {
+        entry = &g_blocks[start];
+        entry->start = start;
+    }
+
+    entry->runs++;
+    entry->instructions += num_instructions;
+    entry->cycles += cycles;
+
+    if (entry->run_lengths.size() < (size_t)num_instructions)
+        entry->run_lengths.resize(num_instructions, 0);
+    entry->run_lengths[num_instructions - 1]++;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Report
+
+/// Formats a guest address as symbol+offset, or an empty string if no symbol contains it
+static std::string Symbolicate(u32 address) {
+    const TSymbol symbol = Symbols::GetSymbolContaining(address);
+    if (symbol.name.empty())
+        return "";
+    if (address == symbol.address)
+        return symbol.name;
+    return StringFromFormat("%s+0x%x", symbol.name.c_str(), address - symbol.address);
+}
+
+static bool CompareBlockCycles(const BlockStats* a, const BlockStats* b) {
+    return a->cycles > b->cycles;
+}
+
+static bool CompareFunctionCycles(const FunctionStats& a, const FunctionStats& b) {
+    return a.cycles > b.cycles;
+}
+
+static bool CompareHits(const std::pair<u32, u64>& a, const std::pair<u32, u64>& b) {
+    return a.second > b.second;
+}
+
+static double Percent(u64 part, u64 total) {
+    return total ? 100.0 * part / total : 0.0;
+}
+
+/// Writes the sorted, human-readable report
+static void WriteTextReport(std::FILE* file, std::vector<const BlockStats*>& blocks,
+    std::vector<std::pair<u32, u64> >& hits) {
+
+    u64 total_instructions = 0;
+    u64 total_cycles = 0;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        total_instructions += blocks[i]->instructions;
+        total_cycles += blocks[i]->cycles;
+    }
+
+    // Blocks outside of any symbol are attributed to themselves
+    std::map<u32, FunctionStats> functions;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        const TSymbol symbol = Symbols::GetSymbolContaining(blocks[i]->start);
+        FunctionStats& function = functions[symbol.name.empty() ? blocks[i]->start :
+            symbol.address];
+        function.name = symbol.name.empty() ? StringFromFormat("(block %08x)", blocks[i]->start) :
+            symbol.name;
+        function.instructions += blocks[i]->instructions;
+        function.cycles += blocks[i]->cycles;
+    }
+    std::vector<FunctionStats> sorted_functions;
+    for (std::map<u32, FunctionStats>::const_iterator it = functions.begin();
+        it != functions.end(); ++it) {
+        sorted_functions.push_back(it->second);
+    }
+    std::sort(sorted_functions.begin(), sorted_functions.end(), CompareFunctionCycles);
+
+    std::fprintf(file, "Total: %llu instructions, %llu cycles in %u blocks\n\n",
+        (unsigned long long)total_instructions, (unsigned long long)total_cycles,
+        (unsigned)blocks.size());
+
+    std::fprintf(file, "Hot functions (by cycles)\n");
+    std::fprintf(file, "%7s %14s %14s  %s\n", "cycles%", "cycles", "instructions", "function");
+    for (size_t i = 0; i < sorted_functions.size() && i < NUM_REPORTED_FUNCTIONS; i++) {
+        const FunctionStats& function = sorted_functions[i];
+        std::fprintf(file, "%6.2f%% %14llu %14llu  %s\n",
+            Percent(function.cycles, total_cycles), (unsigned long long)function.cycles,
+            (unsigned long long)function.instructions, function.name.c_str());
+    }
+
+    std::fprintf(file, "\nHot blocks (by cycles)\n");
+    std::fprintf(file, "%7s %14s %12s %14s %8s  %-8s  %s\n", "cycles%", "cycles", "runs",
+        "instructions", "avg len", "address", "symbol");
+    for (size_t i = 0; i < blocks.size() && i < NUM_REPORTED_BLOCKS; i++) {
+        const BlockStats* block = blocks[i];
+        std::fprintf(file, "%6.2f%% %14llu %12llu %14llu %8.1f  %08x  %s\n",
+            Percent(block->cycles, total_cycles), (unsigned long long)block->cycles,
+            (unsigned long long)block->runs, (unsigned long long)block->instructions,
+            (double)block->instructions / block->runs, block->start,
+            Symbolicate(block->start).c_str());
+    }
+
+    std::fprintf(file, "\nHot instructions (by hits)\n");
+    std::fprintf(file, "%7s %14s  %-8s  %s\n", "instr%", "hits", "address", "symbol");
+    for (size_t i = 0; i < hits.size() && i < NUM_REPORTED_INSTRUCTIONS; i++) {
+        std::fprintf(file, "%6.2f%% %14llu  %08x  %s\n", Percent(hits[i].second,
+            total_instructions), (unsigned long long)hits[i].second, hits[i].first,
+            Symbolicate(hits[i].first).c_str());
+    }
+}
+
+/// Writes all blocks and instructions as CSV, one row each
+static void WriteCSVReport(std::FILE* file, const std::vector<const BlockStats*>& blocks,
+    const std::vector<std::pair<u32, u64> >& hits) {
+
+    std::fprintf(file, "type,address,runs,instructions,cycles,symbol\n");
+    for (size_t i = 0; i < blocks.size(); i++) {
+        const BlockStats* block = blocks[i];
+        std::fprintf(file, "block,0x%08x,%llu,%llu,%llu,%s\n", block->start,
+            (unsigned long long)block->runs, (unsigned long long)block->instructions,
+            (unsigned long long)block->cycles, Symbolicate(block->start).c_str());
+    }
+    for (size_t i = 0; i < hits.size(); i++) {
+        std::fprintf(file, "instruction,0x%08x,%llu,%llu,,%s\n", hits[i].first,
+            (unsigned long long)hits[i].second, (unsigned long long)hits[i].second,
+            Symbolicate(hits[i].first).c_str());
+    }
+}
+
+static void WriteReport() {
+    std::vector<const BlockStats*> blocks;
+    std::map<u32, u64> instruction_hits;
+
+    for (std::map<u32, BlockStats>::const_iterator it = g_blocks.begin(); it != g_blocks.end();
+        ++it) {
+        const BlockStats& block = it->second;
+        blocks.push_back(&block);
+
+        // A run of n instructions hit the first n instructions of the block, so the hits of the
+        // instruction at index i are the number of runs longer than i
+        u64 runs_reaching = 0;
+        for (size_t i = block.run_lengths.size(); i-- > 0;) {
+            runs_reaching += block.run_lengths[i];
+            instruction_hits[block.start + (u32)i * 4] += runs_reaching;
+        }
+    }
+
+    std::sort(blocks.begin(), blocks.end(), CompareBlockCycles);
+    std::vector<std::pair<u32, u64> > hits(instruction_hits.begin(), instruction_hits.end());
+    std::stable_sort(hits.begin(), hits.end(), CompareHits);
+
+    const std::string text_filename = g_filename + ".txt";
+    File::IOFile text_file(text_filename, "w");
+    if (!text_file.IsOpen()) {
+        ERROR_LOG(ARM11, "Failed to open %s for the profiler report", text_filename.c_str());
+        return;
+    }
+    WriteTextReport(text_file.GetHandle(), blocks, hits);
+
+    const std::string csv_filename = g_filename + ".csv";
+    File::IOFile csv_file(csv_filename, "w");
+    if (!csv_file.IsOpen()) {
+        ERROR_LOG(ARM11, "Failed to open %s for the profiler report", csv_filename.c_str());
+        return;
+    }
+    WriteCSVReport(csv_file.GetHandle(), blocks, hits);
+
+    INFO_LOG(ARM11, "Profiler report written to %s and %s", text_filename.c_str(),
+        csv_filename.c_str());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Enable(const std::string& filename) {
+    g_filename = filename;
+    g_enabled = true;
+
+    // The frontends do not always shut the emulator down cleanly, so also report at exit
+    if (!g_exit_handler_registered) {
+        std::atexit(Shutdown);
+        g_exit_handler_registered = true;
+    }
+}
+
+void Shutdown() {
+    if (!g_enabled)
+        return;
+
+    WriteReport();
+
+    g_enabled = false;
+    g_blocks.clear();
+    std::fill(g_lookup, g_lookup + LOOKUP_TABLE_SIZE, (BlockStats*)NULL);
+}
+
+} // namespace
@@ -0,0 +1,54 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+
+#include "common/common_types.h"
+
+#include "core/arm/interpreter/armdefs.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Guest code profiler
+//
+// When enabled, the CPU cores report every run of straight-line guest code they execute (a block
+// from the block cache or the JIT, or a single interpreted instruction) together with the cycles
+// it took. Since a run only ever executes a prefix of its block, keeping a histogram of run
+// lengths per block start is enough to recover exact per-instruction hit counts. The report is
+// symbolicated with the symbols loaded from the ELF or a symbol map, and written as a sorted text
+// file plus a CSV file for further processing.
+
+namespace Profiler {
+
+extern bool g_enabled;  ///< Whether the CPU cores should record the code they execute
+
+/**
+ * Enables profiling, the report is written on shutdown (or at exit)
+ * @param filename Base name of the report files, ".txt" and ".csv" are appended to it
+ */
+void Enable(const std::string& filename = "profile");
+
+/// Writes the report if profiling was enabled, and discards all recorded data
+void Shutdown();
+
+/**
+ * Records a run of guest code
+ * @param start Guest address of the first instruction executed
+ * @param num_instructions Number of consecutive instructions executed, starting at start
+ * @param cycles Number of cycles the instructions took
+ */
+void RecordBlock(u32 start, int num_instructions, u32 cycles);
+
+/**
+ * Gets the total number of emulated cycles an ARM core has accounted for, which is sampled
+ * before and after running guest code to compute the cycles passed to RecordBlock
+ * @param state ARM core state
+ * @return Sum of the cycle counters, wraps around
+ */
+inline u32 GetCycles(const ARMul_State* state) {
+    return state->NumScycles + state->NumNcycles + state->NumIcycles + state->NumCcycles;
+}
+
+} // namespace
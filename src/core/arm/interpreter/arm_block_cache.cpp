@@ -0,0 +1,468 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "common/common.h"
+
+#include "core/core.h"
+#include "core/mem_map.h"
+#include "core/arm/arm_profiler.h"
+#include "core/arm/interpreter/armemu.h"
+#include "core/arm/interpreter/armmmu.h"
+#include "core/arm/interpreter/arm_block_cache.h"
+#include "core/arm/interpreter/arm_decoder.h"
+
+namespace BlockCache {
+
+using namespace ARMDecoder;
+
+enum {
+    LOOKUP_TABLE_BITS   = 14,
+    LOOKUP_TABLE_SIZE   = (1 << LOOKUP_TABLE_BITS),
+    LOOKUP_TABLE_MASK   = (LOOKUP_TABLE_SIZE - 1),
+};
+
+/// A translated basic block, which never crosses a page boundary
+struct Block {
+    u32 start;                      ///< Guest address of the first instruction
+    std::vector<DecodedOp> ops;     ///< Decoded instructions, one per guest instruction
+    bool idle_loop;                 ///< Whether the block is an idle loop (see IsIdleLoop)
+};
+
+static std::map<u32, Block*> g_blocks;          ///< All translated blocks, keyed by start address
+static Block* g_lookup[LOOKUP_TABLE_SIZE];      ///< Direct-mapped lookup cache in front of g_blocks
+static bool g_invalidated = false;              ///< Set when blocks have been freed
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Translation
+
+/**
+ * Translates the basic block starting at a guest address
+ * @param start Guest address of the first instruction
+ * @return The new block, which may contain no instructions
+ */
+static Block* Translate(const u32 start) {
+    Block* block = new Block;
+    block->start = start;
+
+    DecodeBlock(start, block->ops);
+    block->idle_loop = Core::g_detect_idle_loops && IsIdleLoop(start, block->ops);
+
+    g_blocks[start] = block;
+    Memory::WatchPageWrites(start);
+
+    return block;
+}
+
+static inline Block* GetBlock(const u32 addr) {
+    Block*& entry = g_lookup[(addr >> 2) & LOOKUP_TABLE_MASK];
+    if (entry && entry->start == addr)
+        return entry;
+
+    std::map<u32, Block*>::iterator it = g_blocks.find(addr);
+    entry = (it != g_blocks.end()) ? it->second : Translate(addr);
+    return entry;
+}
+
+static void FreeBlock(Block* block) {
+    Block*& entry = g_lookup[(block->start >> 2) & LOOKUP_TABLE_MASK];
+    if (entry == block)
+        entry = NULL;
+
+    Memory::UnwatchPageWrites(block->start);
+    delete block;
+    g_invalidated = true;
+}
+
+/// Write watch callback, invalidates translated code that was written to
+static void OnWatchedWrite(u32 addr, u32 size) {
+    InvalidateRange(addr, size);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Execution
+
+static inline bool ConditionPassed(const ARMul_State* state, const u32 cond) {
+    const bool n = state->NFlag != 0;
+    const bool z = state->ZFlag != 0;
+    const bool c = state->CFlag != 0;
+    const bool v = state->VFlag != 0;
+
+    switch (cond) {
+    case 0x0: return z;                 // EQ
+    case 0x1: return !z;                // NE
+    case 0x2: return c;                 // CS
+    case 0x3: return !c;                // CC
+    case 0x4: return n;                 // MI
+    case 0x5: return !n;                // PL
+    case 0x6: return v;                 // VS
+    case 0x7: return !v;                // VC
+    case 0x8: return c && !z;           // HI
+    case 0x9: return !c || z;           // LS
+    case 0xA: return n == v;            // GE
+    case 0xB: return n != v;            // LT
+    case 0xC: return !z && (n == v);    // GT
+    case 0xD: return z || (n != v);     // LE
+    default:  return true;              // AL
+    }
+}
+
+/// Evaluates an immediate-shifted register operand, optionally computing the shifter carry out
+static inline u32 ShiftedRegister(const ARMul_State* state, const DecodedOp& op, u32* carry_out) {
+    const u32 value = state->Reg[op.rm];
+    const u32 amount = op.shift >> 2;
+
+    switch (op.shift & 3) {
+    case 0: // LSL
+        if (amount == 0)
+            return value;
+        if (carry_out)
+            *carry_out = (value >> (32 - amount)) & 1;
+        return value << amount;
+
+    case 1: // LSR (an amount of 0 encodes 32)
+        if (amount == 0) {
+            if (carry_out)
+                *carry_out = value >> 31;
+            return 0;
+        }
+        if (carry_out)
+            *carry_out = (value >> (amount - 1)) & 1;
+        return value >> amount;
+
+    case 2: // ASR (an amount of 0 encodes 32)
+        if (amount == 0) {
+            if (carry_out)
+                *carry_out = value >> 31;
+            return (u32)((s32)value >> 31);
+        }
+        if (carry_out)
+            *carry_out = (value >> (amount - 1)) & 1;
+        return (u32)((s32)value >> amount);
+
+    default: // ROR (an amount of 0 encodes RRX)
+        if (amount == 0) {
+            const u32 result = (value >> 1) | ((state->CFlag ? 1 : 0) << 31);
+            if (carry_out)
+                *carry_out = value & 1;
+            return result;
+        }
+        if (carry_out)
+            *carry_out = (value >> (amount - 1)) & 1;
+        return RotateRight(value, amount);
+    }
+}
+
+/// Computes a + b + carry_in, setting the NZCV flags if requested
+static inline u32 AddWithCarry(ARMul_State* state, u32 a, u32 b, u32 carry_in, bool set_flags) {
+    const u64 wide = (u64)a + (u64)b + carry_in;
+    const u32 result = (u32)wide;
+    if (set_flags) {
+        state->NFlag = result >> 31;
+        state->ZFlag = (result == 0);
+        state->CFlag = (u32)(wide >> 32);
+        state->VFlag = ((a ^ result) & (b ^ result)) >> 31;
+    }
+    return result;
+}
+
+/**
+ * Executes a data processing instruction
+ * @param state ARM core state
+ * @param op Decoded instruction
+ * @param rhs Second operand
+ * @param shifter_carry Carry out of the second operand's shifter
+ */
+static inline void DataProcessing(ARMul_State* state, const DecodedOp& op, const u32 rhs,
+    const u32 shifter_carry) {
+
+    const u32 lhs = state->Reg[op.rn];
+    const bool set_flags = (op.flags & FLAG_S) != 0;
+    const u32 carry = state->CFlag ? 1 : 0;
+    bool logical = false;
+    u32 result = 0;
+
+    switch (op.opcode) {
+    case DP_AND: result = lhs & rhs; logical = true; break;
+    case DP_EOR: result = lhs ^ rhs; logical = true; break;
+    case DP_SUB: result = AddWithCarry(state, lhs, ~rhs, 1, set_flags); break;
+    case DP_RSB: result = AddWithCarry(state, rhs, ~lhs, 1, set_flags); break;
+    case DP_ADD: result = AddWithCarry(state, lhs, rhs, 0, set_flags); break;
+    case DP_ADC: result = AddWithCarry(state, lhs, rhs, carry, set_flags); break;
+    case DP_SBC: result = AddWithCarry(state, lhs, ~rhs, carry, set_flags); break;
+    case DP_RSC: result = AddWithCarry(state, rhs, ~lhs, carry, set_flags); break;
+    case DP_TST: result = lhs & rhs; logical = true; break;
+    case DP_TEQ: result = lhs ^ rhs; logical = true; break;
+    case DP_CMP: result = AddWithCarry(state, lhs, ~rhs, 1, set_flags); break;
+    case DP_CMN: result = AddWithCarry(state, lhs, rhs, 0, set_flags); break;
+    case DP_ORR: result = lhs | rhs; logical = true; break;
+    case DP_MOV: result = rhs; logical = true; break;
+    case DP_BIC: result = lhs & ~rhs; logical = true; break;
+    case DP_MVN: result = ~rhs; logical = true; break;
+    }
+
+    if (logical && set_flags) {
+        state->NFlag = result >> 31;
+        state->ZFlag = (result == 0);
+        state->CFlag = shifter_carry;
+    }
+    if (op.opcode < DP_TST || op.opcode > DP_CMN)
+        state->Reg[op.rd] = result;
+}
+
+/// Computes the address of a load/store, and updates the base register if needed
+static inline u32 LoadStoreAddress(ARMul_State* state, const DecodedOp& op) {
+    const u32 base = state->Reg[op.rn];
+    const u32 offset_addr = (op.flags & FLAG_UP) ? base + op.imm : base - op.imm;
+
+    if (op.flags & FLAG_WRITEBACK)
+        state->Reg[op.rn] = offset_addr;
+
+    return (op.flags & FLAG_PRE_INDEX) ? offset_addr : base;
+}
+
+bool CanExecute(const ARMul_State* state) {
+    return !state->TFlag && MMU_Disabled && state->space.conf_obj == NULL &&
+        state->Emulate == RUN && !state->EventSet && !state->CallDebug && !state->tea_pc &&
+        state->NresetSig != LOW && (state->NfiqSig || (state->IFFlags & 1)) &&
+        (state->NirqSig || (state->IFFlags >> 1));
+}
+
+int Execute(ARMul_State* state, int num_instructions, bool* idle) {
+    *idle = false;
+    if (!CanExecute(state))
+        return 0;
+
+    // Find the next instruction, as ARMul_Emulate32 would when resuming its pipeline
+    u32 pc = (state->NextInstr < PRIMEPIPE) ? state->pc + 4 : state->Reg[15];
+
+    int executed = 0;
+    bool branched = false;
+    u32 last_pc = 0;
+
+    while (executed < num_instructions) {
+        const Block* block = GetBlock(pc);
+        if (block->ops.empty())
+            break;
+
+        const int count = std::min<int>((int)block->ops.size(), num_instructions - executed);
+        const DecodedOp* const begin = &block->ops[0];
+        const DecodedOp* const end = begin + count;
+        const DecodedOp* op = begin;
+        const bool idle_loop = block->idle_loop;
+        const u32 start = pc;
+        const u32 cycles_before = Profiler::GetCycles(state);
+        u32 addr = pc;
+
+        g_invalidated = false;
+        branched = false;
+
+#if defined(__GNUC__)
+        static const void* const dispatch_table[NUM_OP_TYPES] = {
+            &&op_dp_imm, &&op_dp_reg, &&op_mov_imm, &&op_mov_reg, &&op_add_imm, &&op_sub_imm,
+            &&op_cmp_imm, &&op_cmp_reg, &&op_ldr, &&op_ldrb, &&op_str, &&op_strb, &&op_b, &&op_bl,
+        };
+#define HANDLER(label, type) label
+#define DISPATCH() goto *dispatch_table[op->type]
+#else
+#define HANDLER(label, type) case type
+#define DISPATCH() goto dispatch
+#endif
+
+#define NEXT_OP()                                                                       \
+        do {                                                                            \
+            ++op;                                                                       \
+            if (op == end)                                                              \
+                goto block_done;                                                        \
+            addr += 4;                                                                  \
+            state->Reg[15] = addr + 8;                                                  \
+            if (op->cond != COND_AL && !ConditionPassed(state, op->cond))               \
+                goto skip_op;                                                           \
+            DISPATCH();                                                                 \
+        } while (0)
+
+        state->Reg[15] = addr + 8;
+        if (op->cond != COND_AL && !ConditionPassed(state, op->cond))
+            goto skip_op;
+        DISPATCH();
+
+#if !defined(__GNUC__)
+dispatch:
+        switch (op->type) {
+#endif
+        HANDLER(op_dp_imm, OP_DP_IMM):
+            DataProcessing(state, *op, op->imm,
+                (op->flags & FLAG_IMM_CARRY) ? (op->imm >> 31) : (state->CFlag ? 1 : 0));
+            NEXT_OP();
+
+        HANDLER(op_dp_reg, OP_DP_REG):
+        {
+            u32 carry = state->CFlag ? 1 : 0;
+            const u32 rhs = ShiftedRegister(state, *op, (op->flags & FLAG_S) ? &carry : NULL);
+            DataProcessing(state, *op, rhs, carry);
+            NEXT_OP();
+        }
+
+        HANDLER(op_mov_imm, OP_MOV_IMM):
+            state->Reg[op->rd] = op->imm;
+            NEXT_OP();
+
+        HANDLER(op_mov_reg, OP_MOV_REG):
+            state->Reg[op->rd] = state->Reg[op->rm];
+            NEXT_OP();
+
+        HANDLER(op_add_imm, OP_ADD_IMM):
+            state->Reg[op->rd] = state->Reg[op->rn] + op->imm;
+            NEXT_OP();
+
+        HANDLER(op_sub_imm, OP_SUB_IMM):
+            state->Reg[op->rd] = state->Reg[op->rn] - op->imm;
+            NEXT_OP();
+
+        HANDLER(op_cmp_imm, OP_CMP_IMM):
+            AddWithCarry(state, state->Reg[op->rn], ~op->imm, 1, true);
+            NEXT_OP();
+
+        HANDLER(op_cmp_reg, OP_CMP_REG):
+            AddWithCarry(state, state->Reg[op->rn], ~state->Reg[op->rm], 1, true);
+            NEXT_OP();
+
+        HANDLER(op_ldr, OP_LDR):
+        {
+            const u32 address = LoadStoreAddress(state, *op);
+            u32 value = Memory::Read32(address);
+            if (address & 3)
+                value = ARMul_Align(state, address, value);
+            state->Reg[op->rd] = value;
+            state->NumNcycles++;
+            state->NumIcycles++;
+            NEXT_OP();
+        }
+
+        HANDLER(op_ldrb, OP_LDRB):
+            state->Reg[op->rd] = Memory::Read8(LoadStoreAddress(state, *op));
+            state->NumNcycles++;
+            state->NumIcycles++;
+            NEXT_OP();
+
+        HANDLER(op_str, OP_STR):
+        {
+            const u32 value = state->Reg[op->rd];
+            Memory::Write32(LoadStoreAddress(state, *op), value);
+            state->NumNcycles++;
+            // The store may have invalidated the block being executed
+            if (g_invalidated) {
+                ++op;
+                goto block_done;
+            }
+            NEXT_OP();
+        }
+
+        HANDLER(op_strb, OP_STRB):
+        {
+            const u32 value = state->Reg[op->rd];
+            Memory::Write8(LoadStoreAddress(state, *op), (u8)value);
+            state->NumNcycles++;
+            if (g_invalidated) {
+                ++op;
+                goto block_done;
+            }
+            NEXT_OP();
+        }
+
+        HANDLER(op_bl, OP_BL):
+            state->Reg[14] = addr + 4;
+            // Fall through
+
+        HANDLER(op_b, OP_B):
+            pc = op->imm;
+            branched = true;
+            ++op;
+            goto block_done;
+
+#if !defined(__GNUC__)
+        }
+#endif
+
+skip_op:
+        NEXT_OP();
+
+block_done:
+        // Note that the block itself may have been freed by a store at this point
+        executed += (int)(op - begin);
+        last_pc = addr;
+
+        // The cycles of the instructions themselves are only added once all blocks are done
+        if (Profiler::g_enabled) {
+            Profiler::RecordBlock(start, (int)(op - begin),
+                Profiler::GetCycles(state) - cycles_before + (u32)(op - begin));
+        }
+
+#undef NEXT_OP
+#undef DISPATCH
+#undef HANDLER
+
+        // Taken branches continue in the target block, anything else needs the interpreter
+        if (!branched)
+            break;
+
+        // Stop after one iteration of an idle loop (which only branches back to itself), so
+        // that the caller can skip the rest
+        if (idle_loop) {
+            *idle = true;
+            break;
+        }
+    }
+
+    if (executed == 0)
+        return 0;
+
+    state->NumInstrs += executed;
+    state->NumNcycles += executed;
+    state->pc = last_pc;
+
+    if (branched) {
+        state->Reg[15] = pc;
+        state->NextInstr = RESUME;
+    } else {
+        state->Reg[15] = last_pc + 8;
+        state->NextInstr = SEQ;
+    }
+    return executed;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void InvalidateRange(u32 addr, u32 size) {
+    const u32 start = addr & ~Memory::PAGE_MASK;
+    const u64 end = ((u64)addr + size + Memory::PAGE_MASK) & ~(u64)Memory::PAGE_MASK;
+
+    std::map<u32, Block*>::iterator it = g_blocks.lower_bound(start);
+    while (it != g_blocks.end() && it->first < end) {
+        FreeBlock(it->second);
+        g_blocks.erase(it++);
+    }
+}
+
+void Clear() {
+    for (std::map<u32, Block*>::iterator it = g_blocks.begin(); it != g_blocks.end(); ++it) {
+        FreeBlock(it->second);
+    }
+    g_blocks.clear();
+}
+
+void Init() {
+    memset(g_lookup, 0, sizeof(g_lookup));
+    Memory::RegisterWriteWatchCallback(OnWatchedWrite);
+}
+
+void Shutdown() {
+    Clear();
+    Memory::UnregisterWriteWatchCallback(OnWatchedWrite);
+}
+
+} // namespace
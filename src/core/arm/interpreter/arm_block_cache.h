@@ -0,0 +1,59 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+
+#include "core/arm/interpreter/armdefs.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Basic block cache for the ARM interpreter
+//
+// Straight-line runs of common ARM instructions (data processing with immediate or immediate-
+// shifted register operands, word/byte loads and stores with immediate offsets, and B/BL) are
+// decoded once per basic block into an array of DecodedOps, which are then executed with threaded
+// dispatch. Any other instruction ends the block and is left to ARMul_Emulate32.
+//
+// Blocks are only used while the core is in ARM state with the MMU disabled, which is always the
+// case for HLE. Pages containing translated code are write-watched, and blocks are invalidated
+// when the guest writes to them.
+
+namespace BlockCache {
+
+/// Initialize the block cache
+void Init();
+
+/// Shutdown the block cache, freeing all translated blocks
+void Shutdown();
+
+/// Frees all translated blocks
+void Clear();
+
+/**
+ * Invalidates all blocks in the pages overlapping a guest address range
+ * @param addr Start address of the range
+ * @param size Size of the range in bytes
+ */
+void InvalidateRange(u32 addr, u32 size);
+
+/**
+ * Checks whether translated blocks can be used for the current state of an ARM core
+ * @param state ARM core state to check
+ * @return True if the core is in ARM state, with the MMU disabled and no pending exceptions
+ */
+bool CanExecute(const ARMul_State* state);
+
+/**
+ * Executes instructions from translated blocks, starting at the next instruction of the given
+ * ARM core state, until an instruction that must be handled by the interpreter or an idle loop
+ * is reached.
+ * @param state ARM core state to execute on
+ * @param num_instructions Maximum number of instructions to execute
+ * @param idle Set to true if execution stopped after an iteration of an idle loop
+ * @return Number of instructions executed, 0 if the next instruction needs the interpreter
+ */
+int Execute(ARMul_State* state, int num_instructions, bool* idle);
+
+} // namespace
@@ -0,0 +1,183 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include "common/common.h"
+
+#include "core/mem_map.h"
+#include "core/arm/interpreter/arm_decoder.h"
+
+namespace ARMDecoder {
+
+bool Decode(u32 instr, u32 addr, DecodedOp& op) {
+    const u32 cond = instr >> 28;
+    const u32 rd = (instr >> 12) & 0xF;
+    const u32 rn = (instr >> 16) & 0xF;
+
+    if (cond == 0xF)
+        return false;
+
+    op.cond     = cond;
+    op.flags    = 0;
+    op.opcode   = 0;
+    op.rd       = rd;
+    op.rn       = rn;
+    op.rm       = instr & 0xF;
+    op.shift    = 0;
+    op.imm      = 0;
+
+    switch ((instr >> 25) & 7) {
+    case 0: // Data processing, register operand
+    case 1: // Data processing, immediate operand
+    {
+        const bool immediate = (instr >> 25) & 1;
+        const u32 opcode = (instr >> 21) & 0xF;
+        const bool set_flags = (instr >> 20) & 1;
+
+        // Register-shifted registers, multiplies and extra load/stores
+        if (!immediate && (instr & 0x10))
+            return false;
+        // Test and compare opcodes without S encode MRS, MSR and friends
+        if (opcode >= DP_TST && opcode <= DP_CMN && !set_flags)
+            return false;
+        // Anything that writes to the PC changes control flow (or restores the CPSR)
+        if (rd == 15)
+            return false;
+
+        op.opcode = opcode;
+        op.flags = set_flags ? FLAG_S : 0;
+
+        if (immediate) {
+            const u32 rotate = ((instr >> 8) & 0xF) * 2;
+            op.imm = RotateRight(instr & 0xFF, rotate);
+            if (rotate)
+                op.flags |= FLAG_IMM_CARRY;
+
+            if (!set_flags && opcode == DP_MOV)
+                op.type = OP_MOV_IMM;
+            else if (!set_flags && opcode == DP_ADD)
+                op.type = OP_ADD_IMM;
+            else if (!set_flags && opcode == DP_SUB)
+                op.type = OP_SUB_IMM;
+            else if (opcode == DP_CMP)
+                op.type = OP_CMP_IMM;
+            else
+                op.type = OP_DP_IMM;
+        } else {
+            op.shift = (instr >> 5) & 0x7F;
+
+            if (!set_flags && opcode == DP_MOV && op.shift == 0)
+                op.type = OP_MOV_REG;
+            else if (opcode == DP_CMP && op.shift == 0)
+                op.type = OP_CMP_REG;
+            else
+                op.type = OP_DP_REG;
+        }
+        return true;
+    }
+
+    case 2: // Load/store word or byte, immediate offset
+    {
+        const bool pre_index = (instr >> 24) & 1;
+        const bool writeback = !pre_index || ((instr >> 21) & 1);
+
+        // Loads to the PC are branches
+        if (rd == 15)
+            return false;
+        // Post-indexed with W set are the user mode LDRT/STRT variants
+        if (!pre_index && ((instr >> 21) & 1))
+            return false;
+        // Writeback to the PC, or to the transfer register, is unpredictable
+        if (writeback && (rn == 15 || rn == rd))
+            return false;
+
+        op.imm = instr & 0xFFF;
+        op.flags = (pre_index ? FLAG_PRE_INDEX : 0) | (((instr >> 23) & 1) ? FLAG_UP : 0) |
+            (writeback ? FLAG_WRITEBACK : 0);
+
+        const bool byte = (instr >> 22) & 1;
+        if ((instr >> 20) & 1)
+            op.type = byte ? OP_LDRB : OP_LDR;
+        else
+            op.type = byte ? OP_STRB : OP_STR;
+        return true;
+    }
+
+    case 5: // Branch and branch with link
+    {
+        const s32 offset = ((s32)(instr << 8)) >> 6;
+        op.imm = addr + 8 + offset;
+        op.type = ((instr >> 24) & 1) ? OP_BL : OP_B;
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+void DecodeBlock(u32 start, std::vector<DecodedOp>& ops) {
+    // Only RAM is decoded, anything else (e.g. MMIO) is left to the interpreter
+    if (Memory::g_page_pointers[start >> Memory::PAGE_BITS] == NULL)
+        return;
+
+    u32 addr = start;
+    do {
+        DecodedOp op;
+        if (!Decode(Memory::Read32(addr), addr, op))
+            break;
+
+        ops.push_back(op);
+        addr += 4;
+
+        if (op.type == OP_B || op.type == OP_BL)
+            break;
+    } while (ops.size() < MAX_BLOCK_OPS && (addr & Memory::PAGE_MASK) != 0);
+}
+
+bool IsIdleLoop(u32 start, const std::vector<DecodedOp>& ops) {
+    if (ops.empty() || ops.back().type != OP_B || ops.back().imm != start)
+        return false;
+
+    u32 written_regs = 0;       // Registers loaded or set by the loop
+    u32 address_regs = 0;       // Registers used to compute load addresses
+
+    for (size_t i = 0; i + 1 < ops.size(); i++) {
+        const DecodedOp& op = ops[i];
+        switch (op.type) {
+        case OP_LDR:
+        case OP_LDRB:
+            if (!(op.flags & FLAG_PRE_INDEX) || (op.flags & FLAG_WRITEBACK) || op.rd == 15)
+                return false;
+            written_regs |= 1 << op.rd;
+            address_regs |= 1 << op.rn;
+            break;
+
+        case OP_MOV_IMM:
+            if (op.rd == 15)
+                return false;
+            written_regs |= 1 << op.rd;
+            break;
+
+        case OP_CMP_IMM:
+        case OP_CMP_REG:
+            break;
+
+        case OP_DP_IMM:
+        case OP_DP_REG:
+            // Only comparisons, which just set the condition codes
+            if (op.opcode < DP_TST || op.opcode > DP_CMN)
+                return false;
+            break;
+
+        default:
+            return false;
+        }
+    }
+
+    // Each iteration must load from the same addresses, so that the loop only ends when
+    // something else changes memory
+    return (written_regs & address_regs) == 0;
+}
+
+} // namespace
@@ -0,0 +1,101 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <vector>
+
+#include "common/common_types.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Decoder for the subset of ARM instructions handled by the block cache and the JIT
+
+namespace ARMDecoder {
+
+enum {
+    MAX_BLOCK_OPS       = 64,       ///< Maximum number of instructions decoded per block
+    COND_AL             = 0xE,
+};
+
+/// Kinds of decoded instructions
+enum OpType {
+    OP_DP_IMM = 0,      ///< Any data processing instruction with an immediate operand
+    OP_DP_REG,          ///< Any data processing instruction with an immediate-shifted register
+    OP_MOV_IMM,         ///< MOV Rd, #imm
+    OP_MOV_REG,         ///< MOV Rd, Rm
+    OP_ADD_IMM,         ///< ADD Rd, Rn, #imm
+    OP_SUB_IMM,         ///< SUB Rd, Rn, #imm
+    OP_CMP_IMM,         ///< CMP Rn, #imm
+    OP_CMP_REG,         ///< CMP Rn, Rm
+    OP_LDR,             ///< LDR Rd, [Rn, #imm] (all addressing modes except LDRT)
+    OP_LDRB,            ///< LDRB Rd, [Rn, #imm] (all addressing modes except LDRBT)
+    OP_STR,             ///< STR Rd, [Rn, #imm] (all addressing modes except STRT)
+    OP_STRB,            ///< STRB Rd, [Rn, #imm] (all addressing modes except STRBT)
+    OP_B,               ///< B label
+    OP_BL,              ///< BL label
+    NUM_OP_TYPES
+};
+
+/// Data processing opcodes (bits 21-24 of the instruction)
+enum DPOpcode {
+    DP_AND = 0, DP_EOR, DP_SUB, DP_RSB, DP_ADD, DP_ADC, DP_SBC, DP_RSC,
+    DP_TST, DP_TEQ, DP_CMP, DP_CMN, DP_ORR, DP_MOV, DP_BIC, DP_MVN,
+};
+
+enum OpFlags {
+    FLAG_S              = (1 << 0),     ///< Data processing: set condition codes
+    FLAG_IMM_CARRY      = (1 << 1),     ///< Data processing: rotated immediate sets C to bit 31
+    FLAG_PRE_INDEX      = (1 << 2),     ///< Load/store: offset is applied before the access
+    FLAG_UP             = (1 << 3),     ///< Load/store: offset is added to the base
+    FLAG_WRITEBACK      = (1 << 4),     ///< Load/store: base register is updated
+};
+
+/// A pre-decoded ARM instruction
+struct DecodedOp {
+    u8  type;           ///< OpType of the instruction
+    u8  cond;           ///< Condition code
+    u8  opcode;         ///< Data processing opcode (DPOpcode)
+    u8  flags;          ///< OpFlags
+    u8  rd;             ///< Destination (or source for stores) register
+    u8  rn;             ///< First operand (or base) register
+    u8  rm;             ///< Second operand register
+    u8  shift;          ///< Shift type (bits 0-1) and immediate shift amount (bits 2-6) for Rm
+    u32 imm;            ///< Immediate operand, load/store offset or branch target
+};
+
+/// Rotates a 32-bit value right by 0-31 bits
+inline u32 RotateRight(u32 value, u32 amount) {
+    return amount ? (value >> amount) | (value << (32 - amount)) : value;
+}
+
+/**
+ * Decodes an ARM instruction into a DecodedOp, if it is one of the supported encodings
+ * @param instr Instruction word
+ * @param addr Guest address of the instruction
+ * @param op DecodedOp to fill in
+ * @return True if the instruction was decoded, false if it must be handled by the interpreter
+ */
+bool Decode(u32 instr, u32 addr, DecodedOp& op);
+
+/**
+ * Decodes the basic block starting at a guest address. Blocks end after a branch, before the
+ * first unsupported instruction, at a page boundary or after MAX_BLOCK_OPS instructions.
+ * @param start Guest address of the first instruction
+ * @param ops Vector to append the decoded instructions to, left empty if the first instruction
+ *            is not supported or the address is not backed by RAM
+ */
+void DecodeBlock(u32 start, std::vector<DecodedOp>& ops);
+
+/**
+ * Checks whether a decoded block is an idle loop, i.e. a loop that branches back to its own start
+ * and only loads from memory and compares values. Such loops can only exit after another thread
+ * or the hardware changes memory, so the time spent in them can be skipped. The CPU cores only
+ * check for them if Core::g_detect_idle_loops is set.
+ * @param start Guest address of the first instruction
+ * @param ops Decoded instructions of the block
+ * @return True if the block is an idle loop
+ */
+bool IsIdleLoop(u32 start, const std::vector<DecodedOp>& ops);
+
+} // namespace
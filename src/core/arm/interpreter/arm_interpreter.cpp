@@ -2,13 +2,20 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.  
 
+#include <algorithm>
+
+#include "core/arm/arm_profiler.h"
 #include "core/arm/interpreter/arm_interpreter.h"
+#include "core/arm/interpreter/arm_block_cache.h"
+#include "core/arm/interpreter/arm_decoder.h"
+#include "core/core_timing.h"
+#include "core/hle/hle.h"
 
 const static cpu_config_t s_arm11_cpu_info = {
     "armv6", "arm11", 0x0007b000, 0x0007f000, NONCACHE
 };
 
-ARM_Interpreter::ARM_Interpreter()  {
+ARM_Interpreter::ARM_Interpreter(bool use_block_cache) : use_block_cache(use_block_cache) {
     state = new ARMul_State;
 
     ARMul_EmulateInit();
@@ -32,6 +39,7 @@ ARM_Interpreter::ARM_Interpreter()  {
 }
 
 ARM_Interpreter::~ARM_Interpreter() {
+    mmu_exit(state);
     delete state;
 }
 
@@ -98,14 +106,55 @@ u64 ARM_Interpreter::GetTicks() const {
  * @param num_instructions Number of instructions to executes
  */
 void ARM_Interpreter::ExecuteInstructions(int num_instructions) {
-    state->NumInstrsToExecute = num_instructions;
+    while (num_instructions > 0 && down_count > 0 && !HLE::g_reschedule) {
+        int executed;
+        if (!use_block_cache || !BlockCache::CanExecute(state)) {
+            // Interpret in short batches, so that the block cache is used again soon after
+            // switching back to ARM mode and rescheduling requests are noticed in time. The
+            // profiler needs to see every instruction, which may not be consecutive in a batch.
+            if (Profiler::g_enabled && use_block_cache) {
+                InterpretProfiled();
+                executed = 1;
+            } else {
+                executed = std::min<int>(num_instructions, ARMDecoder::MAX_BLOCK_OPS);
+                state->NumInstrsToExecute = executed - 1;
+                ARMul_Emulate32(state);
+            }
+        } else {
+            bool idle;
+            executed = BlockCache::Execute(state, num_instructions, &idle);
+            if (executed == 0) {
+                // The next instruction is not supported by the block cache, interpret it
+                if (Profiler::g_enabled) {
+                    InterpretProfiled();
+                } else {
+                    state->NumInstrsToExecute = 0;
+                    ARMul_Emulate32(state);
+                }
+                executed = 1;
+            }
+            if (idle) {
+                // Nothing will happen until the next event, skip ahead to it
+                std::lock_guard<std::recursive_mutex> lock(HLE::g_mutex);
+                CoreTiming::Idle();
+            }
+        }
+        num_instructions -= executed;
+        AddTicks(executed);
+    }
+}
+
+void ARM_Interpreter::InterpretProfiled() {
+    const u32 cycles_before = Profiler::GetCycles(state);
+    state->NumInstrsToExecute = 0;
     ARMul_Emulate32(state);
+    // ARMul_Emulate32 leaves the address of the last instruction executed in pc
+    Profiler::RecordBlock(state->pc, 1, Profiler::GetCycles(state) - cycles_before);
 }
 
 /**
  * Saves the current CPU context
- * @param ctx Thread context to save
- * @todo Do we need to save Reg[15] and NextInstr?
+ * @param ctx Thread context to save, with the address of the next instruction to execute as pc
  */
 void ARM_Interpreter::SaveContext(ThreadContext& ctx) {
     memcpy(ctx.cpu_registers, state->Reg, sizeof(ctx.cpu_registers));
@@ -113,7 +162,12 @@ void ARM_Interpreter::SaveContext(ThreadContext& ctx) {
 
     ctx.sp = state->Reg[13];
     ctx.lr = state->Reg[14];
-    ctx.pc = state->pc;
+    // pc is the last instruction executed, which must not run again when the context is loaded:
+    // that would repeat an SVC that made the thread wait
+    if (state->NextInstr < PRIMEPIPE)
+        ctx.pc = state->pc + (state->TFlag ? 2 : 4);
+    else
+        ctx.pc = state->Reg[15];
     ctx.cpsr = state->Cpsr;
 
     ctx.fpscr = state->VFP[1];
@@ -13,7 +13,12 @@
 class ARM_Interpreter : virtual public ARM_Interface {
 public:
 
-    ARM_Interpreter();
+    /**
+     * Constructs an interpreter core
+     * @param use_block_cache Whether to run guest code from the shared BlockCache, which must be
+     *        false for cores that run on another host thread than the application core
+     */
+    ARM_Interpreter(bool use_block_cache = true);
     ~ARM_Interpreter();
 
     /**
@@ -80,8 +85,13 @@ protected:
      */
     void ExecuteInstructions(int num_instructions);
 
-private:
+    /// Interprets the next instruction, recording it with the profiler
+    void InterpretProfiled();
 
     ARMul_State* state;
 
+private:
+
+    bool use_block_cache;   ///< Whether guest code may be run from the shared BlockCache
+
 };
@@ -302,13 +302,14 @@ extern int (*ui_loop_hook) (int);
 //AJ2D--------------------------------------------------------------------------
 
 //Diff register
-unsigned int mirror_register_file[39];
+THREAD_LOCAL unsigned int mirror_register_file[39];
 
 /* EMULATION of ARM6.  */
 
 /* The PC pipeline value depends on whether ARM
-   or Thumb instructions are being executed.  */
-ARMword isize;
+   or Thumb instructions are being executed. Thread-local, as each core may run on its own
+   host thread.  */
+THREAD_LOCAL ARMword isize;
 
 extern int debugmode;
 int ARMul_ICE_debug(ARMul_State *state,ARMword instr,ARMword addr);
@@ -4550,6 +4551,10 @@ ARMul_Emulate26 (ARMul_State * state)
                 //}
                 HLE::CallSVC(instr);
                 ARMul_Abort (state, ARMul_SWIV);
+                // End the batch if the SVC made the thread wait or switched threads, so that
+                // the caller reschedules before running any more of its instructions
+                if (HLE::g_reschedule)
+                    state->NumInstrsToExecute = 0;
                 break;
             }
         }
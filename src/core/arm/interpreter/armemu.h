@@ -21,7 +21,7 @@
 #include "core/arm/interpreter/skyeye_defs.h"
 #include "core/arm/interpreter/armdefs.h"
 
-extern ARMword isize;
+extern THREAD_LOCAL ARMword isize;
 
 /* Condition code values.  */
 #define EQ 0
@@ -195,6 +195,7 @@ typedef struct mmu_state_t
 	ARMword translation_table_base0;
 	ARMword translation_table_base1;
 	ARMword translation_table_ctrl;
+	tlb_s tlb;		/* unified TLB */
 /* arm1176 end */
 
 	ARMword domain_access_control;
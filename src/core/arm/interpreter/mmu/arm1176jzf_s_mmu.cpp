@@ -60,6 +60,10 @@ static inline void insert_tlb(ARMul_State* state, ARMword va, ARMword pa){
     return;
 }
 #endif
+#define ARM1176_TLB() (&state->mmu.tlb)
+#define ARM1176_TLB_ENTRIES 512
+#define CURRENT_ASID() (state->mmu.context_id & 0xFF)
+
 #define BANK0_START 0x50000000
 static void* mem_ptr = NULL;
 
@@ -105,6 +109,14 @@ static void remove_exclusive(ARMul_State* state, ARMword addr){
     state->exclusive_tag_array[0] = 0xFFFFFFFF;
 }
 
+/* Whether permissions are checked for user mode, fast TLB entries are kept apart for it */
+static inline int
+is_user_mode (ARMul_State *state)
+{
+    return (state->Mode == USER32MODE) || (state->Mode == USER26MODE) ||
+        (state->Mode == SYSTEM32MODE);
+}
+
 /* This function encodes table 8-2 Interpreting AP bits,
    returning non-zero if access is allowed. */
 static int
@@ -117,7 +129,7 @@ check_perms (ARMul_State *state, int ap, int read)
     /* chy 2006-02-15 , should consider system mode, don't conside 26bit mode */
 //    printf("ap is %x, user is %x, s is %x, read is %x\n", ap, user, s, read);
 //    printf("mode is %x\n", state->Mode);
-    user = (state->Mode == USER32MODE) || (state->Mode == USER26MODE) || (state->Mode == SYSTEM32MODE);
+    user = is_user_mode (state);
 
     switch (ap) {
     case 0:
@@ -212,11 +224,11 @@ fault_t
 mmu_translate (ARMul_State *state, ARMword virt_addr, ARMword *phys_addr)
 #endif
 
-/*  ap: AP bits value.
- *  sop: section or page description  0:section 1:page
+/*  Walks the translation tables for virt_addr, describing its mapping in entry.
+ *  entry->perms: AP bits value.
  */
 fault_t
-mmu_translate (ARMul_State *state, ARMword virt_addr, ARMword *phys_addr, int *ap, int *sop)
+mmu_translate (ARMul_State *state, ARMword virt_addr, tlb_entry_t *entry)
 {
     {
         /* walk the translation tables */
@@ -270,29 +282,30 @@ mmu_translate (ARMul_State *state, ARMword virt_addr, ARMword *phys_addr, int *a
                     l2desc = Memory::Read32(l2addr); //mem_read_raw(32, l2addr, &l2desc);
                     
                 /* chy 2003-09-02 for xscale */
-                *ap = (l2desc >> 4) & 0x3;
-                *sop = 1;    /* page */
+                entry->perms = (l2desc >> 4) & 0x3;
+                entry->global = !(l2desc & 0x800);    /* nG */
 
                 switch (l2desc & 3) {
                 case 0:
                     return PAGE_TRANSLATION_FAULT;
                     break;
                 case 1:
-                    *phys_addr = (l2desc & 0xFFFF0000) | (virt_addr & 0x0000FFFF);
+                    entry->mapping = TLB_LARGEPAGE;
                     break;
                 case 2:
                 case 3:
-                    *phys_addr = (l2desc & 0xFFFFF000) | (virt_addr & 0x00000FFF);
+                    entry->mapping = TLB_SMALLPAGE;
                     break;
 
                 }
+                entry->phys_addr = l2desc;
             }
             break;
         case 2:
             /* section */
 
-            *ap = (l1desc >> 10) & 3;
-            *sop = 0;     /* section */
+            entry->perms = (l1desc >> 10) & 3;
+            entry->global = !(l1desc & 0x20000);    /* nG */
             #if 0
             if (virt_addr == 0xc000d2bc) {
                     printf("mmu_control is %x\n", state->mmu.translation_table_ctrl);
@@ -300,19 +313,57 @@ mmu_translate (ARMul_State *state, ARMword virt_addr, ARMword *phys_addr, int *a
                     printf("mmu_table_1 is %x\n", state->mmu.translation_table_base1);
                     printf("l1addr is %x l1desc is %x\n", l1addr, l1desc);
 //                    printf("l2addr is %x l2desc is %x\n", l2addr, l2desc);
-                    printf("ap is %x, sop is %x\n", *ap, *sop);
+                    printf("ap is %x\n", entry->perms);
                     printf("mode is %d\n", state->Mode);
 //                      exit(-1);
             }
             #endif
 
-            if (l1desc & 0x30000)
-                *phys_addr = (l1desc & 0xFF000000) | (virt_addr & 0x00FFFFFF);
+            if (l1desc & 0x40000)
+                entry->mapping = TLB_SUPERSECTION;
             else
-                *phys_addr = (l1desc & 0xFFF00000) | (virt_addr & 0x000FFFFF);
+                entry->mapping = TLB_SECTION;
+            entry->phys_addr = l1desc;
             break;
         }
+        entry->virt_addr = virt_addr & tlb_masks[entry->mapping];
+        entry->phys_addr &= tlb_masks[entry->mapping];
+        entry->domain = (l1desc >> 5) & 0xF;
+        entry->asid = CURRENT_ASID ();
+    }
+    return NO_FAULT;
+}
+
+/* Translates va for an access through the TLB, and checks the access permissions */
+static fault_t
+mmu_translate_access (ARMul_State *state, ARMword va, tlb_access_t type, ARMword *pa)
+{
+    tlb_s *tlb_t = ARM1176_TLB ();
+    const int user = is_user_mode (state);
+    tlb_entry_t *tlb;
+
+    if (tlb_fast_lookup (tlb_t, type, va, user, pa))
+        return NO_FAULT;
+
+    tlb = mmu_tlb_search_asid (tlb_t, va, CURRENT_ASID ());
+    if (!tlb) {
+        tlb_entry_t entry;
+        fault_t fault = mmu_translate (state, va, &entry);
+        if (fault)
+            return fault;
+        tlb = mmu_tlb_insert (tlb_t, va, &entry);
+    }
+
+    if (!check_perms (state, tlb->perms, type != TLB_WRITE)) {
+        if (tlb->mapping == TLB_SECTION || tlb->mapping == TLB_SUPERSECTION) {
+            return SECTION_PERMISSION_FAULT;
+        } else {
+            return SUBPAGE_PERMISSION_FAULT;
+        }
     }
+
+    *pa = tlb_va_to_pa (tlb, va);
+    mmu_tlb_insert_fast (tlb_t, type, va, user, *pa);
     return NO_FAULT;
 }
 
@@ -333,7 +384,10 @@ arm1176jzf_s_mmu_init (ARMul_State *state)
     state->mmu.process_id = 0;
     state->mmu.context_id = 0;
     state->mmu.thread_uro_id = 0;
-    //invalidate_all_tlb(state);
+    if (mmu_tlb_init (ARM1176_TLB (), ARM1176_TLB_ENTRIES)) {
+        ERROR_LOG(ARM11, "tlb init %d\n", -1);
+        return -1;
+    }
 
     return No_exp;
 }
@@ -341,6 +395,7 @@ arm1176jzf_s_mmu_init (ARMul_State *state)
 void
 arm1176jzf_s_mmu_exit (ARMul_State *state)
 {
+    mmu_tlb_exit (ARM1176_TLB ());
 }
 
 
@@ -351,7 +406,6 @@ arm1176jzf_s_mmu_load_instr (ARMul_State *state, ARMword va, ARMword *instr)
     int c;            /* cache bit */
     ARMword pa;        /* physical addr */
     ARMword perm;        /* physical addr access permissions */
-    int ap, sop;
 
     static int debug_count = 0;    /* used for debug */
 
@@ -368,24 +422,14 @@ arm1176jzf_s_mmu_load_instr (ARMul_State *state, ARMword va, ARMword *instr)
         } else
             va &= ~(WORD_SIZE - 1);
 
-        /* translate tlb */
-        fault = mmu_translate (state, va, &pa, &ap, &sop);
+        /* translate tlb, checking permissions */
+        fault = mmu_translate_access (state, va, TLB_EXECUTE, &pa);
         if (fault) {
             DEBUG_LOG(ARM11, "translate\n");
             printf("va=0x%x, icounter=%lld, fault=%d\n", va, state->NumInstrs, fault);
             return fault;
         }
 
-
-        /* no tlb, only check permission */
-        if (!check_perms(state, ap, 1)) {
-            if (sop == 0) {
-                return SECTION_PERMISSION_FAULT;
-            } else {
-                return SUBPAGE_PERMISSION_FAULT;
-            }
-        }
-
 #if 0
         /*check access */
         fault = check_access (state, va, tlb, 1);
@@ -442,7 +486,6 @@ arm1176jzf_s_mmu_read (ARMul_State *state, ARMword va, ARMword *data,
     fault_t fault;
     ARMword pa, real_va, temp, offset;
     ARMword perm;        /* physical addr access permissions */
-    int ap, sop;
 
     //DEBUG_LOG(ARM11, "va = %x\n", va);
 
@@ -501,7 +544,7 @@ arm1176jzf_s_mmu_read (ARMul_State *state, ARMword va, ARMword *data,
 #if 0
     fault = mmu_translate (state, va, ARM920T_D_TLB (), &tlb);
 #endif
-    fault = mmu_translate (state, va, &pa, &ap, &sop);
+    fault = mmu_translate_access (state, va, TLB_READ, &pa);
 #if 0
     if(va ==0xbebb1774 || state->Reg[15] == 0x400ff594){
                 //printf("In %s, current=0x%x. mode is %x, pc=0x%x\n", __FUNCTION__, state->CurrInstr, state->Mode, state->Reg[15]);
@@ -519,15 +562,6 @@ arm1176jzf_s_mmu_read (ARMul_State *state, ARMword va, ARMword *data,
         return fault;
     }
 //    printf("va is %x pa is %x\n", va, pa);
-
-    /* no tlb, only check permission */
-    if (!check_perms(state, ap, 1)) {
-        if (sop == 0) {
-            return SECTION_PERMISSION_FAULT;
-        } else {
-            return SUBPAGE_PERMISSION_FAULT;
-        }
-    }
 #if 0
     /*check access permission */
     fault = check_access (state, va, tlb, 1);
@@ -615,7 +649,6 @@ arm1176jzf_s_mmu_write (ARMul_State *state, ARMword va, ARMword data,
     ARMword pa, real_va;
     ARMword perm;        /* physical addr access permissions */
     fault_t fault;
-    int ap, sop;
 
 #if 0
     /8 for sky_printk debugger.*/
@@ -676,7 +709,7 @@ arm1176jzf_s_mmu_write (ARMul_State *state, ARMword va, ARMword data,
     }
     #endif
     /*tlb translate */
-    fault = mmu_translate (state, va, &pa, &ap, &sop);
+    fault = mmu_translate_access (state, va, TLB_WRITE, &pa);
 #if 0
     if(va ==0xbebb1774 || state->Reg[15] == 0x40102334){
                 //printf("In %s, current=0x%x. mode is %x, pc=0x%x\n", __FUNCTION__, state->CurrInstr, state->Mode, state->Reg[15]);
@@ -694,15 +727,6 @@ arm1176jzf_s_mmu_write (ARMul_State *state, ARMword va, ARMword data,
     }
 //    printf("va is %x pa is %x\n", va, pa);
 
-    /* no tlb, only check permission */
-    if (!check_perms(state, ap, 0)) {
-        if (sop == 0) {
-            return SECTION_PERMISSION_FAULT;
-        } else {
-            return SUBPAGE_PERMISSION_FAULT;
-        }
-    }
-
 #if 0
     /* tlb check access */
     fault = check_access (state, va, tlb, 0);
@@ -900,9 +924,11 @@ arm1176jzf_s_mmu_mcr (ARMul_State *state, ARMword instr, ARMword value)
          * 10           read as 0
          * 18,16    read as 1
          * */
-            if(OPC_2 == 0)
+            if(OPC_2 == 0) {
                 state->mmu.control = (value | 0x50078) & 0xFFFFFBFF;
-            else if(OPC_2 == 1)
+                /* the S and R bits change permission checks */
+                mmu_tlb_invalidate_fast (ARM1176_TLB ());
+            } else if(OPC_2 == 1)
                 state->mmu.auxiliary_control = value;
             else if(OPC_2 == 2)
                 state->mmu.coprocessor_access_control = value;
@@ -941,7 +967,8 @@ arm1176jzf_s_mmu_mcr (ARMul_State *state, ARMword instr, ARMword value)
                     break;
             }
             //printf("SKYEYE In %s, write TLB_BASE 0x%x OPC_2=%d instr=0x%x\n", __FUNCTION__, value, OPC_2, instr);
-            //invalidate_all_tlb(state);
+            /* software is meant to flush the TLB itself, but this is rare enough to be safe */
+            mmu_tlb_invalidate_all (state, ARM1176_TLB ());
             break;
         case MMU_DOMAIN_ACCESS_CONTROL:
         /* printf("mmu_mcr wrote DACR         "); */
@@ -968,13 +995,14 @@ arm1176jzf_s_mmu_mcr (ARMul_State *state, ARMword instr, ARMword value)
                 {
                     switch(OPC_2){
                         case 0: /* invalidate all */
-                            //invalidate_all_tlb(state);
+                            mmu_tlb_invalidate_all (state, ARM1176_TLB ());
                             break;
                         case 1: /* invalidate by MVA */
-                            //invalidate_by_mva(state, value);
+                            mmu_tlb_invalidate_mva (state, ARM1176_TLB (), value & 0xFFFFF000,
+                                value & 0xFF);
                             break;
                         case 2: /* invalidate by asid */
-                            //invalidate_by_asid(state, value);
+                            mmu_tlb_invalidate_asid (state, ARM1176_TLB (), value & 0xFF);
                             break;
                         default:
                             printf ("mmu_mcr wrote UNKNOWN - reg %d\n", creg);
@@ -986,13 +1014,14 @@ arm1176jzf_s_mmu_mcr (ARMul_State *state, ARMword instr, ARMword value)
                 {
                     switch(OPC_2){
                         case 0: /* invalidate all */
-                            //invalidate_all_tlb(state);
+                            mmu_tlb_invalidate_all (state, ARM1176_TLB ());
                             break;
                         case 1: /* invalidate by MVA */
-                            //invalidate_by_mva(state, value);
+                            mmu_tlb_invalidate_mva (state, ARM1176_TLB (), value & 0xFFFFF000,
+                                value & 0xFF);
                             break;
                         case 2: /* invalidate by asid */
-                            //invalidate_by_asid(state, value);
+                            mmu_tlb_invalidate_asid (state, ARM1176_TLB (), value & 0xFF);
                             break;
                         default:
                             printf ("mmu_mcr wrote UNKNOWN - reg %d\n", creg);
@@ -1004,13 +1033,14 @@ arm1176jzf_s_mmu_mcr (ARMul_State *state, ARMword instr, ARMword value)
                 {
                     switch(OPC_2){
                         case 0: /* invalidate all */
-                            //invalidate_all_tlb(state);
+                            mmu_tlb_invalidate_all (state, ARM1176_TLB ());
                             break;
                         case 1: /* invalidate by MVA */
-                            //invalidate_by_mva(state, value);
+                            mmu_tlb_invalidate_mva (state, ARM1176_TLB (), value & 0xFFFFF000,
+                                value & 0xFF);
                             break;
                         case 2: /* invalidate by asid */
-                            //invalidate_by_asid(state, value);
+                            mmu_tlb_invalidate_asid (state, ARM1176_TLB (), value & 0xFF);
                             break;
                         default:
                             printf ("mmu_mcr wrote UNKNOWN - reg %d\n", creg);
@@ -1041,8 +1071,11 @@ arm1176jzf_s_mmu_mcr (ARMul_State *state, ARMword instr, ARMword value)
             //state->mmu.process_id = value & 0xfe000000;
             if(OPC_2 == 0)
                 state->mmu.process_id = value;
-            else if(OPC_2 == 1)
+            else if(OPC_2 == 1) {
                 state->mmu.context_id = value;
+                /* fast entries don't keep the ASID they were made for */
+                mmu_tlb_invalidate_fast (ARM1176_TLB ());
+            }
             else if(OPC_2 == 3){
                 state->mmu.thread_uro_id = value;
             }
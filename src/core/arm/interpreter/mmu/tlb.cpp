@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <string.h>
 
 #include "core/arm/interpreter/armdefs.h"
 
@@ -8,7 +9,8 @@ ARMword tlb_masks[] = {
 	0xFFFF0000,		/* TLB_LARGEPAGE */
 	0xFFF00000,		/* TLB_SECTION */
 	0xFFFFF000,		/*TLB_ESMALLPAGE, have TEX attirbute, only for XScale */
-	0xFFFFFC00		/* TLB_TINYPAGE */
+	0xFFFFFC00,		/* TLB_TINYPAGE */
+	0xFF000000		/* TLB_SUPERSECTION */
 };
 
 /* This function encodes table 8-2 Interpreting AP bits,
@@ -225,11 +227,11 @@ translate (ARMul_State * state, ARMword virt_addr, tlb_s * tlb_t,
 		}
 		entry.virt_addr &= tlb_masks[entry.mapping];
 		entry.phys_addr &= tlb_masks[entry.mapping];
+		entry.asid = 0;
+		entry.global = 1;
 
 		/* place entry in the tlb */
-		*tlb = &tlb_t->entrys[tlb_t->cycle];
-		tlb_t->cycle = (tlb_t->cycle + 1) % tlb_t->num;
-		**tlb = entry;
+		*tlb = mmu_tlb_insert (tlb_t, virt_addr, &entry);
 	}
 	state->mmu.last_domain = (*tlb)->domain;
 	return NO_FAULT;
@@ -238,22 +240,27 @@ translate (ARMul_State * state, ARMword virt_addr, tlb_s * tlb_t,
 int
 mmu_tlb_init (tlb_s * tlb_t, int num)
 {
-	tlb_entry_t *e;
-	int i;
+	int num_sets;
 
-	e = (tlb_entry_t *) malloc (sizeof (*e) * num);
-	if (e == NULL) {
-		ERROR_LOG(ARM11, "malloc size %d\n", sizeof (*e) * num);
+	/* round the number of sets down to a power of two, so that sets can be indexed by masking */
+	for (num_sets = 1; num_sets * 2 * TLB_WAYS <= num; num_sets *= 2);
+
+	tlb_t->entrys = (tlb_entry_t *) malloc (sizeof (tlb_entry_t) * num_sets * TLB_WAYS);
+	tlb_t->victims = (unsigned char *) malloc (num_sets);
+	if (tlb_t->entrys == NULL || tlb_t->victims == NULL) {
+		ERROR_LOG(ARM11, "malloc size %d\n", sizeof (tlb_entry_t) * num_sets * TLB_WAYS);
 		goto tlb_malloc_error;
 	}
-	tlb_t->entrys = e;
-	for (i = 0; i < num; i++, e++)
-		e->mapping = TLB_INVALID;
-	tlb_t->cycle = 0;
-	tlb_t->num = num;
+	tlb_t->num_sets = num_sets;
+	tlb_t->num = num_sets * TLB_WAYS;
+	mmu_tlb_invalidate_all (NULL, tlb_t);
 	return 0;
 
       tlb_malloc_error:
+	free (tlb_t->entrys);
+	free (tlb_t->victims);
+	tlb_t->entrys = NULL;
+	tlb_t->victims = NULL;
 	return -1;
 }
 
@@ -261,8 +268,17 @@ void
 mmu_tlb_exit (tlb_s * tlb_t)
 {
 	free (tlb_t->entrys);
+	free (tlb_t->victims);
+	tlb_t->entrys = NULL;
+	tlb_t->victims = NULL;
 };
 
+void
+mmu_tlb_invalidate_fast (tlb_s * tlb_t)
+{
+	memset (tlb_t->fast, 0, sizeof (tlb_t->fast));
+}
+
 void
 mmu_tlb_invalidate_all (ARMul_State * state, tlb_s * tlb_t)
 {
@@ -271,37 +287,107 @@ mmu_tlb_invalidate_all (ARMul_State * state, tlb_s * tlb_t)
 	for (entry = 0; entry < tlb_t->num; entry++) {
 		tlb_t->entrys[entry].mapping = TLB_INVALID;
 	}
-	tlb_t->cycle = 0;
+	memset (tlb_t->victims, 0, tlb_t->num_sets);
+	mmu_tlb_invalidate_fast (tlb_t);
 }
 
+/* Returns non-zero if a valid entry maps mva, whatever its ASID */
+static inline int
+tlb_entry_maps (const tlb_entry_t * tlb, ARMword mva)
+{
+	return tlb->mapping != TLB_INVALID &&
+		(mva & tlb_masks[tlb->mapping]) == tlb->virt_addr;
+}
+
+/*
+ * A mapping larger than a page may be held in the set of any page it covers, so invalidating
+ * one has to go through the whole TLB. TLB maintenance is rare compared to lookups.
+ */
 void
 mmu_tlb_invalidate_entry (ARMul_State * state, tlb_s * tlb_t, ARMword addr)
 {
-	tlb_entry_t *tlb;
+	int entry;
 
-	tlb = mmu_tlb_search (state, tlb_t, addr);
-	if (tlb) {
-		tlb->mapping = TLB_INVALID;
+	for (entry = 0; entry < tlb_t->num; entry++) {
+		if (tlb_entry_maps (&tlb_t->entrys[entry], addr))
+			tlb_t->entrys[entry].mapping = TLB_INVALID;
 	}
+	mmu_tlb_invalidate_fast (tlb_t);
 }
 
-tlb_entry_t *
-mmu_tlb_search (ARMul_State * state, tlb_s * tlb_t, ARMword virt_addr)
+void
+mmu_tlb_invalidate_mva (ARMul_State * state, tlb_s * tlb_t, ARMword mva, ARMword asid)
 {
 	int entry;
 
 	for (entry = 0; entry < tlb_t->num; entry++) {
-		tlb_entry_t *tlb;
-		ARMword mask;
+		tlb_entry_t *tlb = &tlb_t->entrys[entry];
+		if (tlb_entry_maps (tlb, mva) && (tlb->global || tlb->asid == asid))
+			tlb->mapping = TLB_INVALID;
+	}
+	mmu_tlb_invalidate_fast (tlb_t);
+}
 
-		tlb = &(tlb_t->entrys[entry]);
-		if (tlb->mapping == TLB_INVALID) {
-			continue;
-		}
-		mask = tlb_masks[tlb->mapping];
-		if ((virt_addr & mask) == (tlb->virt_addr & mask)) {
+void
+mmu_tlb_invalidate_asid (ARMul_State * state, tlb_s * tlb_t, ARMword asid)
+{
+	int entry;
+
+	for (entry = 0; entry < tlb_t->num; entry++) {
+		tlb_entry_t *tlb = &tlb_t->entrys[entry];
+		if (!tlb->global && tlb->asid == asid)
+			tlb->mapping = TLB_INVALID;
+	}
+	mmu_tlb_invalidate_fast (tlb_t);
+}
+
+tlb_entry_t *
+mmu_tlb_search_asid (tlb_s * tlb_t, ARMword virt_addr, ARMword asid)
+{
+	tlb_entry_t *set = &tlb_t->entrys[tlb_set_index (tlb_t, virt_addr) * TLB_WAYS];
+	int way;
+
+	for (way = 0; way < TLB_WAYS; way++) {
+		tlb_entry_t *tlb = &set[way];
+		if (tlb_entry_maps (tlb, virt_addr) && (tlb->global || tlb->asid == asid)) {
 			return tlb;
 		}
 	}
 	return NULL;
 }
+
+tlb_entry_t *
+mmu_tlb_search (ARMul_State * state, tlb_s * tlb_t, ARMword virt_addr)
+{
+	return mmu_tlb_search_asid (tlb_t, virt_addr, 0);
+}
+
+/* Places a translation of virt_addr in the TLB, returning where it was placed */
+tlb_entry_t *
+mmu_tlb_insert (tlb_s * tlb_t, ARMword virt_addr, const tlb_entry_t * entry)
+{
+	const int set_index = tlb_set_index (tlb_t, virt_addr);
+	tlb_entry_t *set = &tlb_t->entrys[set_index * TLB_WAYS];
+	int way;
+
+	/* fill an invalid way if there is one, otherwise replace the ways in turn */
+	for (way = 0; way < TLB_WAYS; way++) {
+		if (set[way].mapping == TLB_INVALID)
+			break;
+	}
+	if (way == TLB_WAYS) {
+		way = tlb_t->victims[set_index];
+		tlb_t->victims[set_index] = (way + 1) % TLB_WAYS;
+	}
+	set[way] = *entry;
+	return &set[way];
+}
+
+void
+mmu_tlb_insert_fast (tlb_s * tlb_t, tlb_access_t type, ARMword va, int user, ARMword pa)
+{
+	tlb_fast_entry_t *fast = &tlb_t->fast[type][tlb_fast_index (va)];
+
+	fast->tag = tlb_fast_tag (va, user);
+	fast->phys_page = pa & ~((1 << TLB_PAGE_BITS) - 1);
+}
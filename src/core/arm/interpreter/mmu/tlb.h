@@ -8,9 +8,19 @@ typedef enum tlb_mapping_t
     TLB_LARGEPAGE = 2,
     TLB_SECTION = 3,
     TLB_ESMALLPAGE = 4,
-    TLB_TINYPAGE = 5
+    TLB_TINYPAGE = 5,
+    TLB_SUPERSECTION = 6
 } tlb_mapping_t;
 
+/* Kinds of access, each with its own fast entries */
+typedef enum tlb_access_t
+{
+    TLB_READ = 0,
+    TLB_WRITE = 1,
+    TLB_EXECUTE = 2,
+    TLB_NUM_ACCESS_TYPES = 3
+} tlb_access_t;
+
 extern ARMword tlb_masks[];
 
 /* Permissions bits in a TLB entry:
@@ -47,16 +57,62 @@ typedef struct tlb_entry_t
     ARMword phys_addr;
     ARMword perms;
     ARMword domain;
+    ARMword asid;       /* address space the entry belongs to, unless global */
+    int global;         /* matches every ASID */
     tlb_mapping_t mapping;
 } tlb_entry_t;
 
+/*
+ * The TLB is a 2-way set associative cache of translations, indexed by the virtual page number
+ * (in 4KB pages) of the address that was translated. Larger mappings are stored in the set of
+ * every page they were used for, so a lookup only ever checks one set.
+ *
+ * In front of it, each kind of access has a direct-mapped table of fast entries, which map a
+ * virtual page straight to a physical page once the permissions for the access were checked.
+ * Their tag holds the page address, the privilege of the access and a valid bit. They are
+ * flushed along with the TLB, and by the MMU whenever the current ASID or the permission
+ * checks change.
+ */
+#define TLB_WAYS 2
+#define TLB_PAGE_BITS 12
+#define TLB_FAST_BITS 8
+#define TLB_FAST_SIZE (1 << TLB_FAST_BITS)
+#define TLB_FAST_VALID 0x1
+#define TLB_FAST_USER 0x2
+
+typedef struct tlb_fast_entry_t
+{
+    ARMword tag;        /* page address | TLB_FAST_USER | TLB_FAST_VALID */
+    ARMword phys_page;
+} tlb_fast_entry_t;
+
 typedef struct tlb_s
 {
     int num;        /*num of tlb entry */
-    int cycle;        /*current tlb cycle */
+    int num_sets;    /* num of sets of TLB_WAYS entries, a power of two */
     tlb_entry_t *entrys;
+    unsigned char *victims;    /* way of each set to replace next */
+    tlb_fast_entry_t fast[TLB_NUM_ACCESS_TYPES][TLB_FAST_SIZE];
 } tlb_s;
 
+#define tlb_set_index(tlb_t, va) \
+    (((va) >> TLB_PAGE_BITS) & ((tlb_t)->num_sets - 1))
+#define tlb_fast_index(va) \
+    (((va) >> TLB_PAGE_BITS) & (TLB_FAST_SIZE - 1))
+#define tlb_fast_tag(va, user) \
+    (((va) & ~((1 << TLB_PAGE_BITS) - 1)) | ((user) ? TLB_FAST_USER : 0) | TLB_FAST_VALID)
+
+/* Looks up a fast entry, returning non-zero and the physical address in pa on a hit */
+static inline int
+tlb_fast_lookup (tlb_s * tlb_t, tlb_access_t type, ARMword va, int user, ARMword * pa)
+{
+    const tlb_fast_entry_t *fast = &tlb_t->fast[type][tlb_fast_index (va)];
+    if (fast->tag != tlb_fast_tag (va, user))
+        return 0;
+    *pa = fast->phys_page | (va & ((1 << TLB_PAGE_BITS) - 1));
+    return 1;
+}
+
 
 #define tlb_c_flag(tlb) \
     ((tlb)->perms & 0x8)
@@ -81,7 +137,21 @@ void mmu_tlb_invalidate_all (ARMul_State * state, tlb_s * tlb_t);
 void
 mmu_tlb_invalidate_entry (ARMul_State * state, tlb_s * tlb_t, ARMword addr);
 
+void mmu_tlb_invalidate_mva (ARMul_State * state, tlb_s * tlb_t, ARMword mva,
+                 ARMword asid);
+
+void mmu_tlb_invalidate_asid (ARMul_State * state, tlb_s * tlb_t, ARMword asid);
+
+void mmu_tlb_invalidate_fast (tlb_s * tlb_t);
+
 tlb_entry_t *mmu_tlb_search (ARMul_State * state, tlb_s * tlb_t,
                  ARMword virt_addr);
 
+tlb_entry_t *mmu_tlb_search_asid (tlb_s * tlb_t, ARMword virt_addr, ARMword asid);
+
+tlb_entry_t *mmu_tlb_insert (tlb_s * tlb_t, ARMword virt_addr, const tlb_entry_t * entry);
+
+void mmu_tlb_insert_fast (tlb_s * tlb_t, tlb_access_t type, ARMword va, int user,
+              ARMword pa);
+
 #endif        /*_MMU_TLB_H_*/
@@ -0,0 +1,935 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#define FASTMEM_SUPPORTED
+#include <signal.h>
+#ifdef __APPLE__
+#include <sys/ucontext.h>
+#else
+#include <ucontext.h>
+#endif
+#endif
+
+#include "common/common.h"
+#include "common/memory_util.h"
+
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/mem_map.h"
+#include "core/hle/hle.h"
+#include "core/arm/arm_profiler.h"
+#include "core/arm/interpreter/arm_block_cache.h"
+#include "core/arm/interpreter/arm_decoder.h"
+#include "core/arm/jit/arm_jit.h"
+#include "core/arm/jit/x64_emitter.h"
+
+using namespace Gen;
+using namespace ARMDecoder;
+
+namespace JitCache {
+
+enum {
+    CODE_CACHE_SIZE     = 32 * 1024 * 1024, ///< Size of the executable memory for compiled blocks
+    MAX_BLOCK_CODE_SIZE = 64 * 1024,        ///< Upper bound on the code size of a single block
+    LOOKUP_TABLE_BITS   = 14,
+    LOOKUP_TABLE_SIZE   = (1 << LOOKUP_TABLE_BITS),
+    LOOKUP_TABLE_MASK   = (LOOKUP_TABLE_SIZE - 1),
+    NUM_HOST_REGS       = 5,                ///< Number of host registers available for guest ones
+    BACKPATCH_SIZE      = 5,                ///< Size of the jump fastmem accesses are patched to
+};
+
+/// Compiled block entry point, returns the address of the next guest instruction
+typedef u32 (*BlockEntry)(ARMul_State* state);
+
+/// A compiled basic block
+struct Block {
+    u32 start;          ///< Guest address of the first instruction
+    u32 num_ops;        ///< Number of guest instructions, 0 if the block must be interpreted
+    BlockEntry entry;   ///< Compiled code, NULL if num_ops is 0
+    bool idle_loop;     ///< Whether the block is an idle loop (see ARMDecoder::IsIdleLoop)
+};
+
+static u8* g_code_space = NULL;             ///< Executable memory holding all compiled code
+static u8* g_code_ptr = NULL;               ///< Where the next block will be compiled to
+static std::map<u32, Block*> g_blocks;      ///< Compiled blocks, keyed by start address
+static Block* g_lookup[LOOKUP_TABLE_SIZE];  ///< Direct-mapped lookup cache in front of g_blocks
+static bool g_invalidated = false;          ///< Set when blocks have been invalidated
+static int g_num_users = 0;                 ///< Number of ARM_JIT instances using the cache
+
+/// Slow path of each fastmem access, keyed by the host address of the access instruction
+static std::map<u8*, u8*> g_fastmem_sites;
+static bool g_fastmem_handler_installed = false;
+
+/// Callee-saved host registers that guest registers are allocated to (RBX holds the state)
+static const X64Reg g_host_regs[NUM_HOST_REGS] = { RBP, Gen::R12, Gen::R13, Gen::R14, Gen::R15 };
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Fastmem fault handling
+//
+// Compiled loads and stores access guest memory at Memory::g_base + address. Accesses to I/O,
+// unmapped or watched pages fault there; the fault handler then patches the access to jump
+// to its slow path, which calls into Memory, and resumes execution at the slow path.
+
+#ifdef FASTMEM_SUPPORTED
+
+#if defined(__APPLE__)
+#define CONTEXT_RIP(ctx) ((ctx)->uc_mcontext->__ss.__rip)
+static const int g_fault_signals[] = { SIGSEGV, SIGBUS };
+#else
+#define CONTEXT_RIP(ctx) ((ctx)->uc_mcontext.gregs[REG_RIP])
+static const int g_fault_signals[] = { SIGSEGV };
+#endif
+
+static const int NUM_FAULT_SIGNALS = sizeof(g_fault_signals) / sizeof(g_fault_signals[0]);
+static struct sigaction g_old_fault_actions[NUM_FAULT_SIGNALS]; ///< Handlers we replaced
+
+/**
+ * Overwrites a fastmem access with a jump to its slow path, so that it doesn't fault again
+ * @param access Host address of the access instruction
+ * @param slow_path Host address of the slow path
+ */
+static void BackpatchFastmemAccess(u8* access, u8* slow_path) {
+    const s32 displacement = (s32)(slow_path - (access + BACKPATCH_SIZE));
+    access[0] = 0xE9;
+    memcpy(access + 1, &displacement, sizeof(displacement));
+}
+
+static void FastmemFaultHandler(int sig, siginfo_t* info, void* raw_context) {
+    ucontext_t* context = (ucontext_t*)raw_context;
+    u8* rip = (u8*)CONTEXT_RIP(context);
+    const u8* fault_address = (const u8*)info->si_addr;
+
+    std::map<u8*, u8*>::const_iterator it = g_fastmem_sites.find(rip);
+    if (it != g_fastmem_sites.end() && Memory::g_base && fault_address >= Memory::g_base &&
+        fault_address < Memory::g_base + 0x100000000ULL) {
+
+        BackpatchFastmemAccess(rip, it->second);
+        CONTEXT_RIP(context) = (u64)it->second;
+        return;
+    }
+
+    // Not a fastmem access, pass the fault on to whatever handled it before
+    for (int i = 0; i < NUM_FAULT_SIGNALS; i++) {
+        if (g_fault_signals[i] != sig)
+            continue;
+
+        const struct sigaction& old_action = g_old_fault_actions[i];
+        if (old_action.sa_flags & SA_SIGINFO) {
+            old_action.sa_sigaction(sig, info, raw_context);
+        } else if (old_action.sa_handler != SIG_DFL && old_action.sa_handler != SIG_IGN) {
+            old_action.sa_handler(sig);
+        } else {
+            // Restore the default action, which is taken when the instruction faults again
+            sigaction(sig, &old_action, NULL);
+        }
+    }
+}
+
+static void InstallFastmemHandler() {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = FastmemFaultHandler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+
+    for (int i = 0; i < NUM_FAULT_SIGNALS; i++)
+        sigaction(g_fault_signals[i], &action, &g_old_fault_actions[i]);
+    g_fastmem_handler_installed = true;
+}
+
+static void RemoveFastmemHandler() {
+    for (int i = 0; i < NUM_FAULT_SIGNALS; i++)
+        sigaction(g_fault_signals[i], &g_old_fault_actions[i], NULL);
+    g_fastmem_handler_installed = false;
+}
+
+#else
+
+static void InstallFastmemHandler() {
+    // Fault handling is not implemented for this host, the page table is used instead
+}
+
+static void RemoveFastmemHandler() {
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Code generation
+
+#define STATE_OFFSET(field) ((s32)offsetof(ARMul_State, field))
+
+/// Compiles a decoded basic block to x86-64 code
+class BlockCompiler : public XEmitter {
+public:
+    BlockCompiler(u8* code_ptr, u32 start, const std::vector<DecodedOp>& ops) :
+        start(start), ops(ops), use_fastmem(g_fastmem_handler_installed &&
+        Memory::IsFastmemEnabled()) {
+
+        SetCodePtr(code_ptr);
+        for (int i = 0; i < 16; i++)
+            host_reg[i] = INVALID_REG;
+    }
+
+    /// Compiles the block, returning its entry point
+    BlockEntry Compile() {
+        BlockEntry entry = (BlockEntry)GetCodePtr();
+
+        AllocateRegisters();
+        EmitPrologue();
+
+        for (size_t i = 0; i < ops.size(); i++) {
+            const DecodedOp& op = ops[i];
+            const u32 addr = start + (u32)i * 4;
+
+            skip_jumps.clear();
+            if (op.cond != COND_AL)
+                EmitConditionCheck(op.cond);
+
+            switch (op.type) {
+            case OP_DP_IMM:
+            case OP_DP_REG:
+                EmitDataProcessing(op, addr);
+                break;
+
+            case OP_MOV_IMM:
+                if (host_reg[op.rd] != INVALID_REG)
+                    MOV_RI(host_reg[op.rd], op.imm);
+                else
+                    MOV_MI(RegArg(op.rd), op.imm);
+                break;
+
+            case OP_MOV_REG:
+                LoadGuest(RAX, op.rm, addr);
+                StoreGuest(op.rd, RAX);
+                break;
+
+            case OP_ADD_IMM:
+            case OP_SUB_IMM:
+                LoadGuest(RAX, op.rn, addr);
+                ALU_RI(op.type == OP_ADD_IMM ? ALU_ADD : ALU_SUB, RAX, op.imm);
+                StoreGuest(op.rd, RAX);
+                break;
+
+            case OP_CMP_IMM:
+                LoadGuest(RAX, op.rn, addr);
+                ALU_RI(ALU_CMP, RAX, op.imm);
+                StoreArithmeticFlags(true);
+                break;
+
+            case OP_CMP_REG:
+                LoadGuest(RAX, op.rn, addr);
+                LoadGuest(RCX, op.rm, addr);
+                ALU_R(ALU_CMP, RAX, RCX);
+                StoreArithmeticFlags(true);
+                break;
+
+            case OP_LDR:
+            case OP_LDRB:
+                EmitLoad(op, addr);
+                break;
+
+            case OP_STR:
+            case OP_STRB:
+                EmitStore(op, addr, (u32)i + 1);
+                break;
+
+            case OP_BL:
+                if (host_reg[14] != INVALID_REG)
+                    MOV_RI(host_reg[14], addr + 4);
+                else
+                    MOV_MI(RegArg(14), addr + 4);
+                // Fall through
+
+            case OP_B:
+                EmitExit(addr, op.imm, (u32)i + 1);
+                break;
+            }
+
+            for (size_t j = 0; j < skip_jumps.size(); j++)
+                SetJumpTarget(skip_jumps[j]);
+        }
+
+        // Fall through to the next instruction, unless the block ended with an unconditional branch
+        const DecodedOp& last = ops.back();
+        if (!((last.type == OP_B || last.type == OP_BL) && last.cond == COND_AL)) {
+            const u32 last_addr = start + (u32)(ops.size() - 1) * 4;
+            EmitExit(last_addr, last_addr + 4, (u32)ops.size());
+        }
+
+        return entry;
+    }
+
+private:
+
+    static MemArg RegArg(int index) {
+        return MDisp(RBX, STATE_OFFSET(Reg) + index * 4);
+    }
+
+    static MemArg StateArg(s32 offset) {
+        return MDisp(RBX, offset);
+    }
+
+    /// Scratch stack slot, above the shadow space on Windows
+    static MemArg ScratchArg() {
+        return MDisp(RSP, ABI_SHADOW_SPACE);
+    }
+
+    /// Assigns host registers to the most used guest registers of the block
+    void AllocateRegisters() {
+        int uses[16] = {};
+        for (size_t i = 0; i < ops.size(); i++) {
+            const DecodedOp& op = ops[i];
+            if (op.type == OP_B)
+                continue;
+            if (op.type == OP_BL) {
+                uses[14]++;
+                continue;
+            }
+            uses[op.rd]++;
+            uses[op.rn]++;
+            if (op.type == OP_DP_REG || op.type == OP_MOV_REG || op.type == OP_CMP_REG)
+                uses[op.rm]++;
+        }
+        uses[15] = 0; // The PC is always a constant
+
+        for (int i = 0; i < NUM_HOST_REGS; i++) {
+            int best = -1;
+            for (int reg = 0; reg < 15; reg++) {
+                if (host_reg[reg] != INVALID_REG || uses[reg] < 2)
+                    continue;
+                if (best < 0 || uses[reg] > uses[best])
+                    best = reg;
+            }
+            if (best < 0)
+                break;
+            host_reg[best] = g_host_regs[i];
+            allocated.push_back(best);
+        }
+    }
+
+    void EmitPrologue() {
+        PUSH(RBX);
+        for (int i = 0; i < NUM_HOST_REGS; i++)
+            PUSH(g_host_regs[i]);
+        // Six pushes and the return address leave the stack 16-byte aligned minus 8
+        ALU64_RI(ALU_SUB, RSP, 8 + ABI_SHADOW_SPACE);
+        MOV64_R(RBX, ABI_PARAM1);
+
+        for (size_t i = 0; i < allocated.size(); i++)
+            MOV_RM(host_reg[allocated[i]], RegArg(allocated[i]));
+    }
+
+    /**
+     * Emits a return to the dispatcher
+     * @param last_addr Address of the last guest instruction executed
+     * @param next_pc Address of the next guest instruction to execute
+     * @param num_executed Number of guest instructions executed by the block up to this exit
+     */
+    void EmitExit(u32 last_addr, u32 next_pc, u32 num_executed) {
+        for (size_t i = 0; i < allocated.size(); i++)
+            MOV_MR(RegArg(allocated[i]), host_reg[allocated[i]]);
+
+        MOV_MI(StateArg(STATE_OFFSET(pc)), last_addr);
+        MOV_RI(RCX, num_executed);
+        ALU64_MR(ALU_ADD, StateArg(STATE_OFFSET(NumInstrs)), RCX);
+        ALU_MI(ALU_ADD, StateArg(STATE_OFFSET(NumNcycles)), num_executed);
+        MOV_RI(RAX, next_pc);
+
+        ALU64_RI(ALU_ADD, RSP, 8 + ABI_SHADOW_SPACE);
+        for (int i = NUM_HOST_REGS - 1; i >= 0; i--)
+            POP(g_host_regs[i]);
+        POP(RBX);
+        RET();
+    }
+
+    /// Loads a guest register into a host register
+    void LoadGuest(X64Reg dst, int index, u32 addr) {
+        if (index == 15)
+            MOV_RI(dst, addr + 8);
+        else if (host_reg[index] != INVALID_REG)
+            MOV_R(dst, host_reg[index]);
+        else
+            MOV_RM(dst, RegArg(index));
+    }
+
+    /// Stores a host register to a guest register (never the PC)
+    void StoreGuest(int index, X64Reg src) {
+        if (host_reg[index] != INVALID_REG)
+            MOV_R(host_reg[index], src);
+        else
+            MOV_MR(RegArg(index), src);
+    }
+
+    /// Stores a host condition flag to one of the guest flags
+    void StoreFlag(CCFlags cc, s32 offset) {
+        SETcc(cc, RAX);
+        MOVZX8_R(RAX, RAX);
+        MOV_MR(StateArg(offset), RAX);
+    }
+
+    /// Stores NZCV after a host ADD/ADC (C is carry) or SUB/SBB/CMP (C is not borrow)
+    void StoreArithmeticFlags(bool subtraction) {
+        StoreFlag(CC_S, STATE_OFFSET(NFlag));
+        StoreFlag(CC_Z, STATE_OFFSET(ZFlag));
+        StoreFlag(subtraction ? CC_NC : CC_C, STATE_OFFSET(CFlag));
+        StoreFlag(CC_O, STATE_OFFSET(VFlag));
+    }
+
+    /// Compares a guest flag against zero
+    void TestFlag(s32 offset) {
+        ALU_MI(ALU_CMP, StateArg(offset), 0);
+    }
+
+    /// Emits jumps to skip the current instruction when its condition fails
+    void EmitConditionCheck(u32 cond) {
+        u8* pass = NULL;
+
+        switch (cond) {
+        case 0x0: TestFlag(STATE_OFFSET(ZFlag)); skip_jumps.push_back(J_CC(CC_E)); break;   // EQ
+        case 0x1: TestFlag(STATE_OFFSET(ZFlag)); skip_jumps.push_back(J_CC(CC_NE)); break;  // NE
+        case 0x2: TestFlag(STATE_OFFSET(CFlag)); skip_jumps.push_back(J_CC(CC_E)); break;   // CS
+        case 0x3: TestFlag(STATE_OFFSET(CFlag)); skip_jumps.push_back(J_CC(CC_NE)); break;  // CC
+        case 0x4: TestFlag(STATE_OFFSET(NFlag)); skip_jumps.push_back(J_CC(CC_E)); break;   // MI
+        case 0x5: TestFlag(STATE_OFFSET(NFlag)); skip_jumps.push_back(J_CC(CC_NE)); break;  // PL
+        case 0x6: TestFlag(STATE_OFFSET(VFlag)); skip_jumps.push_back(J_CC(CC_E)); break;   // VS
+        case 0x7: TestFlag(STATE_OFFSET(VFlag)); skip_jumps.push_back(J_CC(CC_NE)); break;  // VC
+
+        case 0x8: // HI: C && !Z
+            TestFlag(STATE_OFFSET(CFlag));
+            skip_jumps.push_back(J_CC(CC_E));
+            TestFlag(STATE_OFFSET(ZFlag));
+            skip_jumps.push_back(J_CC(CC_NE));
+            break;
+
+        case 0x9: // LS: !C || Z
+            TestFlag(STATE_OFFSET(CFlag));
+            pass = J_CC(CC_E);
+            TestFlag(STATE_OFFSET(ZFlag));
+            skip_jumps.push_back(J_CC(CC_E));
+            SetJumpTarget(pass);
+            break;
+
+        // The interpreter keeps the flags as 0 or 1, so N == V can be compared directly
+        case 0xA: // GE: N == V
+        case 0xB: // LT: N != V
+            MOV_RM(RAX, StateArg(STATE_OFFSET(NFlag)));
+            ALU_RM(ALU_CMP, RAX, StateArg(STATE_OFFSET(VFlag)));
+            skip_jumps.push_back(J_CC(cond == 0xA ? CC_NE : CC_E));
+            break;
+
+        case 0xC: // GT: !Z && N == V
+            TestFlag(STATE_OFFSET(ZFlag));
+            skip_jumps.push_back(J_CC(CC_NE));
+            MOV_RM(RAX, StateArg(STATE_OFFSET(NFlag)));
+            ALU_RM(ALU_CMP, RAX, StateArg(STATE_OFFSET(VFlag)));
+            skip_jumps.push_back(J_CC(CC_NE));
+            break;
+
+        case 0xD: // LE: Z || N != V
+            TestFlag(STATE_OFFSET(ZFlag));
+            pass = J_CC(CC_NE);
+            MOV_RM(RAX, StateArg(STATE_OFFSET(NFlag)));
+            ALU_RM(ALU_CMP, RAX, StateArg(STATE_OFFSET(VFlag)));
+            skip_jumps.push_back(J_CC(CC_E));
+            SetJumpTarget(pass);
+            break;
+        }
+    }
+
+    /**
+     * Emits the immediate shift of a register operand in ECX
+     * @param shift Shift type and amount, as in DecodedOp
+     * @return True if the host carry flag holds the shifter carry out afterwards
+     */
+    bool EmitShift(u8 shift) {
+        const u8 amount = shift >> 2;
+
+        switch (shift & 3) {
+        case 0: // LSL
+            if (amount == 0)
+                return false;
+            SHIFT_RI(SHIFT_SHL, RCX, amount);
+            return true;
+
+        case 1: // LSR, where 0 encodes 32
+            if (amount == 0) {
+                BT_RI(RCX, 31);
+                MOV_RI(RCX, 0);
+            } else {
+                SHIFT_RI(SHIFT_SHR, RCX, amount);
+            }
+            return true;
+
+        case 2: // ASR, where 0 encodes 32
+            if (amount == 0) {
+                SHIFT_RI(SHIFT_SAR, RCX, 31);
+                BT_RI(RCX, 0);
+            } else {
+                SHIFT_RI(SHIFT_SAR, RCX, amount);
+            }
+            return true;
+
+        default: // ROR, where 0 encodes RRX
+            if (amount == 0) {
+                BT_MI(StateArg(STATE_OFFSET(CFlag)), 0);
+                SHIFT_RI(SHIFT_RCR, RCX, 1);
+            } else {
+                SHIFT_RI(SHIFT_ROR, RCX, amount);
+            }
+            return true;
+        }
+    }
+
+    /// Emits a data processing instruction, with the second operand computed in ECX
+    void EmitDataProcessing(const DecodedOp& op, u32 addr) {
+        const bool set_flags = (op.flags & FLAG_S) != 0;
+        const bool logical = !(op.opcode >= DP_SUB && op.opcode <= DP_RSC) &&
+            op.opcode != DP_CMP && op.opcode != DP_CMN;
+
+        // Shifter carry out, for logical instructions that set flags
+        enum { CARRY_UNCHANGED, CARRY_CONSTANT, CARRY_IN_DL } carry = CARRY_UNCHANGED;
+
+        if (op.type == OP_DP_IMM) {
+            MOV_RI(RCX, op.imm);
+            if (op.flags & FLAG_IMM_CARRY)
+                carry = CARRY_CONSTANT;
+        } else {
+            LoadGuest(RCX, op.rm, addr);
+            if (EmitShift(op.shift) && set_flags && logical) {
+                SETcc(CC_C, RDX);
+                carry = CARRY_IN_DL;
+            }
+        }
+
+        if (op.opcode != DP_MOV && op.opcode != DP_MVN)
+            LoadGuest(RAX, op.rn, addr);
+
+        switch (op.opcode) {
+        case DP_AND:
+        case DP_TST:
+            ALU_R(ALU_AND, RAX, RCX);
+            break;
+        case DP_EOR:
+        case DP_TEQ:
+            ALU_R(ALU_XOR, RAX, RCX);
+            break;
+        case DP_ORR:
+            ALU_R(ALU_OR, RAX, RCX);
+            break;
+        case DP_BIC:
+            NOT(RCX);
+            ALU_R(ALU_AND, RAX, RCX);
+            break;
+        case DP_MOV:
+            MOV_R(RAX, RCX);
+            break;
+        case DP_MVN:
+            MOV_R(RAX, RCX);
+            NOT(RAX);
+            break;
+        case DP_ADD:
+        case DP_CMN:
+            ALU_R(ALU_ADD, RAX, RCX);
+            break;
+        case DP_SUB:
+        case DP_CMP:
+            ALU_R(ALU_SUB, RAX, RCX);
+            break;
+        case DP_RSB:
+            ALU_R(ALU_SUB, RCX, RAX);
+            MOV_R(RAX, RCX);
+            break;
+        case DP_ADC:
+            BT_MI(StateArg(STATE_OFFSET(CFlag)), 0);
+            ALU_R(ALU_ADC, RAX, RCX);
+            break;
+        // x86 borrows where ARM carries, so the carry is inverted around SBB
+        case DP_SBC:
+            BT_MI(StateArg(STATE_OFFSET(CFlag)), 0);
+            CMC();
+            ALU_R(ALU_SBB, RAX, RCX);
+            break;
+        case DP_RSC:
+            BT_MI(StateArg(STATE_OFFSET(CFlag)), 0);
+            CMC();
+            ALU_R(ALU_SBB, RCX, RAX);
+            MOV_R(RAX, RCX);
+            break;
+        }
+
+        if (set_flags && logical)
+            TEST_R(RAX, RAX);
+
+        if (op.opcode < DP_TST || op.opcode > DP_CMN)
+            StoreGuest(op.rd, RAX);
+
+        if (!set_flags)
+            return;
+
+        if (!logical) {
+            StoreArithmeticFlags(op.opcode != DP_ADD && op.opcode != DP_ADC && op.opcode != DP_CMN);
+            return;
+        }
+
+        StoreFlag(CC_S, STATE_OFFSET(NFlag));
+        StoreFlag(CC_Z, STATE_OFFSET(ZFlag));
+        if (carry == CARRY_CONSTANT) {
+            MOV_MI(StateArg(STATE_OFFSET(CFlag)), op.imm >> 31);
+        } else if (carry == CARRY_IN_DL) {
+            MOVZX8_R(RDX, RDX);
+            MOV_MR(StateArg(STATE_OFFSET(CFlag)), RDX);
+        }
+    }
+
+    /// Computes the address of a load/store in ECX, writing back the base register if needed
+    void EmitAddress(const DecodedOp& op, u32 addr) {
+        const ALUOp offset_op = (op.flags & FLAG_UP) ? ALU_ADD : ALU_SUB;
+
+        LoadGuest(RCX, op.rn, addr);
+        if (op.flags & FLAG_PRE_INDEX) {
+            if (op.imm)
+                ALU_RI(offset_op, RCX, op.imm);
+            if (op.flags & FLAG_WRITEBACK)
+                StoreGuest(op.rn, RCX);
+        } else {
+            MOV_R(RAX, RCX);
+            ALU_RI(offset_op, RAX, op.imm);
+            StoreGuest(op.rn, RAX);
+        }
+    }
+
+    /// Emits a call to a function, with the stack already aligned by the prologue
+    void EmitCall(const void* function) {
+        MOV64_RI(RAX, (u64)function);
+        CALL_R(RAX);
+    }
+
+    /**
+     * Emits the start of a fastmem access: the access itself is emitted by the caller right after
+     * this, followed by EndFastmemAccess and the slow path.
+     * @return Host address of the access instruction
+     */
+    u8* BeginFastmemAccess() {
+        MOV64_RI(Gen::R11, (u64)Memory::g_base);
+        return GetCodePtr();
+    }
+
+    /**
+     * Finishes a fastmem access, making sure that it can be backpatched to a jump to the slow path,
+     * which is emitted right after this
+     * @param access Host address of the access instruction, as returned by BeginFastmemAccess
+     * @return Pointer to pass to SetJumpTarget after the slow path
+     */
+    u8* EndFastmemAccess(u8* access) {
+        while (GetCodePtr() < access + BACKPATCH_SIZE)
+            NOP();
+        u8* done = J();
+        g_fastmem_sites[access] = GetCodePtr();
+        return done;
+    }
+
+    void EmitLoad(const DecodedOp& op, u32 addr) {
+        const bool byte = (op.type == OP_LDRB);
+
+        EmitAddress(op, addr);
+        ALU_MI(ALU_ADD, StateArg(STATE_OFFSET(NumNcycles)), 1);
+        ALU_MI(ALU_ADD, StateArg(STATE_OFFSET(NumIcycles)), 1);
+        if (!byte)
+            MOV_MR(ScratchArg(), RCX);
+
+        u8* done;
+        if (use_fastmem) {
+            // Fast path: access the guest address space mirror, I/O, unmapped and read-watched
+            // pages fault
+            u8* access = BeginFastmemAccess();
+            if (byte)
+                MOVZX8_RM(RAX, MIndex(Gen::R11, RCX, 1));
+            else
+                MOV_RM(RAX, MIndex(Gen::R11, RCX, 1));
+            done = EndFastmemAccess(access);
+        } else {
+            // Fast path: the read page table has no entry for I/O and read-watched pages
+            MOV_R(RDX, RCX);
+            SHIFT_RI(SHIFT_SHR, RDX, Memory::PAGE_BITS);
+            MOV64_RI(RAX, (u64)Memory::g_page_read_pointers);
+            MOV64_RM(RAX, MIndex(RAX, RDX, 8));
+            TEST64_R(RAX, RAX);
+            u8* slow = J_CC(CC_Z);
+            ALU_RI(ALU_AND, RCX, Memory::PAGE_MASK);
+            if (byte)
+                MOVZX8_RM(RAX, MIndex(RAX, RCX, 1));
+            else
+                MOV_RM(RAX, MIndex(RAX, RCX, 1));
+            done = J();
+            SetJumpTarget(slow);
+        }
+
+        // Slow path: call into Memory for I/O, unmapped and read-watched pages
+        if (ABI_PARAM1 != RCX)
+            MOV_R(ABI_PARAM1, RCX);
+        if (byte) {
+            EmitCall((const void*)&Memory::Read8);
+            MOVZX8_R(RAX, RAX);
+        } else {
+            EmitCall((const void*)&Memory::Read32);
+        }
+        SetJumpTarget(done);
+
+        // Unaligned word loads rotate the aligned word, like ARMul_Align
+        if (!byte) {
+            MOV_RM(RCX, ScratchArg());
+            ALU_RI(ALU_AND, RCX, 3);
+            SHIFT_RI(SHIFT_SHL, RCX, 3);
+            SHIFT_RCL(SHIFT_ROR, RAX);
+        }
+        StoreGuest(op.rd, RAX);
+    }
+
+    /**
+     * Emits a store
+     * @param op Decoded instruction
+     * @param addr Guest address of the instruction
+     * @param num_executed Number of instructions executed when the store completes
+     */
+    void EmitStore(const DecodedOp& op, u32 addr, u32 num_executed) {
+        const bool byte = (op.type == OP_STRB);
+
+        EmitAddress(op, addr);
+        LoadGuest(Gen::R10, op.rd, addr);
+        ALU_MI(ALU_ADD, StateArg(STATE_OFFSET(NumNcycles)), 1);
+
+        u8* done;
+        if (use_fastmem) {
+            // Fast path: access the guest address space mirror, where I/O and unmapped pages
+            // fault, and write-watched pages are read-only
+            u8* access = BeginFastmemAccess();
+            if (byte)
+                MOV8_MR(MIndex(Gen::R11, RCX, 1), Gen::R10);
+            else
+                MOV_MR(MIndex(Gen::R11, RCX, 1), Gen::R10);
+            done = EndFastmemAccess(access);
+        } else {
+            // Fast path: the write page table has no entry for I/O and write-watched pages
+            MOV_R(RDX, RCX);
+            SHIFT_RI(SHIFT_SHR, RDX, Memory::PAGE_BITS);
+            MOV64_RI(Gen::R11, (u64)Memory::g_page_write_pointers);
+            MOV64_RM(Gen::R11, MIndex(Gen::R11, RDX, 8));
+            TEST64_R(Gen::R11, Gen::R11);
+            u8* slow = J_CC(CC_Z);
+            ALU_RI(ALU_AND, RCX, Memory::PAGE_MASK);
+            if (byte)
+                MOV8_MR(MIndex(Gen::R11, RCX, 1), Gen::R10);
+            else
+                MOV_MR(MIndex(Gen::R11, RCX, 1), Gen::R10);
+            done = J();
+            SetJumpTarget(slow);
+        }
+
+        // Slow path: the write may have invalidated this block, in which case leave it
+        if (ABI_PARAM1 != RCX)
+            MOV_R(ABI_PARAM1, RCX);
+        if (byte) {
+            MOVZX8_R(ABI_PARAM2, Gen::R10);
+            EmitCall((const void*)&Memory::Write8);
+        } else {
+            MOV_R(ABI_PARAM2, Gen::R10);
+            EmitCall((const void*)&Memory::Write32);
+        }
+        MOV64_RI(RAX, (u64)&g_invalidated);
+        CMP8_MI(MDisp(RAX, 0), 0);
+        u8* still_valid = J_CC(CC_E);
+        EmitExit(addr, addr + 4, num_executed);
+        SetJumpTarget(still_valid);
+
+        SetJumpTarget(done);
+    }
+
+    const u32 start;
+    const std::vector<DecodedOp>& ops;
+    const bool use_fastmem;         ///< Whether memory is accessed through Memory::g_base
+
+    X64Reg host_reg[16];            ///< Host register holding each guest register, if any
+    std::vector<int> allocated;     ///< Guest registers held in host registers
+    std::vector<u8*> skip_jumps;    ///< Jumps to patch to the end of the current instruction
+};
+
+#undef STATE_OFFSET
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Block management
+
+/// Frees all compiled blocks, and the code they were compiled to
+static void Clear() {
+    for (std::map<u32, Block*>::iterator it = g_blocks.begin(); it != g_blocks.end(); ++it) {
+        Memory::UnwatchPageWrites(it->first);
+        delete it->second;
+    }
+    g_blocks.clear();
+    g_fastmem_sites.clear();
+    memset(g_lookup, 0, sizeof(g_lookup));
+    g_code_ptr = g_code_space;
+    g_invalidated = true;
+}
+
+/**
+ * Compiles the basic block starting at a guest address
+ * @param start Guest address of the first instruction
+ * @return The new block, which has no code if the first instruction is not supported
+ */
+static Block* Compile(const u32 start) {
+    if (g_code_ptr + MAX_BLOCK_CODE_SIZE > g_code_space + CODE_CACHE_SIZE) {
+        INFO_LOG(DYNA_REC, "Code cache full, clearing");
+        Clear();
+    }
+
+    std::vector<DecodedOp> ops;
+    DecodeBlock(start, ops);
+
+    Block* block = new Block;
+    block->start = start;
+    block->num_ops = (u32)ops.size();
+    block->entry = NULL;
+    block->idle_loop = Core::g_detect_idle_loops && IsIdleLoop(start, ops);
+
+    if (!ops.empty()) {
+        BlockCompiler compiler(g_code_ptr, start, ops);
+        block->entry = compiler.Compile();
+        g_code_ptr = compiler.GetCodePtr();
+        _assert_msg_(DYNA_REC, g_code_ptr <= (u8*)block->entry + MAX_BLOCK_CODE_SIZE,
+            "block at 0x%08X overflowed its code size", start);
+    }
+
+    g_blocks[start] = block;
+    Memory::WatchPageWrites(start);
+
+    return block;
+}
+
+static inline const Block* GetBlock(const u32 addr) {
+    Block*& entry = g_lookup[(addr >> 2) & LOOKUP_TABLE_MASK];
+    if (entry && entry->start == addr)
+        return entry;
+
+    std::map<u32, Block*>::iterator it = g_blocks.find(addr);
+    entry = (it != g_blocks.end()) ? it->second : Compile(addr);
+    return entry;
+}
+
+/**
+ * Invalidates the blocks in the pages overlapping a guest address range. Their code is only
+ * reclaimed once the code cache is cleared, so a block may safely return after invalidating itself.
+ */
+static void OnWatchedWrite(u32 addr, u32 size) {
+    const u32 start = addr & ~Memory::PAGE_MASK;
+    const u64 end = ((u64)addr + size + Memory::PAGE_MASK) & ~(u64)Memory::PAGE_MASK;
+
+    std::map<u32, Block*>::iterator it = g_blocks.lower_bound(start);
+    while (it != g_blocks.end() && it->first < end) {
+        Block*& entry = g_lookup[(it->first >> 2) & LOOKUP_TABLE_MASK];
+        if (entry == it->second)
+            entry = NULL;
+
+        Memory::UnwatchPageWrites(it->first);
+        delete it->second;
+        g_blocks.erase(it++);
+        g_invalidated = true;
+    }
+}
+
+static void Init() {
+    g_code_space = (u8*)AllocateExecutableMemory(CODE_CACHE_SIZE);
+    g_code_ptr = g_code_space;
+    memset(g_lookup, 0, sizeof(g_lookup));
+    Memory::RegisterWriteWatchCallback(OnWatchedWrite);
+    InstallFastmemHandler();
+}
+
+static void Shutdown() {
+    Clear();
+    RemoveFastmemHandler();
+    Memory::UnregisterWriteWatchCallback(OnWatchedWrite);
+    FreeMemoryPages(g_code_space, CODE_CACHE_SIZE);
+    g_code_space = g_code_ptr = NULL;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ARM_JIT::ARM_JIT() {
+    if (JitCache::g_num_users++ == 0)
+        JitCache::Init();
+}
+
+ARM_JIT::~ARM_JIT() {
+    if (--JitCache::g_num_users == 0)
+        JitCache::Shutdown();
+}
+
+/**
+ * Executes the given number of instructions
+ * @param num_instructions Number of instructions to executes
+ */
+void ARM_JIT::ExecuteInstructions(int num_instructions) {
+    while (num_instructions > 0 && down_count > 0 && !HLE::g_reschedule) {
+        if (!BlockCache::CanExecute(state)) {
+            // Interpret in short batches, like the interpreter core does
+            int executed = 1;
+            if (Profiler::g_enabled) {
+                InterpretProfiled();
+            } else {
+                executed = std::min<int>(num_instructions, ARMDecoder::MAX_BLOCK_OPS);
+                state->NumInstrsToExecute = executed - 1;
+                ARMul_Emulate32(state);
+            }
+            num_instructions -= executed;
+            AddTicks(executed);
+            continue;
+        }
+
+        const u32 pc = (state->NextInstr < PRIMEPIPE) ? state->pc + 4 : state->Reg[15];
+        const JitCache::Block* block = JitCache::GetBlock(pc);
+
+        // Blocks always run to completion, so the tail of a time slice is interpreted
+        if (block->num_ops == 0 || (int)block->num_ops > num_instructions) {
+            if (Profiler::g_enabled) {
+                InterpretProfiled();
+            } else {
+                state->NumInstrsToExecute = 0;
+                ARMul_Emulate32(state);
+            }
+            num_instructions--;
+            AddTicks(1);
+            continue;
+        }
+
+        const u64 instructions_before = state->NumInstrs;
+        const u32 cycles_before = Profiler::GetCycles(state);
+        const bool idle_loop = block->idle_loop;
+        JitCache::g_invalidated = false;
+
+        state->Reg[15] = block->entry(state);
+        state->NextInstr = RESUME;
+
+        const int executed = (int)(state->NumInstrs - instructions_before);
+        if (Profiler::g_enabled)
+            Profiler::RecordBlock(pc, executed, Profiler::GetCycles(state) - cycles_before);
+        num_instructions -= executed;
+        AddTicks(executed);
+
+        // Nothing will happen until the next event once an idle loop branches back to itself
+        if (idle_loop && state->Reg[15] == pc) {
+            std::lock_guard<std::recursive_mutex> lock(HLE::g_mutex);
+            CoreTiming::Idle();
+        }
+    }
+}
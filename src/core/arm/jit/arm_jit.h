@@ -0,0 +1,35 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common.h"
+
+#include "core/arm/interpreter/arm_interpreter.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// x86-64 dynamic recompiler
+//
+// ARM basic blocks made of the instructions understood by ARMDecoder are compiled to x86-64 code,
+// with the most used guest registers of each block kept in host registers. Memory is accessed
+// through the fastmem mirror at Memory::g_base where the host supports it, with faulting accesses
+// patched to call into Memory, and through inline page table lookups otherwise. Everything else
+// (Thumb code, unsupported encodings, MMU enabled) is executed by the interpreter this class
+// derives from, which also owns the CPU state.
+
+class ARM_JIT : public ARM_Interpreter {
+public:
+
+    ARM_JIT();
+    ~ARM_JIT();
+
+protected:
+
+    /**
+     * Executes the given number of instructions
+     * @param num_instructions Number of instructions to executes
+     */
+    void ExecuteInstructions(int num_instructions);
+
+};
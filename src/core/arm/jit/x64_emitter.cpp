@@ -0,0 +1,434 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <cstring>
+
+#include "common/common.h"
+
+#include "core/arm/jit/x64_emitter.h"
+
+namespace Gen {
+
+static inline bool FitsInS8(s32 value) {
+    return value >= -128 && value <= 127;
+}
+
+void XEmitter::Write8(u8 value) {
+    *code++ = value;
+}
+
+void XEmitter::Write32(u32 value) {
+    memcpy(code, &value, sizeof(value));
+    code += sizeof(value);
+}
+
+void XEmitter::Write64(u64 value) {
+    memcpy(code, &value, sizeof(value));
+    code += sizeof(value);
+}
+
+/**
+ * Emits a REX prefix if one is needed
+ * @param w Use 64-bit operand size
+ * @param reg Register in the ModRM reg field
+ * @param index Register in the SIB index field, or INVALID_REG
+ * @param base Register in the ModRM rm or SIB base field
+ * @param byte_regs Force a prefix so that registers 4-7 refer to SPL-DIL rather than AH-BH
+ */
+void XEmitter::Rex(bool w, int reg, int index, int base, bool byte_regs) {
+    if (index == INVALID_REG)
+        index = 0;
+
+    const u8 rex = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((index & 8) ? 2 : 0) |
+        ((base & 8) ? 1 : 0);
+    if (rex != 0x40 || byte_regs)
+        Write8(rex);
+}
+
+/// Emits a ModRM byte (with SIB and displacement as needed) for a memory operand
+void XEmitter::ModRM(int reg, const MemArg& arg) {
+    const int base = arg.base & 7;
+
+    int mod;
+    if (arg.disp == 0 && base != RBP)
+        mod = 0;
+    else if (FitsInS8(arg.disp))
+        mod = 1;
+    else
+        mod = 2;
+
+    if (arg.index != INVALID_REG || base == RSP) {
+        int scale_bits = 0;
+        switch (arg.scale) {
+        case 1: scale_bits = 0; break;
+        case 2: scale_bits = 1; break;
+        case 4: scale_bits = 2; break;
+        case 8: scale_bits = 3; break;
+        default: _dbg_assert_msg_(DYNA_REC, false, "invalid scale %d", arg.scale); break;
+        }
+        const int index = (arg.index != INVALID_REG) ? (arg.index & 7) : RSP;
+
+        Write8((mod << 6) | ((reg & 7) << 3) | RSP);
+        Write8((scale_bits << 6) | (index << 3) | base);
+    } else {
+        Write8((mod << 6) | ((reg & 7) << 3) | base);
+    }
+
+    if (mod == 1)
+        Write8((u8)arg.disp);
+    else if (mod == 2)
+        Write32((u32)arg.disp);
+}
+
+/// Emits a ModRM byte for a register operand
+void XEmitter::ModRM_R(int reg, int rm) {
+    Write8(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void XEmitter::MOV_R(X64Reg dst, X64Reg src) {
+    Rex(false, src, INVALID_REG, dst);
+    Write8(0x89);
+    ModRM_R(src, dst);
+}
+
+void XEmitter::MOV_RI(X64Reg dst, u32 imm) {
+    Rex(false, 0, INVALID_REG, dst);
+    Write8(0xB8 + (dst & 7));
+    Write32(imm);
+}
+
+void XEmitter::MOV_RM(X64Reg dst, const MemArg& src) {
+    Rex(false, dst, src.index, src.base);
+    Write8(0x8B);
+    ModRM(dst, src);
+}
+
+void XEmitter::MOV_MR(const MemArg& dst, X64Reg src) {
+    Rex(false, src, dst.index, dst.base);
+    Write8(0x89);
+    ModRM(src, dst);
+}
+
+void XEmitter::MOV_MI(const MemArg& dst, u32 imm) {
+    Rex(false, 0, dst.index, dst.base);
+    Write8(0xC7);
+    ModRM(0, dst);
+    Write32(imm);
+}
+
+void XEmitter::MOVZX8_R(X64Reg dst, X64Reg src) {
+    Rex(false, dst, INVALID_REG, src, src >= RSP);
+    Write8(0x0F);
+    Write8(0xB6);
+    ModRM_R(dst, src);
+}
+
+void XEmitter::MOVZX8_RM(X64Reg dst, const MemArg& src) {
+    Rex(false, dst, src.index, src.base);
+    Write8(0x0F);
+    Write8(0xB6);
+    ModRM(dst, src);
+}
+
+void XEmitter::MOV8_MR(const MemArg& dst, X64Reg src) {
+    Rex(false, src, dst.index, dst.base, src >= RSP);
+    Write8(0x88);
+    ModRM(src, dst);
+}
+
+void XEmitter::MOV64_R(X64Reg dst, X64Reg src) {
+    Rex(true, src, INVALID_REG, dst);
+    Write8(0x89);
+    ModRM_R(src, dst);
+}
+
+void XEmitter::MOV64_RI(X64Reg dst, u64 imm) {
+    Rex(true, 0, INVALID_REG, dst);
+    Write8(0xB8 + (dst & 7));
+    Write64(imm);
+}
+
+void XEmitter::MOV64_RM(X64Reg dst, const MemArg& src) {
+    Rex(true, dst, src.index, src.base);
+    Write8(0x8B);
+    ModRM(dst, src);
+}
+
+void XEmitter::LEA64_RIP(X64Reg dst, const void* target) {
+    Rex(true, dst, INVALID_REG, 0);
+    Write8(0x8D);
+    Write8(((dst & 7) << 3) | 5);
+    const s64 disp = (const u8*)target - (code + 4);
+    _dbg_assert_msg_(DYNA_REC, disp == (s32)disp, "LEA target out of range");
+    Write32((u32)(s32)disp);
+}
+
+void XEmitter::ALU_R(ALUOp op, X64Reg dst, X64Reg src) {
+    Rex(false, src, INVALID_REG, dst);
+    Write8((op << 3) | 1);
+    ModRM_R(src, dst);
+}
+
+void XEmitter::ALU_RI(ALUOp op, X64Reg dst, u32 imm) {
+    Rex(false, 0, INVALID_REG, dst);
+    if (FitsInS8((s32)imm)) {
+        Write8(0x83);
+        ModRM_R(op, dst);
+        Write8((u8)imm);
+    } else {
+        Write8(0x81);
+        ModRM_R(op, dst);
+        Write32(imm);
+    }
+}
+
+void XEmitter::ALU_RM(ALUOp op, X64Reg dst, const MemArg& src) {
+    Rex(false, dst, src.index, src.base);
+    Write8((op << 3) | 3);
+    ModRM(dst, src);
+}
+
+void XEmitter::ALU_MI(ALUOp op, const MemArg& dst, u32 imm) {
+    Rex(false, 0, dst.index, dst.base);
+    if (FitsInS8((s32)imm)) {
+        Write8(0x83);
+        ModRM(op, dst);
+        Write8((u8)imm);
+    } else {
+        Write8(0x81);
+        ModRM(op, dst);
+        Write32(imm);
+    }
+}
+
+void XEmitter::TEST_R(X64Reg a, X64Reg b) {
+    Rex(false, b, INVALID_REG, a);
+    Write8(0x85);
+    ModRM_R(b, a);
+}
+
+void XEmitter::NOT(X64Reg reg) {
+    Rex(false, 0, INVALID_REG, reg);
+    Write8(0xF7);
+    ModRM_R(2, reg);
+}
+
+void XEmitter::SHIFT_RI(ShiftOp op, X64Reg reg, u8 amount) {
+    Rex(false, 0, INVALID_REG, reg);
+    Write8(0xC1);
+    ModRM_R(op, reg);
+    Write8(amount);
+}
+
+void XEmitter::SHIFT_RCL(ShiftOp op, X64Reg reg) {
+    Rex(false, 0, INVALID_REG, reg);
+    Write8(0xD3);
+    ModRM_R(op, reg);
+}
+
+void XEmitter::BT_RI(X64Reg reg, u8 bit) {
+    Rex(false, 0, INVALID_REG, reg);
+    Write8(0x0F);
+    Write8(0xBA);
+    ModRM_R(4, reg);
+    Write8(bit);
+}
+
+void XEmitter::BT_MI(const MemArg& arg, u8 bit) {
+    Rex(false, 0, arg.index, arg.base);
+    Write8(0x0F);
+    Write8(0xBA);
+    ModRM(4, arg);
+    Write8(bit);
+}
+
+void XEmitter::CMC() {
+    Write8(0xF5);
+}
+
+void XEmitter::SETcc(CCFlags cc, X64Reg reg) {
+    Rex(false, 0, INVALID_REG, reg, reg >= RSP);
+    Write8(0x0F);
+    Write8(0x90 + cc);
+    ModRM_R(0, reg);
+}
+
+void XEmitter::ALU64_RI(ALUOp op, X64Reg dst, s32 imm) {
+    Rex(true, 0, INVALID_REG, dst);
+    if (FitsInS8(imm)) {
+        Write8(0x83);
+        ModRM_R(op, dst);
+        Write8((u8)imm);
+    } else {
+        Write8(0x81);
+        ModRM_R(op, dst);
+        Write32((u32)imm);
+    }
+}
+
+void XEmitter::ALU64_MR(ALUOp op, const MemArg& dst, X64Reg src) {
+    Rex(true, src, dst.index, dst.base);
+    Write8((op << 3) | 1);
+    ModRM(src, dst);
+}
+
+void XEmitter::TEST64_R(X64Reg a, X64Reg b) {
+    Rex(true, b, INVALID_REG, a);
+    Write8(0x85);
+    ModRM_R(b, a);
+}
+
+void XEmitter::CMP8_MI(const MemArg& arg, u8 imm) {
+    Rex(false, 0, arg.index, arg.base);
+    Write8(0x80);
+    ModRM(7, arg);
+    Write8(imm);
+}
+
+/**
+ * Emits the prefixes and opcode of an SSE instruction, to be followed by its ModRM byte
+ * @param prefix Mandatory prefix, or 0 for none
+ * @param opcode Opcode bytes following the 0x0F escape, a second escape byte in the high byte
+ * @param reg Register in the ModRM reg field
+ * @param index Register in the SIB index field, or INVALID_REG
+ * @param base Register in the ModRM rm or SIB base field
+ */
+void XEmitter::SSEOpcode(u8 prefix, u16 opcode, int reg, int index, int base) {
+    if (prefix)
+        Write8(prefix);
+    Rex(false, reg, index, base);
+    Write8(0x0F);
+    if (opcode > 0xFF)
+        Write8((u8)(opcode >> 8));
+    Write8((u8)opcode);
+}
+
+void XEmitter::MOVAPS_R(X64Reg dst, X64Reg src) {
+    SSEOpcode(0, 0x28, dst, INVALID_REG, src);
+    ModRM_R(dst, src);
+}
+
+void XEmitter::MOVAPS_RM(X64Reg dst, const MemArg& src) {
+    SSEOpcode(0, 0x28, dst, src.index, src.base);
+    ModRM(dst, src);
+}
+
+void XEmitter::MOVAPS_MR(const MemArg& dst, X64Reg src) {
+    SSEOpcode(0, 0x29, src, dst.index, dst.base);
+    ModRM(src, dst);
+}
+
+void XEmitter::MOVSS_RM(X64Reg dst, const MemArg& src) {
+    SSEOpcode(0xF3, 0x10, dst, src.index, src.base);
+    ModRM(dst, src);
+}
+
+void XEmitter::PS_R(SSEOp op, X64Reg dst, X64Reg src) {
+    SSEOpcode(0, op, dst, INVALID_REG, src);
+    ModRM_R(dst, src);
+}
+
+void XEmitter::PS_RM(SSEOp op, X64Reg dst, const MemArg& src) {
+    SSEOpcode(0, op, dst, src.index, src.base);
+    ModRM(dst, src);
+}
+
+void XEmitter::SS_R(SSEOp op, X64Reg dst, X64Reg src) {
+    SSEOpcode(0xF3, op, dst, INVALID_REG, src);
+    ModRM_R(dst, src);
+}
+
+void XEmitter::SHUFPS_R(X64Reg dst, X64Reg src, u8 shuffle) {
+    SSEOpcode(0, 0xC6, dst, INVALID_REG, src);
+    ModRM_R(dst, src);
+    Write8(shuffle);
+}
+
+void XEmitter::CMPPS_R(X64Reg dst, X64Reg src, SSECompare predicate) {
+    SSEOpcode(0, 0xC2, dst, INVALID_REG, src);
+    ModRM_R(dst, src);
+    Write8(predicate);
+}
+
+void XEmitter::MOVMSKPS_R(X64Reg dst, X64Reg src) {
+    SSEOpcode(0, 0x50, dst, INVALID_REG, src);
+    ModRM_R(dst, src);
+}
+
+void XEmitter::CVTTSS2SI_R(X64Reg dst, X64Reg src) {
+    SSEOpcode(0xF3, 0x2C, dst, INVALID_REG, src);
+    ModRM_R(dst, src);
+}
+
+void XEmitter::BLENDPS_R(X64Reg dst, X64Reg src, u8 mask) {
+    SSEOpcode(0x66, 0x3A0C, dst, INVALID_REG, src);
+    ModRM_R(dst, src);
+    Write8(mask);
+}
+
+void XEmitter::DPPS_R(X64Reg dst, X64Reg src, u8 mask) {
+    SSEOpcode(0x66, 0x3A40, dst, INVALID_REG, src);
+    ModRM_R(dst, src);
+    Write8(mask);
+}
+
+void XEmitter::ROUNDPS_R(X64Reg dst, X64Reg src, u8 mode) {
+    SSEOpcode(0x66, 0x3A08, dst, INVALID_REG, src);
+    ModRM_R(dst, src);
+    Write8(mode);
+}
+
+void XEmitter::PUSH(X64Reg reg) {
+    Rex(false, 0, INVALID_REG, reg);
+    Write8(0x50 + (reg & 7));
+}
+
+void XEmitter::POP(X64Reg reg) {
+    Rex(false, 0, INVALID_REG, reg);
+    Write8(0x58 + (reg & 7));
+}
+
+void XEmitter::CALL_R(X64Reg reg) {
+    Rex(false, 0, INVALID_REG, reg);
+    Write8(0xFF);
+    ModRM_R(2, reg);
+}
+
+void XEmitter::RET() {
+    Write8(0xC3);
+}
+
+void XEmitter::NOP() {
+    Write8(0x90);
+}
+
+u8* XEmitter::J_CC(CCFlags cc) {
+    Write8(0x0F);
+    Write8(0x80 + cc);
+    Write32(0);
+    return code;
+}
+
+u8* XEmitter::J() {
+    Write8(0xE9);
+    Write32(0);
+    return code;
+}
+
+u8* XEmitter::CALL() {
+    Write8(0xE8);
+    Write32(0);
+    return code;
+}
+
+void XEmitter::SetJumpTarget(u8* jump) {
+    SetJumpTarget(jump, code);
+}
+
+void XEmitter::SetJumpTarget(u8* jump, const u8* target) {
+    const s32 displacement = (s32)(target - jump);
+    memcpy(jump - 4, &displacement, sizeof(displacement));
+}
+
+} // namespace
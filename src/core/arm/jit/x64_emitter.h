@@ -0,0 +1,221 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Minimal x86-64 machine code emitter, covering the instructions used by the ARM JIT and the
+// vertex shader JIT
+
+namespace Gen {
+
+/// x86-64 general purpose registers
+enum X64Reg {
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+
+    XMM0 = 0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7,
+    XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15,
+
+    INVALID_REG = 0xFF,
+};
+
+/// x86 condition codes, as encoded in Jcc and SETcc
+enum CCFlags {
+    CC_O = 0, CC_NO, CC_B, CC_AE, CC_E, CC_NE, CC_BE, CC_A,
+    CC_S, CC_NS, CC_P, CC_NP, CC_L, CC_GE, CC_LE, CC_G,
+    CC_C = CC_B, CC_NC = CC_AE, CC_Z = CC_E, CC_NZ = CC_NE,
+};
+
+/// Group 1 ALU operations, in the order of their /digit encoding
+enum ALUOp {
+    ALU_ADD = 0, ALU_OR, ALU_ADC, ALU_SBB, ALU_AND, ALU_SUB, ALU_XOR, ALU_CMP,
+};
+
+/// Group 2 shift and rotate operations, in the order of their /digit encoding
+enum ShiftOp {
+    SHIFT_ROL = 0, SHIFT_ROR, SHIFT_RCL, SHIFT_RCR, SHIFT_SHL, SHIFT_SHR, SHIFT_SAL, SHIFT_SAR,
+};
+
+/// SSE arithmetic operations on floats, as encoded in their second opcode byte
+enum SSEOp {
+    SSE_SQRT = 0x51, SSE_AND = 0x54, SSE_ANDN = 0x55, SSE_OR = 0x56, SSE_XOR = 0x57,
+    SSE_ADD = 0x58, SSE_MUL = 0x59, SSE_SUB = 0x5C, SSE_MIN = 0x5D, SSE_DIV = 0x5E, SSE_MAX = 0x5F,
+};
+
+/// Predicates of CMPPS
+enum SSECompare {
+    SSE_CMP_EQ = 0, SSE_CMP_LT, SSE_CMP_LE, SSE_CMP_UNORD,
+    SSE_CMP_NEQ, SSE_CMP_NLT, SSE_CMP_NLE, SSE_CMP_ORD,
+};
+
+/// A memory operand of the form [base + index * scale + disp]
+struct MemArg {
+    X64Reg  base;
+    X64Reg  index;
+    u8      scale;      ///< 1, 2, 4 or 8
+    s32     disp;
+};
+
+/// Returns a [base + disp] memory operand
+inline MemArg MDisp(X64Reg base, s32 disp) {
+    MemArg arg = { base, INVALID_REG, 1, disp };
+    return arg;
+}
+
+/// Returns a [base + index * scale] memory operand
+inline MemArg MIndex(X64Reg base, X64Reg index, u8 scale) {
+    MemArg arg = { base, index, scale, 0 };
+    return arg;
+}
+
+// Calling convention of the host
+#ifdef _WIN32
+const X64Reg ABI_PARAM1 = RCX;
+const X64Reg ABI_PARAM2 = RDX;
+const X64Reg ABI_PARAM3 = R8;
+const X64Reg ABI_PARAM4 = R9;
+const int ABI_SHADOW_SPACE = 32;
+#else
+const X64Reg ABI_PARAM1 = RDI;
+const X64Reg ABI_PARAM2 = RSI;
+const X64Reg ABI_PARAM3 = RDX;
+const X64Reg ABI_PARAM4 = RCX;
+const int ABI_SHADOW_SPACE = 0;
+#endif
+
+class XEmitter {
+public:
+    XEmitter() : code(NULL) {
+    }
+
+    /**
+     * Sets the buffer that code is emitted to
+     * @param ptr Pointer to writable and executable memory
+     */
+    void SetCodePtr(u8* ptr) {
+        code = ptr;
+    }
+
+    /// Gets the address the next instruction will be emitted at
+    u8* GetCodePtr() const {
+        return code;
+    }
+
+    // Raw bytes
+    void Write8(u8 value);
+    void Write32(u32 value);
+    void Write64(u64 value);
+
+    // 32-bit moves
+    void MOV_R(X64Reg dst, X64Reg src);
+    void MOV_RI(X64Reg dst, u32 imm);
+    void MOV_RM(X64Reg dst, const MemArg& src);
+    void MOV_MR(const MemArg& dst, X64Reg src);
+    void MOV_MI(const MemArg& dst, u32 imm);
+    void MOVZX8_R(X64Reg dst, X64Reg src);
+    void MOVZX8_RM(X64Reg dst, const MemArg& src);
+    void MOV8_MR(const MemArg& dst, X64Reg src);
+
+    // 64-bit moves
+    void MOV64_R(X64Reg dst, X64Reg src);
+    void MOV64_RI(X64Reg dst, u64 imm);
+    void MOV64_RM(X64Reg dst, const MemArg& src);
+
+    /**
+     * Loads the address of code or data next to it, keeping the emitted code position-independent
+     * @param dst Register to load to
+     * @param target Address within 2GB of the instruction
+     */
+    void LEA64_RIP(X64Reg dst, const void* target);
+
+    // 32-bit arithmetic
+    void ALU_R(ALUOp op, X64Reg dst, X64Reg src);
+    void ALU_RI(ALUOp op, X64Reg dst, u32 imm);
+    void ALU_RM(ALUOp op, X64Reg dst, const MemArg& src);
+    void ALU_MI(ALUOp op, const MemArg& dst, u32 imm);
+    void TEST_R(X64Reg a, X64Reg b);
+    void NOT(X64Reg reg);
+    void SHIFT_RI(ShiftOp op, X64Reg reg, u8 amount);
+    void SHIFT_RCL(ShiftOp op, X64Reg reg);
+    void BT_RI(X64Reg reg, u8 bit);
+    void BT_MI(const MemArg& arg, u8 bit);
+    void CMC();
+    void SETcc(CCFlags cc, X64Reg reg);
+
+    // 64-bit arithmetic
+    void ALU64_RI(ALUOp op, X64Reg dst, s32 imm);
+    void ALU64_MR(ALUOp op, const MemArg& dst, X64Reg src);
+    void TEST64_R(X64Reg a, X64Reg b);
+    void CMP8_MI(const MemArg& arg, u8 imm);
+
+    // SSE, operating on the XMM registers
+    void MOVAPS_R(X64Reg dst, X64Reg src);
+    void MOVAPS_RM(X64Reg dst, const MemArg& src);
+    void MOVAPS_MR(const MemArg& dst, X64Reg src);
+    void MOVSS_RM(X64Reg dst, const MemArg& src);
+    void PS_R(SSEOp op, X64Reg dst, X64Reg src);
+    void PS_RM(SSEOp op, X64Reg dst, const MemArg& src);
+    void SS_R(SSEOp op, X64Reg dst, X64Reg src);
+    void SHUFPS_R(X64Reg dst, X64Reg src, u8 shuffle);
+    void CMPPS_R(X64Reg dst, X64Reg src, SSECompare predicate);
+    void MOVMSKPS_R(X64Reg dst, X64Reg src);
+    void CVTTSS2SI_R(X64Reg dst, X64Reg src);
+
+    // SSE4.1
+    void BLENDPS_R(X64Reg dst, X64Reg src, u8 mask);
+    void DPPS_R(X64Reg dst, X64Reg src, u8 mask);
+    void ROUNDPS_R(X64Reg dst, X64Reg src, u8 mode);
+
+    // Control flow
+    void PUSH(X64Reg reg);
+    void POP(X64Reg reg);
+    void CALL_R(X64Reg reg);
+    void RET();
+    void NOP();
+
+    /**
+     * Emits a conditional jump with a 32-bit displacement to be filled in later
+     * @param cc Condition to jump on
+     * @return Pointer to pass to SetJumpTarget
+     */
+    u8* J_CC(CCFlags cc);
+
+    /**
+     * Emits an unconditional jump with a 32-bit displacement to be filled in later
+     * @return Pointer to pass to SetJumpTarget
+     */
+    u8* J();
+
+    /**
+     * Emits a call with a 32-bit displacement to be filled in later
+     * @return Pointer to pass to SetJumpTarget
+     */
+    u8* CALL();
+
+    /**
+     * Points a jump emitted by J_CC, J or CALL to the current code pointer
+     * @param jump Pointer returned by J_CC, J or CALL
+     */
+    void SetJumpTarget(u8* jump);
+
+    /**
+     * Points a jump emitted by J_CC, J or CALL to the given code
+     * @param jump Pointer returned by J_CC, J or CALL
+     * @param target Code to jump to
+     */
+    void SetJumpTarget(u8* jump, const u8* target);
+
+private:
+    void Rex(bool w, int reg, int index, int base, bool byte_regs = false);
+    void ModRM(int reg, const MemArg& arg);
+    void ModRM_R(int reg, int rm);
+    void SSEOpcode(u8 prefix, u16 opcode, int reg, int index, int base);
+
+    u8* code;
+};
+
+} // namespace
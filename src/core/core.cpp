@@ -2,38 +2,207 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "common/common_types.h"
 #include "common/log.h"
 #include "common/symbols.h"
+#include "common/thread.h"
 
 #include "core/core.h"
+#include "core/core_timing.h"
 #include "core/mem_map.h"
 #include "core/hw/hw.h"
+#include "core/arm/arm_profiler.h"
 #include "core/arm/disassembler/arm_disasm.h"
 #include "core/arm/interpreter/arm_interpreter.h"
+#include "core/arm/interpreter/arm_block_cache.h"
+#include "core/arm/jit/arm_jit.h"
 
+#include "core/hle/hle.h"
 #include "core/hle/kernel/thread.h"
 
 namespace Core {
 
+/// Cycles the system core may run ahead of the application core in MULTICORE_RELAXED mode
+static const s64 RELAXED_MAX_LEAD = 100000;
+
+/// Length of the time slices the system core runs in MULTICORE_RELAXED mode
+static const int RELAXED_SLICE_LENGTH = 20000;
+
 ARM_Disasm*     g_disasm    = NULL; ///< ARM disassembler
 ARM_Interface*  g_app_core  = NULL; ///< ARM11 application core
 ARM_Interface*  g_sys_core  = NULL; ///< ARM11 system (OS) core
 
+bool            g_detect_idle_loops = false;
+
+static THREAD_LOCAL int g_current_core_id = CORE_APP;  ///< CoreId run by the calling host thread
+
+static MultiCoreMode    g_multicore_mode = MULTICORE_DISABLED;
+static std::thread*     g_sys_thread = NULL;        ///< Host thread running the system core
+static volatile bool    g_sys_thread_stop = false;  ///< Set to make the system core thread exit
+static Common::Event    g_quantum_start;            ///< Lockstep: the system core may run
+static Common::Event    g_quantum_done;             ///< Lockstep: the system core has finished
+static int              g_quantum_length = 0;       ///< Lockstep: cycles to run the system core
+
+ARM_Interface* GetCurrentCore() {
+    return (g_current_core_id == CORE_SYS) ? g_sys_core : g_app_core;
+}
+
+CoreId GetCurrentCoreId() {
+    return (CoreId)g_current_core_id;
+}
+
+bool IsSysCoreEnabled() {
+    return g_multicore_mode != MULTICORE_DISABLED;
+}
+
+/// Switches threads on the calling thread's core if HLE asked for it
+static void HandleReschedule() {
+    if (HLE::g_reschedule) {
+        std::lock_guard<std::recursive_mutex> lock(HLE::g_mutex);
+        HLE::g_reschedule = false;
+        Kernel::Reschedule();
+    }
+}
+
+/// Handles scheduled events and thread switches requested while the CPU was running
+static void HandlePendingEvents() {
+    // Let the code caches know about writes the system core made to the code they translated
+    Memory::DeliverDeferredWriteWatches();
+
+    if (g_app_core->down_count <= 0) {
+        std::lock_guard<std::recursive_mutex> lock(HLE::g_mutex);
+        CoreTiming::Advance();
+        HW::Update();
+    }
+    HandleReschedule();
+}
+
+/**
+ * Runs the system core for a number of cycles, on the system core's thread
+ * @param cycles Number of cycles to run
+ * @return Number of cycles the system core actually ran for, 0 if it had no thread to run
+ */
+static int RunSysCore(int cycles) {
+    // Pick up the threads that the application core made ready
+    {
+        std::lock_guard<std::recursive_mutex> lock(HLE::g_mutex);
+        Kernel::Reschedule();
+        if (!Kernel::IsCurrentThreadRunning())
+            return 0;
+    }
+
+    g_sys_core->down_count = cycles;
+    while (g_sys_core->down_count > 0) {
+        g_sys_core->Run(g_sys_core->down_count);
+        if (HLE::g_reschedule) {
+            HandleReschedule();
+
+            std::lock_guard<std::recursive_mutex> lock(HLE::g_mutex);
+            if (!Kernel::IsCurrentThreadRunning())
+                break;
+        }
+    }
+    return cycles - std::max(g_sys_core->down_count, 0);
+}
+
+/// Entry point of the system core's host thread
+static void SysCoreThread() {
+    Common::SetCurrentThreadName("SysCore");
+    g_current_core_id = CORE_SYS;
+
+    if (g_multicore_mode == MULTICORE_LOCKSTEP) {
+        for (;;) {
+            g_quantum_start.Wait();
+            if (g_sys_thread_stop)
+                break;
+            RunSysCore(g_quantum_length);
+            g_quantum_done.Set();
+        }
+        return;
+    }
+
+    // Relaxed: run freely, keeping the system core's clock within RELAXED_MAX_LEAD cycles of
+    // CoreTiming's, which follows the application core
+    s64 ticks = 0;
+    while (!g_sys_thread_stop) {
+        s64 app_ticks;
+        {
+            std::lock_guard<std::recursive_mutex> lock(HLE::g_mutex);
+            app_ticks = (s64)CoreTiming::GetTicks();
+        }
+        if (ticks < app_ticks)
+            ticks = app_ticks;
+        if (ticks - app_ticks > RELAXED_MAX_LEAD) {
+            Common::YieldCPU();
+            continue;
+        }
+
+        const int executed = RunSysCore(RELAXED_SLICE_LENGTH);
+        if (executed == 0) {
+            // No thread to run, wait for the application core to make one ready
+            Common::SleepCurrentThread(1);
+        }
+        ticks += executed;
+    }
+}
+
+/// Starts the system core's host thread, once the kernel is up
+static void StartSysCoreThread() {
+    if (g_sys_thread || g_multicore_mode == MULTICORE_DISABLED)
+        return;
+
+    g_sys_thread_stop = false;
+    g_sys_thread = new std::thread(SysCoreThread);
+}
+
+/// Stops the system core's host thread
+static void StopSysCoreThread() {
+    if (!g_sys_thread)
+        return;
+
+    g_sys_thread_stop = true;
+    g_quantum_start.Set();
+    g_sys_thread->join();
+    delete g_sys_thread;
+    g_sys_thread = NULL;
+}
+
+/// Runs the application core until the end of its CoreTiming slice, switching threads as needed
+static void RunAppCoreSlice() {
+    while (g_app_core->down_count > 0) {
+        g_app_core->Run(g_app_core->down_count);
+        HandleReschedule();
+    }
+}
+
 /// Run the core CPU loop
 void RunLoop() {
+    StartSysCoreThread();
+
     for (;;){
-        g_app_core->Run(100);
-        HW::Update();
-        Kernel::Reschedule();
+        if (g_multicore_mode == MULTICORE_LOCKSTEP) {
+            // Both cores run the same slice in parallel, and meet up again before the events
+            // at its end are handled
+            g_quantum_length = g_app_core->down_count;
+            g_quantum_start.Set();
+            RunAppCoreSlice();
+            g_quantum_done.Wait();
+        } else {
+            // Run until the next scheduled event is due, or until HLE requests a thread switch
+            if (g_app_core->down_count > 0) {
+                g_app_core->Run(g_app_core->down_count);
+            }
+        }
+        HandlePendingEvents();
     }
 }
 
 /// Step the CPU one instruction
 void SingleStep() {
     g_app_core->Step();
-    HW::Update();
-    Kernel::Reschedule();
+    HandlePendingEvents();
 }
 
 /// Halt the core
@@ -47,17 +216,45 @@ void Stop() {
 }
 
 /// Initialize the core
-int Init() {
+int Init(CPUCoreType cpu_core, MultiCoreMode multicore_mode) {
     NOTICE_LOG(MASTER_LOG, "initialized OK");
 
+    g_current_core_id = CORE_APP;
+    g_multicore_mode = multicore_mode;
+
+#ifndef EMU_ARCHITECTURE_X64
+    if (cpu_core == CPU_JIT) {
+        ERROR_LOG(MASTER_LOG, "JIT is only supported on x86-64 hosts, using the interpreter");
+        cpu_core = CPU_INTERPRETER;
+    }
+#endif
+
     g_disasm = new ARM_Disasm();
-    g_app_core = new ARM_Interpreter();
-    g_sys_core = new ARM_Interpreter();
+    switch (cpu_core) {
+#ifdef EMU_ARCHITECTURE_X64
+    case CPU_JIT:
+        g_app_core = new ARM_JIT();
+        break;
+#endif
+    default:
+        g_app_core = new ARM_Interpreter();
+        break;
+    }
+
+    // The block cache and JIT are not thread-safe, so the system core, which may run on another
+    // host thread, only uses the interpreter
+    g_sys_core = new ARM_Interpreter(false);
+
+    BlockCache::Init();
 
     return 0;
 }
 
 void Shutdown() {
+    StopSysCoreThread();
+    Profiler::Shutdown();
+    BlockCache::Shutdown();
+
     delete g_disasm;
     delete g_app_core;
     delete g_sys_core;
@@ -11,9 +11,47 @@
 
 namespace Core {
 
+/// ARM11 CPU core implementations, selected at startup
+enum CPUCoreType {
+    CPU_INTERPRETER = 0,    ///< SkyEye interpreter, with the basic block cache
+    CPU_JIT,                ///< x86-64 dynamic recompiler (x86-64 hosts only)
+};
+
+/// How the system core is run alongside the application core
+enum MultiCoreMode {
+    MULTICORE_DISABLED = 0, ///< Only the application core runs, all threads are scheduled on it
+    MULTICORE_LOCKSTEP,     ///< The system core runs on its own host thread, in lockstep with the
+                            ///< application core for each CoreTiming slice
+    MULTICORE_RELAXED,      ///< The system core runs freely on its own host thread, at most
+                            ///< RELAXED_MAX_LEAD cycles ahead of the application core
+};
+
+/// Index of each ARM11 core
+enum CoreId {
+    CORE_APP = 0,           ///< Application core, which drives CoreTiming
+    CORE_SYS,               ///< System core
+    NUM_CORES,
+};
+
 extern ARM_Interface*   g_app_core;     ///< ARM11 application core
 extern ARM_Interface*   g_sys_core;     ///< ARM11 system (OS) core
 
+/// Whether the CPU cores detect idle loops (see IsIdleLoop) and skip to the next event after one
+/// iteration of them. Off by default, since a loop can be misdetected; set before Init.
+extern bool             g_detect_idle_loops;
+
+/**
+ * Gets the core running on the calling host thread, whose registers HLE functions operate on
+ * @return g_sys_core on the system core's thread, g_app_core on any other thread
+ */
+ARM_Interface* GetCurrentCore();
+
+/// Gets the CoreId of the core running on the calling host thread
+CoreId GetCurrentCoreId();
+
+/// Returns whether guest threads can be scheduled on the system core
+bool IsSysCoreEnabled();
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /// Start the core
@@ -31,8 +69,13 @@ void Halt(const char *msg);
 /// Kill the core
 void Stop();
 
-/// Initialize the core
-int Init();
+/**
+ * Initialize the core
+ * @param cpu_core CPU core implementation to use for the application core
+ * @param multicore_mode How to run the system core
+ * @return 0 on success
+ */
+int Init(CPUCoreType cpu_core = CPU_INTERPRETER, MultiCoreMode multicore_mode = MULTICORE_DISABLED);
 
 /// Shutdown the core
 void Shutdown();
@@ -2,6 +2,7 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <vector>
 #include <cstdio>
 
@@ -56,8 +57,8 @@ int allocatedTsEvents = 0;
 // Optimization to skip MoveEvents when possible.
 volatile u32 hasTsEvents = false;
 
-// Downcount has been moved to currentMIPS, to save a couple of clocks in every ARM JIT block
-// as we can already reach that structure through a register.
+// The downcount lives in the ARM core (ARM_Interface::down_count), which decrements it as it
+// executes instructions.
 int slicelength;
 
 MEMORY_ALIGNED16(s64) globalTimer;
@@ -144,8 +145,8 @@ void UnregisterAllEvents()
 
 void Init()
 {
-    //currentMIPS->downcount = INITIAL_SLICE_LENGTH;
-    //slicelength = INITIAL_SLICE_LENGTH;
+    Core::g_app_core->down_count = INITIAL_SLICE_LENGTH;
+    slicelength = INITIAL_SLICE_LENGTH;
     globalTimer = 0;
     idledCycles = 0;
     hasTsEvents = 0;
@@ -153,6 +154,8 @@ void Init()
 
 void Shutdown()
 {
+    INFO_LOG(TIME, "Idled for %lld of %lld cycles", idledCycles, globalTimer);
+
     MoveEvents();
     ClearPendingEvents();
     UnregisterAllEvents();
@@ -175,9 +178,13 @@ void Shutdown()
 
 u64 GetTicks()
 {
-    ERROR_LOG(TIME, "Unimplemented function!");
-    return 0;
-    //return (u64)globalTimer + slicelength - currentMIPS->downcount;
+    // The application core's host thread decrements its downcount without a lock, so the other
+    // cores read it atomically. They hold HLE::g_mutex, which keeps globalTimer and slicelength
+    // from changing under them.
+    int downcount = Core::g_app_core->down_count;
+    if (Core::GetCurrentCoreId() != Core::CORE_APP)
+        downcount = (int)Common::AtomicLoad(*(volatile u32*)&Core::g_app_core->down_count);
+    return (u64)globalTimer + slicelength - downcount;
 }
 
 u64 GetIdleTicks()
@@ -251,17 +258,39 @@ void AddEventToQueue(Event* ne)
 // than Advance 
 void ScheduleEvent(s64 cyclesIntoFuture, int event_type, u64 userdata)
 {
+    // Only the application core's host thread may shorten its slice. The system core hands its
+    // events over through the threadsafe queue, which is moved into the main one when the slice
+    // ends.
+    if (Core::GetCurrentCoreId() != Core::CORE_APP)
+    {
+        ScheduleEvent_Threadsafe(cyclesIntoFuture, event_type, userdata);
+        return;
+    }
+
     Event *ne = GetNewEvent();
     ne->userdata = userdata;
     ne->type = event_type;
     ne->time = GetTicks() + cyclesIntoFuture;
     AddEventToQueue(ne);
+
+    // If the event is due before the current slice ends, shorten the slice so that the CPU stops
+    // in time (this leaves GetTicks unchanged)
+    int& downcount = Core::g_app_core->down_count;
+    if (cyclesIntoFuture < downcount)
+    {
+        int cyclesCut = downcount - (int)std::max<s64>(cyclesIntoFuture, 0);
+        slicelength -= cyclesCut;
+        downcount -= cyclesCut;
+    }
 }
 
 // Returns cycles left in timer.
 s64 UnscheduleEvent(int event_type, u64 userdata)
 {
     s64 result = 0;
+    // Events the system core scheduled may not have been moved to the main queue yet
+    if (Common::AtomicLoadAcquire(hasTsEvents))
+        result = UnscheduleThreadsafeEvent(event_type, userdata);
     if (!first)
         return result;
     while (first)
@@ -509,29 +538,29 @@ void MoveEvents()
 
 void Advance()
 {
-    ERROR_LOG(TIME, "Unimplemented function!");
-    //int cyclesExecuted = slicelength - currentMIPS->downcount;
-    //globalTimer += cyclesExecuted;
-    //currentMIPS->downcount = slicelength;
-
-    //if (Common::AtomicLoadAcquire(hasTsEvents))
-    //	MoveEvents();
-    //ProcessFifoWaitEvents();
-
-    //if (!first)
-    //{
-    //	// WARN_LOG(TIMER, "WARNING - no events in queue. Setting currentMIPS->downcount to 10000");
-    //	currentMIPS->downcount += 10000;
-    //}
-    //else
-    //{
-    //	slicelength = (int)(first->time - globalTimer);
-    //	if (slicelength > MAX_SLICE_LENGTH)
-    //		slicelength = MAX_SLICE_LENGTH;
-    //	currentMIPS->downcount = slicelength;
-    //}
-    //if (advanceCallback)
-    //	advanceCallback(cyclesExecuted);
+    int cyclesExecuted = slicelength - Core::g_app_core->down_count;
+    globalTimer += cyclesExecuted;
+    Core::g_app_core->down_count = slicelength;
+
+    if (Common::AtomicLoadAcquire(hasTsEvents))
+        MoveEvents();
+    ProcessFifoWaitEvents();
+
+    if (!first)
+    {
+        // WARN_LOG(TIMER, "WARNING - no events in queue. Setting downcount to 10000");
+        slicelength = 10000;
+    }
+    else
+    {
+        slicelength = (int)(first->time - globalTimer);
+        if (slicelength > MAX_SLICE_LENGTH)
+            slicelength = MAX_SLICE_LENGTH;
+    }
+    Core::g_app_core->down_count = slicelength;
+
+    if (advanceCallback)
+        advanceCallback(cyclesExecuted);
 }
 
 void LogPendingEvents()
@@ -546,31 +575,30 @@ void LogPendingEvents()
 
 void Idle(int maxIdle)
 {
-    ERROR_LOG(TIME, "Unimplemented function!");
-    //int cyclesDown = currentMIPS->downcount;
-    //if (maxIdle != 0 && cyclesDown > maxIdle)
-    //	cyclesDown = maxIdle;
-
-    //if (first && cyclesDown > 0)
-    //{
-    //	int cyclesExecuted = slicelength - currentMIPS->downcount;
-    //	int cyclesNextEvent = (int) (first->time - globalTimer);
-
-    //	if (cyclesNextEvent < cyclesExecuted + cyclesDown)
-    //	{
-    //		cyclesDown = cyclesNextEvent - cyclesExecuted;
-    //		// Now, now... no time machines, please.
-    //		if (cyclesDown < 0)
-    //			cyclesDown = 0;
-    //	}
-    //}
+    int cyclesDown = Core::g_app_core->down_count;
+    if (maxIdle != 0 && cyclesDown > maxIdle)
+        cyclesDown = maxIdle;
+
+    if (first && cyclesDown > 0)
+    {
+        int cyclesExecuted = slicelength - Core::g_app_core->down_count;
+        int cyclesNextEvent = (int) (first->time - globalTimer);
+
+        if (cyclesNextEvent < cyclesExecuted + cyclesDown)
+        {
+            cyclesDown = cyclesNextEvent - cyclesExecuted;
+            // Now, now... no time machines, please.
+            if (cyclesDown < 0)
+                cyclesDown = 0;
+        }
+    }
 
     //INFO_LOG(TIME, "Idle for %i cycles! (%f ms)", cyclesDown, cyclesDown / (float)(g_clock_rate_arm11 * 0.001f));
 
-    //idledCycles += cyclesDown;
-    //currentMIPS->downcount -= cyclesDown;
-    //if (currentMIPS->downcount == 0)
-    //	currentMIPS->downcount = -1;
+    idledCycles += cyclesDown;
+    Core::g_app_core->down_count -= cyclesDown;
+    if (Core::g_app_core->down_count == 0)
+        Core::g_app_core->down_count = -1;
 }
 
 std::string GetScheduledEventsSummary()
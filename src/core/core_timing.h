@@ -51,6 +51,12 @@ inline s64 usToCycles(u64 us) {
     return (s64)(g_clock_rate_arm11 / 1000000 * us);
 }
 
+inline s64 nsToCycles(s64 ns) {
+    // Whole seconds are converted apart so that the product can't overflow
+    return ns / 1000000000 * g_clock_rate_arm11 +
+        ns % 1000000000 * g_clock_rate_arm11 / 1000000000;
+}
+
 inline s64 cyclesToUs(s64 cycles) {
     return cycles / (g_clock_rate_arm11 / 1000000);
 }
@@ -0,0 +1,409 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include "common/common.h"
+#include "common/file_util.h"
+#include "common/symbols.h"
+
+#include "core/mem_map.h"
+#include "core/hle/hle.h"
+#include "core/hle/function_replacement.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace FunctionReplacement {
+
+/// Name of the hash map file in the user's maps directory
+static const char HASH_MAP_FILENAME[] = "function_hashes.txt";
+
+static const u32 INSTR_SVC      = 0xEF000000;   ///< svc #0
+static const u32 INSTR_BX_LR    = 0xE12FFF1E;   ///< bx lr
+
+/// Multiplier of the polynomial hash of a function's code words, an odd 64-bit constant
+static const u64 HASH_MULTIPLIER = 0x100000001B3ULL;
+
+/// A known function, found by the hash of its code
+struct KnownFunction {
+    u64         hash;
+    u32         size;   ///< Size of the code in bytes
+    std::string name;
+};
+
+static std::vector<KnownFunction> g_hash_map;
+static std::set<u32> g_patched;     ///< Entry addresses of all functions replaced
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Guest memory helpers
+//
+// These work page by page on host memory where possible, falling back to the regular accessors
+// for I/O and unmapped pages.
+
+static inline u32 BytesLeftInPage(u32 addr) {
+    return Memory::PAGE_SIZE - (addr & Memory::PAGE_MASK);
+}
+
+/// Copies a range of guest memory that lies within one page, both at the source and destination
+static void MovePageChunk(u32 dst, u32 src, u32 size, bool backwards) {
+    const u8* src_page = Memory::g_page_pointers[src >> Memory::PAGE_BITS];
+    u8* dst_page = Memory::g_page_pointers[dst >> Memory::PAGE_BITS];
+
+    if (src_page && dst_page) {
+        // Reads from watched pages are not allowed through the read pointers either
+        if (Memory::g_page_read_pointers[src >> Memory::PAGE_BITS] == NULL)
+            Memory::NotifyReadWatch(src, size);
+        std::memmove(dst_page + (dst & Memory::PAGE_MASK), src_page + (src & Memory::PAGE_MASK),
+            size);
+        // Writes to watched pages are not allowed through the write pointers
+        if (Memory::g_page_write_pointers[dst >> Memory::PAGE_BITS] == NULL)
+            Memory::NotifyWriteWatch(dst, size);
+    } else if (backwards) {
+        for (u32 i = size; i-- > 0;)
+            Memory::Write8(dst + i, Memory::Read8(src + i));
+    } else {
+        for (u32 i = 0; i < size; i++)
+            Memory::Write8(dst + i, Memory::Read8(src + i));
+    }
+}
+
+/// Copies guest memory with memmove semantics, so the ranges may overlap
+static void MoveMemory(u32 dst, u32 src, u32 size) {
+    if (dst > src && dst - src < size) {
+        // Copy from the end, so that the overlapping part of the source is read before it is
+        // overwritten
+        while (size > 0) {
+            const u32 src_left = ((src + size - 1) & Memory::PAGE_MASK) + 1;
+            const u32 dst_left = ((dst + size - 1) & Memory::PAGE_MASK) + 1;
+            const u32 chunk = std::min(size, std::min(src_left, dst_left));
+            size -= chunk;
+            MovePageChunk(dst + size, src + size, chunk, true);
+        }
+    } else {
+        while (size > 0) {
+            const u32 chunk = std::min(size, std::min(BytesLeftInPage(src), BytesLeftInPage(dst)));
+            MovePageChunk(dst, src, chunk, false);
+            dst += chunk;
+            src += chunk;
+            size -= chunk;
+        }
+    }
+}
+
+/// Fills guest memory with a byte value
+static void FillMemory(u32 dst, u8 value, u32 size) {
+    while (size > 0) {
+        const u32 chunk = std::min(size, BytesLeftInPage(dst));
+        u8* dst_page = Memory::g_page_pointers[dst >> Memory::PAGE_BITS];
+
+        if (dst_page) {
+            std::memset(dst_page + (dst & Memory::PAGE_MASK), value, chunk);
+            if (Memory::g_page_write_pointers[dst >> Memory::PAGE_BITS] == NULL)
+                Memory::NotifyWriteWatch(dst, chunk);
+        } else {
+            for (u32 i = 0; i < chunk; i++)
+                Memory::Write8(dst + i, value);
+        }
+        dst += chunk;
+        size -= chunk;
+    }
+}
+
+/// Gets the length of a null-terminated string in guest memory
+static u32 StringLength(u32 addr) {
+    u32 length = 0;
+    for (;;) {
+        const u32 chunk = BytesLeftInPage(addr + length);
+        const u8* page = Memory::g_page_pointers[(addr + length) >> Memory::PAGE_BITS];
+
+        if (page) {
+            if (Memory::g_page_read_pointers[(addr + length) >> Memory::PAGE_BITS] == NULL)
+                Memory::NotifyReadWatch(addr + length, chunk);
+            const u8* start = page + ((addr + length) & Memory::PAGE_MASK);
+            const u8* end = (const u8*)std::memchr(start, 0, chunk);
+            if (end)
+                return length + (u32)(end - start);
+            length += chunk;
+        } else {
+            for (u32 i = 0; i < chunk; i++, length++) {
+                if (Memory::Read8(addr + length) == 0)
+                    return length;
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Native implementations
+
+static void Replace_memcpy() {
+    MoveMemory(PARAM(0), PARAM(1), PARAM(2));
+    RETURN(PARAM(0));
+}
+
+static void Replace_memset() {
+    FillMemory(PARAM(0), (u8)PARAM(1), PARAM(2));
+    RETURN(PARAM(0));
+}
+
+static void Replace_strlen() {
+    RETURN(StringLength(PARAM(0)));
+}
+
+/// void __aeabi_memset(void* dest, size_t n, int c), note the argument order
+static void Replace_aeabi_memset() {
+    FillMemory(PARAM(0), (u8)PARAM(2), PARAM(1));
+}
+
+/// void __aeabi_memclr(void* dest, size_t n)
+static void Replace_aeabi_memclr() {
+    FillMemory(PARAM(0), 0, PARAM(1));
+}
+
+// The ARM11 has no divide instruction, these helpers are what the guest's compiler calls instead.
+// Division by zero returns a quotient of 0 (and the numerator as remainder), the result the
+// runtime's default __aeabi_idiv0 handler leaves, so that we don't have to call back into guest
+// code. Note that this skips __aeabi_idiv0 entirely: a guest that installs its own handler to trap
+// or report division by zero will not see it.
+
+static void Replace_aeabi_uidiv() {
+    const u32 numerator = PARAM(0);
+    const u32 denominator = PARAM(1);
+    RETURN(denominator ? numerator / denominator : 0);
+}
+
+static void Replace_aeabi_idiv() {
+    const s32 numerator = (s32)PARAM(0);
+    const s32 denominator = (s32)PARAM(1);
+    if (denominator == 0)
+        RETURN(0);
+    else if (numerator == INT_MIN && denominator == -1)
+        RETURN((u32)INT_MIN);
+    else
+        RETURN((u32)(numerator / denominator));
+}
+
+/// Returns the quotient in r0 and the remainder in r1
+static void Replace_aeabi_uidivmod() {
+    const u32 numerator = PARAM(0);
+    const u32 denominator = PARAM(1);
+    if (denominator == 0) {
+        RETURN(0);
+        Core::GetCurrentCore()->SetReg(1, numerator);
+    } else {
+        RETURN(numerator / denominator);
+        Core::GetCurrentCore()->SetReg(1, numerator % denominator);
+    }
+}
+
+/// Returns the quotient in r0 and the remainder in r1
+static void Replace_aeabi_idivmod() {
+    const s32 numerator = (s32)PARAM(0);
+    const s32 denominator = (s32)PARAM(1);
+    if (denominator == 0) {
+        RETURN(0);
+        Core::GetCurrentCore()->SetReg(1, (u32)numerator);
+    } else if (numerator == INT_MIN && denominator == -1) {
+        RETURN((u32)INT_MIN);
+        Core::GetCurrentCore()->SetReg(1, 0);
+    } else {
+        RETURN((u32)(numerator / denominator));
+        Core::GetCurrentCore()->SetReg(1, (u32)(numerator % denominator));
+    }
+}
+
+/// Replaceable functions, the index of each is its SVC number minus SVC_BASE
+static const HLE::FunctionDef g_replacements[] = {
+    {0x00, Replace_memcpy,          "memcpy"},
+    {0x01, Replace_memcpy,          "memmove"},
+    {0x02, Replace_memset,          "memset"},
+    {0x03, Replace_strlen,          "strlen"},
+    {0x04, Replace_memcpy,          "__aeabi_memcpy"},
+    {0x05, Replace_memcpy,          "__aeabi_memcpy4"},
+    {0x06, Replace_memcpy,          "__aeabi_memcpy8"},
+    {0x07, Replace_memcpy,          "__aeabi_memmove"},
+    {0x08, Replace_memcpy,          "__aeabi_memmove4"},
+    {0x09, Replace_memcpy,          "__aeabi_memmove8"},
+    {0x0A, Replace_aeabi_memset,    "__aeabi_memset"},
+    {0x0B, Replace_aeabi_memset,    "__aeabi_memset4"},
+    {0x0C, Replace_aeabi_memset,    "__aeabi_memset8"},
+    {0x0D, Replace_aeabi_memclr,    "__aeabi_memclr"},
+    {0x0E, Replace_aeabi_memclr,    "__aeabi_memclr4"},
+    {0x0F, Replace_aeabi_memclr,    "__aeabi_memclr8"},
+    {0x10, Replace_aeabi_uidiv,     "__aeabi_uidiv"},
+    {0x11, Replace_aeabi_idiv,      "__aeabi_idiv"},
+    {0x12, Replace_aeabi_uidivmod,  "__aeabi_uidivmod"},
+    {0x13, Replace_aeabi_idivmod,   "__aeabi_idivmod"},
+};
+
+static const int kNumReplacements = ARRAY_SIZE(g_replacements);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Gets the index of a replaceable function in g_replacements, or -1 if there is none
+static int FindReplacement(const std::string& name) {
+    for (int i = 0; i < kNumReplacements; i++) {
+        if (g_replacements[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * Hashes the code of a guest function
+ * @param addr Guest address of the function
+ * @param size Size of the function in bytes, any trailing partial word is ignored
+ * @return Polynomial hash of the code words, see HASH_MULTIPLIER
+ */
+static u64 HashFunction(u32 addr, u32 size) {
+    u64 hash = 0;
+    for (u32 i = 0; i < size / 4; i++)
+        hash = hash * HASH_MULTIPLIER + Memory::Read32(addr + i * 4);
+    return hash;
+}
+
+/// Patches the entry of a guest function to trap into its native implementation
+static void Patch(u32 addr, int index, const char* found_by) {
+    if (g_patched.count(addr))
+        return;
+
+    Memory::Write32(addr, INSTR_SVC | (SVC_BASE + g_replacements[index].id));
+    Memory::Write32(addr + 4, INSTR_BX_LR);
+    g_patched.insert(addr);
+
+    INFO_LOG(HLE, "Replaced %s at 0x%08X (found by %s)", g_replacements[index].name.c_str(), addr,
+        found_by);
+}
+
+/// Replaces the functions found in the symbol table
+static void ApplySymbols() {
+    for (int i = 0; i < kNumReplacements; i++) {
+        const TSymbol symbol = Symbols::GetSymbolByName(g_replacements[i].name);
+        if (symbol.name.empty())
+            continue;
+
+        // Thumb functions and stubs too short to patch are left alone
+        if ((symbol.address & 3) || symbol.size < 8) {
+            WARN_LOG(HLE, "Not replacing %s at 0x%08X (size %u)", symbol.name.c_str(),
+                symbol.address, symbol.size);
+            continue;
+        }
+
+        // Log the hash before patching, so that it can be added to the hash map for stripped
+        // executables
+        INFO_LOG(HLE, "Hash map entry: %016llx %u %s",
+            (unsigned long long)HashFunction(symbol.address, symbol.size), symbol.size,
+            symbol.name.c_str());
+
+        Patch(symbol.address, i, "symbol");
+    }
+}
+
+/// Replaces the functions found in the hash map, by hashing every word-aligned range of the code
+static void ApplyHashMap(u32 code_address, u32 code_size) {
+    if (g_hash_map.empty() || code_size < 8)
+        return;
+
+    std::vector<u32> code(code_size / 4);
+    for (size_t i = 0; i < code.size(); i++)
+        code[i] = Memory::Read32(code_address + (u32)i * 4);
+
+    std::set<u32> sizes;
+    for (size_t i = 0; i < g_hash_map.size(); i++)
+        sizes.insert(g_hash_map[i].size / 4);
+
+    // Rolling hash over each window size used by the hash map, so the whole scan is linear in the
+    // size of the code for each of them
+    for (std::set<u32>::const_iterator it = sizes.begin(); it != sizes.end(); ++it) {
+        const u32 num_words = *it;
+        if (num_words < 2 || num_words > code.size())
+            continue;
+
+        // Multiplier of the word leaving the window
+        u64 leading_multiplier = 1;
+        for (u32 i = 1; i < num_words; i++)
+            leading_multiplier *= HASH_MULTIPLIER;
+
+        u64 hash = 0;
+        for (u32 i = 0; i < num_words; i++)
+            hash = hash * HASH_MULTIPLIER + code[i];
+
+        for (size_t start = 0;; start++) {
+            for (size_t i = 0; i < g_hash_map.size(); i++) {
+                const KnownFunction& function = g_hash_map[i];
+                if (function.hash == hash && function.size / 4 == num_words) {
+                    const int index = FindReplacement(function.name);
+                    if (index >= 0)
+                        Patch(code_address + (u32)start * 4, index, "hash");
+                }
+            }
+
+            if (start + num_words >= code.size())
+                break;
+            hash = (hash - code[start] * leading_multiplier) * HASH_MULTIPLIER +
+                code[start + num_words];
+        }
+    }
+}
+
+void Apply(u32 code_address, u32 code_size) {
+    g_patched.clear();
+
+    ApplySymbols();
+    ApplyHashMap(code_address, code_size);
+
+    INFO_LOG(HLE, "Replaced %u guest functions", (unsigned)g_patched.size());
+}
+
+void Call(u32 svc) {
+    const u32 index = svc - SVC_BASE;
+    if (index >= (u32)kNumReplacements) {
+        ERROR_LOG(HLE, "Unknown replaced function SVC: 0x%X", svc);
+        return;
+    }
+    g_replacements[index].func();
+}
+
+bool LoadHashMap(const std::string& filename) {
+    std::ifstream infile(filename.c_str());
+    if (!infile.is_open())
+        return false;
+
+    std::string line;
+    while (std::getline(infile, line)) {
+        std::istringstream iss(line);
+        KnownFunction function;
+        if (!(iss >> std::hex >> function.hash >> std::dec >> function.size >> function.name))
+            continue; // Skip blank and malformed lines
+
+        if (FindReplacement(function.name) < 0) {
+            WARN_LOG(HLE, "Hash map entry for %s, which has no replacement", function.name.c_str());
+            continue;
+        }
+        g_hash_map.push_back(function);
+    }
+
+    INFO_LOG(HLE, "Loaded %u function hashes from %s", (unsigned)g_hash_map.size(),
+        filename.c_str());
+    return true;
+}
+
+void Init() {
+    const std::string filename = File::GetUserPath(D_MAPS_IDX) + HASH_MAP_FILENAME;
+    if (File::Exists(filename))
+        LoadHashMap(filename);
+}
+
+void Shutdown() {
+    g_hash_map.clear();
+    g_patched.clear();
+}
+
+} // namespace
@@ -0,0 +1,57 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+
+#include "common/common_types.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// HLE replacement of guest library functions
+//
+// Hot guest library routines (memcpy, memset, strlen, software division, ...) are replaced with
+// native implementations once the executable is loaded. Functions are found by symbol name, or in
+// stripped executables by a hash of their code, using a hash map of known functions. The entry of
+// each function found is patched with
+//
+//     svc  #(SVC_BASE + index)
+//     bx   lr
+//
+// so that calls trap into HLE::CallSVC, which runs the native implementation on the guest
+// arguments, and then return straight to the caller.
+
+namespace FunctionReplacement {
+
+/// First SVC number used for replaced functions, just above the range of real SVCs
+const u32 SVC_BASE = 0x100;
+
+/// Initialize function replacement, loading the hash map of known functions
+void Init();
+
+/// Shutdown function replacement
+void Shutdown();
+
+/**
+ * Replaces the known functions of a newly loaded executable
+ * @param code_address Guest address of the executable's code, searched for known function hashes
+ * @param code_size Size of the executable's code in bytes
+ */
+void Apply(u32 code_address, u32 code_size);
+
+/**
+ * Loads a hash map of known functions, each line giving the 64-bit hash of a function's code in
+ * hex, its size in bytes and its name
+ * @param filename Path of the hash map file
+ * @return True if the file was loaded
+ */
+bool LoadHashMap(const std::string& filename);
+
+/**
+ * Runs the native implementation of a replaced function, called by HLE::CallSVC
+ * @param svc SVC number the function's entry was patched with
+ */
+void Call(u32 svc);
+
+} // namespace
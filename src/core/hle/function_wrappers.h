@@ -734,12 +734,25 @@ template<int func(void*, u32, u32, u32, u32, u32)> void WrapI_VUUUUU(){
     RETURN(retval);
 }
 
+// 64-bit arguments are passed in an even/odd register pair, or split in two single registers
+
 template<int func(u32, s64)> void WrapI_US64() {
-    int retval = func(PARAM(0), PARAM64(1));
+    int retval = func(PARAM(0), PARAM64(2));
+    RETURN(retval);
+}
+
+template<int func(u32, u32, u32, s64)> void WrapI_UUUS64() {
+    s64 param_4 = ((s64)PARAM(4) << 32) | PARAM(0);
+    int retval = func(PARAM(1), PARAM(2), PARAM(3), param_4);
     RETURN(retval);
 }
 
-template<int func(void*, void*, u32, u32, s64)> void WrapI_VVUUS64() {
-    int retval = func(Memory::GetPointer(PARAM(0)), Memory::GetPointer(PARAM(1)), PARAM(2), PARAM(3), PARAM(4));
+template<int func(u32, s64, s64)> void WrapI_US64S64() {
+    s64 param_3 = ((s64)PARAM(4) << 32) | PARAM(1);
+    int retval = func(PARAM(0), PARAM64(2), param_3);
     RETURN(retval);
 }
+
+template<void func(s64)> void WrapV_S64() {
+    func(PARAM64(0));
+}
@@ -6,6 +6,7 @@
 
 #include "core/mem_map.h"
 #include "core/hle/hle.h"
+#include "core/hle/function_replacement.h"
 #include "core/hle/svc.h"
 #include "core/hle/service/service.h"
 
@@ -15,6 +16,10 @@ namespace HLE {
 
 static std::vector<ModuleDef> g_module_db;
 
+THREAD_LOCAL bool g_reschedule = false;
+
+std::recursive_mutex g_mutex;
+
 const FunctionDef* GetSVCInfo(u32 opcode) {
     u32 func_num = opcode & 0xFFFFFF; // 8 bits
     if (func_num > 0xFF) {
@@ -25,6 +30,14 @@ const FunctionDef* GetSVCInfo(u32 opcode) {
 }
 
 void CallSVC(u32 opcode) {
+    // Entries of replaced guest functions trap with SVC numbers above the real ones
+    if ((opcode & 0xFFFFFF) >= FunctionReplacement::SVC_BASE) {
+        FunctionReplacement::Call(opcode & 0xFFFFFF);
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+
     const FunctionDef *info = GetSVCInfo(opcode);
 
     if (!info) {
@@ -45,7 +58,7 @@ void ReSchedule(const char *reason) {
 #ifdef _DEBUG
     _dbg_assert_msg_(HLE, reason != 0 && strlen(reason) < 256, "ReSchedule: Invalid or too long reason.");
 #endif
-    // TODO: ImplementMe
+    g_reschedule = true;
 }
 
 void RegisterModule(std::string name, int num_functions, const FunctionDef* func_table) {
@@ -59,14 +72,18 @@ void RegisterAllModules() {
 
 void Init() {
     Service::Init();
+
+    g_reschedule = false;
     
     RegisterAllModules();
+    FunctionReplacement::Init();
 
     NOTICE_LOG(HLE, "initialized OK");
 }
 
 void Shutdown() {
     Service::Shutdown();
+    FunctionReplacement::Shutdown();
 
     g_module_db.clear();
 
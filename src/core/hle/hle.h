@@ -5,13 +5,15 @@
 #pragma once
 
 #include "common/common_types.h"
+#include "common/std_mutex.h"
 #include "core/core.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#define PARAM(n)        Core::g_app_core->GetReg(n)
-#define PARAM64(n)      (Core::g_app_core->GetReg(n) | ((u64)Core::g_app_core->GetReg(n + 1) << 32))
-#define RETURN(n)       Core::g_app_core->SetReg(0, n)
+#define PARAM(n)        Core::GetCurrentCore()->GetReg(n)
+#define PARAM64(n)      (Core::GetCurrentCore()->GetReg(n) | \
+                            ((u64)Core::GetCurrentCore()->GetReg(n + 1) << 32))
+#define RETURN(n)       Core::GetCurrentCore()->SetReg(0, n)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -36,8 +38,21 @@ void RegisterModule(std::string name, int num_functions, const FunctionDef *func
 
 void CallSVC(u32 opcode);
 
+extern THREAD_LOCAL bool g_reschedule;  ///< If true, the calling thread's CPU core stops and
+                                        ///< the kernel switches threads on it
+
+/**
+ * Serializes the HLE kernel, services, CoreTiming and the HW registers between the application
+ * and system cores, when they run on separate host threads
+ */
+extern std::recursive_mutex g_mutex;
+
 void EatCycles(u32 cycles);
 
+/**
+ * Requests a thread switch, the CPU core ends its current time slice as soon as possible
+ * @param reason Description of why the reschedule is needed, for debugging
+ */
 void ReSchedule(const char *reason);
 
 void Init();
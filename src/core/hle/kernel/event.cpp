@@ -0,0 +1,94 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <string>
+
+#include "common/common.h"
+
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/event.h"
+#include "core/hle/kernel/thread.h"
+
+namespace Kernel {
+
+class Event : public WaitObject {
+public:
+    const char* GetTypeName() { return "Event"; }
+    const char* GetName() { return name.c_str(); }
+
+    static Kernel::HandleType GetStaticHandleType() {  return Kernel::HandleType::Event; }
+    Kernel::HandleType GetHandleType() const { return Kernel::HandleType::Event; }
+
+    bool ShouldWait(Handle thread) const {
+        return !signaled;
+    }
+
+    void Acquire(Handle thread) {
+        if (reset_type == RESETTYPE_ONESHOT) {
+            signaled = false;
+        }
+    }
+
+    ResetType reset_type;                       ///< How the event goes back to unsignaled:
+                                                ///< when acquired (oneshot), when cleared
+                                                ///< (sticky) or right after signaling (pulse)
+    bool signaled;                              ///< Whether the event is currently signaled
+    std::string name;                           ///< Name of event (optional)
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Signals an event, waking up the threads waiting on it
+ * @param handle Handle to event to signal
+ * @return Result of operation, 0 on success, otherwise error code
+ */
+Result SignalEvent(Handle handle) {
+    u32 error;
+    Event* event = Kernel::g_object_pool.Get<Event>(handle, error);
+    if (event == NULL) {
+        return RESULT_INVALID_HANDLE;
+    }
+    event->signaled = true;
+    WakeupWaitingThreads(event);
+
+    if (event->reset_type == RESETTYPE_PULSE) {
+        event->signaled = false;
+    }
+    return 0;
+}
+
+/**
+ * Clears an event
+ * @param handle Handle to event to clear
+ * @return Result of operation, 0 on success, otherwise error code
+ */
+Result ClearEvent(Handle handle) {
+    u32 error;
+    Event* event = Kernel::g_object_pool.Get<Event>(handle, error);
+    if (event == NULL) {
+        return RESULT_INVALID_HANDLE;
+    }
+    event->signaled = false;
+    return 0;
+}
+
+/**
+ * Creates an event
+ * @param reset_type ResetType describing how the event goes back to the unsignaled state
+ * @param name Name of the event, for debugging
+ * @return Handle to the newly created event
+ */
+Handle CreateEvent(ResetType reset_type, const char* name) {
+    Event* event = new Event;
+    Handle handle = Kernel::g_object_pool.Create(event);
+
+    event->reset_type = reset_type;
+    event->signaled = false;
+    event->name = name;
+
+    return handle;
+}
+
+} // namespace
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <string.h>
 
 #include "common/common.h"
@@ -11,80 +12,87 @@
 #include "core/core.h"
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/thread.h"
+#include "core/hle/kernel/timer.h"
 
 namespace Kernel {
 
 ObjectPool g_object_pool;
 
 ObjectPool::ObjectPool() {
-    memset(occupied, 0, sizeof(bool) * MAX_COUNT);
-    next_id = INITIAL_NEXT_ID;
+    free_list = NO_SLOT;
+    count = 0;
 }
 
-Handle ObjectPool::Create(Object* obj, int range_bottom, int range_top) {
-    if (range_top > MAX_COUNT) {
-        range_top = MAX_COUNT;
+Handle ObjectPool::Create(Object* obj) {
+    u32 index;
+    if (free_list != NO_SLOT) {
+        index = free_list;
+        free_list = slots[index].next_free;
+    } else if (slots.size() < MAX_COUNT) {
+        index = slots.size();
+        Slot slot = { NULL, 0, HandleType::Unknown, 1, NO_SLOT };
+        slots.push_back(slot);
+    } else {
+        ERROR_LOG(HLE, "Unable to allocate kernel object, too many objects slots in use.");
+        return 0;
     }
-    if (next_id >= range_bottom && next_id < range_top) {
-        range_bottom = next_id++;
-    }
-    for (int i = range_bottom; i < range_top; i++) {
-        if (!occupied[i]) {
-            occupied[i] = true;
-            pool[i] = obj;
-            pool[i]->handle = i + HANDLE_OFFSET;
-            return i + HANDLE_OFFSET;
-        }
-    }
-    ERROR_LOG(HLE, "Unable to allocate kernel object, too many objects slots in use.");
-    return 0;
-}
 
-bool ObjectPool::IsValid(Handle handle) {
-    int index = handle - HANDLE_OFFSET;
-    if (index < 0)
-        return false;
-    if (index >= MAX_COUNT)
-        return false;
+    Slot& slot = slots[index];
+    slot.object = obj;
+    slot.handle = (slot.generation << INDEX_BITS) | index;
+    slot.type = obj->GetHandleType();
+    obj->handle = slot.handle;
+    count++;
+    return slot.handle;
+}
 
-    return occupied[index];
+void ObjectPool::Free(Handle handle) {
+    const u32 index = GetIndex(handle);
+    Slot& slot = slots[index];
+    delete slot.object;
+    slot.object = NULL;
+    slot.handle = 0;
+
+    // Handles to the freed object won't match the next object in the slot
+    slot.generation = slot.generation % MAX_GENERATION + 1;
+    slot.next_free = free_list;
+    free_list = index;
+    count--;
 }
 
 void ObjectPool::Clear() {
-    for (int i = 0; i < MAX_COUNT; i++) {
+    for (size_t i = 0; i < slots.size(); i++) {
         //brutally clear everything, no validation
-        if (occupied[i])
-            delete pool[i];
-        occupied[i] = false;
+        if (slots[i].object != NULL)
+            Free(slots[i].object->handle);
     }
-    memset(pool, 0, sizeof(Object*)*MAX_COUNT);
-    next_id = INITIAL_NEXT_ID;
 }
 
 Object* &ObjectPool::operator [](Handle handle)
 {
     _dbg_assert_msg_(KERNEL, IsValid(handle), "GRABBING UNALLOCED KERNEL OBJ");
-    return pool[handle - HANDLE_OFFSET];
+    return slots[GetIndex(handle)].object;
 }
 
 void ObjectPool::List() {
-    for (int i = 0; i < MAX_COUNT; i++) {
-        if (occupied[i]) {
-            if (pool[i]) {
-                INFO_LOG(KERNEL, "KO %i: %s \"%s\"", i + HANDLE_OFFSET, pool[i]->GetTypeName(), 
-                    pool[i]->GetName());
-            }
+    for (size_t i = 0; i < slots.size(); i++) {
+        Object* object = slots[i].object;
+        if (object != NULL) {
+            INFO_LOG(KERNEL, "KO %08x: %s \"%s\"", object->GetHandle(), object->GetTypeName(),
+                object->GetName());
         }
     }
 }
 
-int ObjectPool::GetCount() {
-    int count = 0;
-    for (int i = 0; i < MAX_COUNT; i++) {
-        if (occupied[i])
-            count++;
+void WaitObject::AddWaitingThread(Handle thread) {
+    waiting_threads.push_back(thread);
+}
+
+void WaitObject::RemoveWaitingThread(Handle thread) {
+    auto iter = std::find(waiting_threads.begin(), waiting_threads.end(), thread);
+    if (iter != waiting_threads.end()) {
+        waiting_threads.erase(iter);
     }
-    return count;
 }
 
 Object* ObjectPool::CreateByIDType(int type) {
@@ -133,6 +141,7 @@ Object* ObjectPool::CreateByIDType(int type) {
 
 void Init() {
     Kernel::ThreadingInit();
+    Kernel::TimersInit();
 }
 
 void Shutdown() {
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "common/common.h"
 
 typedef u32 Handle;
@@ -24,6 +26,7 @@ enum class HandleType : u32 {
     Arbiter         = 9,
     File            = 10,
     Semaphore       = 11,
+    Timer           = 12,
 };
     
 enum {
@@ -42,15 +45,59 @@ public:
     virtual const char *GetTypeName() { return "[BAD KERNEL OBJECT TYPE]"; }
     virtual const char *GetName() { return "[UNKNOWN KERNEL OBJECT]"; }
     virtual Kernel::HandleType GetHandleType() const = 0;
+
+    /// Whether threads can wait on the object, that is whether it is a WaitObject
+    virtual bool IsWaitable() const { return false; }
+};
+
+/// Kernel object that threads can wait on with WaitSynchronization1/N
+class WaitObject : public Object {
+public:
+    bool IsWaitable() const { return true; }
+
+    /**
+     * Checks whether a thread would have to wait to acquire the object
+     * @param thread Handle of the thread acquiring the object
+     * @return True if the object is not available to the thread
+     */
+    virtual bool ShouldWait(Handle thread) const = 0;
+
+    /**
+     * Acquires the object for a thread, once ShouldWait returned false
+     * @param thread Handle of the thread acquiring the object
+     */
+    virtual void Acquire(Handle thread) = 0;
+
+    /// Adds a thread to the threads waiting on the object
+    void AddWaitingThread(Handle thread);
+
+    /// Removes a thread from the threads waiting on the object, if it is waiting on it
+    void RemoveWaitingThread(Handle thread);
+
+    /// Gets the threads waiting on the object, in the order they started waiting
+    const std::vector<Handle>& GetWaitingThreads() const { return waiting_threads; }
+
+private:
+    std::vector<Handle> waiting_threads;    ///< Threads waiting on the object
 };
 
+/**
+ * Table of the kernel objects, indexed by handle. A handle holds the index of its slot in its low
+ * bits and the generation of the slot in its high bits. The generation changes each time the slot
+ * is freed, so that stale handles are caught by a single comparison. Free slots are chained in a
+ * free list, so that creating and destroying objects is O(1).
+ */
 class ObjectPool : NonCopyable {
 public:
     ObjectPool();
     ~ObjectPool() {}
 
-    // Allocates a handle within the range and inserts the object into the map.
-    Handle Create(Object* obj, int range_bottom=INITIAL_NEXT_ID, int range_top=0x7FFFFFFF);
+    /**
+     * Allocates a handle for an object and inserts the object into the table
+     * @param obj Object to insert, owned by the table until it is destroyed
+     * @return Handle to the object, 0 if the table is full
+     */
+    Handle Create(Object* obj);
 
     static Object* CreateByIDType(int type);
 
@@ -58,88 +105,92 @@ public:
     u32 Destroy(Handle handle) {
         u32 error;
         if (Get<T>(handle, error)) {
-            occupied[handle - HANDLE_OFFSET] = false;
-            delete pool[handle - HANDLE_OFFSET];
+            Free(handle);
         }
         return error;
     };
 
-    bool IsValid(Handle handle);
+    bool IsValid(Handle handle) const {
+        const u32 index = GetIndex(handle);
+        return index < slots.size() && slots[index].handle == handle;
+    }
 
     template <class T>
     T* Get(Handle handle, u32& outError) {
-        if (handle < HANDLE_OFFSET || handle >= HANDLE_OFFSET + MAX_COUNT || !occupied[handle - HANDLE_OFFSET]) {
-            // Tekken 6 spams 0x80020001 gets wrong with no ill effects, also on the real PSP
-            if (handle != 0 && (u32)handle != 0x80020001) {
+        outError = 0;
+        if (!IsValid(handle)) {
+            if (handle != 0) {
                 WARN_LOG(KERNEL, "Kernel: Bad object handle %i (%08x)", handle, handle);
             }
-            outError = 0;//T::GetMissingErrorCode();
-            return 0;
-        } else {
-            // Previously we had a dynamic_cast here, but since RTTI was disabled traditionally,
-            // it just acted as a static case and everything worked. This means that we will never
-            // see the Wrong type object error below, but we'll just have to live with that danger.
-            T* t = static_cast<T*>(pool[handle - HANDLE_OFFSET]);
-            if (t == 0 || t->GetHandleType() != T::GetStaticHandleType()) {
-                WARN_LOG(KERNEL, "Kernel: Wrong object type for %i (%08x)", handle, handle);
-                outError = 0;//T::GetMissingErrorCode();
-                return 0;
-            }
-            outError = 0;//SCE_KERNEL_ERROR_OK;
-            return t;
+            return NULL;
+        }
+        // The type is cached in the slot, to avoid a virtual GetHandleType call
+        const Slot& slot = slots[GetIndex(handle)];
+        if (slot.type != T::GetStaticHandleType()) {
+            WARN_LOG(KERNEL, "Kernel: Wrong object type for %i (%08x)", handle, handle);
+            return NULL;
         }
+        return static_cast<T*>(slot.object);
     }
 
     // ONLY use this when you know the handle is valid.
     template <class T>
     T *GetFast(Handle handle) {
-        const Handle realHandle = handle - HANDLE_OFFSET;
-        _dbg_assert_(KERNEL, realHandle >= 0 && realHandle < MAX_COUNT && occupied[realHandle]);
-        return static_cast<T*>(pool[realHandle]);
+        _dbg_assert_(KERNEL, IsValid(handle));
+        return static_cast<T*>(slots[GetIndex(handle)].object);
     }
 
     template <class T, typename ArgT>
     void Iterate(bool func(T*, ArgT), ArgT arg) {
-        int type = T::GetStaticIDType();
-        for (int i = 0; i < MAX_COUNT; i++)
-        {
-            if (!occupied[i])
-                continue;
-            T* t = static_cast<T*>(pool[i]);
-            if (t->GetIDType() == type) {
-                if (!func(t, arg))
+        for (size_t i = 0; i < slots.size(); i++) {
+            const Slot& slot = slots[i];
+            if (slot.object != NULL && slot.type == T::GetStaticHandleType()) {
+                if (!func(static_cast<T*>(slot.object), arg))
                     break;
             }
         }
     }
 
     bool GetIDType(Handle handle, HandleType* type) const {
-        if ((handle < HANDLE_OFFSET) || (handle >= HANDLE_OFFSET + MAX_COUNT) || 
-            !occupied[handle - HANDLE_OFFSET]) {
+        if (!IsValid(handle)) {
             ERROR_LOG(KERNEL, "Kernel: Bad object handle %i (%08x)", handle, handle);
             return false;
         }
-        Object* t = pool[handle - HANDLE_OFFSET];
-        *type = t->GetHandleType();
+        *type = slots[GetIndex(handle)].type;
         return true;
     }
 
     Object* &operator [](Handle handle);
     void List();
     void Clear();
-    int GetCount();
+    int GetCount() const { return count; }
 
 private:
-    
+
     enum {
-        MAX_COUNT       = 0x1000,
-        HANDLE_OFFSET   = 0x100,
-        INITIAL_NEXT_ID = 0x10,
+        INDEX_BITS      = 16,
+        MAX_COUNT       = 1 << INDEX_BITS,  ///< Maximum number of live objects
+        MAX_GENERATION  = 0x7FFF,           ///< Keeps handles clear of the 0xFFFF8000 aliases
+        NO_SLOT         = 0xFFFFFFFF,       ///< End of the free list
+    };
+
+    struct Slot {
+        Object*     object;         ///< Object in the slot, NULL if the slot is free
+        Handle      handle;         ///< Handle to the object, 0 if the slot is free, so that a
+                                    ///< handle is checked by comparing it with this one
+        HandleType  type;           ///< Handle type of the object
+        u32         generation;     ///< Generation of the slot, never 0
+        u32         next_free;      ///< Next slot of the free list, if the slot is free
     };
 
-    Object* pool[MAX_COUNT];
-    bool    occupied[MAX_COUNT];
-    int     next_id;
+    static u32 GetIndex(Handle handle) { return handle & (MAX_COUNT - 1); }
+
+    /// Destroys the object of a valid handle and frees its slot
+    void Free(Handle handle);
+
+    std::vector<Slot>   slots;      ///< Slots allocated so far, grown as needed
+    u32                 free_list;  ///< First free slot, NO_SLOT if none
+    int                 count;      ///< Number of live objects
 };
 
 extern ObjectPool g_object_pool;
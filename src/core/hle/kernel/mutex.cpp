@@ -8,21 +8,25 @@
 #include "common/common.h"
 
 #include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/mutex.h"
 #include "core/hle/kernel/thread.h"
 
 namespace Kernel {
 
-class Mutex : public Object {
+class Mutex : public WaitObject {
 public:
     const char* GetTypeName() { return "Mutex"; }
 
     static Kernel::HandleType GetStaticHandleType() {  return Kernel::HandleType::Mutex; }
     Kernel::HandleType GetHandleType() const { return Kernel::HandleType::Mutex; }
 
+    bool ShouldWait(Handle thread) const;
+    void Acquire(Handle thread);
+
     bool initial_locked;                        ///< Initial lock state when mutex was created
     bool locked;                                ///< Current locked state
     Handle lock_thread;                         ///< Handle to thread that currently has mutex
-    std::vector<Handle> waiting_threads;        ///< Threads that are waiting for the mutex
+    u32 lock_count;                             ///< Times lock_thread acquired the mutex
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -52,37 +56,39 @@ void MutexEraseLock(Mutex* mutex) {
     mutex->lock_thread = -1;
 }
 
-bool LockMutex(Mutex* mutex) {
-    // Mutex alread locked?
-    if (mutex->locked) {
-        return false;
-    }
-    MutexAcquireLock(mutex);
-    return true;
+bool Mutex::ShouldWait(Handle thread) const {
+    return locked && lock_thread != thread;
 }
 
-bool ReleaseMutexForThread(Mutex* mutex, Handle thread) {
-    MutexAcquireLock(mutex, thread);
-    Kernel::ResumeThreadFromWait(thread);
-    return true;
+void Mutex::Acquire(Handle thread) {
+    // The owner may acquire the mutex again, and has to release it as many times
+    if (locked) {
+        lock_count++;
+        return;
+    }
+    locked = true;
+    lock_count = 1;
+    MutexAcquireLock(this, thread);
 }
 
+/**
+ * Releases a mutex for the current thread
+ * @param mutex Mutex to release
+ * @return True on success, false if the current thread does not hold the mutex
+ */
 bool ReleaseMutex(Mutex* mutex) {
-    MutexEraseLock(mutex);
-    bool woke_threads = false;
-    auto iter = mutex->waiting_threads.begin();
-
-    // Find the next waiting thread for the mutex...
-    while (!woke_threads && !mutex->waiting_threads.empty()) {
-        woke_threads |= ReleaseMutexForThread(mutex, *iter);
-        mutex->waiting_threads.erase(iter);
+    if (!mutex->locked || mutex->lock_thread != GetCurrentThreadHandle()) {
+        return false;
     }
-    // Reset mutex lock thread handle, nothing is waiting
-    if (!woke_threads) {
-        mutex->locked = false;
-        mutex->lock_thread = -1;
+    if (--mutex->lock_count != 0) {
+        return true;
     }
-    return woke_threads;
+    MutexEraseLock(mutex);
+    mutex->locked = false;
+
+    // Hand the mutex over to the highest priority thread waiting for it
+    WakeupWaitingThreads(mutex);
+    return true;
 }
 
 /**
@@ -90,9 +96,15 @@ bool ReleaseMutex(Mutex* mutex) {
  * @param handle Handle to mutex to release
  */
 Result ReleaseMutex(Handle handle) {
-    Mutex* mutex = Kernel::g_object_pool.GetFast<Mutex>(handle);
+    u32 error;
+    Mutex* mutex = Kernel::g_object_pool.Get<Mutex>(handle, error);
+    if (mutex == NULL) {
+        return RESULT_INVALID_HANDLE;
+    }
     if (!ReleaseMutex(mutex)) {
-        return -1;
+        ERROR_LOG(KERNEL, "ReleaseMutex on 0x%08X, which thread 0x%08X does not hold", handle,
+            GetCurrentThreadHandle());
+        return RESULT_WRONG_LOCKING_THREAD;
     }
     return 0;
 }
@@ -107,6 +119,7 @@ Mutex* CreateMutex(Handle& handle, bool initial_locked) {
     handle = Kernel::g_object_pool.Create(mutex);
 
     mutex->locked = mutex->initial_locked = initial_locked;
+    mutex->lock_count = initial_locked ? 1 : 0;
 
     // Acquire mutex with current thread if initialized as locked...
     if (mutex->locked) {
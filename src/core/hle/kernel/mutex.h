@@ -10,9 +10,15 @@
 
 namespace Kernel {
 
+/// Result of releasing a mutex that the current thread does not hold
+const Result RESULT_WRONG_LOCKING_THREAD = 0xD8E0041F;
+
 /**
- * Releases a mutex
+ * Releases a mutex held by the current thread, which has to release it as many times as it
+ * acquired it before other threads can acquire it
  * @param handle Handle to mutex to release
+ * @return 0 on success, RESULT_INVALID_HANDLE if handle is not a mutex, or
+ *         RESULT_WRONG_LOCKING_THREAD if the current thread does not hold the mutex
  */
 Result ReleaseMutex(Handle handle);
 
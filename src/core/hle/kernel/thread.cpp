@@ -13,6 +13,7 @@
 #include "common/thread_queue_list.h"
 
 #include "core/core.h"
+#include "core/core_timing.h"
 #include "core/mem_map.h"
 #include "core/hle/hle.h"
 #include "core/hle/svc.h"
@@ -47,25 +48,40 @@ public:
     s32 current_priority;
 
     s32 processor_id;
+    Core::CoreId core;  ///< CPU core the thread runs on, derived from processor_id
 
     WaitType wait_type;
 
+    std::vector<Handle> wait_objects;   ///< Handles passed to WaitSynchronization, while waiting
+    bool wait_all;                      ///< Whether the wait is for all wait_objects at once
+    bool wait_result_pending;           ///< Whether the result of an ended wait is to be set in
+                                        ///< r0/r1 when the thread is next switched to
+    Result wait_result;                 ///< Result of the ended wait, set in r0
+    s32 wait_result_index;              ///< Index of the acquired object, set in r1 unless -1
+
+    Common::ThreadQueueHook<Thread> ready_hook; ///< Links in the ready queue of its core
+
     char name[Kernel::MAX_NAME_LENGTH + 1];
 };
 
 // Lists all thread ids that aren't deleted/etc.
 std::vector<Handle> g_thread_queue;
 
-// Lists only ready thread ids.
-Common::ThreadQueueList<Handle> g_thread_ready_queue;
+typedef Common::ThreadQueueList<Thread, &Thread::ready_hook> ReadyQueue;
+
+// Lists only ready threads, per CPU core.
+ReadyQueue g_thread_ready_queue[Core::NUM_CORES];
 
-Handle g_current_thread_handle;
-Thread* g_current_thread;
+static Handle g_current_thread_handle[Core::NUM_CORES];
+static Thread* g_current_thread[Core::NUM_CORES];
 
+// CoreTiming event type used to wake up threads after a timeout
+static int g_thread_wakeup_event_type = -1;
 
-/// Gets the current thread
+
+/// Gets the current thread of the calling CPU core
 inline Thread* GetCurrentThread() {
-    return g_current_thread;
+    return g_current_thread[Core::GetCurrentCoreId()];
 }
 
 /// Gets the current thread handle
@@ -73,20 +89,34 @@ Handle GetCurrentThreadHandle() {
     return GetCurrentThread()->GetHandle();
 }
 
-/// Sets the current thread
+/// Sets the current thread of the calling CPU core
 inline void SetCurrentThread(Thread* t) {
-    g_current_thread = t;
-    g_current_thread_handle = t->GetHandle();
+    const Core::CoreId core = Core::GetCurrentCoreId();
+    g_current_thread[core] = t;
+    g_current_thread_handle[core] = t ? t->GetHandle() : 0;
 }
 
-/// Saves the current CPU context
+/// Saves the CPU context of the calling CPU core
 void SaveContext(ThreadContext& ctx) {
-    Core::g_app_core->SaveContext(ctx);
+    Core::GetCurrentCore()->SaveContext(ctx);
 }
 
-/// Loads a CPU context
+/// Loads a CPU context into the calling CPU core
 void LoadContext(ThreadContext& ctx) {
-    Core::g_app_core->LoadContext(ctx);
+    Core::GetCurrentCore()->LoadContext(ctx);
+}
+
+/**
+ * Gets the CPU core a thread created with the given processor ID runs on
+ * @param processor_id Processor ID passed to svcCreateThread
+ * @return CORE_SYS for threads pinned to the system core if it is running, else CORE_APP
+ */
+static Core::CoreId GetCoreForProcessorId(s32 processor_id) {
+    if (Core::IsSysCoreEnabled() &&
+        (processor_id == 1 || (u32)processor_id == THREADPROCESSORID_1)) {
+        return Core::CORE_SYS;
+    }
+    return Core::CORE_APP;
 }
 
 /// Resets a thread
@@ -107,16 +137,16 @@ void ResetThread(Thread* t, u32 arg, s32 lowest_priority) {
 
 /// Change a thread to "ready" state
 void ChangeReadyState(Thread* t, bool ready) {
-    Handle handle = t->GetHandle();
+    ReadyQueue& ready_queue = g_thread_ready_queue[t->core];
     if (t->IsReady()) {
         if (!ready) {
-            g_thread_ready_queue.remove(t->current_priority, handle);
+            ready_queue.remove(t);
         }
     }  else if (ready) {
         if (t->IsRunning()) {
-            g_thread_ready_queue.push_front(t->current_priority, handle);
+            ready_queue.push_front(t->current_priority, t);
         } else {
-            g_thread_ready_queue.push_back(t->current_priority, handle);
+            ready_queue.push_back(t->current_priority, t);
         }
         t->status = THREADSTATUS_READY;
     }
@@ -164,26 +194,28 @@ void SwitchContext(Thread* t) {
         ChangeReadyState(t, false);
         t->status = (t->status | THREADSTATUS_RUNNING) & ~THREADSTATUS_READY;
         t->wait_type = WAITTYPE_NONE;
+        if (t->wait_result_pending) {
+            t->context.cpu_registers[0] = t->wait_result;
+            if (t->wait_result_index != -1) {
+                t->context.cpu_registers[1] = t->wait_result_index;
+            }
+            t->wait_result_pending = false;
+        }
         LoadContext(t->context);
     } else {
         SetCurrentThread(NULL);
     }
 }
 
-/// Gets the next thread that is ready to be run by priority
+/// Gets the next thread that is ready to be run on the calling CPU core by priority
 Thread* NextThread() {
-    Handle next;
     Thread* cur = GetCurrentThread();
+    ReadyQueue& ready_queue = g_thread_ready_queue[Core::GetCurrentCoreId()];
     
     if (cur && cur->IsRunning()) {
-        next = g_thread_ready_queue.pop_first_better(cur->current_priority);
-    } else  {
-        next = g_thread_ready_queue.pop_first();
-    }
-    if (next == 0) {
-        return NULL;
+        return ready_queue.pop_first_better(cur->current_priority);
     }
-    return Kernel::g_object_pool.GetFast<Thread>(next);
+    return ready_queue.pop_first();
 }
 
 /// Puts the current thread in the wait state for the given type
@@ -191,6 +223,20 @@ void WaitCurrentThread(WaitType wait_type) {
     Thread* t = GetCurrentThread();
     t->wait_type = wait_type;
     ChangeThreadState(t, ThreadStatus(THREADSTATUS_WAIT | (t->status & THREADSTATUS_SUSPEND)));
+    HLE::ReSchedule("thread waiting");
+}
+
+/**
+ * Sets the result a thread gets from its ended wait once it runs again: it cannot be set in its
+ * context right away, as the thread may still be the current one, with its registers in the CPU.
+ * @param t Thread whose wait ended
+ * @param result Result of the wait, set in r0
+ * @param index Index of the acquired object, set in r1 unless -1
+ */
+static void SetWaitResult(Thread* t, Result result, s32 index) {
+    t->wait_result_pending = true;
+    t->wait_result = result;
+    t->wait_result_index = index;
 }
 
 /// Resumes a thread from waiting by marking it as "ready"
@@ -201,8 +247,211 @@ void ResumeThreadFromWait(Handle handle) {
         t->status &= ~THREADSTATUS_WAIT;
         if (!(t->status & (THREADSTATUS_WAITSUSPEND | THREADSTATUS_DORMANT | THREADSTATUS_DEAD))) {
             ChangeReadyState(t, true);
+            HLE::ReSchedule("thread resumed");
+        }
+    }
+}
+
+/// Resumes all threads waiting for a given type, for waits that are not on a kernel object
+void ResumeThreadsWaitingFor(WaitType wait_type) {
+    for (size_t i = 0; i < g_thread_queue.size(); i++) {
+        Thread* t = Kernel::g_object_pool.GetFast<Thread>(g_thread_queue[i]);
+        if (t->IsWaiting() && t->wait_type == wait_type) {
+            ResumeThreadFromWait(t->GetHandle());
+        }
+    }
+}
+
+/// Gets the object a handle refers to if threads can wait on it, NULL otherwise
+static WaitObject* GetWaitObject(Handle handle) {
+    if (!Kernel::g_object_pool.IsValid(handle)) {
+        return NULL;
+    }
+    Object* object = Kernel::g_object_pool[handle];
+    return object->IsWaitable() ? static_cast<WaitObject*>(object) : NULL;
+}
+
+/**
+ * Checks whether a thread can end its wait on its wait objects
+ * @param t Thread to check
+ * @param index Set to the index of the object to acquire if the thread does not wait for all
+ * @return True if the wait objects of the thread can be acquired
+ */
+static bool CanAcquireWaitObjects(Thread* t, s32* index) {
+    const Handle handle = t->GetHandle();
+    *index = -1;
+    for (size_t i = 0; i < t->wait_objects.size(); i++) {
+        WaitObject* object = GetWaitObject(t->wait_objects[i]);
+        if (object == NULL) {
+            continue;
+        }
+        if (t->wait_all) {
+            if (object->ShouldWait(handle)) {
+                return false;
+            }
+        } else if (!object->ShouldWait(handle)) {
+            *index = (s32)i;
+            return true;
+        }
+    }
+    return t->wait_all;
+}
+
+/**
+ * Ends the wait of a thread on its wait objects, removing it from their waiting threads
+ * @param t Thread whose wait ends
+ * @param acquire Whether to acquire the objects, else the wait was cancelled
+ * @param index Index of the object to acquire if the thread does not wait for all
+ */
+static void EndWaitOnObjects(Thread* t, bool acquire, s32 index) {
+    const Handle handle = t->GetHandle();
+    for (size_t i = 0; i < t->wait_objects.size(); i++) {
+        WaitObject* object = GetWaitObject(t->wait_objects[i]);
+        if (object == NULL) {
+            continue;
+        }
+        object->RemoveWaitingThread(handle);
+        if (acquire && (t->wait_all || (s32)i == index)) {
+            object->Acquire(handle);
+        }
+    }
+    t->wait_objects.clear();
+}
+
+/// Acquires one or all of the given objects for the current thread, or waits until it can
+Result WaitThread_Synchronization(const Handle* handles, u32 count, bool wait_all,
+    s64 nanoseconds, s32* index) {
+
+    Thread* t = GetCurrentThread();
+    bool any_waitable = false;
+    *index = -1;
+
+    // Handles that are not in the object table are an error. Valid handles of objects that can't
+    // be waited on (services, ports and other objects not modelled as wait objects yet) are
+    // skipped on purpose, as applications wait on them along with events. If none of the objects
+    // can be waited on, the wait ends right away as if the first one had been signaled.
+    for (u32 i = 0; i < count; i++) {
+        if (!Kernel::g_object_pool.IsValid(handles[i])) {
+            ERROR_LOG(KERNEL, "WaitSynchronization on invalid handle 0x%08X", handles[i]);
+            return RESULT_INVALID_HANDLE;
+        }
+        if (GetWaitObject(handles[i]) != NULL) {
+            any_waitable = true;
+        } else {
+            WARN_LOG(KERNEL, "WaitSynchronization on 0x%08X, which is not a wait object",
+                handles[i]);
+        }
+    }
+    if (!any_waitable) {
+        if (count != 0 && !wait_all) {
+            *index = 0;
+        }
+        return 0;
+    }
+
+    t->wait_objects.assign(handles, handles + count);
+    t->wait_all = wait_all;
+    if (CanAcquireWaitObjects(t, index)) {
+        EndWaitOnObjects(t, true, *index);
+        return 0;
+    }
+    // A zero timeout only polls the objects
+    if (nanoseconds == 0) {
+        t->wait_objects.clear();
+        return RESULT_WAIT_TIMEOUT;
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        WaitObject* object = GetWaitObject(handles[i]);
+        if (object != NULL) {
+            object->AddWaitingThread(t->GetHandle());
         }
     }
+    WaitCurrentThread(WAITTYPE_SYNCH);
+    WakeThreadAfterDelay(t->GetHandle(), nanoseconds);
+    return 0;
+}
+
+/// Wakes up the threads waiting on an object that can now acquire it, by priority
+void WakeupWaitingThreads(WaitObject* object) {
+    // One thread at a time, as acquiring the object may make it unavailable to the others
+    for (;;) {
+        const std::vector<Handle>& waiting_threads = object->GetWaitingThreads();
+        Thread* next = NULL;
+        s32 next_index = -1;
+        Handle stale = 0;
+
+        for (size_t i = 0; i < waiting_threads.size(); i++) {
+            u32 error;
+            Thread* t = Kernel::g_object_pool.Get<Thread>(waiting_threads[i], error);
+            if (t == NULL) {
+                // The thread is gone, but its handle was left behind
+                stale = waiting_threads[i];
+                continue;
+            }
+            s32 index;
+            if ((next == NULL || t->current_priority < next->current_priority) &&
+                CanAcquireWaitObjects(t, &index)) {
+                next = t;
+                next_index = index;
+            }
+        }
+        if (stale != 0) {
+            WARN_LOG(KERNEL, "Removing stale waiting thread 0x%08X", stale);
+            object->RemoveWaitingThread(stale);
+            continue;
+        }
+        if (next == NULL) {
+            break;
+        }
+
+        EndWaitOnObjects(next, true, next_index);
+        SetWaitResult(next, 0, next_index);
+        CoreTiming::UnscheduleEvent(g_thread_wakeup_event_type, next->GetHandle());
+        ResumeThreadFromWait(next->GetHandle());
+    }
+}
+
+/**
+ * Wakes up a thread whose wait timed out
+ * @param userdata Handle of the thread to wake up
+ * @param cycles_late Number of cycles the event was handled late by
+ */
+void ThreadWakeupCallback(u64 userdata, int cycles_late) {
+    const Handle handle = (Handle)userdata;
+    u32 error;
+    Thread* t = Kernel::g_object_pool.Get<Thread>(handle, error);
+    if (t && t->IsWaiting()) {
+        if (t->wait_type == WAITTYPE_SYNCH) {
+            EndWaitOnObjects(t, false, -1);
+            SetWaitResult(t, RESULT_WAIT_TIMEOUT, -1);
+        }
+        ResumeThreadFromWait(handle);
+    }
+}
+
+/// Schedules a thread to be woken up after the given number of nanoseconds
+void WakeThreadAfterDelay(Handle handle, s64 nanoseconds) {
+    // Don't schedule a wakeup if the thread wants to wait forever
+    if (nanoseconds < 0) {
+        return;
+    }
+    CoreTiming::UnscheduleEvent(g_thread_wakeup_event_type, handle);
+    CoreTiming::ScheduleEvent(nsToCycles(nanoseconds), g_thread_wakeup_event_type, handle);
+}
+
+/// Puts the current thread to sleep for the given number of nanoseconds
+void SleepCurrentThread(s64 nanoseconds) {
+    Thread* t = GetCurrentThread();
+    if (nanoseconds <= 0) {
+        // Only yield: the thread goes behind the other ready threads of its priority
+        t->status &= ~THREADSTATUS_RUNNING;
+        ChangeReadyState(t, true);
+        HLE::ReSchedule("thread yield");
+        return;
+    }
+    WaitCurrentThread(WAITTYPE_SLEEP);
+    WakeThreadAfterDelay(t->GetHandle(), nanoseconds);
 }
 
 /// Creates a new thread
@@ -217,7 +466,6 @@ Thread* CreateThread(Handle& handle, const char* name, u32 entry_point, s32 prio
     handle = Kernel::g_object_pool.Create(t);
     
     g_thread_queue.push_back(handle);
-    g_thread_ready_queue.prepare(priority);
     
     t->status = THREADSTATUS_DORMANT;
     t->entry_point = entry_point;
@@ -225,7 +473,12 @@ Thread* CreateThread(Handle& handle, const char* name, u32 entry_point, s32 prio
     t->stack_size = stack_size;
     t->initial_priority = t->current_priority = priority;
     t->processor_id = processor_id;
+    t->core = GetCoreForProcessorId(processor_id);
     t->wait_type = WAITTYPE_NONE;
+    t->wait_all = false;
+    t->wait_result_pending = false;
+    t->wait_result = 0;
+    t->wait_result_index = -1;
     
     strncpy(t->name, name, Kernel::MAX_NAME_LENGTH);
     t->name[Kernel::MAX_NAME_LENGTH] = '\0';
@@ -302,19 +555,35 @@ Handle SetupMainThread(s32 priority, int stack_size) {
 void Reschedule() {
     Thread* prev = GetCurrentThread();
     Thread* next = NextThread();
-    if (next > 0) {
+    if (next) {
         SwitchContext(next);
-
-        // Hack - automatically change previous thread (which would have been in "wait" state) to
-        // "ready" state, so that we can immediately resume to it when new thread yields. FixMe to
-        // actually wait for whatever event it is supposed to be waiting on.
-        ChangeReadyState(prev, true);
+    } else if (prev && prev->IsWaiting()) {
+        // No thread is runnable: instead of executing instructions, skip ahead to the next
+        // scheduled event, which may wake a thread up, and check again then. CoreTiming follows
+        // the application core, so the system core just leaves its slice to the other core.
+        if (Core::GetCurrentCoreId() == Core::CORE_APP) {
+            CoreTiming::Idle();
+            HLE::ReSchedule("idle");
+        }
     }
 }
 
+/// Returns whether the calling CPU core has a thread to run
+bool IsCurrentThreadRunning() {
+    Thread* t = GetCurrentThread();
+    return t && t->IsRunning();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void ThreadingInit() {
+    for (int i = 0; i < Core::NUM_CORES; i++) {
+        g_thread_ready_queue[i].clear();
+        g_current_thread[i] = NULL;
+        g_current_thread_handle[i] = 0;
+    }
+    g_thread_wakeup_event_type = CoreTiming::RegisterEvent("ThreadWakeupCallback",
+        ThreadWakeupCallback);
 }
 
 void ThreadingShutdown() {
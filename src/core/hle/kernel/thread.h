@@ -43,6 +43,15 @@ enum WaitType {
 
 namespace Kernel {
 
+/// Result of a WaitSynchronization whose timeout expired before the objects could be acquired
+const Result RESULT_WAIT_TIMEOUT = 0x09401BFE;
+
+/// Result of a kernel call given a handle that does not refer to any object
+const Result RESULT_INVALID_HANDLE = 0xD8E007F7;
+
+/// Result of a kernel call given an argument that is out of range
+const Result RESULT_OUT_OF_RANGE = 0xE0E007FD;
+
 /// Creates a new thread - wrapper for external user
 Handle CreateThread(const char* name, u32 entry_point, s32 priority, u32 arg, s32 processor_id,
     u32 stack_top, int stack_size=Kernel::DEFAULT_STACK_SIZE);
@@ -59,11 +68,54 @@ void WaitCurrentThread(WaitType wait_type);
 /// Resumes a thread from waiting by marking it as "ready"
 void ResumeThreadFromWait(Handle handle);
 
+/**
+ * Schedules a thread to be woken up after the given number of nanoseconds
+ * @param handle Handle of the waiting thread
+ * @param nanoseconds Timeout in nanoseconds, negative to wait forever
+ */
+void WakeThreadAfterDelay(Handle handle, s64 nanoseconds);
+
+/**
+ * Puts the current thread to sleep for the given number of nanoseconds - on SleepThread
+ * @param nanoseconds Time to sleep, 0 to only yield to the other threads of the same priority
+ */
+void SleepCurrentThread(s64 nanoseconds);
+
 /// Gets the current thread handle
 Handle GetCurrentThreadHandle();
 
-/// Put current thread in a wait state - on WaitSynchronization
-void WaitThread_Synchronization();
+/// Returns whether the calling CPU core has a thread to run
+bool IsCurrentThreadRunning();
+
+/**
+ * Resumes all threads waiting for a given type, for waits that are not on a kernel object
+ * @param wait_type Type of the waits to end, e.g. WAITTYPE_VBLANK
+ */
+void ResumeThreadsWaitingFor(WaitType wait_type);
+
+/**
+ * Acquires one or all of the given objects for the current thread - on WaitSynchronization. If
+ * they are not available, the thread is put in a wait state until they are or the timeout
+ * expires.
+ * @param handles Handles of the objects to wait on
+ * @param count Number of handles
+ * @param wait_all Whether to wait until all objects can be acquired at once, rather than any one
+ * @param nanoseconds Timeout of the wait, 0 to only poll the objects, negative to wait forever
+ * @param index Set to the index of the acquired object if wait_all is false and the thread does
+ *        not wait, -1 otherwise. A waiting thread gets the index in r1 when it is woken up.
+ * @return RESULT_INVALID_HANDLE if a handle does not refer to any object, RESULT_WAIT_TIMEOUT if
+ *         polling found the objects unavailable, 0 otherwise. A waiting thread gets the result of
+ *         its wait in r0 when it is woken up.
+ */
+Result WaitThread_Synchronization(const Handle* handles, u32 count, bool wait_all,
+    s64 nanoseconds, s32* index);
+
+/**
+ * Wakes up the threads waiting on an object that can now acquire it, by priority. Called by wait
+ * objects when they become available.
+ * @param object Object that became available
+ */
+void WakeupWaitingThreads(WaitObject* object);
 
 /// Initialize threading
 void ThreadingInit();
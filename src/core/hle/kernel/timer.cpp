@@ -0,0 +1,150 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <string>
+
+#include "common/common.h"
+
+#include "core/core_timing.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/timer.h"
+#include "core/hle/kernel/thread.h"
+
+namespace Kernel {
+
+class Timer : public WaitObject {
+public:
+    const char* GetTypeName() { return "Timer"; }
+    const char* GetName() { return name.c_str(); }
+
+    static Kernel::HandleType GetStaticHandleType() {  return Kernel::HandleType::Timer; }
+    Kernel::HandleType GetHandleType() const { return Kernel::HandleType::Timer; }
+
+    bool ShouldWait(Handle thread) const {
+        return !signaled;
+    }
+
+    void Acquire(Handle thread) {
+        if (reset_type == RESETTYPE_ONESHOT) {
+            signaled = false;
+        }
+    }
+
+    ResetType reset_type;                       ///< How the timer goes back to unsignaled: when
+                                                ///< acquired (oneshot), when cleared (sticky) or
+                                                ///< right after signaling (pulse)
+    bool signaled;                              ///< Whether the timer is currently signaled
+    s64 interval_delay;                         ///< Nanoseconds between signals, 0 if it only
+                                                ///< signals once
+    std::string name;                           ///< Name of timer (optional)
+};
+
+/// CoreTiming event type used to signal timers when they are due
+static int g_timer_callback_event_type = -1;
+
+/**
+ * Signals a timer when it is due, and schedules its next signal if it repeats
+ * @param userdata Handle of the timer
+ * @param cycles_late Number of cycles the event was handled late by
+ */
+static void TimerCallback(u64 userdata, int cycles_late) {
+    u32 error;
+    Timer* timer = Kernel::g_object_pool.Get<Timer>((Handle)userdata, error);
+    if (timer == NULL) {
+        return;
+    }
+    timer->signaled = true;
+    WakeupWaitingThreads(timer);
+
+    if (timer->reset_type == RESETTYPE_PULSE) {
+        timer->signaled = false;
+    }
+    if (timer->interval_delay != 0) {
+        // Keep the period from drifting by the lateness of this signal. A period shorter than a
+        // cycle still takes one, or the timer would keep firing without time ever passing.
+        s64 period = std::max<s64>(nsToCycles(timer->interval_delay), 1);
+        CoreTiming::ScheduleEvent(std::max<s64>(period - cycles_late, 0),
+            g_timer_callback_event_type, userdata);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Creates a timer
+ * @param reset_type ResetType describing how the timer goes back to the unsignaled state
+ * @param name Name of the timer, for debugging
+ * @return Handle to the newly created timer
+ */
+Handle CreateTimer(ResetType reset_type, const char* name) {
+    Timer* timer = new Timer;
+    Handle handle = Kernel::g_object_pool.Create(timer);
+
+    timer->reset_type = reset_type;
+    timer->signaled = false;
+    timer->interval_delay = 0;
+    timer->name = name;
+
+    return handle;
+}
+
+/**
+ * Starts a timer, replacing its previous schedule
+ * @param handle Handle to timer to start
+ * @param initial Nanoseconds until the timer is first signaled
+ * @param interval Nanoseconds between the following signals, 0 to signal it only once
+ * @return Result of operation, 0 on success, otherwise error code
+ */
+Result SetTimer(Handle handle, s64 initial, s64 interval) {
+    u32 error;
+    Timer* timer = Kernel::g_object_pool.Get<Timer>(handle, error);
+    if (timer == NULL) {
+        return RESULT_INVALID_HANDLE;
+    }
+    if (initial < 0 || interval < 0) {
+        return RESULT_OUT_OF_RANGE;
+    }
+    timer->interval_delay = interval;
+
+    CoreTiming::UnscheduleEvent(g_timer_callback_event_type, handle);
+    CoreTiming::ScheduleEvent(nsToCycles(initial), g_timer_callback_event_type, handle);
+    return 0;
+}
+
+/**
+ * Stops a timer, without changing whether it is signaled
+ * @param handle Handle to timer to stop
+ * @return Result of operation, 0 on success, otherwise error code
+ */
+Result CancelTimer(Handle handle) {
+    u32 error;
+    Timer* timer = Kernel::g_object_pool.Get<Timer>(handle, error);
+    if (timer == NULL) {
+        return RESULT_INVALID_HANDLE;
+    }
+    CoreTiming::UnscheduleEvent(g_timer_callback_event_type, handle);
+    return 0;
+}
+
+/**
+ * Clears a timer
+ * @param handle Handle to timer to clear
+ * @return Result of operation, 0 on success, otherwise error code
+ */
+Result ClearTimer(Handle handle) {
+    u32 error;
+    Timer* timer = Kernel::g_object_pool.Get<Timer>(handle, error);
+    if (timer == NULL) {
+        return RESULT_INVALID_HANDLE;
+    }
+    timer->signaled = false;
+    return 0;
+}
+
+void TimersInit() {
+    g_timer_callback_event_type = CoreTiming::RegisterEvent("TimerCallback", TimerCallback);
+}
+
+} // namespace
@@ -0,0 +1,48 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/svc.h"
+
+namespace Kernel {
+
+/**
+ * Creates a timer
+ * @param reset_type ResetType describing how the timer goes back to the unsignaled state
+ * @param name Name of the timer, for debugging
+ * @return Handle to the newly created timer
+ */
+Handle CreateTimer(ResetType reset_type, const char* name="Unknown");
+
+/**
+ * Starts a timer, replacing its previous schedule
+ * @param handle Handle to timer to start
+ * @param initial Nanoseconds until the timer is first signaled
+ * @param interval Nanoseconds between the following signals, 0 to signal it only once
+ * @return Result of operation, 0 on success, otherwise error code
+ */
+Result SetTimer(Handle handle, s64 initial, s64 interval);
+
+/**
+ * Stops a timer, without changing whether it is signaled
+ * @param handle Handle to timer to stop
+ * @return Result of operation, 0 on success, otherwise error code
+ */
+Result CancelTimer(Handle handle);
+
+/**
+ * Clears a timer
+ * @param handle Handle to timer to clear
+ * @return Result of operation, 0 on success, otherwise error code
+ */
+Result ClearTimer(Handle handle);
+
+/// Initialize timers
+void TimersInit();
+
+} // namespace
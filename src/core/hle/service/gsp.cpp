@@ -6,13 +6,19 @@
 #include "common/log.h"
 #include "common/bit_field.h"
 
+#include "core/core_timing.h"
 #include "core/mem_map.h"
 #include "core/hle/hle.h"
+#include "core/hle/kernel/event.h"
 #include "core/hle/service/gsp.h"
 
 #include "core/hw/gpu.h"
 
 #include "video_core/gpu_debugger.h"
+#include "video_core/gpu_thread.h"
+#include "video_core/texture_cache.h"
+#include "video_core/transfer.h"
+#include "video_core/renderer_opengl/gl_rasterizer.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -62,6 +68,12 @@ namespace GSP_GPU {
 
 u32 g_thread_id = 0;
 
+/// Event signaled when an interrupt is queued up, registered by the application
+static Handle g_interrupt_event = 0;
+
+/// CoreTiming event type relaying interrupts of GX commands from the GPU thread
+static int g_interrupt_event_type = -1;
+
 enum {
     REG_FRAMEBUFFER_1   = 0x00400468,
     REG_FRAMEBUFFER_2   = 0x00400494,
@@ -77,6 +89,9 @@ void ReadHWRegs(Service::Interface* self) {
     u32 size = cmd_buff[2];
     u32* dst = (u32*)Memory::GetPointer(cmd_buff[0x41]);
 
+    // The registers may still be written by queued up GPU commands
+    GPUThread::Synchronize();
+
     switch (reg_addr) {
 
     // NOTE: Calling SetFramebufferLocation here is a hack... Not sure the correct way yet to set 
@@ -101,45 +116,281 @@ void ReadHWRegs(Service::Interface* self) {
 
 }
 
+/// Gets a pointer to the interrupt relay queue of a thread in GSP shared memory
+static inline InterruptRelayQueue* GetInterruptRelayQueue(u32 thread_id) {
+    return (InterruptRelayQueue*)Memory::GetPointer(0x10002000 + thread_id * 0x40);
+}
+
+void SignalInterrupt(InterruptId interrupt_id) {
+    if (g_interrupt_event == 0) {
+        return;
+    }
+    InterruptRelayQueue* queue = GetInterruptRelayQueue(g_thread_id);
+    if (queue->number_interrupts >= ARRAY_SIZE(queue->slot)) {
+        queue->error_code = 1;
+    } else {
+        const u32 next = (queue->index + queue->number_interrupts) % ARRAY_SIZE(queue->slot);
+        queue->slot[next] = interrupt_id;
+        queue->number_interrupts = queue->number_interrupts + 1;
+    }
+    Kernel::SignalEvent(g_interrupt_event);
+}
+
+/**
+ * Signals an interrupt queued up by the GPU thread, on the CPU thread
+ * @param userdata InterruptId to signal
+ * @param cycles_late Number of cycles the event was handled late by
+ */
+static void InterruptCallback(u64 userdata, int cycles_late) {
+    SignalInterrupt((InterruptId)userdata);
+}
+
+/**
+ * Signals an interrupt once the GPU thread got to it
+ * @param interrupt_id Interrupt to signal
+ */
+static void SignalInterruptFromGPUThread(InterruptId interrupt_id) {
+    CoreTiming::ScheduleEvent_Threadsafe(0, g_interrupt_event_type, (u64)interrupt_id);
+}
+
 void RegisterInterruptRelayQueue(Service::Interface* self) {
     u32* cmd_buff = Service::GetCommandBuffer();
     u32 flags = cmd_buff[1];
-    u32 event_handle = cmd_buff[3]; // TODO(bunnei): Implement event handling
+    g_interrupt_event = cmd_buff[3];
 
     cmd_buff[2] = g_thread_id;          // ThreadID
 }
 
 
-/// This triggers handling of the GX command written to the command buffer in shared memory.
-void TriggerCmdReqQueue(Service::Interface* self) {
-    GX_CmdBufferHeader* header = (GX_CmdBufferHeader*)GX_GetCmdBufferPointer(g_thread_id);
-    u32* cmd_buff = (u32*)GX_GetCmdBufferPointer(g_thread_id, 0x20 + (header->index * 0x20));
+/**
+ * Marks the textures decoded from memory written by a GX command dirty
+ * @param address Virtual address of the written memory
+ * @param size Size of the written memory in bytes
+ */
+static void InvalidateTextures(u32 address, u32 size) {
+    const u32 physical_address = Memory::PhysicalAddressFromVirtual(address);
+    if (physical_address != 0) {
+        Pica::TextureCache::InvalidateRange(physical_address, size);
+    }
+}
 
-    switch (static_cast<GXCommandId>(cmd_buff[0])) {
+/**
+ * Writes back the buffers cached by the hardware rasterizer that overlap memory read by a GX
+ * command
+ * @param address Virtual address of the read memory
+ * @param size Size of the read memory in bytes
+ */
+static void FlushSurfaces(u32 address, u32 size) {
+    const u32 physical_address = Memory::PhysicalAddressFromVirtual(address);
+    if (physical_address != 0) {
+        Pica::HWRasterizer::FlushRegion(physical_address, size);
+    }
+}
+
+/**
+ * Makes the buffers cached by the hardware rasterizer that overlap memory about to be written by
+ * a GX command reload it
+ * @param address Virtual address of the written memory
+ * @param size Size of the written memory in bytes
+ */
+static void InvalidateSurfaces(u32 address, u32 size) {
+    const u32 physical_address = Memory::PhysicalAddressFromVirtual(address);
+    if (physical_address != 0) {
+        Pica::HWRasterizer::InvalidateRegion(physical_address, size);
+    }
+}
+
+/**
+ * Gets a pointer to a buffer accessed by a GX command, checking that all of it is mapped
+ * @param address Virtual address of the buffer
+ * @param size Size of the buffer in bytes
+ * @return Host pointer to the buffer, or NULL if it is empty or not within one memory block
+ */
+static u8* GetBufferPointer(u32 address, u64 size) {
+    if (size == 0 || size > 0xFFFFFFFF)
+        return NULL;
+    return Memory::GetBlockPointer(address, (u32)size);
+}
+
+/**
+ * Fills one of the buffers of a memory fill
+ * @param start Virtual address of the buffer
+ * @param end Virtual address past the end of the buffer
+ * @param value Value to fill the buffer with
+ * @param fill_24bit Whether to fill with the low 24 bits of the value
+ * @param fill_32bit Whether to fill with the 32-bit value
+ */
+static void MemoryFill(u32 start, u32 end, u32 value, bool fill_24bit, bool fill_32bit) {
+    if (end == start)
+        return;
+
+    u8* const pointer = (end > start) ? GetBufferPointer(start, end - start) : NULL;
+    if (pointer == NULL) {
+        ERROR_LOG(GSP, "invalid memory fill 0x%08X-0x%08X", start, end);
+        return;
+    }
+
+    const u32 value_size = fill_32bit ? 4 : (fill_24bit ? 3 : 2);
+    InvalidateSurfaces(start, end - start);
+    VideoCore::MemoryFill(pointer, pointer + (end - start), value, value_size);
+    InvalidateTextures(start, end - start);
+}
+
+/**
+ * Executes a GX command, on the GPU thread
+ * @param cmd_buff Copy of the command taken from the command buffer in shared memory
+ */
+void ExecuteGXCommand(const u32* cmd_buff) {
+    const GXCommand& command = *(const GXCommand*)cmd_buff;
+
+    switch (command.id) {
 
     // GX request DMA - typically used for copying memory from GSP heap to VRAM
     case GXCommandId::REQUEST_DMA:
-        memcpy(Memory::GetPointer(cmd_buff[2]), Memory::GetPointer(cmd_buff[1]), cmd_buff[3]);
+    {
+        const u32 source_address = command.dma_request.source_address;
+        const u32 dest_address = command.dma_request.dest_address;
+        const u32 size = command.dma_request.size;
+
+        const u8* source = GetBufferPointer(source_address, size);
+        u8* dest = GetBufferPointer(dest_address, size);
+        if (size != 0 && (source == NULL || dest == NULL)) {
+            ERROR_LOG(GSP, "invalid DMA 0x%08X -> 0x%08X, size 0x%08X", source_address,
+                dest_address, size);
+            break;
+        }
+
+        if (size != 0) {
+            FlushSurfaces(source_address, size);
+            InvalidateSurfaces(dest_address, size);
+            memmove(dest, source, size);
+            InvalidateTextures(dest_address, size);
+        }
+        SignalInterruptFromGPUThread(InterruptId::DMA);
         break;
+    }
 
     case GXCommandId::SET_COMMAND_LIST_LAST:
         GPU::Write<u32>(GPU::Registers::CommandListAddress, cmd_buff[1] >> 3);
         GPU::Write<u32>(GPU::Registers::CommandListSize, cmd_buff[2] >> 3);
-        GPU::Write<u32>(GPU::Registers::ProcessCommandList, 1); // TODO: Not sure if we are supposed to always write this
+
+        // Already on the GPU thread, so run the list directly rather than through the
+        // ProcessCommandList register, whose writes are queued up for the GPU thread
+        GPU::ProcessCommandList(cmd_buff[1] & ~7u, cmd_buff[2] & ~7u);
 
         // TODO: Move this to GPU
         // TODO: Not sure what units the size is measured in
         g_debugger.CommandListCalled(cmd_buff[1], (u32*)Memory::GetPointer(cmd_buff[1]), cmd_buff[2]);
+        SignalInterruptFromGPUThread(InterruptId::P3D);
         break;
 
+    // Fills up to two buffers, typically to clear the color and depth buffers
     case GXCommandId::SET_MEMORY_FILL:
+    {
+        const GXMemoryFillControl control = command.memory_fill.control;
+        if (control.start1) {
+            MemoryFill(command.memory_fill.start1, command.memory_fill.end1,
+                command.memory_fill.value1, control.fill1_24bit, control.fill1_32bit);
+            SignalInterruptFromGPUThread(InterruptId::PSC0);
+        }
+        if (control.start2) {
+            MemoryFill(command.memory_fill.start2, command.memory_fill.end2,
+                command.memory_fill.value2, control.fill2_24bit, control.fill2_32bit);
+            SignalInterruptFromGPUThread(InterruptId::PSC1);
+        }
         break;
+    }
 
+    // Copies a rendered color buffer to a framebuffer, or linear data to a tiled texture
     case GXCommandId::SET_DISPLAY_TRANSFER:
+    {
+        const GXDisplayTransferFlags flags = command.display_transfer.flags;
+
+        VideoCore::DisplayTransferConfig config;
+        config.input_width = command.display_transfer.in_buffer_size & 0xFFFF;
+        config.input_height = command.display_transfer.in_buffer_size >> 16;
+        config.input_format = static_cast<GPU::FramebufferFormat>((u32)flags.input_format);
+        config.output_width = command.display_transfer.out_buffer_size & 0xFFFF;
+        config.output_height = command.display_transfer.out_buffer_size >> 16;
+        config.output_format = static_cast<GPU::FramebufferFormat>((u32)flags.output_format);
+        config.flip_vertically = flags.flip_vertically != 0;
+        config.output_tiled = flags.output_tiled != 0;
+        config.scaling = static_cast<VideoCore::TransferScaling>((u32)flags.scaling);
+
+        const u8* in = NULL;
+        u8* out = NULL;
+        u32 in_size = 0;
+        u32 out_size = 0;
+        if (config.input_format <= GPU::FRAMEBUFFER_FORMAT_RGBA4 &&
+            config.output_format <= GPU::FRAMEBUFFER_FORMAT_RGBA4 &&
+            config.scaling <= VideoCore::TRANSFER_SCALING_XY) {
+
+            // Each side is accessed as a whole, sizes are at most 0xFFFF * 0xFFFF * 4 bytes
+            const u64 in_size64 = (u64)config.input_width * config.input_height *
+                VideoCore::GetFramebufferBytesPerPixel(config.input_format);
+            const u64 out_size64 = (u64)config.output_width * config.output_height *
+                VideoCore::GetFramebufferBytesPerPixel(config.output_format);
+            in = GetBufferPointer(command.display_transfer.in_buffer_address, in_size64);
+            out = GetBufferPointer(command.display_transfer.out_buffer_address, out_size64);
+            in_size = (u32)in_size64;
+            out_size = (u32)out_size64;
+        }
+        if (in == NULL || out == NULL) {
+            ERROR_LOG(GSP, "invalid display transfer 0x%08X -> 0x%08X, flags 0x%08X, "
+                "sizes 0x%08X -> 0x%08X", command.display_transfer.in_buffer_address,
+                command.display_transfer.out_buffer_address, flags.hex,
+                command.display_transfer.in_buffer_size,
+                command.display_transfer.out_buffer_size);
+            break;
+        }
+
+        FlushSurfaces(command.display_transfer.in_buffer_address, in_size);
+        InvalidateSurfaces(command.display_transfer.out_buffer_address, out_size);
+
+        VideoCore::DisplayTransfer(in, out, config);
+        InvalidateTextures(command.display_transfer.out_buffer_address, out_size);
+        SignalInterruptFromGPUThread(InterruptId::PPF);
         break;
+    }
 
+    // Copies raw data, skipping gaps between its lines in both the input and the output
     case GXCommandId::SET_TEXTURE_COPY:
+    {
+        const u32 in_width = (command.texture_copy.in_width_gap & 0xFFFF) * 16;
+        const u32 in_gap = (command.texture_copy.in_width_gap >> 16) * 16;
+        const u32 out_width = (command.texture_copy.out_width_gap & 0xFFFF) * 16;
+        const u32 out_gap = (command.texture_copy.out_width_gap >> 16) * 16;
+        const u32 size = command.texture_copy.size;
+
+        if (size == 0) {
+            SignalInterruptFromGPUThread(InterruptId::PPF);
+            break;
+        }
+
+        // Count the gaps the copy spans as read and written too
+        const u64 in_size64 = (in_width != 0 && in_gap != 0) ?
+            size + (u64)((size - 1) / in_width) * in_gap : size;
+        const u64 out_size64 = (out_width != 0 && out_gap != 0) ?
+            size + (u64)((size - 1) / out_width) * out_gap : size;
+        const u8* in = GetBufferPointer(command.texture_copy.in_buffer_address, in_size64);
+        u8* out = GetBufferPointer(command.texture_copy.out_buffer_address, out_size64);
+        if (in == NULL || out == NULL) {
+            ERROR_LOG(GSP, "invalid texture copy 0x%08X -> 0x%08X, size 0x%08X",
+                command.texture_copy.in_buffer_address, command.texture_copy.out_buffer_address,
+                size);
+            break;
+        }
+
+        const u32 in_size = (u32)in_size64;
+        const u32 out_size = (u32)out_size64;
+        FlushSurfaces(command.texture_copy.in_buffer_address, in_size);
+        InvalidateSurfaces(command.texture_copy.out_buffer_address, out_size);
+
+        VideoCore::TextureCopy(in, in_width, in_gap, out, out_width, out_gap, size);
+        InvalidateTextures(command.texture_copy.out_buffer_address, out_size);
+        SignalInterruptFromGPUThread(InterruptId::PPF);
         break;
+    }
 
     case GXCommandId::SET_COMMAND_LIST_FIRST:
     {
@@ -152,6 +403,15 @@ void TriggerCmdReqQueue(Service::Interface* self) {
     default:
         ERROR_LOG(GSP, "TriggerCmdReqQueue unknown command 0x%08X", cmd_buff[0]);
     }
+}
+
+/// This triggers handling of the GX command written to the command buffer in shared memory.
+void TriggerCmdReqQueue(Service::Interface* self) {
+    GX_CmdBufferHeader* header = (GX_CmdBufferHeader*)GX_GetCmdBufferPointer(g_thread_id);
+    u32* cmd_buff = (u32*)GX_GetCmdBufferPointer(g_thread_id, 0x20 + (header->index * 0x20));
+
+    // The command is copied, so the application may reuse its 0x20 byte slot right away
+    GPUThread::PushCommand(ExecuteGXCommand, cmd_buff, 0x20 / sizeof(u32));
 
     GX_FinishCommand(g_thread_id);
 }
@@ -194,6 +454,9 @@ const Interface::FunctionInfo FunctionTable[] = {
 
 Interface::Interface() {
     Register(FunctionTable, ARRAY_SIZE(FunctionTable));
+
+    g_interrupt_event = 0;
+    g_interrupt_event_type = CoreTiming::RegisterEvent("GSP_GPU::Interrupt", InterruptCallback);
 }
 
 Interface::~Interface() {
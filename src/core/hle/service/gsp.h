@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "common/bit_field.h"
+
 #include "core/hle/service/service.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -11,6 +13,41 @@
 
 namespace GSP_GPU {
 
+/// GSP interrupts, relayed to the application through its interrupt relay queue
+enum class InterruptId : u8 {
+    PSC0    = 0x00,     ///< First buffer of a memory fill done
+    PSC1    = 0x01,     ///< Second buffer of a memory fill done
+    PDC0    = 0x02,     ///< VBlank of the top screen
+    PDC1    = 0x03,     ///< VBlank of the bottom screen
+    PPF     = 0x04,     ///< Display transfer or texture copy done
+    P3D     = 0x05,     ///< Command list done
+    DMA     = 0x06,     ///< DMA request done
+};
+
+/// Interrupt relay queue of an application thread in GSP shared memory
+struct InterruptRelayQueue {
+    union {
+        u32 hex;
+
+        BitField< 0, 8, u32> index;             ///< Slot of the oldest queued interrupt
+        BitField< 8, 8, u32> number_interrupts; ///< Number of queued interrupts
+        BitField<16, 8, u32> error_code;        ///< Set when the queue overflowed
+    };
+
+    u32 missed_PDC0;
+    u32 missed_PDC1;
+
+    InterruptId slot[0x34];                     ///< Queued interrupts, circular
+};
+static_assert(sizeof(InterruptRelayQueue) == 0x40, "InterruptRelayQueue has incorrect size");
+
+/**
+ * Queues up an interrupt in the application's interrupt relay queue and signals its interrupt
+ * event. Must be called on the CPU thread.
+ * @param interrupt_id Interrupt to signal
+ */
+void SignalInterrupt(InterruptId interrupt_id);
+
 enum class GXCommandId : u32 {
     REQUEST_DMA            = 0x00000000,
     SET_COMMAND_LIST_LAST  = 0x00000001,
@@ -20,14 +57,83 @@ enum class GXCommandId : u32 {
     SET_COMMAND_LIST_FIRST = 0x00000005,
 };
 
+/// Control of the two buffers of a memory fill
+union GXMemoryFillControl {
+    u32 hex;
+
+    // Each buffer is filled with a 16-bit value, unless one of its size flags is set
+    BitField< 0, 1, u32> start1;        ///< Whether the first buffer is filled at all
+    BitField< 8, 1, u32> fill1_24bit;
+    BitField< 9, 1, u32> fill1_32bit;
+    BitField<16, 1, u32> start2;        ///< Whether the second buffer is filled at all
+    BitField<24, 1, u32> fill2_24bit;
+    BitField<25, 1, u32> fill2_32bit;
+};
+
+/// Flags of a display transfer
+union GXDisplayTransferFlags {
+    u32 hex;
+
+    BitField< 0, 1, u32> flip_vertically;
+    BitField< 1, 1, u32> output_tiled;  ///< Converts linear input to tiled output if set, tiled
+                                        ///< input to linear output otherwise
+    BitField< 8, 3, u32> input_format;  ///< GPU::FramebufferFormat of the input
+    BitField<12, 3, u32> output_format; ///< GPU::FramebufferFormat of the output
+    BitField<24, 2, u32> scaling;       ///< VideoCore::TransferScaling
+};
+
 union GXCommand {
     struct {
         GXCommandId id;
+
+        union {
+            struct {
+                u32 source_address;
+                u32 dest_address;
+                u32 size;
+            } dma_request;
+
+            struct {
+                u32 start1;
+                u32 value1;
+                u32 end1;
+                u32 start2;
+                u32 value2;
+                u32 end2;
+                GXMemoryFillControl control;
+            } memory_fill;
+
+            struct {
+                u32 in_buffer_address;
+                u32 out_buffer_address;
+                u32 in_buffer_size;     ///< Width in the low 16 bits, height in the high ones
+                u32 out_buffer_size;    ///< Width in the low 16 bits, height in the high ones
+                GXDisplayTransferFlags flags;
+            } display_transfer;
+
+            struct {
+                u32 in_buffer_address;
+                u32 out_buffer_address;
+                u32 size;               ///< Bytes to copy, not counting the gaps
+                u32 in_width_gap;       ///< Line width in the low 16 bits, gap in the high ones,
+                                        ///< both in units of 16 bytes
+                u32 out_width_gap;      ///< Line width in the low 16 bits, gap in the high ones,
+                                        ///< both in units of 16 bytes
+                u32 flags;
+            } texture_copy;
+        };
     };
 
     u32 data[0x20];
 };
 
+/**
+ * Executes a GX command, on the GPU thread. Buffers that are not entirely within one mapped
+ * memory block are rejected with an error.
+ * @param cmd_buff Copy of the command taken from the command buffer in shared memory
+ */
+void ExecuteGXCommand(const u32* cmd_buff);
+
 /// Interface to "srv:" service
 class Interface : public Service::Interface {
 public:
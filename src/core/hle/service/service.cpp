@@ -2,6 +2,8 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <chrono>
+
 #include "common/common.h"
 #include "common/log.h"
 #include "common/string_util.h"
@@ -19,6 +21,86 @@
 namespace Service {
 
 Manager* g_manager = NULL;  ///< Service manager
+bool g_time_functions = false;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Service Interface class
+
+Result Interface::Sync() {
+    u32* cmd_buff = GetCommandBuffer();
+    const u32 command = cmd_buff[0];
+
+    // The high halfword of a command ID numbers the command, the low halfword describes its
+    // parameters, which must match too
+    const u32 index = command >> 16;
+    FunctionSlot* slot = index < m_functions.size() ? &m_functions[index] : NULL;
+    if (slot == NULL || slot->info == NULL || slot->info->id != command) {
+        ERROR_LOG(OSHLE, "Unknown/unimplemented function: port = %s, command = 0x%08X!",
+            GetPortName(), command);
+        return -1;
+    }
+    if (slot->info->func == NULL) {
+        ERROR_LOG(OSHLE, "Unimplemented function: port = %s, name = %s!",
+            GetPortName(), slot->info->name.c_str());
+        return -1;
+    }
+
+    slot->stats.call_count++;
+    if (g_time_functions) {
+        const auto start = std::chrono::steady_clock::now();
+        slot->info->func(this);
+        slot->stats.host_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    } else {
+        slot->info->func(this);
+    }
+
+    return 0; // TODO: Implement return from actual function
+}
+
+void Interface::Register(const FunctionInfo* functions, int len) {
+    for (int i = 0; i < len; i++) {
+        const u32 index = functions[i].id >> 16;
+        if (index >= m_functions.size()) {
+            FunctionSlot empty = { NULL, { 0, 0 } };
+            m_functions.resize(index + 1, empty);
+        }
+        if (m_functions[index].info != NULL) {
+            // The table could only dispatch one of them, so keep the first and drop the other
+            ERROR_LOG(OSHLE, "Register: port %s has two functions numbered 0x%X, ignoring %s",
+                GetPortName(), index, functions[i].name.c_str());
+            continue;
+        }
+        m_functions[index].info = &functions[i];
+    }
+}
+
+const Interface::FunctionStats* Interface::GetFunctionStats(u32 id) const {
+    const u32 index = id >> 16;
+    if (index >= m_functions.size() || m_functions[index].info == NULL ||
+        m_functions[index].info->id != id) {
+        return NULL;
+    }
+    return &m_functions[index].stats;
+}
+
+void Interface::ResetFunctionStats() {
+    for (size_t i = 0; i < m_functions.size(); i++) {
+        m_functions[i].stats.call_count = 0;
+        m_functions[i].stats.host_time_ns = 0;
+    }
+}
+
+void Interface::LogFunctionStats() const {
+    for (size_t i = 0; i < m_functions.size(); i++) {
+        const FunctionSlot& slot = m_functions[i];
+        if (slot.info != NULL && slot.stats.call_count != 0) {
+            INFO_LOG(OSHLE, "%s %s (0x%08X): %llu calls, %llu us", GetPortName(),
+                slot.info->name.c_str(), slot.info->id, slot.stats.call_count,
+                slot.stats.host_time_ns / 1000);
+        }
+    }
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Service Manager class
@@ -60,6 +142,13 @@ Interface* Manager::FetchFromPortName(std::string port_name) {
     return FetchFromHandle(itr->second);
 }
 
+/// Logs the call statistics of the functions of all services
+void Manager::LogFunctionStats() const {
+    for (Interface* service : m_services) {
+        service->LogFunctionStats();
+    }
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Module interface
@@ -78,6 +167,7 @@ void Init() {
 
 /// Shutdown ServiceManager
 void Shutdown() {
+    g_manager->LogFunctionStats();
     delete g_manager;
     NOTICE_LOG(HLE, "Services shutdown OK");
 }
@@ -53,6 +53,13 @@ public:
         std::string name;
     };
 
+    /// Statistics of the calls to a function of the service
+    struct FunctionStats {
+        u64 call_count;     ///< Number of calls
+        u64 host_time_ns;   ///< Cumulative host time spent in the function, in nanoseconds,
+                            ///< measured only if g_time_functions is set
+    };
+
     /**
      * Gets the string name used by CTROS for a service
      * @return Port name of service
@@ -79,41 +86,41 @@ public:
      * Called when svcSendSyncRequest is called, loads command buffer and executes comand
      * @return Return result of svcSendSyncRequest passed back to user app
      */
-    Result Sync() {
-        u32* cmd_buff = GetCommandBuffer();
-        auto itr = m_functions.find(cmd_buff[0]);
-
-        if (itr == m_functions.end()) {
-            ERROR_LOG(OSHLE, "Unknown/unimplemented function: port = %s, command = 0x%08X!", 
-                GetPortName(), cmd_buff[0]);
-            return -1;
-        }
-        if (itr->second.func == NULL) {
-            ERROR_LOG(OSHLE, "Unimplemented function: port = %s, name = %s!", 
-                GetPortName(), itr->second.name.c_str());
-            return -1;
-        } 
-
-        itr->second.func(this);
-
-        return 0; // TODO: Implement return from actual function
-    }
+    Result Sync();
+
+    /**
+     * Gets the call statistics of a function of the service
+     * @param id Command ID of the function
+     * @return Statistics of the function, NULL if the service has no function with this ID
+     */
+    const FunctionStats* GetFunctionStats(u32 id) const;
+
+    /// Resets the call statistics of all functions of the service
+    void ResetFunctionStats();
+
+    /// Logs the call statistics of the functions of the service that were called
+    void LogFunctionStats() const;
 
 protected:
 
     /**
-     * Registers the functions in the service
+     * Registers the functions in the service. Of functions with the same number, the high
+     * halfword of the command ID, only the first is registered and the others are logged as errors.
+     * @param functions Table of the functions, which must outlive the service
+     * @param len Number of functions in the table
      */
-    void Register(const FunctionInfo* functions, int len) {
-        for (int i = 0; i < len; i++) {
-            m_functions[functions[i].id] = functions[i];
-        }
-    }
+    void Register(const FunctionInfo* functions, int len);
 
 private:
 
+    /// Entry of the dispatch table, for the command IDs whose high halfword is its index
+    struct FunctionSlot {
+        const FunctionInfo* info;   ///< Registered function, NULL if none
+        FunctionStats       stats;  ///< Statistics of the calls to the function
+    };
+
     std::vector<Handle>         m_handles;
-    std::map<u32, FunctionInfo> m_functions;
+    std::vector<FunctionSlot>   m_functions;    ///< Indexed by command ID >> 16
 
 };
 
@@ -137,6 +144,9 @@ public:
     /// Get a Service Interface from its port
     Interface* FetchFromPortName(std::string port_name);
 
+    /// Logs the call statistics of the functions of all services
+    void LogFunctionStats() const;
+
 private:
 
     std::vector<Interface*>     m_services;
@@ -153,5 +163,9 @@ void Shutdown();
 
 extern Manager* g_manager; ///< Service manager
 
+/// Whether Sync measures the host time spent in service functions, which costs more than
+/// dispatching the call itself. Call counts are always kept.
+extern bool g_time_functions;
+
 
 } // namespace
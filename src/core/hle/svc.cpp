@@ -9,9 +9,11 @@
 
 #include "core/mem_map.h"
 
+#include "core/hle/kernel/event.h"
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/mutex.h"
 #include "core/hle/kernel/thread.h"
+#include "core/hle/kernel/timer.h"
 
 #include "core/hle/function_wrappers.h"
 #include "core/hle/svc.h"
@@ -33,6 +35,10 @@ enum MapMemoryPermission {
     MEMORY_PERMISSION_NORMAL    = 0x00000001,
 };
 
+const u32 MAX_WAIT_HANDLES          = 256;          ///< Most handles WaitSynchronizationN takes
+
+const Result RESULT_INVALID_POINTER = 0xD8E007F6;   ///< A buffer argument is not mapped
+
 /// Map application or GSP heap memory
 Result ControlMemory(void* _outaddr, u32 operation, u32 addr0, u32 addr1, u32 size, u32 permissions) {
     u32* outaddr = (u32*)_outaddr;
@@ -60,7 +66,7 @@ Result ControlMemory(void* _outaddr, u32 operation, u32 addr0, u32 addr1, u32 si
     if (NULL != outaddr) {
         *outaddr = virtual_address;
     }
-    Core::g_app_core->SetReg(1, virtual_address);
+    Core::GetCurrentCore()->SetReg(1, virtual_address);
 
     return 0;
 }
@@ -85,7 +91,7 @@ Result MapMemoryBlock(Handle memblock, u32 addr, u32 mypermissions, u32 otherper
 Result ConnectToPort(void* out, const char* port_name) {
     Service::Interface* service = Service::g_manager->FetchFromPortName(port_name);
     if (service) {
-        Core::g_app_core->SetReg(1, service->GetHandle());
+        Core::GetCurrentCore()->SetReg(1, service->GetHandle());
     } else {
         PanicYesNo("ConnectToPort called port_name=%s, but it is not implemented!", port_name);
     }
@@ -110,38 +116,55 @@ Result CloseHandle(Handle handle) {
 
 /// Wait for a handle to synchronize, timeout after the specified nanoseconds
 Result WaitSynchronization1(Handle handle, s64 nano_seconds) {
-    DEBUG_LOG(SVC, "(UNIMPLEMENTED) WaitSynchronization1 called handle=0x%08X, nanoseconds=%d", 
-        handle, nano_seconds);
-    Kernel::WaitCurrentThread(WAITTYPE_SYNCH); // TODO(bunnei): Is this correct?
-    return 0;
+    DEBUG_LOG(SVC, "WaitSynchronization1 called handle=0x%08X, nanoseconds=%lld", handle,
+        nano_seconds);
+    s32 index;
+    return Kernel::WaitThread_Synchronization(&handle, 1, false, nano_seconds, &index);
 }
 
 /// Wait for the given handles to synchronize, timeout after the specified nanoseconds
-Result WaitSynchronizationN(void* _out, void* _handles, u32 handle_count, u32 wait_all, s64 nano_seconds) {
-    s32* out = (s32*)_out;
-    Handle* handles = (Handle*)_handles;
+Result WaitSynchronizationN(u32 handles_address, u32 handle_count, u32 wait_all,
+    s64 nano_seconds) {
 
-    DEBUG_LOG(SVC, "(UNIMPLEMENTED) WaitSynchronizationN called handle_count=%d, wait_all=%s, nanoseconds=%d %s", 
+    DEBUG_LOG(SVC, "WaitSynchronizationN called handle_count=%d, wait_all=%s, nanoseconds=%lld",
         handle_count, (wait_all ? "true" : "false"), nano_seconds);
 
+    if (handle_count > MAX_WAIT_HANDLES) {
+        ERROR_LOG(SVC, "WaitSynchronizationN called with too many handles (%u)", handle_count);
+        return Kernel::RESULT_OUT_OF_RANGE;
+    }
+    Handle* handles = (Handle*)Memory::GetBlockPointer(handles_address,
+        handle_count * sizeof(Handle));
+    if (handles == NULL && handle_count != 0) {
+        ERROR_LOG(SVC, "WaitSynchronizationN called with invalid handles at 0x%08X",
+            handles_address);
+        return RESULT_INVALID_POINTER;
+    }
     for (u32 i = 0; i < handle_count; i++) {
         DEBUG_LOG(SVC, "\thandle[%d]=0x%08X", i, handles[i]);
     }
-    Kernel::WaitCurrentThread(WAITTYPE_SYNCH); // TODO(bunnei): Is this correct?
-    return 0;
+
+    // The index of the acquired handle is returned in r1
+    s32 index;
+    Result result = Kernel::WaitThread_Synchronization(handles, handle_count, wait_all != 0,
+        nano_seconds, &index);
+    if (index != -1) {
+        Core::GetCurrentCore()->SetReg(1, index);
+    }
+    return result;
 }
 
 /// Create an address arbiter (to allocate access to shared resources)
 Result CreateAddressArbiter(void* arbiter) {
     // ImplementMe
     DEBUG_LOG(SVC, "(UNIMPLEMENTED) CreateAddressArbiter called");
-    Core::g_app_core->SetReg(1, 0xFABBDADD);
+    Core::GetCurrentCore()->SetReg(1, 0xFABBDADD);
     return 0;
 }
 
 /// Used to output a message on a debug hardware unit - does nothing on a retail unit
 void OutputDebugString(const char* string) {
-    NOTICE_LOG(SVC, "## OSDEBUG: %08X %s", Core::g_app_core->GetPC(), string);
+    NOTICE_LOG(SVC, "## OSDEBUG: %08X %s", Core::GetCurrentCore()->GetPC(), string);
 }
 
 /// Get resource limit
@@ -150,7 +173,7 @@ Result GetResourceLimit(void* resource_limit, Handle process) {
     // 0xFFFF8001 is a handle alias for the current KProcess, and 0xFFFF8000 is a handle alias for 
     // the current KThread.
     DEBUG_LOG(SVC, "(UNIMPLEMENTED) GetResourceLimit called process=0x%08X", process);
-    Core::g_app_core->SetReg(1, 0xDEADBEEF);
+    Core::GetCurrentCore()->SetReg(1, 0xDEADBEEF);
     return 0;
 }
 
@@ -159,7 +182,7 @@ Result GetResourceLimitCurrentValues(void* _values, Handle resource_limit, void*
     //s64* values = (s64*)_values;
     DEBUG_LOG(SVC, "(UNIMPLEMENTED) GetResourceLimitCurrentValues called resource_limit=%08X, names=%s, name_count=%d",
         resource_limit, names, name_count);
-    Memory::Write32(Core::g_app_core->GetReg(0), 0); // Normmatt: Set used memory to 0 for now
+    Memory::Write32(Core::GetCurrentCore()->GetReg(0), 0); // Normmatt: Set used memory to 0 for now
     return 0;
 }
 
@@ -178,7 +201,7 @@ Result CreateThread(u32 priority, u32 entry_point, u32 arg, u32 stack_top, u32 p
     Handle thread = Kernel::CreateThread(name.c_str(), entry_point, priority, arg, processor_id,
         stack_top);
 
-    Core::g_app_core->SetReg(1, thread);
+    Core::GetCurrentCore()->SetReg(1, thread);
 
     DEBUG_LOG(SVC, "CreateThread called entrypoint=0x%08X (%s), arg=0x%08X, stacktop=0x%08X, "
         "threadpriority=0x%08X, processorid=0x%08X : created handle 0x%08X", entry_point, 
@@ -191,7 +214,7 @@ Result CreateThread(u32 priority, u32 entry_point, u32 arg, u32 stack_top, u32 p
 Result CreateMutex(void* _mutex, u32 initial_locked) {
     Handle* mutex = (Handle*)_mutex;
     *mutex = Kernel::CreateMutex((initial_locked != 0));
-    Core::g_app_core->SetReg(1, *mutex);
+    Core::GetCurrentCore()->SetReg(1, *mutex);
     DEBUG_LOG(SVC, "CreateMutex called initial_locked=%s : created handle 0x%08X", 
         initial_locked ? "true" : "false", *mutex);
     return 0;
@@ -200,8 +223,13 @@ Result CreateMutex(void* _mutex, u32 initial_locked) {
 /// Release a mutex
 Result ReleaseMutex(Handle handle) {
     DEBUG_LOG(SVC, "ReleaseMutex called handle=0x%08X", handle);
-    Kernel::ReleaseMutex(handle);
-    return 0;
+    return Kernel::ReleaseMutex(handle);
+}
+
+/// Put the current thread to sleep for the specified nanoseconds
+void SleepThread(s64 nano_seconds) {
+    DEBUG_LOG(SVC, "SleepThread called nanoseconds=%lld", nano_seconds);
+    Kernel::SleepCurrentThread(nano_seconds);
 }
 
 /// Get current thread ID
@@ -220,12 +248,53 @@ Result QueryMemory(void *_info, void *_out, u32 addr) {
 
 /// Create an event
 Result CreateEvent(void* _event, u32 reset_type) {
-    Handle* event = (Handle*)_event;
-    DEBUG_LOG(SVC, "(UNIMPLEMENTED) CreateEvent called reset_type=0x%08X", reset_type);
-    Core::g_app_core->SetReg(1, 0xBADC0DE0);
+    Handle event = Kernel::CreateEvent((ResetType)reset_type);
+    Core::GetCurrentCore()->SetReg(1, event);
+    DEBUG_LOG(SVC, "CreateEvent called reset_type=0x%08X : created handle 0x%08X", reset_type,
+        event);
+    return 0;
+}
+
+/// Signal an event
+Result SignalEvent(Handle event) {
+    DEBUG_LOG(SVC, "SignalEvent called event=0x%08X", event);
+    return Kernel::SignalEvent(event);
+}
+
+/// Clear an event
+Result ClearEvent(Handle event) {
+    DEBUG_LOG(SVC, "ClearEvent called event=0x%08X", event);
+    return Kernel::ClearEvent(event);
+}
+
+/// Create a timer
+Result CreateTimer(void* _timer, u32 reset_type) {
+    Handle timer = Kernel::CreateTimer((ResetType)reset_type);
+    Core::GetCurrentCore()->SetReg(1, timer);
+    DEBUG_LOG(SVC, "CreateTimer called reset_type=0x%08X : created handle 0x%08X", reset_type,
+        timer);
     return 0;
 }
 
+/// Start a timer, signaled after the initial nanoseconds and then every interval nanoseconds
+Result SetTimer(Handle timer, s64 initial, s64 interval) {
+    DEBUG_LOG(SVC, "SetTimer called timer=0x%08X, initial=%lld, interval=%lld", timer, initial,
+        interval);
+    return Kernel::SetTimer(timer, initial, interval);
+}
+
+/// Stop a timer
+Result CancelTimer(Handle timer) {
+    DEBUG_LOG(SVC, "CancelTimer called timer=0x%08X", timer);
+    return Kernel::CancelTimer(timer);
+}
+
+/// Clear a timer
+Result ClearTimer(Handle timer) {
+    DEBUG_LOG(SVC, "ClearTimer called timer=0x%08X", timer);
+    return Kernel::ClearTimer(timer);
+}
+
 const HLE::FunctionDef SVC_Table[] = {
     {0x00,  NULL,                                       "Unknown"},
     {0x01,  WrapI_VUUUUU<ControlMemory>,                "ControlMemory"},
@@ -237,7 +306,7 @@ const HLE::FunctionDef SVC_Table[] = {
     {0x07,  NULL,                                       "SetProcessIdealProcessor"},
     {0x08,  WrapI_UUUUU<CreateThread>,                  "CreateThread"},
     {0x09,  NULL,                                       "ExitThread"},
-    {0x0A,  NULL,                                       "SleepThread"},
+    {0x0A,  WrapV_S64<SleepThread>,                     "SleepThread"},
     {0x0B,  NULL,                                       "GetThreadPriority"},
     {0x0C,  NULL,                                       "SetThreadPriority"},
     {0x0D,  NULL,                                       "GetThreadAffinityMask"},
@@ -251,12 +320,12 @@ const HLE::FunctionDef SVC_Table[] = {
     {0x15,  NULL,                                       "CreateSemaphore"},
     {0x16,  NULL,                                       "ReleaseSemaphore"},
     {0x17,  WrapI_VU<CreateEvent>,                      "CreateEvent"},
-    {0x18,  NULL,                                       "SignalEvent"},
-    {0x19,  NULL,                                       "ClearEvent"},
-    {0x1A,  NULL,                                       "CreateTimer"},
-    {0x1B,  NULL,                                       "SetTimer"},
-    {0x1C,  NULL,                                       "CancelTimer"},
-    {0x1D,  NULL,                                       "ClearTimer"},
+    {0x18,  WrapI_U<SignalEvent>,                       "SignalEvent"},
+    {0x19,  WrapI_U<ClearEvent>,                        "ClearEvent"},
+    {0x1A,  WrapI_VU<CreateTimer>,                      "CreateTimer"},
+    {0x1B,  WrapI_US64S64<SetTimer>,                    "SetTimer"},
+    {0x1C,  WrapI_U<CancelTimer>,                       "CancelTimer"},
+    {0x1D,  WrapI_U<ClearTimer>,                        "ClearTimer"},
     {0x1E,  NULL,                                       "CreateMemoryBlock"},
     {0x1F,  WrapI_UUUU<MapMemoryBlock>,                 "MapMemoryBlock"},
     {0x20,  NULL,                                       "UnmapMemoryBlock"},
@@ -264,7 +333,7 @@ const HLE::FunctionDef SVC_Table[] = {
     {0x22,  NULL,                                       "ArbitrateAddress"},
     {0x23,  WrapI_U<CloseHandle>,                       "CloseHandle"},
     {0x24,  WrapI_US64<WaitSynchronization1>,           "WaitSynchronization1"},
-    {0x25,  WrapI_VVUUS64<WaitSynchronizationN>,        "WaitSynchronizationN"},
+    {0x25,  WrapI_UUUS64<WaitSynchronizationN>,         "WaitSynchronizationN"},
     {0x26,  NULL,                                       "SignalAndWait"},
     {0x27,  NULL,                                       "DuplicateHandle"},
     {0x28,  NULL,                                       "GetSystemTick"},
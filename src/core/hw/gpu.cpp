@@ -6,10 +6,14 @@
 #include "common/log.h"
 
 #include "core/core.h"
+#include "core/core_timing.h"
 #include "core/mem_map.h"
 #include "core/hle/kernel/thread.h"
+#include "core/hle/service/gsp.h"
 #include "core/hw/gpu.h"
 
+#include "video_core/command_processor.h"
+#include "video_core/gpu_thread.h"
 #include "video_core/video_core.h"
 
 
@@ -19,7 +23,8 @@ Registers g_regs;
 
 static const u32 kFrameTicks = 268123480 / 60;  ///< 268MHz / 60 frames per second
 
-u64 g_last_ticks = 0; ///< Last CPU ticks
+static int g_vblank_event_type = -1;    ///< CoreTiming event type of the vertical blank
+static u32 g_frame_fence = 0;           ///< GPU thread fence following the last frame presented
 
 /**
  * Sets whether the framebuffers are in the GSP heap (FCRAM) or VRAM
@@ -85,6 +90,9 @@ const u8* GetFramebufferPointer(const u32 address) {
 
 template <typename T>
 inline void Read(T &var, const u32 addr) {
+    // Registers may still be written by queued up GPU commands
+    GPUThread::Synchronize();
+
     switch (addr) {
     case Registers::FramebufferTopLeft1:
         var = g_regs.framebuffer_top_left_1;
@@ -110,6 +118,14 @@ inline void Read(T &var, const u32 addr) {
         var = g_regs.framebuffer_sub_right_1;
         break;
 
+    case Registers::FramebufferTopFormat:
+        var = g_regs.framebuffer_top_format;
+        break;
+
+    case Registers::FramebufferSubFormat:
+        var = g_regs.framebuffer_sub_format;
+        break;
+
     case Registers::CommandListSize:
         var = g_regs.command_list_size;
         break;
@@ -128,9 +144,37 @@ inline void Read(T &var, const u32 addr) {
     }
 }
 
+void ProcessCommandList(const u32 address, const u32 size) {
+    if (size == 0)
+        return;
+
+    const u32* buffer = (const u32*)Memory::GetBlockPointer(address, size);
+    if (buffer) {
+        Pica::CommandProcessor::ProcessCommandList(buffer, size / sizeof(u32));
+    } else {
+        ERROR_LOG(GPU, "command list at invalid address 0x%08X, size 0x%08X", address, size);
+    }
+}
+
+/**
+ * Executes a command list started by a register write, on the GPU thread
+ * @param params Address and size in bytes of the command list
+ */
+static void ProcessCommandListCommand(const u32* params) {
+    ProcessCommandList(params[0], params[1]);
+}
+
 template <typename T>
 inline void Write(u32 addr, const T data) {
     switch (static_cast<Registers::Id>(addr)) {
+    case Registers::FramebufferTopFormat:
+        g_regs.framebuffer_top_format = data;
+        break;
+
+    case Registers::FramebufferSubFormat:
+        g_regs.framebuffer_sub_format = data;
+        break;
+
     case Registers::CommandListSize:
         g_regs.command_list_size = data;
         break;
@@ -143,9 +187,10 @@ inline void Write(u32 addr, const T data) {
         g_regs.command_processing_enabled = data;
         if (g_regs.command_processing_enabled & 1)
         {
-            // u32* buffer = (u32*)Memory::GetPointer(g_regs.command_list_address << 3);
-            ERROR_LOG(GPU, "Beginning %x bytes of commands from address %x", g_regs.command_list_size, g_regs.command_list_address << 3);
-            // TODO: Process command list!
+            // Address and size are both given in units of 8 bytes. The PICA state belongs to the
+            // GPU thread, so the list is executed there.
+            const u32 params[] = { g_regs.command_list_address << 3, g_regs.command_list_size << 3 };
+            GPUThread::PushCommand(ProcessCommandListCommand, params, 2);
         }
         break;
 
@@ -167,22 +212,40 @@ template void Write<u32>(u32 addr, const u32 data);
 template void Write<u16>(u32 addr, const u16 data);
 template void Write<u8>(u32 addr, const u8 data);
 
-/// Update hardware
-void Update() {
-    u64 current_ticks = Core::g_app_core->GetTicks();
+/// Presents the current frame, on the GPU thread
+static void SwapBuffersCommand(const u32* params) {
+    VideoCore::g_renderer->SwapBuffers();
+}
 
-    // Fake a vertical blank
-    if ((current_ticks - g_last_ticks) >= kFrameTicks) {
-        g_last_ticks = current_ticks;
-        VideoCore::g_renderer->SwapBuffers();
-        Kernel::WaitCurrentThread(WAITTYPE_VBLANK);
-    }
+/**
+ * Fakes a vertical blank, scheduled once per frame
+ * @param userdata Unused
+ * @param cycles_late Number of cycles the event was handled late by
+ */
+static void VBlankCallback(u64 userdata, int cycles_late) {
+    // Let the CPU run at most one frame ahead of the GPU thread
+    GPUThread::WaitForFence(g_frame_fence);
+    GPUThread::PushCommand(SwapBuffersCommand);
+    g_frame_fence = GPUThread::InsertFence();
+
+    // Wake up the threads waiting for the VBlank, directly or through the GSP interrupt event
+    Kernel::ResumeThreadsWaitingFor(WAITTYPE_VBLANK);
+    GSP_GPU::SignalInterrupt(GSP_GPU::InterruptId::PDC0);
+    GSP_GPU::SignalInterrupt(GSP_GPU::InterruptId::PDC1);
+
+    CoreTiming::ScheduleEvent(kFrameTicks - cycles_late, g_vblank_event_type);
 }
 
 /// Initialize hardware
 void Init() {
-    g_last_ticks = Core::g_app_core->GetTicks();
     SetFramebufferLocation(FRAMEBUFFER_LOCATION_FCRAM);
+    g_regs.framebuffer_top_format = FRAMEBUFFER_FORMAT_RGB8;
+    g_regs.framebuffer_sub_format = FRAMEBUFFER_FORMAT_RGB8;
+    g_frame_fence = 0;
+
+    g_vblank_event_type = CoreTiming::RegisterEvent("GPU::VBlank", VBlankCallback);
+    CoreTiming::ScheduleEvent(kFrameTicks, g_vblank_event_type);
+
     NOTICE_LOG(GPU, "initialized OK");
 }
 
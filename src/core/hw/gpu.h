@@ -12,10 +12,12 @@ struct Registers {
     enum Id : u32 {
         FramebufferTopLeft1     = 0x1EF00468,   // Main LCD, first framebuffer for 3D left
         FramebufferTopLeft2     = 0x1EF0046C,   // Main LCD, second framebuffer for 3D left
+        FramebufferTopFormat    = 0x1EF00470,   // Main LCD, framebuffer pixel format
         FramebufferTopRight1    = 0x1EF00494,   // Main LCD, first framebuffer for 3D right
         FramebufferTopRight2    = 0x1EF00498,   // Main LCD, second framebuffer for 3D right
         FramebufferSubLeft1     = 0x1EF00568,   // Sub LCD, first framebuffer
         FramebufferSubLeft2     = 0x1EF0056C,   // Sub LCD, second framebuffer
+        FramebufferSubFormat    = 0x1EF00570,   // Sub LCD, framebuffer pixel format
         FramebufferSubRight1    = 0x1EF00594,   // Sub LCD, unused first framebuffer
         FramebufferSubRight2    = 0x1EF00598,   // Sub LCD, unused second framebuffer
 
@@ -32,6 +34,8 @@ struct Registers {
     u32 framebuffer_sub_left_2;
     u32 framebuffer_sub_right_1;
     u32 framebuffer_sub_right_2;
+    u32 framebuffer_top_format;
+    u32 framebuffer_sub_format;
 
     u32 command_list_size;
     u32 command_list_address;
@@ -67,6 +71,24 @@ enum {
     PADDR_VRAM_SUB_FRAME2       = 0x18249CF0,
 };
 
+/// Pixel format of the LCD framebuffers, in the low bits of the framebuffer format registers
+enum FramebufferFormat {
+    FRAMEBUFFER_FORMAT_RGBA8    = 0,
+    FRAMEBUFFER_FORMAT_RGB8     = 1,    ///< Stored as B, G, R bytes
+    FRAMEBUFFER_FORMAT_RGB565   = 2,
+    FRAMEBUFFER_FORMAT_RGB5A1   = 3,
+    FRAMEBUFFER_FORMAT_RGBA4    = 4,
+};
+
+/**
+ * Gets the pixel format of a framebuffer from its format register
+ * @param format_register Value of the framebuffer format register
+ * @return Pixel format of the framebuffer
+ */
+static inline FramebufferFormat GetFramebufferFormat(const u32 format_register) {
+    return static_cast<FramebufferFormat>(format_register & 7);
+}
+
 /// Framebuffer location
 enum FramebufferLocation {
     FRAMEBUFFER_LOCATION_UNKNOWN,   ///< Framebuffer location is unknown
@@ -92,15 +114,19 @@ const u8* GetFramebufferPointer(const u32 address);
  */
 const FramebufferLocation GetFramebufferLocation();
 
+/**
+ * Executes a PICA command list. Must be called on the GPU thread, which owns the PICA state.
+ * @param address Virtual address of the command list
+ * @param size Size of the command list in bytes
+ */
+void ProcessCommandList(const u32 address, const u32 size);
+
 template <typename T>
 inline void Read(T &var, const u32 addr);
 
 template <typename T>
 inline void Write(u32 addr, const T data);
 
-/// Update hardware
-void Update();
-
 /// Initialize hardware
 void Init();
 
@@ -87,7 +87,6 @@ template void Write<u8>(u32 addr, const u8 data);
 
 /// Update hardware
 void Update() {
-    GPU::Update();
     NDMA::Update();
 }
 
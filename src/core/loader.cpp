@@ -10,6 +10,7 @@
 #include "core/core.h"
 #include "core/file_sys/directory_file_system.h"
 #include "core/elf/elf_reader.h"
+#include "core/hle/function_replacement.h"
 #include "core/hle/kernel/kernel.h"
 #include "core/mem_map.h"
 
@@ -56,6 +57,14 @@ bool Load_ELF(std::string &filename) {
         elf_reader = new ElfReader(buffer);
         elf_reader->LoadInto(0x00100000);
 
+        const SectionID text_section = elf_reader->GetSectionByName(".text");
+        if (text_section != -1) {
+            FunctionReplacement::Apply(elf_reader->GetSectionAddr(text_section),
+                elf_reader->GetSectionSize(text_section));
+        } else {
+            FunctionReplacement::Apply(0, 0);
+        }
+
         Kernel::LoadExec(elf_reader->GetEntryPoint());
 
         delete[] buffer;
@@ -101,7 +110,8 @@ bool Load_DAT(std::string &filename) {
         {
             *d++ = (*s++);
         }
-        
+
+        FunctionReplacement::Apply(entry_point, srcSize);
         Kernel::LoadExec(entry_point);
 
 
@@ -143,7 +153,8 @@ bool Load_BIN(std::string &filename) {
         {
             *d++ = (*s++);
         }
-        
+
+        FunctionReplacement::Apply(entry_point, srcSize);
         Kernel::LoadExec(entry_point);
 
         delete[] buffer;
@@ -4,6 +4,7 @@
 
 #include "common/common.h"
 #include "common/mem_arena.h"
+#include "common/memory_util.h"
 
 #include "core/mem_map.h"
 #include "core/core.h"
@@ -62,6 +63,34 @@ static MemoryView g_views[] = {
 
 static const int kNumMemViews = sizeof(g_views) / sizeof(MemoryView);    ///< Number of mem views
 
+bool IsFastmemEnabled() {
+#if defined(_M_X64) && !defined(_WIN32)
+    return g_base != NULL;
+#else
+    // Elsewhere, the space between the views is not reserved
+    return false;
+#endif
+}
+
+void ProtectFastmemPage(u32 addr, bool readable, bool writable) {
+    if (!IsFastmemEnabled())
+        return;
+
+    // Only pages of the views are mapped, anything else always faults
+    addr &= ~PAGE_MASK;
+    for (int i = 0; i < kNumMemViews; i++) {
+        if (addr - g_views[i].virtual_address < g_views[i].size) {
+            if (!readable)
+                ReadWriteProtectMemory(g_base + addr, PAGE_SIZE);
+            else if (writable)
+                UnWriteProtectMemory(g_base + addr, PAGE_SIZE);
+            else
+                WriteProtectMemory(g_base + addr, PAGE_SIZE);
+            return;
+        }
+    }
+}
+
 void Init() {
     int flags = 0;
 
@@ -72,15 +101,19 @@ void Init() {
 
     g_base = MemoryMap_Setup(g_views, kNumMemViews, flags, &g_arena);
 
+    InitPageTable();
+
     NOTICE_LOG(MEMMAP, "initialized OK, RAM at %p (mirror at 0 @ %p)", g_heap, 
         g_physical_fcram);
 }
 
 void Shutdown() {
     u32 flags = 0;
+    ShutdownPageTable();
     MemoryMap_Shutdown(g_views, kNumMemViews, flags, &g_arena);
     
     g_arena.ReleaseSpace();
+    MemArena::Release4GBBase(g_base);
     g_base = NULL;
 
     NOTICE_LOG(MEMMAP, "shutdown OK");
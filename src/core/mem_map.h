@@ -4,8 +4,11 @@
 
 #pragma once
 
+#include <set>
+
 #include "common/common.h"
 #include "common/common_types.h"
+#include "common/std_mutex.h"
 
 namespace Memory {
 
@@ -87,6 +90,23 @@ enum {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+enum {
+    PAGE_BITS               = 12,
+    PAGE_SIZE               = (1 << PAGE_BITS),                 ///< Page table granularity (4KB)
+    PAGE_MASK               = (PAGE_SIZE - 1),
+    NUM_PAGE_TABLE_ENTRIES  = (1 << (32 - PAGE_BITS)),          ///< Pages in 32-bit address space
+};
+
+/// Describes how accesses to a page in the page table are handled
+enum PageType {
+    PAGE_UNMAPPED = 0,      ///< Page is not mapped, accesses are logged and ignored
+    PAGE_MEMORY,            ///< Page is backed by host memory, accessed through g_page_pointers
+    PAGE_HW_IO,             ///< Page is handled by HW::Read/HW::Write
+    PAGE_CONFIG_MEM,        ///< Page is handled by ConfigMem::Read (read-only)
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 /// Represents a block of memory mapped by ControlMemory/MapMemoryBlock
 struct MemoryBlock {
     MemoryBlock() : handle(0), base_address(0), address(0), size(0), operation(0), permissions(0) {
@@ -114,6 +134,23 @@ struct MemoryBlock {
 // so be sure to load it into a 64-bit register.
 extern u8 *g_base; 
 
+/**
+ * Checks whether guest memory can be accessed directly at g_base + address ("fastmem"). This is
+ * the case on 64-bit hosts where the whole 32-bit guest address space is reserved at g_base: RAM
+ * views are mapped into it, and accesses to I/O or unmapped pages fault instead.
+ * @return True if fastmem accesses can be used
+ */
+bool IsFastmemEnabled();
+
+/**
+ * Sets which accesses to a page of the fastmem mirror are allowed, so that accesses to watched
+ * pages fault
+ * @param addr Address within the page
+ * @param readable True to allow reads, false to make the page inaccessible
+ * @param writable True to allow writes to a readable page, false to make it read-only
+ */
+void ProtectFastmemPage(u32 addr, bool readable, bool writable);
+
 // These are guaranteed to point to "low memory" addresses (sub-32-bit).
 // 64-bit: Pointers to low-mem (sub-0x10000000) mirror
 // 32-bit: Same as the corresponding physical/virtual pointers.
@@ -125,9 +162,149 @@ extern u8* g_kernel_mem;    ///< Kernel memory
 extern u8* g_system_mem;    ///< System memory
 extern u8* g_exefs_code;    ///< ExeFS:/.code is loaded here
 
+/// Host pointer for each guest page, or NULL if the page is not backed by host memory
+extern u8* g_page_pointers[NUM_PAGE_TABLE_ENTRIES];
+
+/// Host pointer used for reads from each guest page, NULL for pages whose reads are watched
+extern u8* g_page_read_pointers[NUM_PAGE_TABLE_ENTRIES];
+
+/// Host pointer used for writes to each guest page, NULL for pages whose writes are watched
+extern u8* g_page_write_pointers[NUM_PAGE_TABLE_ENTRIES];
+
+/// Access type for each guest page, used for the accesses that miss g_page_pointers
+extern u8 g_page_types[NUM_PAGE_TABLE_ENTRIES];
+
 void Init();
 void Shutdown();
 
+/// Builds the page table from the memory views set up by Init
+void InitPageTable();
+
+/// Clears the page table, so that all pages are unmapped
+void ShutdownPageTable();
+
+/**
+ * Callback invoked after the guest writes to a watched page
+ * @param addr Address that was written to
+ * @param size Size of the write in bytes
+ */
+typedef void (*WriteWatchCallback)(u32 addr, u32 size);
+
+/**
+ * Registers a callback to be notified of guest writes to watched pages
+ * @param callback Function to call on each write to a watched page
+ */
+void RegisterWriteWatchCallback(WriteWatchCallback callback);
+
+/**
+ * Unregisters a callback previously registered with RegisterWriteWatchCallback
+ * @param callback Function to stop calling on writes to watched pages
+ */
+void UnregisterWriteWatchCallback(WriteWatchCallback callback);
+
+/**
+ * Starts watching guest writes to the page containing an address. Pages are reference counted,
+ * so every call must be paired with a call to UnwatchPageWrites. Writes through the mirrors of
+ * the application heap (FCRAM_PADDR, FCRAM_VADDR_FW0B) are seen at every address of the page.
+ * @param addr Address within the page to watch
+ */
+void WatchPageWrites(const u32 addr);
+
+/**
+ * Stops watching guest writes to the page containing an address
+ * @param addr Address within the page to stop watching
+ */
+void UnwatchPageWrites(const u32 addr);
+
+/**
+ * Notifies the write watch callbacks of a write to a watched page. Only needed by code that
+ * writes to watched pages directly through g_page_pointers rather than with Write8-Write32.
+ * @param addr Address that was written to
+ * @param size Size of the write in bytes
+ */
+void NotifyWriteWatch(const u32 addr, const u32 size);
+
+/**
+ * Notifies the write watch callbacks of the writes to watched pages that the system core made
+ * since the last call. Must be called on the application core's thread.
+ */
+void DeliverDeferredWriteWatches();
+
+/**
+ * Callback invoked before the guest reads from a watched page, which may update its memory
+ * @param addr Address that is read from
+ * @param size Size of the read in bytes
+ */
+typedef void (*ReadWatchCallback)(u32 addr, u32 size);
+
+/**
+ * Registers a callback to be notified of guest reads from watched pages
+ * @param callback Function to call on each read from a watched page
+ */
+void RegisterReadWatchCallback(ReadWatchCallback callback);
+
+/**
+ * Unregisters a callback previously registered with RegisterReadWatchCallback
+ * @param callback Function to stop calling on reads from watched pages
+ */
+void UnregisterReadWatchCallback(ReadWatchCallback callback);
+
+/**
+ * Starts watching guest reads from the page containing an address. Pages are reference counted
+ * like write watches, and reads through the mirrors of the application heap are seen at every
+ * address of the page as well. Only reads made with Read8-Read32 and by the CPU cores are seen,
+ * not those through GetPointer.
+ * @param addr Address within the page to watch
+ */
+void WatchPageReads(const u32 addr);
+
+/**
+ * Stops watching guest reads from the page containing an address
+ * @param addr Address within the page to stop watching
+ */
+void UnwatchPageReads(const u32 addr);
+
+/**
+ * Notifies the read watch callbacks of a read from a watched page, before it is made. Only
+ * needed by code that reads from watched pages directly through g_page_pointers rather than
+ * with Read8-Read32.
+ * @param addr Address that is read from
+ * @param size Size of the read in bytes
+ */
+void NotifyReadWatch(const u32 addr, const u32 size);
+
+/**
+ * Guest pages written to since they were last taken. Filled by a write watch callback on the
+ * thread that wrote, and emptied by the watcher on its own thread.
+ */
+class WrittenPageQueue {
+public:
+    WrittenPageQueue() : have_pages(false) {
+    }
+
+    /**
+     * Queues up the pages of a write
+     * @param addr Address that was written to
+     * @param size Size of the write in bytes
+     */
+    void Push(u32 addr, u32 size);
+
+    /**
+     * Takes the queued up pages, leaving the queue empty
+     * @param pages Set to the addresses of the queued up pages
+     * @return True if any pages were queued up
+     */
+    bool Take(std::set<u32>& pages);
+
+    /// Drops the queued up pages
+    void Clear();
+
+private:
+    std::set<u32> pages;
+    std::mutex mutex;
+    volatile bool have_pages;           ///< Whether pages is not empty, checked without locking
+};
+
 u8 Read8(const u32 addr);
 u16 Read16(const u32 addr);
 u32 Read32(const u32 addr);
@@ -141,6 +318,29 @@ void Write32(const u32 addr, const u32 data);
 
 u8* GetPointer(const u32 Address);
 
+/**
+ * Gets a pointer to a block of guest memory, which must be backed by contiguous host memory
+ * @param address Virtual address of the block
+ * @param size Size of the block in bytes
+ * @return Host pointer to the block, or NULL if any part of it is not mapped
+ */
+u8* GetBlockPointer(const u32 address, const u32 size);
+
+/**
+ * Gets a pointer to the host memory backing a physical address, as used by the GPU
+ * @param address Physical address in VRAM or FCRAM
+ * @return Host pointer, or NULL if the address is not backed by memory
+ */
+u8* GetPhysicalPointer(const u32 address);
+
+/**
+ * Gets a pointer to the host memory backing a block of physical memory, as used by the GPU
+ * @param address Physical address of the block in VRAM or FCRAM
+ * @param size Size of the block in bytes
+ * @return Host pointer to the block, or NULL if any part of it is not backed by memory
+ */
+u8* GetPhysicalBlockPointer(const u32 address, const u32 size);
+
 /**
  * Maps a block of memory in shared memory
  * @param handle Handle to map memory block for
@@ -181,4 +381,18 @@ inline const u32 VirtualAddressFromPhysical_VRAM(const u32 address) {
     return (address + 0x07000000);
 }
 
+/**
+ * Gets the physical address the GPU sees a virtual address in VRAM or FCRAM at
+ * @param address Virtual address
+ * @return Physical address, or 0 if the address is neither in VRAM nor in FCRAM
+ */
+inline const u32 PhysicalAddressFromVirtual(const u32 address) {
+    if (address >= VRAM_VADDR && address < VRAM_VADDR_END) {
+        return (address - 0x07000000);
+    } else if (address >= FCRAM_VADDR && address < FCRAM_VADDR_END) {
+        return ((address & FCRAM_MASK) | FCRAM_PADDR);
+    }
+    return 0;
+}
+
 } // namespace
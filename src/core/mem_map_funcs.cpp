@@ -2,10 +2,15 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <map>
+#include <set>
+#include <vector>
 
 #include "common/common.h"
+#include "common/std_mutex.h"
 
+#include "core/core.h"
 #include "core/mem_map.h"
 #include "core/hw/hw.h"
 #include "hle/hle.h"
@@ -17,165 +22,441 @@ std::map<u32, MemoryBlock> g_heap_map;
 std::map<u32, MemoryBlock> g_heap_gsp_map;
 std::map<u32, MemoryBlock> g_shared_map;
 
-/// Convert a physical address (or firmware-specific virtual address) to primary virtual address
-u32 _VirtualAddress(const u32 addr) {
-    // Our memory interface read/write functions assume virtual addresses. Put any physical address 
-    // to virtual address translations here. This is obviously quite hacky... But we're not doing 
-    // any MMU emulation yet or anything
-    if ((addr >= FCRAM_PADDR) && (addr < FCRAM_PADDR_END)) {
-        return VirtualAddressFromPhysical_FCRAM(addr);
-
-    // Virtual address mapping FW0B
-    } else if ((addr >= FCRAM_VADDR_FW0B) && (addr < FCRAM_VADDR_FW0B_END)) {
-        return VirtualAddressFromPhysical_FCRAM(addr);
-
-    // Hardware IO
-    // TODO(bunnei): FixMe
-    // This isn't going to work... The physical address of HARDWARE_IO conflicts with the virtual 
-    // address of shared memory.
-    //} else if ((addr >= HARDWARE_IO_PADDR) && (addr < HARDWARE_IO_PADDR_END)) {
-    //    return (addr + 0x0EB00000);
+u8* g_page_pointers[NUM_PAGE_TABLE_ENTRIES];         ///< Host pointer for each guest page
+u8* g_page_read_pointers[NUM_PAGE_TABLE_ENTRIES];    ///< Host pointer for reads from each page
+u8* g_page_write_pointers[NUM_PAGE_TABLE_ENTRIES];   ///< Host pointer for writes to each page
+u8  g_page_types[NUM_PAGE_TABLE_ENTRIES];            ///< PageType of each guest page
 
+static u16 g_page_watch_counts[NUM_PAGE_TABLE_ENTRIES];     ///< Write watch references per page
+static u16 g_page_read_watch_counts[NUM_PAGE_TABLE_ENTRIES];///< Read watch references per page
+static std::mutex g_page_watch_mutex;                       ///< Guards the watch counts
+static std::vector<WriteWatchCallback> g_write_watch_callbacks;
+static std::vector<ReadWatchCallback> g_read_watch_callbacks;
+
+/// Writes to watched pages made off the application core's thread, as (address, size) pairs
+static std::vector<std::pair<u32, u32> > g_deferred_write_watches;
+static std::mutex g_deferred_write_watches_mutex;
+static volatile bool g_have_deferred_write_watches = false;
+
+/// Addresses InitPageTable maps the application heap at, all of which alias the same memory
+static const u32 g_heap_mirrors[] = { HEAP_VADDR, FCRAM_PADDR, FCRAM_VADDR_FW0B };
+
+/// Maximum number of addresses that alias the same memory
+static const int MAX_ALIASES = ARRAY_SIZE(g_heap_mirrors);
+
+/**
+ * Gets all the addresses that map the same memory as an address, so that a write watch sees
+ * writes through any of them
+ * @param addr Address to get the aliases of
+ * @param aliases Set to the aliases, the address itself included
+ * @return Number of aliases
+ */
+static int GetAliases(const u32 addr, u32 aliases[MAX_ALIASES]) {
+    for (int i = 0; i < MAX_ALIASES; i++) {
+        const u32 offset = addr - g_heap_mirrors[i];
+        if (offset < FCRAM_SIZE) {
+            for (int j = 0; j < MAX_ALIASES; j++) {
+                aliases[j] = g_heap_mirrors[j] + offset;
+            }
+            return MAX_ALIASES;
+        }
     }
-    return addr;
+    aliases[0] = addr;
+    return 1;
 }
 
-template <typename T>
-inline void _Read(T &var, const u32 addr) {
-    // TODO: Figure out the fastest order of tests for both read and write (they are probably different).
-    // TODO: Make sure this represents the mirrors in a correct way.
-    // Could just do a base-relative read, too.... TODO
+/**
+ * Maps a range of guest pages in the page table
+ * @param vaddr Guest virtual address of the start of the range
+ * @param size Size of the range in bytes
+ * @param type PageType of the range
+ * @param memory Host memory backing the range (only used for PAGE_MEMORY), or NULL
+ * @param mask Mask applied to the offset into the range to get the offset into memory, which
+ *             mirrors memory if the range is larger
+ * @param memory_size Size of the host memory block, pages beyond it are left unmapped
+ */
+static void MapPages(u32 vaddr, u32 size, PageType type, u8* memory = NULL, u32 mask = 0,
+    u32 memory_size = 0) {
+
+    for (u64 addr = vaddr; addr < (u64)vaddr + size; addr += PAGE_SIZE) {
+        const u32 page = (u32)(addr >> PAGE_BITS);
+        const u32 offset = (u32)(addr - vaddr) & mask;
+
+        if (type == PAGE_MEMORY && (memory == NULL || offset + PAGE_SIZE > memory_size)) {
+            g_page_pointers[page] = NULL;
+            g_page_read_pointers[page] = NULL;
+            g_page_write_pointers[page] = NULL;
+            g_page_types[page] = PAGE_UNMAPPED;
+            continue;
+        }
+        g_page_pointers[page] = (type == PAGE_MEMORY) ? memory + offset : NULL;
+        g_page_read_pointers[page] = g_page_read_watch_counts[page] ? NULL : g_page_pointers[page];
+        g_page_write_pointers[page] = g_page_watch_counts[page] ? NULL : g_page_pointers[page];
+        g_page_types[page] = type;
+    }
+}
 
-    const u32 vaddr = _VirtualAddress(addr);
+/// Builds the page table from the memory views set up by Init
+void InitPageTable() {
+    ShutdownPageTable();
+
+    // Hardware I/O (0x10XXXXXX is physical address space, 0x1EXXXXXX is virtual address space).
+    // This is mapped first so that VRAM, which lies inside this range, is mapped over it.
+    MapPages(HARDWARE_IO_VADDR, HARDWARE_IO_SIZE, PAGE_HW_IO);
+
+    MapPages(KERNEL_MEMORY_VADDR, KERNEL_MEMORY_SIZE, PAGE_MEMORY, g_kernel_mem,
+        KERNEL_MEMORY_MASK, KERNEL_MEMORY_SIZE);
+    MapPages(EXEFS_CODE_VADDR, EXEFS_CODE_SIZE, PAGE_MEMORY, g_exefs_code, EXEFS_CODE_MASK,
+        EXEFS_CODE_SIZE);
+    MapPages(HEAP_GSP_VADDR, HEAP_GSP_SIZE, PAGE_MEMORY, g_heap_gsp, HEAP_GSP_MASK,
+        HEAP_GSP_SIZE);
+    MapPages(HEAP_VADDR, HEAP_SIZE, PAGE_MEMORY, g_heap, HEAP_MASK, HEAP_SIZE);
+    MapPages(SHARED_MEMORY_VADDR, SHARED_MEMORY_SIZE, PAGE_MEMORY, g_shared_mem,
+        SHARED_MEMORY_MASK, SHARED_MEMORY_SIZE);
+    MapPages(SYSTEM_MEMORY_VADDR, SYSTEM_MEMORY_SIZE, PAGE_MEMORY, g_system_mem,
+        SYSTEM_MEMORY_MASK, SYSTEM_MEMORY_SIZE);
+    MapPages(CONFIG_MEMORY_VADDR, CONFIG_MEMORY_SIZE, PAGE_CONFIG_MEM);
+    MapPages(VRAM_VADDR, VRAM_SIZE, PAGE_MEMORY, g_vram, VRAM_MASK, VRAM_SIZE);
+
+    // Physical FCRAM and the FW0B virtual mapping are mirrors of the application heap. Our memory
+    // interface otherwise assumes virtual addresses, since we're not doing any MMU emulation yet.
+    MapPages(FCRAM_PADDR, FCRAM_SIZE, PAGE_MEMORY, g_heap, FCRAM_MASK, HEAP_SIZE);
+    MapPages(FCRAM_VADDR_FW0B, FCRAM_SIZE, PAGE_MEMORY, g_heap, FCRAM_MASK, HEAP_SIZE);
+
+    // TODO: The physical address of HARDWARE_IO conflicts with the virtual address of shared memory, so
+    // it is not mapped here.
+}
 
-    // Kernel memory command buffer
-    if (vaddr >= KERNEL_MEMORY_VADDR && vaddr < KERNEL_MEMORY_VADDR_END) {
-        var = *((const T*)&g_kernel_mem[vaddr & KERNEL_MEMORY_MASK]);
+/// Clears the page table, so that all pages are unmapped
+void ShutdownPageTable() {
+    for (u32 page = 0; page < NUM_PAGE_TABLE_ENTRIES; page++) {
+        if (g_page_watch_counts[page] || g_page_read_watch_counts[page])
+            ProtectFastmemPage(page << PAGE_BITS, true, true);
+    }
 
-    // Hardware I/O register reads
-    // 0x10XXXXXX- is physical address space, 0x1EXXXXXX is virtual address space
-    } else if ((vaddr >= HARDWARE_IO_VADDR) && (vaddr < HARDWARE_IO_VADDR_END)) {
-        HW::Read<T>(var, vaddr);
+    memset(g_page_pointers, 0, sizeof(g_page_pointers));
+    memset(g_page_read_pointers, 0, sizeof(g_page_read_pointers));
+    memset(g_page_write_pointers, 0, sizeof(g_page_write_pointers));
+    memset(g_page_types, PAGE_UNMAPPED, sizeof(g_page_types));
+    memset(g_page_watch_counts, 0, sizeof(g_page_watch_counts));
+    memset(g_page_read_watch_counts, 0, sizeof(g_page_read_watch_counts));
+}
 
-    // ExeFS:/.code is loaded here
-    } else if ((vaddr >= EXEFS_CODE_VADDR)  && (vaddr < EXEFS_CODE_VADDR_END)) {
-        var = *((const T*)&g_exefs_code[vaddr & EXEFS_CODE_MASK]);
+/**
+ * Registers a callback to be notified of guest writes to watched pages
+ * @param callback Function to call on each write to a watched page
+ */
+void RegisterWriteWatchCallback(WriteWatchCallback callback) {
+    g_write_watch_callbacks.push_back(callback);
+}
 
-    // FCRAM - GSP heap
-    } else if ((vaddr >= HEAP_GSP_VADDR) && (vaddr < HEAP_GSP_VADDR_END)) {
-        var = *((const T*)&g_heap_gsp[vaddr & HEAP_GSP_MASK]);
+/**
+ * Unregisters a callback previously registered with RegisterWriteWatchCallback
+ * @param callback Function to stop calling on writes to watched pages
+ */
+void UnregisterWriteWatchCallback(WriteWatchCallback callback) {
+    g_write_watch_callbacks.erase(std::remove(g_write_watch_callbacks.begin(),
+        g_write_watch_callbacks.end(), callback), g_write_watch_callbacks.end());
+}
 
-    // FCRAM - application heap
-    } else if ((vaddr >= HEAP_VADDR)  && (vaddr < HEAP_VADDR_END)) {
-        var = *((const T*)&g_heap[vaddr & HEAP_MASK]);
+/**
+ * Starts watching guest writes to the page containing an address, and to the pages that alias it
+ * @param addr Address within the page to watch
+ */
+void WatchPageWrites(const u32 addr) {
+    // The GPU emulation watches pages too, possibly from the video thread
+    std::lock_guard<std::mutex> lock(g_page_watch_mutex);
+    u32 aliases[MAX_ALIASES];
+    const int num_aliases = GetAliases(addr, aliases);
+    for (int i = 0; i < num_aliases; i++) {
+        const u32 page = aliases[i] >> PAGE_BITS;
+        if (g_page_watch_counts[page]++ == 0) {
+            ProtectFastmemPage(aliases[i], g_page_read_watch_counts[page] == 0, false);
+        }
+        g_page_write_pointers[page] = NULL;
+    }
+}
 
-    // Shared memory
-    } else if ((vaddr >= SHARED_MEMORY_VADDR)  && (vaddr < SHARED_MEMORY_VADDR_END)) {
-        var = *((const T*)&g_shared_mem[vaddr & SHARED_MEMORY_MASK]);
+/**
+ * Stops watching guest writes to the page containing an address, and to the pages that alias it
+ * @param addr Address within the page to stop watching
+ */
+void UnwatchPageWrites(const u32 addr) {
+    std::lock_guard<std::mutex> lock(g_page_watch_mutex);
+    u32 aliases[MAX_ALIASES];
+    const int num_aliases = GetAliases(addr, aliases);
+    for (int i = 0; i < num_aliases; i++) {
+        const u32 page = aliases[i] >> PAGE_BITS;
+        _dbg_assert_msg_(MEMMAP, g_page_watch_counts[page] > 0, "page 0x%08X is not watched",
+            aliases[i]);
+        if (g_page_watch_counts[page] && --g_page_watch_counts[page] == 0) {
+            g_page_write_pointers[page] = g_page_pointers[page];
+            ProtectFastmemPage(aliases[i], g_page_read_watch_counts[page] == 0, true);
+        }
+    }
+}
 
-    // System memory
-    } else if ((vaddr >= SYSTEM_MEMORY_VADDR)  && (vaddr < SYSTEM_MEMORY_VADDR_END)) {
-        var = *((const T*)&g_system_mem[vaddr & SYSTEM_MEMORY_MASK]);
+/**
+ * Notifies the write watch callbacks of a write to a watched page, once for each address that
+ * aliases it, since the watchers only know the address they watched the page at
+ * @param addr Address that was written to
+ * @param size Size of the write in bytes
+ */
+void NotifyWriteWatch(const u32 addr, const u32 size) {
+    // The watchers (the code caches) belong to the application core, so writes made by the system
+    // core are queued up and handed to them in between its time slices
+    if (Core::GetCurrentCoreId() != Core::CORE_APP) {
+        std::lock_guard<std::mutex> lock(g_deferred_write_watches_mutex);
+        g_deferred_write_watches.push_back(std::make_pair(addr, size));
+        g_have_deferred_write_watches = true;
+        return;
+    }
 
-    // Config memory
-    } else if ((vaddr >= CONFIG_MEMORY_VADDR)  && (vaddr < CONFIG_MEMORY_VADDR_END)) {
-        ConfigMem::Read<T>(var, vaddr);
+    u32 aliases[MAX_ALIASES];
+    const int num_aliases = GetAliases(addr, aliases);
+    for (int i = 0; i < num_aliases; i++) {
+        for (size_t j = 0; j < g_write_watch_callbacks.size(); j++) {
+            g_write_watch_callbacks[j](aliases[i], size);
+        }
+    }
+}
+
+/// Notifies the write watch callbacks of the writes queued up by other cores, on the app core
+void DeliverDeferredWriteWatches() {
+    if (!g_have_deferred_write_watches)
+        return;
+
+    std::vector<std::pair<u32, u32> > writes;
+    {
+        std::lock_guard<std::mutex> lock(g_deferred_write_watches_mutex);
+        writes.swap(g_deferred_write_watches);
+        g_have_deferred_write_watches = false;
+    }
+    for (size_t i = 0; i < writes.size(); i++) {
+        NotifyWriteWatch(writes[i].first, writes[i].second);
+    }
+}
 
-    // VRAM
-    } else if ((vaddr >= VRAM_VADDR)  && (vaddr < VRAM_VADDR_END)) {
-        var = *((const T*)&g_vram[vaddr & VRAM_MASK]);
+/**
+ * Registers a callback to be notified of guest reads from watched pages
+ * @param callback Function to call on each read from a watched page
+ */
+void RegisterReadWatchCallback(ReadWatchCallback callback) {
+    g_read_watch_callbacks.push_back(callback);
+}
 
-    } else {
-        //_assert_msg_(MEMMAP, false, "unknown Read%d @ 0x%08X", sizeof(var) * 8, vaddr);
+/**
+ * Unregisters a callback previously registered with RegisterReadWatchCallback
+ * @param callback Function to stop calling on reads from watched pages
+ */
+void UnregisterReadWatchCallback(ReadWatchCallback callback) {
+    g_read_watch_callbacks.erase(std::remove(g_read_watch_callbacks.begin(),
+        g_read_watch_callbacks.end(), callback), g_read_watch_callbacks.end());
+}
+
+/**
+ * Starts watching guest reads from the page containing an address, and from the pages that alias
+ * it. Fastmem accesses to the pages fault, writes included.
+ * @param addr Address within the page to watch
+ */
+void WatchPageReads(const u32 addr) {
+    std::lock_guard<std::mutex> lock(g_page_watch_mutex);
+    u32 aliases[MAX_ALIASES];
+    const int num_aliases = GetAliases(addr, aliases);
+    for (int i = 0; i < num_aliases; i++) {
+        const u32 page = aliases[i] >> PAGE_BITS;
+        if (g_page_read_watch_counts[page]++ == 0) {
+            ProtectFastmemPage(aliases[i], false, false);
+        }
+        g_page_read_pointers[page] = NULL;
     }
 }
 
+/**
+ * Stops watching guest reads from the page containing an address, and from the pages that alias
+ * it
+ * @param addr Address within the page to stop watching
+ */
+void UnwatchPageReads(const u32 addr) {
+    std::lock_guard<std::mutex> lock(g_page_watch_mutex);
+    u32 aliases[MAX_ALIASES];
+    const int num_aliases = GetAliases(addr, aliases);
+    for (int i = 0; i < num_aliases; i++) {
+        const u32 page = aliases[i] >> PAGE_BITS;
+        _dbg_assert_msg_(MEMMAP, g_page_read_watch_counts[page] > 0,
+            "page 0x%08X is not read-watched", aliases[i]);
+        if (g_page_read_watch_counts[page] && --g_page_read_watch_counts[page] == 0) {
+            g_page_read_pointers[page] = g_page_pointers[page];
+            ProtectFastmemPage(aliases[i], true, g_page_watch_counts[page] == 0);
+        }
+    }
+}
+
+/**
+ * Notifies the read watch callbacks of a read from a watched page, once for each address that
+ * aliases it. Unlike writes, reads are reported right away on every core, since the watchers
+ * have to update the memory before it is read.
+ * @param addr Address that is read from
+ * @param size Size of the read in bytes
+ */
+void NotifyReadWatch(const u32 addr, const u32 size) {
+    u32 aliases[MAX_ALIASES];
+    const int num_aliases = GetAliases(addr, aliases);
+    for (int i = 0; i < num_aliases; i++) {
+        for (size_t j = 0; j < g_read_watch_callbacks.size(); j++) {
+            g_read_watch_callbacks[j](aliases[i], size);
+        }
+    }
+}
+
+void WrittenPageQueue::Push(u32 addr, u32 size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const u64 end = (u64)addr + size;
+    for (u64 page = addr & ~PAGE_MASK; page < end; page += PAGE_SIZE) {
+        pages.insert((u32)page);
+    }
+    have_pages = true;
+}
+
+bool WrittenPageQueue::Take(std::set<u32>& pages) {
+    pages.clear();
+    if (!have_pages)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pages.swap(this->pages);
+    have_pages = false;
+    return !pages.empty();
+}
+
+void WrittenPageQueue::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    pages.clear();
+    have_pages = false;
+}
+
 template <typename T>
-inline void _Write(u32 addr, const T data) {
-    u32 vaddr = _VirtualAddress(addr);
-    
-    // Kernel memory command buffer
-    if (vaddr >= KERNEL_MEMORY_VADDR && vaddr < KERNEL_MEMORY_VADDR_END) {
-        *(T*)&g_kernel_mem[vaddr & KERNEL_MEMORY_MASK] = data;
+inline void _Read(T &var, const u32 addr) {
+    // Fast path: the page is backed by host memory and its reads are not watched
+    const u8* page_pointer = g_page_read_pointers[addr >> PAGE_BITS];
+    if (page_pointer) {
+        var = *((const T*)&page_pointer[addr & PAGE_MASK]);
+        return;
+    }
 
-    // Hardware I/O register writes
-    // 0x10XXXXXX- is physical address space, 0x1EXXXXXX is virtual address space
-    } else if ((vaddr >= HARDWARE_IO_VADDR) && (vaddr < HARDWARE_IO_VADDR_END)) {
-        HW::Write<T>(vaddr, data);
-
-    // ExeFS:/.code is loaded here
-    } else if ((vaddr >= EXEFS_CODE_VADDR)  && (vaddr < EXEFS_CODE_VADDR_END)) {
-        *(T*)&g_exefs_code[vaddr & EXEFS_CODE_MASK] = data;
-
-    // FCRAM - GSP heap
-    } else if ((vaddr >= HEAP_GSP_VADDR)  && (vaddr < HEAP_GSP_VADDR_END)) {
-        *(T*)&g_heap_gsp[vaddr & HEAP_GSP_MASK] = data;
-
-    // FCRAM - application heap
-    } else if ((vaddr >= HEAP_VADDR)  && (vaddr < HEAP_VADDR_END)) {
-        *(T*)&g_heap[vaddr & HEAP_MASK] = data;
-
-    // Shared memory
-    } else if ((vaddr >= SHARED_MEMORY_VADDR)  && (vaddr < SHARED_MEMORY_VADDR_END)) {
-        *(T*)&g_shared_mem[vaddr & SHARED_MEMORY_MASK] = data;
-
-    // System memory
-    } else if ((vaddr >= SYSTEM_MEMORY_VADDR)  && (vaddr < SYSTEM_MEMORY_VADDR_END)) {
-         *(T*)&g_system_mem[vaddr & SYSTEM_MEMORY_MASK] = data;
-
-    // VRAM
-    } else if ((vaddr >= VRAM_VADDR)  && (vaddr < VRAM_VADDR_END)) {
-        *(T*)&g_vram[vaddr & VRAM_MASK] = data;
-
-    //} else if ((vaddr & 0xFFF00000) == 0x1FF00000) {
-    //    _assert_msg_(MEMMAP, false, "umimplemented write to DSP memory");
-    //} else if ((vaddr & 0xFFFF0000) == 0x1FF80000) {
-    //    _assert_msg_(MEMMAP, false, "umimplemented write to Configuration Memory");
-    //} else if ((vaddr & 0xFFFFF000) == 0x1FF81000) {
-    //    _assert_msg_(MEMMAP, false, "umimplemented write to shared page");
-    
-    // Error out...
-    } else {
-        _assert_msg_(MEMMAP, false, "unknown Write%d 0x%08X @ 0x%08X", sizeof(data) * 8,
-            data, vaddr);
+    // Watched page: let the watchers update it, then do the read
+    page_pointer = g_page_pointers[addr >> PAGE_BITS];
+    if (page_pointer) {
+        NotifyReadWatch(addr, sizeof(T));
+        var = *((const T*)&page_pointer[addr & PAGE_MASK]);
+        return;
+    }
+
+    switch (g_page_types[addr >> PAGE_BITS]) {
+
+    // Hardware I/O register reads
+    case PAGE_HW_IO:
+    {
+        std::lock_guard<std::recursive_mutex> lock(HLE::g_mutex);
+        HW::Read<T>(var, addr);
+        break;
+    }
+
+    // Config memory
+    case PAGE_CONFIG_MEM:
+        ConfigMem::Read<T>(var, addr);
+        break;
+
+    default:
+        //_assert_msg_(MEMMAP, false, "unknown Read%d @ 0x%08X", sizeof(var) * 8, addr);
+        break;
     }
 }
 
-u8 *GetPointer(const u32 addr) {
-    const u32 vaddr = _VirtualAddress(addr);
+template <typename T>
+inline void _Write(u32 addr, const T data) {
+    // Fast path: the page is backed by host memory and its writes are not watched
+    u8* page_pointer = g_page_write_pointers[addr >> PAGE_BITS];
+    if (page_pointer) {
+        *(T*)&page_pointer[addr & PAGE_MASK] = data;
+        return;
+    }
 
-    // Kernel memory command buffer
-    if (vaddr >= KERNEL_MEMORY_VADDR && vaddr < KERNEL_MEMORY_VADDR_END) {
-        return g_kernel_mem + (vaddr & KERNEL_MEMORY_MASK);
+    // Watched page: do the write, then let the watchers know about it
+    page_pointer = g_page_pointers[addr >> PAGE_BITS];
+    if (page_pointer) {
+        *(T*)&page_pointer[addr & PAGE_MASK] = data;
+        NotifyWriteWatch(addr, sizeof(T));
+        return;
+    }
 
-    // ExeFS:/.code is loaded here
-    } else if ((vaddr >= EXEFS_CODE_VADDR)  && (vaddr < EXEFS_CODE_VADDR_END)) {
-        return g_exefs_code + (vaddr & EXEFS_CODE_MASK);
+    switch (g_page_types[addr >> PAGE_BITS]) {
 
-    // FCRAM - GSP heap
-    } else if ((vaddr >= HEAP_GSP_VADDR)  && (vaddr < HEAP_GSP_VADDR_END)) {
-        return g_heap_gsp + (vaddr & HEAP_GSP_MASK);
+    // Hardware I/O register writes
+    case PAGE_HW_IO:
+    {
+        std::lock_guard<std::recursive_mutex> lock(HLE::g_mutex);
+        HW::Write<T>(addr, data);
+        break;
+    }
 
-    // FCRAM - application heap
-    } else if ((vaddr >= HEAP_VADDR)  && (vaddr < HEAP_VADDR_END)) {
-        return g_heap + (vaddr & HEAP_MASK);
+    // Error out...
+    default:
+        _assert_msg_(MEMMAP, false, "unknown Write%d 0x%08X @ 0x%08X", sizeof(data) * 8,
+            data, addr);
+        break;
+    }
+}
 
-    // Shared memory
-    } else if ((vaddr >= SHARED_MEMORY_VADDR)  && (vaddr < SHARED_MEMORY_VADDR_END)) {
-        return g_shared_mem + (vaddr & SHARED_MEMORY_MASK);
+u8 *GetPointer(const u32 addr) {
+    u8* page_pointer = g_page_pointers[addr >> PAGE_BITS];
+    if (page_pointer) {
+        return page_pointer + (addr & PAGE_MASK);
+    }
+    ERROR_LOG(MEMMAP, "unknown GetPointer @ 0x%08x", addr);
+    return 0;
+}
 
-    // System memory
-    } else if ((vaddr >= SYSTEM_MEMORY_VADDR)  && (vaddr < SYSTEM_MEMORY_VADDR_END)) {
-         return g_system_mem + (vaddr & SYSTEM_MEMORY_MASK);
+u8* GetBlockPointer(const u32 address, const u32 size) {
+    if (size == 0 || address + size - 1 < address) {
+        return NULL;
+    }
+    const u32 first_page = address >> PAGE_BITS;
+    const u32 last_page = (address + size - 1) >> PAGE_BITS;
+    u8* block = g_page_pointers[first_page];
+    if (!block) {
+        return NULL;
+    }
+    block += address & PAGE_MASK;
+    for (u32 page = first_page + 1; page <= last_page; page++) {
+        if (g_page_pointers[page] != block + ((page << PAGE_BITS) - address)) {
+            return NULL;
+        }
+    }
+    return block;
+}
 
-    // VRAM
-    } else if ((vaddr > VRAM_VADDR)  && (vaddr < VRAM_VADDR_END)) {
-        return g_vram + (vaddr & VRAM_MASK);
+u8* GetPhysicalPointer(const u32 address) {
+    if (address >= VRAM_PADDR && address < VRAM_PADDR_END) {
+        return GetPointer(VirtualAddressFromPhysical_VRAM(address));
+    } else if (address >= FCRAM_PADDR && address < FCRAM_PADDR_END) {
+        return GetPointer(VirtualAddressFromPhysical_FCRAM(address));
+    }
+    ERROR_LOG(MEMMAP, "unknown GetPhysicalPointer @ 0x%08x", address);
+    return NULL;
+}
 
-    } else {
-        ERROR_LOG(MEMMAP, "unknown GetPointer @ 0x%08x", vaddr);
-        return 0;
+u8* GetPhysicalBlockPointer(const u32 address, const u32 size) {
+    if (size == 0 || address + size - 1 < address) {
+        return NULL;
+    }
+    const u32 last = address + size - 1;
+    if (address >= VRAM_PADDR && last < VRAM_PADDR_END) {
+        return GetBlockPointer(VirtualAddressFromPhysical_VRAM(address), size);
+    } else if (address >= FCRAM_PADDR && last < FCRAM_PADDR_END) {
+        return GetBlockPointer(VirtualAddressFromPhysical_FCRAM(address), size);
     }
+    return NULL;
 }
 
 /**
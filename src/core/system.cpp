@@ -19,12 +19,14 @@ MetaFileSystem g_ctr_file_system;
 void UpdateState(State state) {
 }
 
-void Init(EmuWindow* emu_window) {
-    Core::Init();
+void Init(EmuWindow* emu_window, Core::CPUCoreType cpu_core,
+    Core::MultiCoreMode multicore_mode) {
+
+    Core::Init(cpu_core, multicore_mode);
+    CoreTiming::Init();
     Memory::Init();
     HW::Init();
     HLE::Init();
-    CoreTiming::Init();
     VideoCore::Init(emu_window);
 }
 
@@ -37,11 +39,12 @@ void RunLoopUntil(u64 global_cycles) {
 
 void Shutdown() {
     Core::Shutdown();
+    // The video core still reads and watches emulated memory until it is shut down
+    VideoCore::Shutdown();
     Memory::Shutdown();
     HW::Shutdown();
     HLE::Shutdown();
     CoreTiming::Shutdown();
-    VideoCore::Shutdown();
     g_ctr_file_system.Shutdown();
 }
 
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "common/emu_window.h"
+#include "core/core.h"
 #include "core/file_sys/meta_file_system.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -27,7 +28,8 @@ extern volatile State g_state;
 extern MetaFileSystem g_ctr_file_system;
 
 void UpdateState(State state);
-void Init(EmuWindow* emu_window);
+void Init(EmuWindow* emu_window, Core::CPUCoreType cpu_core = Core::CPU_INTERPRETER,
+    Core::MultiCoreMode multicore_mode = Core::MULTICORE_DISABLED);
 void RunLoopFor(int cycles);
 void RunLoopUntil(u64 global_cycles);
 void Shutdown();
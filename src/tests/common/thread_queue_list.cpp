@@ -0,0 +1,144 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#include "common/common.h"
+#include "common/thread_queue_list.h"
+
+#include "tests/tests.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Checks ThreadQueueList against a model with a deque per priority level, over a long random
+// sequence of operations on a few hundred elements.
+
+/// Operations in the random sequence
+static const int NUM_OPERATIONS = 500000;
+
+/// Elements that the operations pick from
+static const int NUM_ELEMENTS = 300;
+
+struct Element {
+    Common::ThreadQueueHook<Element> hook;
+};
+
+typedef Common::ThreadQueueList<Element, &Element::hook> Queue;
+
+/// Reference model of the queue, one deque per priority level
+class Model {
+public:
+    Element* PopFirst(u32 priority_limit = Queue::NUM_QUEUES) {
+        for (u32 priority = 0; priority < priority_limit; priority++) {
+            if (!levels[priority].empty()) {
+                Element* element = levels[priority].front();
+                levels[priority].pop_front();
+                return element;
+            }
+        }
+        return NULL;
+    }
+
+    void Remove(Element* element) {
+        for (int priority = 0; priority < Queue::NUM_QUEUES; priority++) {
+            std::deque<Element*>& level = levels[priority];
+            std::deque<Element*>::iterator iter = std::find(level.begin(), level.end(), element);
+            if (iter != level.end()) {
+                level.erase(iter);
+                return;
+            }
+        }
+    }
+
+    int Contains(const Element* element) const {
+        for (int priority = 0; priority < Queue::NUM_QUEUES; priority++) {
+            const std::deque<Element*>& level = levels[priority];
+            if (std::find(level.begin(), level.end(), element) != level.end())
+                return priority;
+        }
+        return -1;
+    }
+
+    void Rotate(u32 priority) {
+        std::deque<Element*>& level = levels[priority];
+        if (level.size() > 1) {
+            level.push_back(level.front());
+            level.pop_front();
+        }
+    }
+
+    std::deque<Element*> levels[Queue::NUM_QUEUES];
+};
+
+/// Picks a priority level, favoring a few of them so that levels often hold several elements
+static u32 RandomPriority() {
+    if (rand() & 1)
+        return (rand() % 4) * 40;
+    return rand() % Queue::NUM_QUEUES;
+}
+
+int main() {
+    std::vector<Element> elements(NUM_ELEMENTS);
+    Queue* queue = new Queue;
+    Model* model = new Model;
+
+    srand(1);
+    for (int i = 0; i < NUM_OPERATIONS && g_failures == 0; i++) {
+        Element* element = &elements[rand() % NUM_ELEMENTS];
+        const int priority = model->Contains(element);
+        CHECK(queue->contains(element) == priority);
+
+        switch (rand() % 7) {
+        case 0:
+            if (priority == -1) {
+                const u32 new_priority = RandomPriority();
+                queue->push_back(new_priority, element);
+                model->levels[new_priority].push_back(element);
+            }
+            break;
+        case 1:
+            if (priority == -1) {
+                const u32 new_priority = RandomPriority();
+                queue->push_front(new_priority, element);
+                model->levels[new_priority].push_front(element);
+            }
+            break;
+        case 2:
+            queue->remove(element);
+            model->Remove(element);
+            break;
+        case 3:
+            CHECK(queue->pop_first() == model->PopFirst());
+            break;
+        case 4: {
+            const u32 limit = rand() % (Queue::NUM_QUEUES + 1);
+            CHECK(queue->pop_first_better(limit) == model->PopFirst(limit));
+            break;
+        }
+        case 5: {
+            const u32 level = RandomPriority();
+            queue->rotate(level);
+            model->Rotate(level);
+            break;
+        }
+        case 6: {
+            const u32 level = RandomPriority();
+            CHECK(queue->empty(level) == model->levels[level].empty());
+            break;
+        }
+        }
+    }
+
+    // Drain both, which must give the same order
+    while (Element* element = model->PopFirst()) {
+        CHECK(queue->pop_first() == element);
+    }
+    CHECK(queue->pop_first() == NULL);
+
+    delete queue;
+    delete model;
+    return g_failures;
+}
@@ -0,0 +1,191 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "common/common.h"
+#include "common/thread_queue_list.h"
+
+#include "tests/common/previous_thread_queue_list.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compares ThreadQueueList with the queue the kernel used before it, on the operations that the
+// scheduler does most, as the number of threads and of priority levels in use grows.
+
+/// Operations per measurement
+static const int NUM_STEPS = 4000000;
+
+struct Element {
+    u32 id;
+    u32 priority;
+    Common::ThreadQueueHook<Element> hook;
+};
+
+typedef Common::ThreadQueueList<Element, &Element::hook> Queue;
+typedef Previous::ThreadQueueList<u32> PreviousQueue;
+
+/// Keeps the results of the measured operations alive
+static volatile u32 g_sink;
+
+/**
+ * Runs a function once
+ * @return Time it took in nanoseconds
+ */
+template <typename F>
+static double Measure(F function) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    function();
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::high_resolution_clock::now() - start;
+    return elapsed.count();
+}
+
+static void PrintResult(const char* name, double previous, double current) {
+    printf("%-40s previous %6.1f ns, now %6.1f ns (%.1fx)\n", name, previous / NUM_STEPS,
+        current / NUM_STEPS, previous / current);
+}
+
+/**
+ * A random ready thread blocks and becomes ready again, as threads waiting on objects do
+ * @param num_threads Number of ready threads
+ * @param num_levels Number of priority levels the threads are spread over
+ */
+static void BenchmarkBlockAndWake(int num_threads, int num_levels) {
+    std::vector<Element> elements(num_threads);
+    std::vector<u32> sequence(NUM_STEPS);
+    for (int i = 0; i < num_threads; i++) {
+        elements[i].id = i + 1;
+        elements[i].priority = 0x18 + i % num_levels;
+    }
+    srand(num_threads);
+    for (int i = 0; i < NUM_STEPS; i++) {
+        sequence[i] = rand() % num_threads;
+    }
+
+    const double previous = Measure([&] {
+        PreviousQueue* queue = new PreviousQueue;
+        for (int i = 0; i < num_threads; i++) {
+            queue->prepare(elements[i].priority);
+            queue->push_back(elements[i].priority, elements[i].id);
+        }
+        for (int i = 0; i < NUM_STEPS; i++) {
+            const Element& element = elements[sequence[i]];
+            queue->remove(element.priority, element.id);
+            queue->push_back(element.priority, element.id);
+        }
+        g_sink += queue->pop_first();
+        delete queue;
+    });
+    const double current = Measure([&] {
+        Queue* queue = new Queue;
+        for (int i = 0; i < num_threads; i++) {
+            queue->push_back(elements[i].priority, &elements[i]);
+        }
+        for (int i = 0; i < NUM_STEPS; i++) {
+            Element* element = &elements[sequence[i]];
+            queue->remove(element);
+            queue->push_back(element->priority, element);
+        }
+        g_sink += queue->pop_first()->id;
+        delete queue;
+    });
+
+    char name[64];
+    sprintf(name, "block+wake, %d threads, %d priorities", num_threads, num_levels);
+    PrintResult(name, previous, current);
+}
+
+/**
+ * The only ready thread is popped and queued again, as on a reschedule, after threads of better
+ * priorities ran and blocked
+ * @param num_used_levels Number of empty priority levels better than the ready thread's
+ */
+static void BenchmarkReschedule(int num_used_levels) {
+    const u32 ready_priority = num_used_levels;
+    Element ready;
+    ready.id = 1;
+    ready.priority = ready_priority;
+
+    const double previous = Measure([&] {
+        PreviousQueue* queue = new PreviousQueue;
+        for (u32 priority = 0; priority <= ready_priority; priority++) {
+            queue->prepare(priority);
+        }
+        queue->push_back(ready_priority, ready.id);
+        for (int i = 0; i < NUM_STEPS; i++) {
+            queue->push_back(ready_priority, queue->pop_first());
+        }
+        delete queue;
+    });
+    const double current = Measure([&] {
+        Queue* queue = new Queue;
+        queue->push_back(ready_priority, &ready);
+        for (int i = 0; i < NUM_STEPS; i++) {
+            queue->push_back(ready_priority, queue->pop_first());
+        }
+        delete queue;
+    });
+
+    char name[64];
+    sprintf(name, "pop+push, %d used better levels", num_used_levels);
+    PrintResult(name, previous, current);
+}
+
+/**
+ * Looks up whether threads are ready
+ * @param num_threads Number of ready threads
+ */
+static void BenchmarkContains(int num_threads) {
+    std::vector<Element> elements(num_threads);
+    for (int i = 0; i < num_threads; i++) {
+        elements[i].id = i + 1;
+        elements[i].priority = 0x18 + i % 8;
+    }
+
+    const double previous = Measure([&] {
+        PreviousQueue* queue = new PreviousQueue;
+        for (int i = 0; i < num_threads; i++) {
+            queue->prepare(elements[i].priority);
+            queue->push_back(elements[i].priority, elements[i].id);
+        }
+        for (int i = 0; i < NUM_STEPS; i++) {
+            g_sink += queue->contains(elements[i % num_threads].id);
+        }
+        delete queue;
+    });
+    const double current = Measure([&] {
+        Queue* queue = new Queue;
+        for (int i = 0; i < num_threads; i++) {
+            queue->push_back(elements[i].priority, &elements[i]);
+        }
+        for (int i = 0; i < NUM_STEPS; i++) {
+            g_sink += queue->contains(&elements[i % num_threads]);
+        }
+        delete queue;
+    });
+
+    char name[64];
+    sprintf(name, "contains, %d threads", num_threads);
+    PrintResult(name, previous, current);
+}
+
+int main() {
+    static const int thread_counts[] = { 4, 16, 64, 256 };
+    static const int used_level_counts[] = { 1, 8, 32, 127 };
+
+    for (u32 i = 0; i < ARRAY_SIZE(thread_counts); i++) {
+        BenchmarkBlockAndWake(thread_counts[i], 1);
+        BenchmarkBlockAndWake(thread_counts[i], 8);
+    }
+    for (u32 i = 0; i < ARRAY_SIZE(used_level_counts); i++) {
+        BenchmarkReschedule(used_level_counts[i]);
+    }
+    for (u32 i = 0; i < ARRAY_SIZE(thread_counts); i++) {
+        BenchmarkContains(thread_counts[i]);
+    }
+    return 0;
+}
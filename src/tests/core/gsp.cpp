@@ -0,0 +1,213 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <cstring>
+
+#include "common/common.h"
+
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/mem_map.h"
+#include "core/hle/service/gsp.h"
+#include "core/hw/gpu.h"
+
+#include "tests/tests.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Runs GX commands on emulated VRAM. Checks that memory fills, DMAs, display transfers and
+// texture copies within VRAM write what they should, and that commands whose buffers run past
+// the end of VRAM or start in unmapped memory are rejected without touching memory.
+
+using namespace GSP_GPU;
+
+/// Value of the bytes that rejected commands must leave alone
+static const u8 GUARD_BYTE = 0xA5;
+
+/// Address of the last 256 bytes of VRAM, to run buffers past the end of it from
+static const u32 VRAM_TAIL = Memory::VRAM_VADDR_END - 0x100;
+
+/// Address that no memory is mapped at
+static const u32 UNMAPPED_ADDRESS = 0x40000000;
+
+/// Host pointer to VRAM at a virtual address
+static u8* VRAM(u32 address) {
+    return Memory::g_vram + (address - Memory::VRAM_VADDR);
+}
+
+/// Fills all of VRAM with GUARD_BYTE
+static void ResetVRAM() {
+    memset(Memory::g_vram, GUARD_BYTE, Memory::VRAM_SIZE);
+}
+
+/// Whether a range of VRAM still holds GUARD_BYTE everywhere
+static bool IsUntouched(u32 address, u32 size) {
+    const u8* const data = VRAM(address);
+    for (u32 i = 0; i < size; i++) {
+        if (data[i] != GUARD_BYTE)
+            return false;
+    }
+    return true;
+}
+
+/// Runs a GX command
+static void Execute(const GXCommand& command) {
+    ExecuteGXCommand(command.data);
+}
+
+static void TestMemoryFill() {
+    GXCommand command = {};
+    command.id = GXCommandId::SET_MEMORY_FILL;
+    command.memory_fill.control.start1 = 1;
+    command.memory_fill.control.fill1_32bit = 1;
+    command.memory_fill.value1 = 0x11223344;
+
+    // Within VRAM
+    ResetVRAM();
+    command.memory_fill.start1 = Memory::VRAM_VADDR + 0x1000;
+    command.memory_fill.end1 = Memory::VRAM_VADDR + 0x1040;
+    Execute(command);
+    u32 word;
+    memcpy(&word, VRAM(Memory::VRAM_VADDR + 0x103C), 4);
+    CHECK(word == 0x11223344);
+    CHECK(IsUntouched(Memory::VRAM_VADDR + 0x1040, 0x100));
+
+    // Running past the end of VRAM, or backwards
+    ResetVRAM();
+    command.memory_fill.start1 = VRAM_TAIL;
+    command.memory_fill.end1 = Memory::VRAM_VADDR_END + 0x100;
+    Execute(command);
+    CHECK(IsUntouched(VRAM_TAIL, 0x100));
+
+    command.memory_fill.start1 = VRAM_TAIL + 0x80;
+    command.memory_fill.end1 = VRAM_TAIL;
+    Execute(command);
+    CHECK(IsUntouched(VRAM_TAIL, 0x100));
+}
+
+static void TestDMA() {
+    GXCommand command = {};
+    command.id = GXCommandId::REQUEST_DMA;
+
+    // Within VRAM
+    ResetVRAM();
+    for (u32 i = 0; i < 0x100; i++) {
+        VRAM(Memory::VRAM_VADDR)[i] = (u8)i;
+    }
+    command.dma_request.source_address = Memory::VRAM_VADDR;
+    command.dma_request.dest_address = Memory::VRAM_VADDR + 0x1000;
+    command.dma_request.size = 0x100;
+    Execute(command);
+    CHECK(memcmp(VRAM(Memory::VRAM_VADDR), VRAM(Memory::VRAM_VADDR + 0x1000), 0x100) == 0);
+
+    // Destination running past the end of VRAM
+    ResetVRAM();
+    command.dma_request.dest_address = VRAM_TAIL;
+    command.dma_request.size = 0x200;
+    Execute(command);
+    CHECK(IsUntouched(VRAM_TAIL, 0x100));
+
+    // Unmapped source, and unmapped destination
+    command.dma_request.source_address = UNMAPPED_ADDRESS;
+    command.dma_request.dest_address = VRAM_TAIL;
+    command.dma_request.size = 0x10;
+    Execute(command);
+    CHECK(IsUntouched(VRAM_TAIL, 0x100));
+
+    command.dma_request.source_address = VRAM_TAIL;
+    command.dma_request.dest_address = UNMAPPED_ADDRESS;
+    Execute(command);
+}
+
+static void TestDisplayTransfer() {
+    GXCommand command = {};
+    command.id = GXCommandId::SET_DISPLAY_TRANSFER;
+    command.display_transfer.flags.output_tiled = 1;
+    command.display_transfer.flags.input_format = GPU::FRAMEBUFFER_FORMAT_RGBA8;
+    command.display_transfer.flags.output_format = GPU::FRAMEBUFFER_FORMAT_RGBA8;
+
+    // 8x8 pixels of one color, tiled or not they are the same
+    ResetVRAM();
+    const u32 in_address = Memory::VRAM_VADDR;
+    const u32 out_address = Memory::VRAM_VADDR + 0x1000;
+    for (u32 i = 0; i < 8 * 8 * 4; i++) {
+        VRAM(in_address)[i] = (u8)(i % 4);
+    }
+    command.display_transfer.in_buffer_address = in_address;
+    command.display_transfer.out_buffer_address = out_address;
+    command.display_transfer.in_buffer_size = (8 << 16) | 8;
+    command.display_transfer.out_buffer_size = (8 << 16) | 8;
+    Execute(command);
+    CHECK(memcmp(VRAM(in_address), VRAM(out_address), 8 * 8 * 4) == 0);
+    CHECK(IsUntouched(out_address + 8 * 8 * 4, 0x100));
+
+    // Output running past the end of VRAM
+    ResetVRAM();
+    command.display_transfer.out_buffer_address = VRAM_TAIL;
+    Execute(command);
+    CHECK(IsUntouched(VRAM_TAIL, 0x100));
+
+    // Input larger than VRAM, whose size overflows 32 bits
+    command.display_transfer.out_buffer_address = out_address;
+    command.display_transfer.in_buffer_size = 0xFFF8FFF8;
+    Execute(command);
+    CHECK(IsUntouched(out_address, 8 * 8 * 4));
+}
+
+static void TestTextureCopy() {
+    GXCommand command = {};
+    command.id = GXCommandId::SET_TEXTURE_COPY;
+
+    // Two lines of 16 bytes, with a 16-byte gap in the input and none in the output
+    ResetVRAM();
+    const u32 in_address = Memory::VRAM_VADDR;
+    const u32 out_address = Memory::VRAM_VADDR + 0x1000;
+    for (u32 i = 0; i < 0x30; i++) {
+        VRAM(in_address)[i] = (u8)i;
+    }
+    command.texture_copy.in_buffer_address = in_address;
+    command.texture_copy.out_buffer_address = out_address;
+    command.texture_copy.size = 0x20;
+    command.texture_copy.in_width_gap = (1 << 16) | 1;
+    command.texture_copy.out_width_gap = 1;
+    Execute(command);
+    CHECK(memcmp(VRAM(out_address), VRAM(in_address), 0x10) == 0);
+    CHECK(memcmp(VRAM(out_address + 0x10), VRAM(in_address + 0x20), 0x10) == 0);
+    CHECK(IsUntouched(out_address + 0x20, 0x100));
+
+    // Fits at the end of VRAM without its gaps, but not with them
+    ResetVRAM();
+    command.texture_copy.in_buffer_address = VRAM_TAIL;
+    command.texture_copy.out_buffer_address = out_address;
+    command.texture_copy.size = 0x80;
+    command.texture_copy.in_width_gap = (0xFFFF << 16) | 1;
+    Execute(command);
+    CHECK(IsUntouched(out_address, 0x100));
+
+    // Output running past the end of VRAM
+    command.texture_copy.in_buffer_address = in_address;
+    command.texture_copy.out_buffer_address = VRAM_TAIL;
+    command.texture_copy.size = 0x200;
+    command.texture_copy.in_width_gap = 1;
+    Execute(command);
+    CHECK(IsUntouched(VRAM_TAIL, 0x100));
+}
+
+int main() {
+    Core::Init();
+    CoreTiming::Init();
+    Memory::Init();
+
+    CHECK(Memory::GetBlockPointer(UNMAPPED_ADDRESS, 1) == NULL);
+
+    TestMemoryFill();
+    TestDMA();
+    TestDisplayTransfer();
+    TestTextureCopy();
+
+    Memory::Shutdown();
+    CoreTiming::Shutdown();
+    Core::Shutdown();
+
+    return g_failures;
+}
@@ -0,0 +1,150 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <set>
+#include <vector>
+
+#include "common/common.h"
+
+#include "core/hle/kernel/kernel.h"
+
+#include "tests/tests.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Checks the generational handles of Kernel::ObjectPool: handles of destroyed objects are
+// rejected, also once their slot holds a new object, objects are only returned as their own type,
+// freed slots are reused, and slot generations wrap around without ever producing 0 or a handle
+// in the range of the 0xFFFF8000 pseudo-handles.
+
+/// Number of live TestObjects
+static int g_live_objects = 0;
+
+class TestObject : public Kernel::Object {
+public:
+    TestObject() { g_live_objects++; }
+    ~TestObject() { g_live_objects--; }
+
+    static Kernel::HandleType GetStaticHandleType() { return Kernel::HandleType::Event; }
+    Kernel::HandleType GetHandleType() const { return Kernel::HandleType::Event; }
+};
+
+class OtherObject : public Kernel::Object {
+public:
+    static Kernel::HandleType GetStaticHandleType() { return Kernel::HandleType::Mutex; }
+    Kernel::HandleType GetHandleType() const { return Kernel::HandleType::Mutex; }
+};
+
+/// Slot index held in the low bits of a handle
+static u32 GetIndex(Handle handle) {
+    return handle & 0xFFFF;
+}
+
+/// Slot generation held in the high bits of a handle
+static u32 GetGeneration(Handle handle) {
+    return handle >> 16;
+}
+
+static void TestStaleHandles() {
+    Kernel::ObjectPool pool;
+    u32 error;
+
+    TestObject* first = new TestObject;
+    const Handle first_handle = pool.Create(first);
+    CHECK(first_handle != 0);
+    CHECK(first->GetHandle() == first_handle);
+    CHECK(pool.Get<TestObject>(first_handle, error) == first);
+    CHECK(pool.Get<OtherObject>(first_handle, error) == NULL);
+    CHECK(pool.GetCount() == 1);
+
+    pool.Destroy<TestObject>(first_handle);
+    CHECK(g_live_objects == 0);
+    CHECK(pool.GetCount() == 0);
+    CHECK(!pool.IsValid(first_handle));
+    CHECK(pool.Get<TestObject>(first_handle, error) == NULL);
+
+    // The slot is reused, but the old handle still does not refer to anything
+    TestObject* second = new TestObject;
+    const Handle second_handle = pool.Create(second);
+    CHECK(GetIndex(second_handle) == GetIndex(first_handle));
+    CHECK(second_handle != first_handle);
+    CHECK(pool.Get<TestObject>(second_handle, error) == second);
+    CHECK(pool.Get<TestObject>(first_handle, error) == NULL);
+
+    // Destroying through the stale handle or as the wrong type leaves the object alone
+    pool.Destroy<TestObject>(first_handle);
+    pool.Destroy<OtherObject>(second_handle);
+    CHECK(pool.Get<TestObject>(second_handle, error) == second);
+    CHECK(g_live_objects == 1);
+
+    pool.Clear();
+    CHECK(g_live_objects == 0);
+    CHECK(!pool.IsValid(second_handle));
+}
+
+static void TestSlotReuse() {
+    Kernel::ObjectPool pool;
+    static const int NUM_OBJECTS = 100;
+
+    std::vector<Handle> handles;
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        handles.push_back(pool.Create(new TestObject));
+    }
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        pool.Destroy<TestObject>(handles[i]);
+    }
+
+    // Only the freed slots are used again, each with a new handle
+    std::set<u32> indices;
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        const Handle handle = pool.Create(new TestObject);
+        CHECK(GetIndex(handle) < NUM_OBJECTS);
+        CHECK(!pool.IsValid(handles[GetIndex(handle)]));
+        indices.insert(GetIndex(handle));
+    }
+    CHECK(indices.size() == NUM_OBJECTS);
+    CHECK(pool.GetCount() == NUM_OBJECTS);
+
+    pool.Clear();
+    CHECK(g_live_objects == 0);
+}
+
+static void TestGenerationWrap() {
+    Kernel::ObjectPool pool;
+    u32 error;
+
+    // Cycle one slot through all of its generations, and then some
+    const Handle first_handle = pool.Create(new TestObject);
+    pool.Destroy<TestObject>(first_handle);
+
+    Handle previous = first_handle;
+    Handle wrapped = 0;
+    for (u32 i = 1; i < 2 * 0x7FFF; i++) {
+        const Handle handle = pool.Create(new TestObject);
+        CHECK(handle != 0);
+        CHECK(GetIndex(handle) == GetIndex(first_handle));
+        CHECK(GetGeneration(handle) >= 1 && GetGeneration(handle) <= 0x7FFF);
+        CHECK(handle < 0xFFFF8000);
+        CHECK(handle != previous);
+        CHECK(!pool.IsValid(previous));
+        CHECK(pool.Get<TestObject>(handle, error) != NULL);
+
+        if (handle == first_handle && wrapped == 0) {
+            wrapped = i;
+        }
+        pool.Destroy<TestObject>(handle);
+        previous = handle;
+    }
+
+    // The handle of the slot only comes back once all the generations have been used
+    CHECK(wrapped == 0x7FFF);
+    CHECK(g_live_objects == 0);
+}
+
+int main() {
+    TestStaleHandles();
+    TestSlotReuse();
+    TestGenerationWrap();
+
+    return g_failures;
+}
@@ -0,0 +1,139 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <cstring>
+
+#include "common/common.h"
+
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/mem_map.h"
+#include "core/hle/service/service.h"
+
+#include "tests/tests.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Dispatches commands through the function table of a test service. Checks that commands are
+// matched on their full ID, that unknown, unimplemented and out-of-table commands fail, that of
+// two functions with the same number only the first is registered, and the call counters.
+
+/// Function that was called last, NULL if none
+static const char* g_called = NULL;
+
+static void First(Service::Interface* self) {
+    g_called = "First";
+}
+
+static void Second(Service::Interface* self) {
+    g_called = "Second";
+}
+
+static void Duplicate(Service::Interface* self) {
+    g_called = "Duplicate";
+}
+
+static void Far(Service::Interface* self) {
+    g_called = "Far";
+}
+
+const Service::Interface::FunctionInfo FunctionTable[] = {
+    {0x00010040, First,     "First"},
+    {0x00020082, Second,    "Second"},
+    {0x00030000, NULL,      "Unimplemented"},
+    {0x000100C0, Duplicate, "Duplicate"},
+    {0x00400000, Far,       "Far"},
+};
+
+class TestInterface : public Service::Interface {
+public:
+    TestInterface() {
+        Register(FunctionTable, ARRAY_SIZE(FunctionTable));
+    }
+
+    const char *GetPortName() const {
+        return "test:s";
+    }
+};
+
+/**
+ * Sends a command to a service
+ * @param service Service to send the command to
+ * @param command Command ID
+ * @param result Optional, set to the result of the request
+ * @return Name of the function that ran, NULL if none did
+ */
+static const char* Send(Service::Interface& service, u32 command, Result* result = NULL) {
+    g_called = NULL;
+    Service::GetCommandBuffer()[0] = command;
+    const Result sync_result = service.Sync();
+    if (result != NULL) {
+        *result = sync_result;
+    }
+    return g_called;
+}
+
+/// Whether sending a command to a service runs a function
+static bool Called(Service::Interface& service, u32 command, const char* name) {
+    const char* called = Send(service, command);
+    return called != NULL && strcmp(called, name) == 0;
+}
+
+static void TestDispatch() {
+    TestInterface service;
+    Result result;
+
+    CHECK(Called(service, 0x00010040, "First"));
+    CHECK(Called(service, 0x00020082, "Second"));
+    CHECK(Called(service, 0x00400000, "Far"));
+    CHECK(Send(service, 0x00400000, &result) != NULL && result == 0);
+
+    // Other parameter descriptors, unimplemented functions, and numbers between, past and at the
+    // end of the table
+    CHECK(Send(service, 0x00010080, &result) == NULL && result != 0);
+    CHECK(Send(service, 0x00030000, &result) == NULL && result != 0);
+    CHECK(Send(service, 0x00000000, &result) == NULL && result != 0);
+    CHECK(Send(service, 0x00200000, &result) == NULL && result != 0);
+    CHECK(Send(service, 0x00410000, &result) == NULL && result != 0);
+    CHECK(Send(service, 0xFFFF0000, &result) == NULL && result != 0);
+
+    // Only the first of two functions numbered 1 is registered
+    CHECK(Send(service, 0x000100C0) == NULL);
+    CHECK(service.GetFunctionStats(0x000100C0) == NULL);
+}
+
+static void TestFunctionStats() {
+    TestInterface service;
+
+    for (int i = 0; i < 3; i++) {
+        Send(service, 0x00010040);
+    }
+    Send(service, 0x00020082);
+    Send(service, 0x00010080);
+
+    CHECK(service.GetFunctionStats(0x00010040) != NULL);
+    CHECK(service.GetFunctionStats(0x00010040)->call_count == 3);
+    CHECK(service.GetFunctionStats(0x00020082)->call_count == 1);
+    CHECK(service.GetFunctionStats(0x00400000)->call_count == 0);
+    CHECK(service.GetFunctionStats(0x00010080) == NULL);
+    CHECK(service.GetFunctionStats(0x00500000) == NULL);
+
+    service.ResetFunctionStats();
+    CHECK(service.GetFunctionStats(0x00010040)->call_count == 0);
+    CHECK(service.GetFunctionStats(0x00020082)->call_count == 0);
+}
+
+int main() {
+    Core::Init();
+    CoreTiming::Init();
+    Memory::Init();
+
+    TestDispatch();
+    TestFunctionStats();
+
+    Memory::Shutdown();
+    CoreTiming::Shutdown();
+    Core::Shutdown();
+
+    return g_failures;
+}
@@ -0,0 +1,221 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+
+#include "common/common.h"
+
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/mem_map.h"
+#include "core/hle/hle.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/thread.h"
+#include "core/hle/kernel/timer.h"
+
+#include "tests/tests.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Runs the kernel scheduler and CoreTiming the way Core::RunLoop does, without executing any
+// guest instructions. The main thread waits on timers and sleeps, and the test checks when it is
+// woken up and with which result: one-shot, periodic and cancelled timers, timed waits that are
+// satisfied or time out, timers with periods shorter than a microsecond, and SleepThread.
+
+/// Nanoseconds in a millisecond, the unit of the kernel timeouts
+static const s64 MS = 1000000;
+
+/// Cycles in a number of nanoseconds, converted like the kernel does
+static s64 NsToCycles(s64 nanoseconds) {
+    return nsToCycles(nanoseconds);
+}
+
+/// Whether a number of elapsed cycles is a duration, give or take the cycle Idle rounds up by
+static bool TookCycles(u64 elapsed, s64 nanoseconds) {
+    const s64 expected = NsToCycles(nanoseconds);
+    return (s64)elapsed >= expected && (s64)elapsed <= expected + 1;
+}
+
+/**
+ * Switches threads and skips ahead to the next event until the main thread runs again, as the
+ * run loop does when no thread can run
+ * @return Number of cycles that elapsed
+ */
+static u64 RunUntilThreadRuns() {
+    const u64 start = CoreTiming::GetTicks();
+    for (int i = 0; i < 1000 && (HLE::g_reschedule || !Kernel::IsCurrentThreadRunning()); i++) {
+        HLE::g_reschedule = false;
+        Kernel::Reschedule();
+        if (Core::g_app_core->down_count <= 0) {
+            CoreTiming::Advance();
+        }
+    }
+    return CoreTiming::GetTicks() - start;
+}
+
+/**
+ * Lets time pass while the main thread runs, handling the events that become due
+ * @param nanoseconds Time to let pass
+ */
+static void RunFor(s64 nanoseconds) {
+    s64 cycles = NsToCycles(nanoseconds);
+    while (cycles > 0) {
+        const s64 step = std::min<s64>(cycles, Core::g_app_core->down_count);
+        Core::g_app_core->down_count -= (int)step;
+        cycles -= step;
+        if (Core::g_app_core->down_count <= 0) {
+            CoreTiming::Advance();
+        }
+    }
+    RunUntilThreadRuns();
+}
+
+/**
+ * Waits on one object, as WaitSynchronization1 does, until the wait ends
+ * @param handle Object to wait on
+ * @param nanoseconds Timeout, negative to wait forever
+ * @param elapsed Set to the number of cycles the wait took
+ * @return Result of the wait, as the thread gets it in r0
+ */
+static Result Wait(Handle handle, s64 nanoseconds, u64* elapsed) {
+    s32 index;
+    const Result result = Kernel::WaitThread_Synchronization(&handle, 1, false, nanoseconds,
+        &index);
+    if (!HLE::g_reschedule) {
+        // Acquired or polled without waiting
+        *elapsed = 0;
+        return result;
+    }
+    *elapsed = RunUntilThreadRuns();
+    return (Result)Core::g_app_core->GetReg(0);
+}
+
+/// Polls an object, returning whether it could be acquired
+static bool Poll(Handle handle) {
+    u64 elapsed;
+    return Wait(handle, 0, &elapsed) == 0;
+}
+
+static void TestOneShotTimer() {
+    const Handle timer = Kernel::CreateTimer(RESETTYPE_ONESHOT);
+    CHECK(Kernel::SetTimer(timer, 2 * MS, 0) == 0);
+    CHECK(!Poll(timer));
+
+    u64 elapsed;
+    CHECK(Wait(timer, -1, &elapsed) == 0);
+    CHECK(TookCycles(elapsed, 2 * MS));
+
+    // Acquiring it reset it, and it does not signal again
+    CHECK(!Poll(timer));
+    RunFor(10 * MS);
+    CHECK(!Poll(timer));
+}
+
+static void TestPeriodicTimer() {
+    const Handle timer = Kernel::CreateTimer(RESETTYPE_ONESHOT);
+    CHECK(Kernel::SetTimer(timer, 3 * MS, 1 * MS) == 0);
+
+    u64 elapsed;
+    CHECK(Wait(timer, -1, &elapsed) == 0);
+    CHECK(TookCycles(elapsed, 3 * MS));
+    for (int i = 0; i < 5; i++) {
+        CHECK(Wait(timer, -1, &elapsed) == 0);
+        CHECK(TookCycles(elapsed, 1 * MS));
+    }
+
+    // A sticky timer stays signaled until cleared
+    const Handle sticky = Kernel::CreateTimer(RESETTYPE_STICKY);
+    CHECK(Kernel::SetTimer(sticky, 1 * MS, 1 * MS) == 0);
+    RunFor(2 * MS);
+    CHECK(Poll(sticky));
+    CHECK(Poll(sticky));
+    CHECK(Kernel::ClearTimer(sticky) == 0);
+    CHECK(!Poll(sticky));
+
+    CHECK(Kernel::CancelTimer(timer) == 0);
+    CHECK(Kernel::CancelTimer(sticky) == 0);
+}
+
+static void TestCancelledTimer() {
+    const Handle timer = Kernel::CreateTimer(RESETTYPE_ONESHOT);
+    CHECK(Kernel::SetTimer(timer, 1 * MS, 1 * MS) == 0);
+    CHECK(Kernel::CancelTimer(timer) == 0);
+
+    // The wait times out instead
+    u64 elapsed;
+    CHECK(Wait(timer, 5 * MS, &elapsed) == Kernel::RESULT_WAIT_TIMEOUT);
+    CHECK(TookCycles(elapsed, 5 * MS));
+    CHECK(!Poll(timer));
+
+    CHECK(Kernel::CancelTimer(0x12345678) == Kernel::RESULT_INVALID_HANDLE);
+    CHECK(Kernel::ClearTimer(0x12345678) == Kernel::RESULT_INVALID_HANDLE);
+    CHECK(Kernel::SetTimer(0x12345678, 1 * MS, 0) == Kernel::RESULT_INVALID_HANDLE);
+    CHECK(Kernel::SetTimer(timer, -1, 0) == Kernel::RESULT_OUT_OF_RANGE);
+    CHECK(Kernel::SetTimer(timer, 1 * MS, -1) == Kernel::RESULT_OUT_OF_RANGE);
+}
+
+static void TestShortPeriod() {
+    // Shorter than a microsecond, which must neither be rounded down to no time at all nor hang
+    // CoreTiming by rescheduling the timer at the cycle it fired on
+    const Handle timer = Kernel::CreateTimer(RESETTYPE_ONESHOT);
+    CHECK(Kernel::SetTimer(timer, 1 * MS, 500) == 0);
+    RunFor(2 * MS);
+    CHECK(Poll(timer));
+
+    // The next signal comes at most one period after acquiring the last one
+    u64 elapsed;
+    CHECK(Wait(timer, -1, &elapsed) == 0);
+    CHECK(elapsed > 0 && (s64)elapsed <= NsToCycles(500) + 1);
+
+    // Shorter than a cycle
+    CHECK(Kernel::SetTimer(timer, 0, 1) == 0);
+    RunFor(1 * MS);
+    CHECK(Poll(timer));
+    CHECK(Kernel::CancelTimer(timer) == 0);
+}
+
+static void TestTimedWait() {
+    // Satisfied before the timeout, which must then not end a later wait early
+    const Handle timer = Kernel::CreateTimer(RESETTYPE_ONESHOT);
+    CHECK(Kernel::SetTimer(timer, 1 * MS, 0) == 0);
+    u64 elapsed;
+    CHECK(Wait(timer, 4 * MS, &elapsed) == 0);
+    CHECK(TookCycles(elapsed, 1 * MS));
+
+    CHECK(Kernel::SetTimer(timer, 6 * MS, 0) == 0);
+    CHECK(Wait(timer, -1, &elapsed) == 0);
+    CHECK(TookCycles(elapsed, 6 * MS));
+
+    // Timing out, then waiting again
+    CHECK(Kernel::SetTimer(timer, 8 * MS, 0) == 0);
+    CHECK(Wait(timer, 3 * MS, &elapsed) == Kernel::RESULT_WAIT_TIMEOUT);
+    CHECK(TookCycles(elapsed, 3 * MS));
+    CHECK(Wait(timer, -1, &elapsed) == 0);
+    CHECK(TookCycles(elapsed, 5 * MS));
+}
+
+static void TestSleep() {
+    Kernel::SleepCurrentThread(7 * MS);
+    CHECK(TookCycles(RunUntilThreadRuns(), 7 * MS));
+}
+
+int main() {
+    Core::Init();
+    CoreTiming::Init();
+    Memory::Init();
+    Kernel::LoadExec(Memory::EXEFS_CODE_VADDR);
+    CoreTiming::Advance();
+
+    TestOneShotTimer();
+    TestPeriodicTimer();
+    TestCancelledTimer();
+    TestTimedWait();
+    TestShortPeriod();
+    TestSleep();
+
+    Memory::Shutdown();
+    CoreTiming::Shutdown();
+    Core::Shutdown();
+
+    return g_failures;
+}
@@ -0,0 +1,158 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <vector>
+
+#include "common/common.h"
+
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/mem_map.h"
+
+#include "tests/tests.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Watches pages of the application heap and writes to them through the heap's virtual address,
+// its physical address and the FW0B mapping. The code caches and the texture cache look up what a
+// write invalidates by the address they watched, so each write must be reported at that address
+// whichever alias it went through. Reads from read-watched pages are checked the same way, and
+// must be reported before they are made, so that the watcher can update the memory.
+
+/// Addresses of the writes reported to the callback since the last Reset
+static std::vector<u32> g_writes;
+
+static void OnWatchedWrite(u32 addr, u32 size) {
+    g_writes.push_back(addr);
+}
+
+/// Addresses of the reads reported to the callback since the last Reset
+static std::vector<u32> g_reads;
+
+/// Value the read watch callback stores to the address read, like a cache writing back its data
+static const u32 READ_WATCH_VALUE = 0xCAFEF00D;
+
+static void OnWatchedRead(u32 addr, u32 size) {
+    g_reads.push_back(addr);
+    *(u32*)Memory::GetPointer(addr) = READ_WATCH_VALUE;
+}
+
+/// Whether a read from an address was reported
+static bool ReportedRead(u32 addr) {
+    for (size_t i = 0; i < g_reads.size(); i++) {
+        if (g_reads[i] == addr)
+            return true;
+    }
+    return false;
+}
+
+/// Whether a write to an address was reported
+static bool Reported(u32 addr) {
+    for (size_t i = 0; i < g_writes.size(); i++) {
+        if (g_writes[i] == addr)
+            return true;
+    }
+    return false;
+}
+
+/// Offset into the heap of the page the tests watch
+static const u32 OFFSET = 0x12340;
+
+static void TestAliasedWrites() {
+    const u32 mirrors[] = { Memory::HEAP_VADDR, Memory::FCRAM_PADDR, Memory::FCRAM_VADDR_FW0B };
+
+    // Whichever address the page is watched at, a write through any alias is reported there
+    for (int watched = 0; watched < 3; watched++) {
+        Memory::WatchPageWrites(mirrors[watched] + OFFSET);
+        for (int written = 0; written < 3; written++) {
+            g_writes.clear();
+            Memory::Write32(mirrors[written] + OFFSET, 0x12345678);
+            CHECK(Reported(mirrors[watched] + OFFSET));
+            CHECK(Memory::Read32(mirrors[watched] + OFFSET) == 0x12345678);
+
+            g_writes.clear();
+            Memory::NotifyWriteWatch(mirrors[written] + OFFSET, 4);
+            CHECK(Reported(mirrors[watched] + OFFSET));
+        }
+        Memory::UnwatchPageWrites(mirrors[watched] + OFFSET);
+
+        // Once unwatched, writes through every alias take the fast path again
+        for (int written = 0; written < 3; written++) {
+            g_writes.clear();
+            Memory::Write32(mirrors[written] + OFFSET, 0);
+            CHECK(g_writes.empty());
+        }
+    }
+}
+
+static void TestOtherMemory() {
+    // Memory without mirrors is only reported at its own address
+    const u32 address = Memory::VRAM_VADDR + OFFSET;
+    Memory::WatchPageWrites(address);
+    g_writes.clear();
+    Memory::Write32(address, 0x12345678);
+    CHECK(g_writes.size() == 1 && Reported(address));
+    Memory::UnwatchPageWrites(address);
+
+    g_writes.clear();
+    Memory::Write32(address, 0);
+    CHECK(g_writes.empty());
+}
+
+static void TestAliasedReads() {
+    const u32 mirrors[] = { Memory::HEAP_VADDR, Memory::FCRAM_PADDR, Memory::FCRAM_VADDR_FW0B };
+
+    for (int watched = 0; watched < 3; watched++) {
+        Memory::WatchPageReads(mirrors[watched] + OFFSET);
+        for (int read = 0; read < 3; read++) {
+            Memory::Write32(mirrors[watched] + OFFSET, 0);
+            g_reads.clear();
+            CHECK(Memory::Read32(mirrors[read] + OFFSET) == READ_WATCH_VALUE);
+            CHECK(ReportedRead(mirrors[watched] + OFFSET));
+        }
+
+        // Writes are not reported as reads, and read watches don't make writes watched
+        g_reads.clear();
+        g_writes.clear();
+        Memory::Write32(mirrors[watched] + OFFSET, 0);
+        CHECK(g_reads.empty() && g_writes.empty());
+        Memory::UnwatchPageReads(mirrors[watched] + OFFSET);
+
+        for (int read = 0; read < 3; read++) {
+            g_reads.clear();
+            CHECK(Memory::Read32(mirrors[read] + OFFSET) == 0);
+            CHECK(g_reads.empty());
+        }
+    }
+
+    // Pages watched for both reads and writes report both
+    Memory::WatchPageReads(Memory::HEAP_VADDR + OFFSET);
+    Memory::WatchPageWrites(Memory::HEAP_VADDR + OFFSET);
+    g_reads.clear();
+    g_writes.clear();
+    Memory::Write32(Memory::FCRAM_PADDR + OFFSET, 0);
+    CHECK(Memory::Read32(Memory::FCRAM_PADDR + OFFSET) == READ_WATCH_VALUE);
+    CHECK(Reported(Memory::HEAP_VADDR + OFFSET) && ReportedRead(Memory::HEAP_VADDR + OFFSET));
+    Memory::UnwatchPageWrites(Memory::HEAP_VADDR + OFFSET);
+    Memory::UnwatchPageReads(Memory::HEAP_VADDR + OFFSET);
+}
+
+int main() {
+    Core::Init();
+    CoreTiming::Init();
+    Memory::Init();
+    Memory::RegisterWriteWatchCallback(OnWatchedWrite);
+    Memory::RegisterReadWatchCallback(OnWatchedRead);
+
+    TestAliasedWrites();
+    TestOtherMemory();
+    TestAliasedReads();
+
+    Memory::UnregisterReadWatchCallback(OnWatchedRead);
+    Memory::UnregisterWriteWatchCallback(OnWatchedWrite);
+    Memory::Shutdown();
+    CoreTiming::Shutdown();
+    Core::Shutdown();
+
+    return g_failures;
+}
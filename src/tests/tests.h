@@ -0,0 +1,25 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstdio>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Test programs
+//
+// Each test is a small program that checks its conditions with CHECK and returns the number of
+// failures from main, so that CTest reports it as failed when any check failed.
+
+/// Number of failed checks of the test program
+static int g_failures = 0;
+
+/// Checks a condition, reporting it and counting a failure if it does not hold
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            g_failures++; \
+        } \
+    } while (0)
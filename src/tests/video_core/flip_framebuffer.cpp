@@ -0,0 +1,100 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "common/common.h"
+#include "common/cpu_detect.h"
+
+#include "video_core/utils.h"
+
+#include "tests/tests.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Checks FlipFramebuffer against a pixel by pixel rotation for every framebuffer format, at the
+// sizes of both screens, at sizes only the SSE2 kernels or only the generic code handle, and with
+// and without AVX2, so that each of the SIMD kernels is compared with the reference.
+
+/// Bytes after the output that FlipFramebuffer must leave alone
+static const u32 GUARD_SIZE = 64;
+
+/// Value of the guard bytes
+static const u8 GUARD_BYTE = 0xA5;
+
+/// Size of a pixel of the framebuffer in memory
+static int GetInputPixelSize(GPU::FramebufferFormat format) {
+    return (format == GPU::FRAMEBUFFER_FORMAT_RGB8) ? 3 : VideoCore::GetFlippedPixelSize(format);
+}
+
+/// Rotates a framebuffer one pixel at a time, as the reference for FlipFramebuffer
+static void ReferenceFlip(const u8* in, u8* out, int width, int height,
+    GPU::FramebufferFormat format) {
+
+    const int in_size = GetInputPixelSize(format);
+    const int out_size = VideoCore::GetFlippedPixelSize(format);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            // Columns are stored from the bottom of the screen to the top
+            const u8* src = in + (x * height + (height - 1 - y)) * in_size;
+            u8* dst = out + (y * width + x) * out_size;
+            memcpy(dst, src, in_size);
+            if (format == GPU::FRAMEBUFFER_FORMAT_RGB8) {
+                dst[3] = 0xFF;
+            }
+        }
+    }
+}
+
+static void TestFlip(int width, int height, GPU::FramebufferFormat format) {
+    const int out_size = width * height * VideoCore::GetFlippedPixelSize(format);
+    std::vector<u8> in(width * height * GetInputPixelSize(format));
+    for (size_t i = 0; i < in.size(); i++) {
+        in[i] = (u8)rand();
+    }
+
+    std::vector<u8> expected(out_size);
+    ReferenceFlip(&in[0], &expected[0], width, height, format);
+
+    std::vector<u8> out(out_size + GUARD_SIZE, GUARD_BYTE);
+    VideoCore::FlipFramebuffer(&in[0], &out[0], width, height, format);
+
+    const bool same = memcmp(&out[0], &expected[0], out_size) == 0;
+    if (!same) {
+        fprintf(stderr, "format %d at %dx%d differs%s\n", (int)format, width, height,
+            cpu_info.bAVX2 ? " with AVX2" : "");
+    }
+    CHECK(same);
+    for (u32 i = 0; i < GUARD_SIZE; i++) {
+        CHECK(out[out_size + i] == GUARD_BYTE);
+    }
+}
+
+int main() {
+    static const GPU::FramebufferFormat formats[] = {
+        GPU::FRAMEBUFFER_FORMAT_RGBA8, GPU::FRAMEBUFFER_FORMAT_RGB8,
+        GPU::FRAMEBUFFER_FORMAT_RGB565, GPU::FRAMEBUFFER_FORMAT_RGB5A1,
+        GPU::FRAMEBUFFER_FORMAT_RGBA4,
+    };
+    // The screens, a height the 2 byte AVX2 kernel can't handle, and sizes that aren't multiples
+    // of 16 and 8, which take the generic path
+    static const int sizes[][2] = {
+        { 400, 240 }, { 320, 240 }, { 240, 400 }, { 48, 24 }, { 100, 60 }, { 400, 236 },
+    };
+
+    const bool have_avx2 = cpu_info.bAVX2;
+    for (int avx2 = have_avx2; avx2 >= 0; avx2--) {
+        cpu_info.bAVX2 = (avx2 != 0);
+        for (int i = 0; i < (int)ARRAY_SIZE(formats); i++) {
+            for (int j = 0; j < (int)ARRAY_SIZE(sizes); j++) {
+                TestFlip(sizes[j][0], sizes[j][1], formats[i]);
+            }
+        }
+    }
+    cpu_info.bAVX2 = have_avx2;
+
+    return g_failures;
+}
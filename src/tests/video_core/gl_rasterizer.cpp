@@ -0,0 +1,522 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "common/common.h"
+
+#include "core/mem_map.h"
+
+#include "video_core/command_processor.h"
+#include "video_core/morton.h"
+#include "video_core/rasterizer.h"
+#include "video_core/texture_cache.h"
+#include "video_core/vertex_shader.h"
+#include "video_core/renderer_opengl/gl_rasterizer.h"
+#include "video_core/renderer_opengl/gl_shader_gen.h"
+
+#include "tests/tests.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Runs the hardware rasterizer on an offscreen context, e.g. Mesa's llvmpipe through an EGL
+// surfaceless display. Checks that the GLSL generated for the texture combiner compiles and links
+// for every source, modifier, operation and scale, that drawing gives the expected pixels and the
+// same ones as the software rasterizer, and that FlushRegion, InvalidateRegion and guest reads and
+// writes keep the surface cache and emulated memory consistent. Exits with SKIP_RETURN_CODE when there is no context.
+
+using namespace Pica;
+
+/// Exit code telling CTest that the test was skipped
+static const int SKIP_RETURN_CODE = 77;
+
+static const u32 WIDTH = 256;
+static const u32 HEIGHT = 128;
+
+static const u32 COLOR_BUFFER_ADDRESS = 0x18000000;   ///< In VRAM, physical address
+static const u32 DEPTH_BUFFER_ADDRESS = 0x18040000;   ///< In VRAM, physical address
+static const u32 VERTEX_ARRAY_ADDRESS = 0x20100000;   ///< In FCRAM, physical address
+
+/// Size of a vertex in the vertex array: position and color as float4, texcoord0 as float2
+static const u32 VERTEX_SIZE = 10 * sizeof(float);
+
+/**
+ * Creates an OpenGL 3.2 core context without a window and makes it current
+ * @return True on success
+ */
+static bool CreateOffscreenContext() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display == NULL)
+        return false;
+
+    EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY,
+        NULL);
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+        return false;
+    if (!eglBindAPI(EGL_OPENGL_API))
+        return false;
+
+    static const EGLint config_attributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config;
+    EGLint num_configs = 0;
+    eglChooseConfig(display, config_attributes, &config, 1, &num_configs);
+
+    static const EGLint context_attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 2,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, num_configs ? config : EGL_NO_CONFIG_KHR,
+        EGL_NO_CONTEXT, context_attributes);
+    if (context == EGL_NO_CONTEXT)
+        return false;
+    return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) == EGL_TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// GLSL generation
+
+/**
+ * Compiles a shader
+ * @return Shader handle, or 0 when it did not compile
+ */
+static GLuint CompileShader(GLenum type, const std::string& source) {
+    GLuint shader = glCreateShader(type);
+    const char* source_ptr = source.c_str();
+    glShaderSource(shader, 1, &source_ptr, NULL);
+    glCompileShader(shader);
+
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "%s\nin\n%s\n", log, source.c_str());
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+/**
+ * Generates, compiles and links the program of a combiner configuration
+ * @return True when the program linked
+ */
+static bool BuildProgram(GLuint vertex_shader, const GLShaderGen::FragmentConfig& config) {
+    GLuint fragment_shader = CompileShader(GL_FRAGMENT_SHADER,
+        GLShaderGen::GenerateFragmentShader(config));
+    if (fragment_shader == 0)
+        return false;
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    glLinkProgram(program);
+    glDeleteShader(fragment_shader);
+
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        fprintf(stderr, "%s\n", log);
+    }
+    glDeleteProgram(program);
+    return status == GL_TRUE;
+}
+
+/// A configuration with every texture unit and buffer update enabled, whose stages pass the
+/// primary color through
+static GLShaderGen::FragmentConfig PassthroughConfig() {
+    GLShaderGen::FragmentConfig config;
+    memset(&config, 0, sizeof(config));
+    config.texture_enable = 0x7;
+    config.buffer_update = 0xFF00;
+    return config;
+}
+
+/**
+ * Builds the programs of every value of each field of the first combiner stage, the other fields
+ * of the stage using each source of the stage, and of random configurations of all stages
+ */
+static void TestShaderGeneration() {
+    GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, GLShaderGen::GenerateVertexShader());
+    CHECK(vertex_shader != 0);
+    if (vertex_shader == 0)
+        return;
+
+    // Color sources are in bits 0-11 and alpha sources in bits 16-27, 4 bits each
+    for (u32 source = 0; source < 16; source++) {
+        GLShaderGen::FragmentConfig config = PassthroughConfig();
+        config.sources[0] = source * 0x01110111;
+        config.modifiers[0] = 0x0000;
+        config.operations[0] = 0x00040004;  // Lerp, which uses all three sources
+        CHECK(BuildProgram(vertex_shader, config));
+    }
+
+    // Color modifiers are in bits 0-11, 4 bits each, alpha modifiers in the low 3 bits of 12-23
+    for (u32 modifier = 0; modifier < 16; modifier++) {
+        GLShaderGen::FragmentConfig config = PassthroughConfig();
+        config.sources[0] = 0x03210321;
+        config.modifiers[0] = modifier * 0x111 | (modifier & 7) * 0x111000;
+        config.operations[0] = 0x00040004;
+        CHECK(BuildProgram(vertex_shader, config));
+    }
+
+    for (u32 operation = 0; operation < 16; operation++) {
+        for (u32 scale = 0; scale < 4; scale++) {
+            GLShaderGen::FragmentConfig config = PassthroughConfig();
+            config.sources[0] = 0x0E300E30;
+            config.operations[0] = operation * 0x00010001;
+            config.scales[0] = scale * 0x00010001;
+            CHECK(BuildProgram(vertex_shader, config));
+        }
+    }
+
+    srand(1);
+    for (int i = 0; i < 32; i++) {
+        GLShaderGen::FragmentConfig config;
+        config.texture_enable = rand() & 0x7;
+        config.buffer_update = rand() & 0xFF00;
+        for (int stage = 0; stage < NUM_TEV_STAGES; stage++) {
+            config.sources[stage] = (rand() | rand() << 16) & 0x0FFF0FFF;
+            config.modifiers[stage] = (rand() | rand() << 16) & 0x777FFF;
+            config.operations[stage] = (rand() | rand() << 16) & 0x000F000F;
+            config.scales[stage] = (rand() | rand() << 16) & 0x00030003;
+        }
+        CHECK(BuildProgram(vertex_shader, config));
+    }
+
+    glDeleteShader(vertex_shader);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Drawing through the command processor
+
+/// Converts a float to the 24-bit floats of the registers
+static u32 ToFloat24(float value) {
+    if (value == 0.0f)
+        return 0;
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const u32 sign = bits >> 31;
+    const u32 exponent = ((bits >> 23) & 0xFF) - 64;
+    const u32 mantissa = (bits >> 7) & 0xFFFF;
+    return (sign << 23) | (exponent << 16) | mantissa;
+}
+
+static void WriteRegister(u32 id, u32 value) {
+    u32 command_list[2] = { value, (0xFu << 16) | id };
+    CommandProcessor::ProcessCommandList(command_list, ARRAY_SIZE(command_list));
+}
+
+static void SetTevStage(int stage, u32 source, u32 modifier, u32 operation, u32 color, u32 scale) {
+    WriteRegister(TexEnvRegister(Regs::TexEnv0Source, stage), source);
+    WriteRegister(TexEnvRegister(Regs::TexEnv0Modifier, stage), modifier);
+    WriteRegister(TexEnvRegister(Regs::TexEnv0Operation, stage), operation);
+    WriteRegister(TexEnvRegister(Regs::TexEnv0Color, stage), color);
+    WriteRegister(TexEnvRegister(Regs::TexEnv0Scale, stage), scale);
+}
+
+/// Uploads a vertex shader program that copies the position, color and texcoord0 inputs to the
+/// outputs of the same index
+static void LoadPassthroughShader() {
+    static const u32 MOV = 0x13u << 26;
+    static const u32 END = 0x22u << 26;
+    const u32 command_list[] = {
+        0, (0xFu << 16) | Regs::VSBeginLoadProgramData,
+        MOV | (0 << 21) | (0 << 12), (0xFu << 16) | Regs::VSLoadProgramData,
+        MOV | (1 << 21) | (1 << 12), (0xFu << 16) | Regs::VSLoadProgramData,
+        MOV | (2 << 21) | (2 << 12), (0xFu << 16) | Regs::VSLoadProgramData,
+        END, (0xFu << 16) | Regs::VSLoadProgramData,
+        // Operand descriptor 0: write xyzw, identity swizzles
+        0, (0xFu << 16) | Regs::VSBeginLoadSwizzleData,
+        0xF | (0x1B << 5) | (0x1B << 14) | (0x1Bu << 23), (0xFu << 16) | Regs::VSLoadSwizzleData,
+        0x7, (0xFu << 16) | Regs::VSOutputMask,
+        0x76543210, (0xFu << 16) | Regs::VSInputRegisterMap,
+        0xFEDCBA98, (0xFu << 16) | (Regs::VSInputRegisterMap + 1),
+        0, (0xFu << 16) | Regs::VSMainOffset,
+    };
+    CommandProcessor::ProcessCommandList(command_list, ARRAY_SIZE(command_list));
+}
+
+/**
+ * Sets up a draw to the RGBA8 color buffer, with a D24S8 depth buffer and the combiner stages
+ * passing the primary color through
+ * @param num_vertices Number of vertices in the vertex array
+ */
+static void SetupDraw(u32 num_vertices) {
+    WriteRegister(Regs::ViewportSizeX, ToFloat24(WIDTH / 2.0f));
+    WriteRegister(Regs::ViewportSizeY, ToFloat24(HEIGHT / 2.0f));
+    WriteRegister(Regs::ViewportCorner, 0);
+    WriteRegister(Regs::ViewportDepthRange, ToFloat24(1.0f));
+    WriteRegister(Regs::ViewportDepthNearPlane, 0);
+
+    WriteRegister(Regs::ColorBufferFormat, 0);
+    WriteRegister(Regs::ColorBufferAddress, COLOR_BUFFER_ADDRESS / 8);
+    WriteRegister(Regs::ColorBufferSize, WIDTH | (HEIGHT << 12));
+    WriteRegister(Regs::DepthBufferFormat, 3);
+    WriteRegister(Regs::DepthBufferAddress, DEPTH_BUFFER_ADDRESS / 8);
+    WriteRegister(Regs::DepthColorMask, 0xF00);  // Color writes only
+
+    // Three float attributes, with 4, 4 and 2 components, loaded from one array
+    WriteRegister(Regs::VertexArrayBaseAddr, VERTEX_ARRAY_ADDRESS / 8);
+    WriteRegister(Regs::VertexDescriptor, 0xF | (0xF << 4) | (0x7 << 8));
+    WriteRegister(Regs::VertexDescriptor + 1, (2u << 28) | (0x7 << 16));
+    WriteRegister(Regs::VertexAttributeOffset, 0);
+    WriteRegister(Regs::VertexAttributeInfo0, 0x210);
+    WriteRegister(Regs::VertexAttributeInfo1, (VERTEX_SIZE << 16) | (3u << 28));
+
+    // Output 0 is the position, 1 the color, 2 the texture coordinate 0
+    WriteRegister(VertexOutputMap(0), 0x03020100);
+    WriteRegister(VertexOutputMap(1), 0x0B0A0908);
+    WriteRegister(VertexOutputMap(2), 0x1F1F0D0C);
+    for (int i = 3; i < 7; i++) {
+        WriteRegister(VertexOutputMap(i), 0x1F1F1F1F);
+    }
+
+    WriteRegister(Regs::TextureUnitsConfig, 0);
+    SetTevStage(0, 0, 0, 0, 0, 0);
+    for (int stage = 1; stage < NUM_TEV_STAGES; stage++) {
+        SetTevStage(stage, 0x0FFF0FFF, 0, 0, 0, 0);
+    }
+
+    WriteRegister(Regs::NumVertices, num_vertices);
+    WriteRegister(Regs::TriangleTopology, 1 << 8);  // Triangle strip
+}
+
+/**
+ * Writes a vertex of the vertex array
+ * @param index Index of the vertex
+ * @param x X in pixels
+ * @param y Y in pixels, from the bottom
+ * @param w W of the vertex, which the position is multiplied with
+ */
+static void SetVertex(u32 index, float x, float y, float w, float r, float g, float b, float a) {
+    float* vertex = (float*)Memory::GetPhysicalPointer(VERTEX_ARRAY_ADDRESS + index * VERTEX_SIZE);
+    vertex[0] = (x / (WIDTH / 2.0f) - 1.0f) * w;
+    vertex[1] = (y / (HEIGHT / 2.0f) - 1.0f) * w;
+    vertex[2] = 0.0f;
+    vertex[3] = w;
+    vertex[4] = r;
+    vertex[5] = g;
+    vertex[6] = b;
+    vertex[7] = a;
+    vertex[8] = 0.0f;
+    vertex[9] = 0.0f;
+}
+
+/// Draws a rectangle of one color, in pixels from the bottom left corner
+static void DrawRectangle(float x0, float y0, float x1, float y1, float r, float g, float b) {
+    SetupDraw(4);
+    SetVertex(0, x0, y0, 1.0f, r, g, b, 1.0f);
+    SetVertex(1, x1, y0, 1.0f, r, g, b, 1.0f);
+    SetVertex(2, x0, y1, 1.0f, r, g, b, 1.0f);
+    SetVertex(3, x1, y1, 1.0f, r, g, b, 1.0f);
+    WriteRegister(Regs::TriggerDraw, 1);
+}
+
+static u8* GetColorBuffer() {
+    return Memory::GetPhysicalPointer(COLOR_BUFFER_ADDRESS);
+}
+
+/// Gets a pixel of the color buffer in emulated memory, as RGBA8 with R in the top byte
+static u32 GetPixel(u32 x, u32 y) {
+    u32 pixel;
+    memcpy(&pixel, GetColorBuffer() + VideoCore::GetMortonOffset(x, HEIGHT - 1 - y, WIDTH, 4),
+        sizeof(pixel));
+    return pixel;
+}
+
+/// Writes the surfaces of the hardware rasterizer back to emulated memory
+static void FlushAll() {
+    HWRasterizer::FlushRegion(COLOR_BUFFER_ADDRESS, WIDTH * HEIGHT * 4);
+}
+
+/// Sets the color buffer in emulated memory to a value, dropping what the rasterizer holds of it
+static void ClearColorBuffer(u8 value) {
+    HWRasterizer::InvalidateRegion(COLOR_BUFFER_ADDRESS, WIDTH * HEIGHT * 4);
+    memset(GetColorBuffer(), value, WIDTH * HEIGHT * 4);
+}
+
+/// Draws a rectangle, which must only reach memory once flushed, and checks its coverage
+static void TestRectangle() {
+    ClearColorBuffer(0);
+    DrawRectangle(64, 32, 192, 96, 1.0f, 0.0f, 0.0f);
+    CHECK(GetPixel(100, 50) == 0);
+
+    FlushAll();
+    int wrong_pixels = 0;
+    for (u32 y = 0; y < HEIGHT; y++) {
+        for (u32 x = 0; x < WIDTH; x++) {
+            const bool inside = x >= 64 && x < 192 && y >= 32 && y < 96;
+            if (GetPixel(x, y) != (inside ? 0xFF0000FF : 0))
+                wrong_pixels++;
+        }
+    }
+    CHECK(wrong_pixels == 0);
+}
+
+/// Modulates the primary color with the constant color of the first stage, scaled by 2
+static void TestCombiner() {
+    ClearColorBuffer(0);
+    SetupDraw(4);
+    // Color: primary * constant, alpha: primary
+    SetTevStage(0, 0x000000E0, 0, 0x00000001, 0xFF4080C0, 0x00000001);
+    SetVertex(0, 0, 0, 1.0f, 0.5f, 0.5f, 0.5f, 1.0f);
+    SetVertex(1, 32, 0, 1.0f, 0.5f, 0.5f, 0.5f, 1.0f);
+    SetVertex(2, 0, 32, 1.0f, 0.5f, 0.5f, 0.5f, 1.0f);
+    SetVertex(3, 32, 32, 1.0f, 0.5f, 0.5f, 0.5f, 1.0f);
+    WriteRegister(Regs::TriggerDraw, 1);
+    FlushAll();
+
+    // The constant color is stored as ABGR, so this is 0.5 * 2 * (0xC0, 0x80, 0x40)
+    const u32 pixel = GetPixel(10, 10);
+    CHECK(abs((int)(pixel >> 24) - 0xC0) <= 1);
+    CHECK(abs((int)((pixel >> 16) & 0xFF) - 0x80) <= 1);
+    CHECK(abs((int)((pixel >> 8) & 0xFF) - 0x40) <= 1);
+    CHECK((pixel & 0xFF) == 0xFF);
+}
+
+/// Draws a quad with a different color and w at each corner
+static void DrawGradient() {
+    SetupDraw(4);
+    SetVertex(0, 16, 8, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f);
+    SetVertex(1, 240, 8, 2.0f, 0.0f, 1.0f, 0.0f, 1.0f);
+    SetVertex(2, 16, 120, 1.5f, 0.0f, 0.0f, 1.0f, 1.0f);
+    SetVertex(3, 240, 120, 1.0f, 1.0f, 1.0f, 1.0f, 0.5f);
+    WriteRegister(Regs::TriggerDraw, 1);
+}
+
+/// Compares the perspective-correct interpolation and coverage with the software rasterizer
+static void TestSameAsSoftware() {
+    ClearColorBuffer(0);
+    DrawGradient();
+    FlushAll();
+    const std::vector<u8> hardware(GetColorBuffer(), GetColorBuffer() + WIDTH * HEIGHT * 4);
+
+    HWRasterizer::Shutdown();
+    CHECK(!HWRasterizer::IsEnabled());
+    memset(GetColorBuffer(), 0, WIDTH * HEIGHT * 4);
+    DrawGradient();
+    const u8* software = GetColorBuffer();
+
+    int coverage_differences = 0;
+    int max_difference = 0;
+    for (u32 i = 0; i < WIDTH * HEIGHT * 4; i += 4) {
+        const bool hardware_covered = memcmp(&hardware[i], "\0\0\0\0", 4) != 0;
+        const bool software_covered = memcmp(&software[i], "\0\0\0\0", 4) != 0;
+        if (hardware_covered != software_covered) {
+            coverage_differences++;
+            continue;
+        }
+        for (int channel = 0; channel < 4; channel++) {
+            max_difference = std::max(max_difference,
+                abs((int)hardware[i + channel] - (int)software[i + channel]));
+        }
+    }
+    CHECK(coverage_differences == 0);
+    CHECK(max_difference <= 2);
+
+    HWRasterizer::Init();
+    CHECK(HWRasterizer::IsEnabled());
+}
+
+/// Checks that InvalidateRegion drops unflushed drawing, and writes back what is outside of it
+static void TestInvalidate() {
+    ClearColorBuffer(0);
+    DrawRectangle(0, 0, 64, 64, 1.0f, 0.0f, 0.0f);
+    // Memory is then overwritten, e.g. by a memory fill
+    ClearColorBuffer(0x11);
+    DrawRectangle(128, 0, 136, 8, 0.0f, 1.0f, 0.0f);
+    FlushAll();
+    CHECK(GetPixel(10, 10) == 0x11111111);
+    CHECK(GetPixel(130, 4) == 0x00FF00FF);
+
+    // Only the first 16 pixels are invalidated, the rest of the buffer must be written back
+    DrawRectangle(0, 0, WIDTH, HEIGHT, 0.0f, 0.0f, 1.0f);
+    HWRasterizer::InvalidateRegion(COLOR_BUFFER_ADDRESS, 64);
+    CHECK(GetPixel(200, 100) == 0x0000FFFF);
+}
+
+/// Checks that a CPU write to a buffer the rasterizer holds makes it load the buffer again
+static void TestReloadAfterWrite() {
+    ClearColorBuffer(0);
+    DrawRectangle(0, 0, 8, 8, 1.0f, 0.0f, 0.0f);
+    FlushAll();
+
+    const u32 offset = VideoCore::GetMortonOffset(100, HEIGHT - 1 - 100, WIDTH, 4);
+    Memory::Write32(Memory::VirtualAddressFromPhysical_VRAM(COLOR_BUFFER_ADDRESS + offset),
+        0xDEADBEEF);
+    DrawRectangle(200, 0, 208, 8, 0.0f, 1.0f, 0.0f);
+    FlushAll();
+    CHECK(GetPixel(100, 100) == 0xDEADBEEF);
+    CHECK(GetPixel(4, 4) == 0xFF0000FF);
+    CHECK(GetPixel(204, 4) == 0x00FF00FF);
+}
+
+/// Checks that a CPU read of a buffer the rasterizer drew to sees the drawing without a flush
+static void TestReadAfterDraw() {
+    ClearColorBuffer(0);
+    DrawRectangle(0, 0, 8, 8, 1.0f, 0.0f, 0.0f);
+    CHECK(GetPixel(4, 4) == 0);
+
+    const u32 offset = VideoCore::GetMortonOffset(4, HEIGHT - 1 - 4, WIDTH, 4);
+    const u32 address = Memory::VirtualAddressFromPhysical_VRAM(COLOR_BUFFER_ADDRESS + offset);
+    CHECK(Memory::Read32(address) == 0xFF0000FF);
+    CHECK(GetPixel(4, 4) == 0xFF0000FF);
+
+    // Drawing again makes the next read write the buffer back again
+    DrawRectangle(0, 0, 8, 8, 0.0f, 1.0f, 0.0f);
+    CHECK(Memory::Read32(address) == 0x00FF00FF);
+    CHECK(Memory::Read8(address) == 0xFF);
+}
+
+int main() {
+    if (!CreateOffscreenContext()) {
+        fprintf(stderr, "No offscreen OpenGL 3.2 context, skipping\n");
+        return SKIP_RETURN_CODE;
+    }
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        fprintf(stderr, "glewInit failed, skipping\n");
+        return SKIP_RETURN_CODE;
+    }
+
+    TestShaderGeneration();
+
+    Memory::Init();
+    CommandProcessor::Init();
+    VertexShader::Init();
+    Rasterizer::Init();
+    TextureCache::Init();
+    HWRasterizer::Init();
+    CHECK(HWRasterizer::IsEnabled());
+    LoadPassthroughShader();
+
+    TestRectangle();
+    TestCombiner();
+    TestSameAsSoftware();
+    TestInvalidate();
+    TestReloadAfterWrite();
+    TestReadAfterDraw();
+
+    HWRasterizer::Shutdown();
+    TextureCache::Shutdown();
+    Rasterizer::Shutdown();
+    VertexShader::Shutdown();
+    CommandProcessor::Shutdown();
+    Memory::Shutdown();
+    return g_failures;
+}
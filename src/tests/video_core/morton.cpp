@@ -0,0 +1,144 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "common/common.h"
+
+#include "video_core/morton.h"
+
+#include "tests/tests.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Checks the Morton codec against a pixel by pixel conversion with GetMortonOffset, for every
+// pixel size, with aligned tiled surfaces (which the SIMD kernels handle on x64) and unaligned
+// ones (which always take the scalar path), and with flipped linear rows.
+
+/// Bytes around each buffer that the codec must leave alone
+static const u32 GUARD_SIZE = 64;
+
+/// Value of the guard bytes
+static const u8 GUARD_BYTE = 0xA5;
+
+/// A buffer with guard bytes on both sides, whose data starts at a chosen alignment
+class GuardedBuffer {
+public:
+    /**
+     * @param size Size of the data in bytes
+     * @param misalignment Offset of the data from a 16-byte boundary
+     */
+    GuardedBuffer(u32 size, u32 misalignment) : size(size), storage(size + 2 * GUARD_SIZE + 16) {
+        u8* base = &storage[0] + GUARD_SIZE;
+        data = base + ((16 - ((uintptr_t)base & 15)) & 15) + misalignment;
+        memset(&storage[0], GUARD_BYTE, storage.size());
+    }
+
+    /// Whether the bytes outside of the data still hold the guard value
+    bool GuardsIntact() const {
+        for (size_t i = 0; i < storage.size(); i++) {
+            const u8* p = &storage[i];
+            if ((p < data || p >= data + size) && *p != GUARD_BYTE)
+                return false;
+        }
+        return true;
+    }
+
+    u8* data;
+
+private:
+    u32 size;
+    std::vector<u8> storage;
+};
+
+/**
+ * Converts a surface one pixel at a time, as the reference for the codec
+ * @param encode Whether to convert linear rows to the tiled layout, else the other way around
+ */
+static void ReferenceCopy(bool encode, u8* tiled, u8* linear, ptrdiff_t linear_stride, u32 width,
+    u32 height, u32 bytes_per_pixel) {
+
+    for (u32 y = 0; y < height; y++) {
+        for (u32 x = 0; x < width; x++) {
+            u8* tiled_pixel = tiled + VideoCore::GetMortonOffset(x, y, width, bytes_per_pixel);
+            u8* linear_pixel = linear + y * linear_stride + x * bytes_per_pixel;
+            if (encode) {
+                memcpy(tiled_pixel, linear_pixel, bytes_per_pixel);
+            } else {
+                memcpy(linear_pixel, tiled_pixel, bytes_per_pixel);
+            }
+        }
+    }
+}
+
+/**
+ * Decodes and encodes a surface of random pixels and compares with the reference conversion
+ * @param tiled_misalignment Offset of the tiled surface from a 16-byte boundary
+ * @param flip Whether the linear rows are stored bottom up, with a negative stride
+ */
+static void TestRoundTrip(u32 width, u32 height, u32 bytes_per_pixel, u32 tiled_misalignment,
+    bool flip) {
+
+    const u32 surface_size = width * height * bytes_per_pixel;
+    // Pad the linear rows, so that the stride differs from the row size
+    const u32 row_size = width * bytes_per_pixel + 12;
+    const u32 linear_size = row_size * height;
+
+    GuardedBuffer tiled(surface_size, tiled_misalignment);
+    GuardedBuffer expected_tiled(surface_size, 0);
+    GuardedBuffer linear(linear_size, 4);
+    GuardedBuffer expected_linear(linear_size, 4);
+
+    for (u32 i = 0; i < surface_size; i++) {
+        tiled.data[i] = (u8)rand();
+    }
+    memset(linear.data, 0, linear_size);
+    memset(expected_linear.data, 0, linear_size);
+
+    const ptrdiff_t stride = flip ? -(ptrdiff_t)row_size : (ptrdiff_t)row_size;
+    u8* first_row = flip ? linear.data + (height - 1) * row_size : linear.data;
+    u8* expected_first_row =
+        flip ? expected_linear.data + (height - 1) * row_size : expected_linear.data;
+
+    VideoCore::MortonDecode(tiled.data, first_row, stride, width, height, bytes_per_pixel);
+    ReferenceCopy(false, tiled.data, expected_first_row, stride, width, height, bytes_per_pixel);
+    CHECK(memcmp(linear.data, expected_linear.data, linear_size) == 0);
+    CHECK(linear.GuardsIntact());
+
+    // Encoding the decoded surface must give back the original one
+    std::vector<u8> original(tiled.data, tiled.data + surface_size);
+    memset(tiled.data, 0, surface_size);
+    VideoCore::MortonEncode(first_row, stride, tiled.data, width, height, bytes_per_pixel);
+    ReferenceCopy(true, expected_tiled.data, expected_first_row, stride, width, height,
+        bytes_per_pixel);
+    CHECK(memcmp(tiled.data, &original[0], surface_size) == 0);
+    CHECK(memcmp(expected_tiled.data, &original[0], surface_size) == 0);
+    CHECK(tiled.GuardsIntact());
+
+    if (g_failures) {
+        fprintf(stderr, "    with %ux%u, %u bytes per pixel, tiled surface at +%u%s\n", width,
+            height, bytes_per_pixel, tiled_misalignment, flip ? ", flipped" : "");
+    }
+}
+
+int main() {
+    static const u32 sizes[][2] = { { 8, 8 }, { 64, 24 }, { 400, 240 } };
+    static const u32 misalignments[] = { 0, 1, 4, 8 };
+
+    srand(1);
+    for (u32 bytes_per_pixel = 1; bytes_per_pixel <= 4; bytes_per_pixel++) {
+        for (u32 size = 0; size < ARRAY_SIZE(sizes); size++) {
+            for (u32 misalignment = 0; misalignment < ARRAY_SIZE(misalignments); misalignment++) {
+                for (int flip = 0; flip < 2; flip++) {
+                    TestRoundTrip(sizes[size][0], sizes[size][1], bytes_per_pixel,
+                        misalignments[misalignment], flip != 0);
+                    if (g_failures)
+                        return g_failures;
+                }
+            }
+        }
+    }
+    return g_failures;
+}
@@ -0,0 +1,92 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "common/common.h"
+
+#include "video_core/morton.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Measures the Morton codec on a top screen sized surface and on a large texture, for each pixel
+// size. The aligned runs use the SIMD kernels where there are some, the unaligned ones the scalar
+// tile copy, and the per-pixel runs convert with GetMortonOffset as the texture decoder used to.
+
+/// Surfaces converted per measurement
+static const int ITERATIONS = 200;
+
+/// Converts a surface one pixel at a time
+static void PerPixelDecode(const u8* tiled, u8* linear, ptrdiff_t linear_stride, u32 width,
+    u32 height, u32 bytes_per_pixel) {
+
+    for (u32 y = 0; y < height; y++) {
+        for (u32 x = 0; x < width; x++) {
+            const u32 offset = VideoCore::GetMortonOffset(x, y, width, bytes_per_pixel);
+            memcpy(linear + y * linear_stride + x * bytes_per_pixel, tiled + offset,
+                bytes_per_pixel);
+        }
+    }
+}
+
+/**
+ * Runs a conversion of a surface several times
+ * @return Throughput in megabytes of surface per second
+ */
+template <typename F>
+static double Measure(u32 surface_size, F convert) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        convert();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    return (double)surface_size * ITERATIONS / elapsed.count() / (1024 * 1024);
+}
+
+static void Benchmark(u32 width, u32 height, u32 bytes_per_pixel) {
+    const u32 surface_size = width * height * bytes_per_pixel;
+    const ptrdiff_t stride = width * bytes_per_pixel;
+
+    // Tiled surfaces at a 16-byte boundary and one byte past it
+    std::vector<u8> tiled_storage(surface_size + 32);
+    u8* aligned = &tiled_storage[0] + ((16 - ((uintptr_t)&tiled_storage[0] & 15)) & 15);
+    u8* unaligned = aligned + 1;
+    std::vector<u8> linear(surface_size);
+    for (size_t i = 0; i < tiled_storage.size(); i++) {
+        tiled_storage[i] = (u8)rand();
+    }
+
+    const double decode_aligned = Measure(surface_size, [&] {
+        VideoCore::MortonDecode(aligned, &linear[0], stride, width, height, bytes_per_pixel);
+    });
+    const double encode_aligned = Measure(surface_size, [&] {
+        VideoCore::MortonEncode(&linear[0], stride, aligned, width, height, bytes_per_pixel);
+    });
+    const double decode_unaligned = Measure(surface_size, [&] {
+        VideoCore::MortonDecode(unaligned, &linear[0], stride, width, height, bytes_per_pixel);
+    });
+    const double decode_flipped = Measure(surface_size, [&] {
+        VideoCore::MortonDecode(aligned, &linear[(height - 1) * stride], -stride, width, height,
+            bytes_per_pixel);
+    });
+    const double decode_per_pixel = Measure(surface_size, [&] {
+        PerPixelDecode(aligned, &linear[0], stride, width, height, bytes_per_pixel);
+    });
+
+    printf("%4ux%-4u %u Bpp  decode %8.0f  encode %8.0f  unaligned %8.0f  flipped %8.0f  "
+        "per-pixel %8.0f MB/s\n", width, height, bytes_per_pixel, decode_aligned, encode_aligned,
+        decode_unaligned, decode_flipped, decode_per_pixel);
+}
+
+int main() {
+    srand(1);
+    for (u32 bytes_per_pixel = 1; bytes_per_pixel <= 4; bytes_per_pixel++) {
+        Benchmark(400, 240, bytes_per_pixel);
+        Benchmark(1024, 1024, bytes_per_pixel);
+    }
+    return 0;
+}
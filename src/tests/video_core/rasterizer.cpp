@@ -0,0 +1,207 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "common/common.h"
+#include "common/cpu_detect.h"
+
+#include "core/mem_map.h"
+
+#include "video_core/command_processor.h"
+#include "video_core/pica.h"
+#include "video_core/rasterizer.h"
+#include "video_core/texture_cache.h"
+#include "video_core/vertex_shader.h"
+
+#include "tests/tests.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Draws the same random triangles with the software rasterizer using AVX2 and using SSE2, into
+// every color buffer format, and checks that both give the same pixels. The triangles cover partial
+// spans at both ends of the eight and four pixel groups, and some are clipped. Also checks that two
+// triangles covering the viewport draw every pixel exactly once, with both code paths.
+
+using namespace Pica;
+
+typedef Regs::Struct<Regs::ColorBufferFormat>::Format ColorFormat;
+
+static const u32 WIDTH = 240;
+static const u32 HEIGHT = 400;
+
+static const u32 COLOR_BUFFER_ADDRESS = 0x18000000;   ///< In VRAM, physical address
+
+/// Number of random triangles drawn into each color buffer format
+static const int NUM_TRIANGLES = 400;
+
+/// Value the color buffer is cleared to before drawing
+static const u8 CLEAR_BYTE = 0x5A;
+
+/// Converts a float to the 24-bit floats of the registers
+static u32 ToFloat24(float value) {
+    if (value == 0.0f)
+        return 0;
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const u32 sign = bits >> 31;
+    const u32 exponent = ((bits >> 23) & 0xFF) - 64;
+    const u32 mantissa = (bits >> 7) & 0xFFFF;
+    return (sign << 23) | (exponent << 16) | mantissa;
+}
+
+static void WriteRegister(u32 id, u32 value) {
+    u32 command_list[2] = { value, (0xFu << 16) | id };
+    CommandProcessor::ProcessCommandList(command_list, ARRAY_SIZE(command_list));
+}
+
+static u32 GetBytesPerPixel(ColorFormat format) {
+    switch (format) {
+    case ColorFormat::RGBA8:    return 4;
+    case ColorFormat::RGB8:     return 3;
+    default:                    return 2;
+    }
+}
+
+static u8* GetColorBuffer() {
+    return Memory::GetPhysicalPointer(COLOR_BUFFER_ADDRESS);
+}
+
+/// Random float in [min, max]
+static float RandomFloat(float min, float max) {
+    return min + (rand() / (float)RAND_MAX) * (max - min);
+}
+
+/// Random vertex, mostly within the viewport, now and then outside of the guard band or behind
+/// the viewer so that the triangle is clipped
+static VertexShader::OutputVertex RandomVertex() {
+    VertexShader::OutputVertex v;
+    memset(&v, 0, sizeof(v));
+    const float w = (rand() % 16 == 0) ? RandomFloat(-1.0f, 0.1f) : RandomFloat(0.5f, 2.0f);
+    const float extent = (rand() % 8 == 0) ? 3.0f : 1.2f;
+    v.pos[0] = RandomFloat(-extent, extent) * w;
+    v.pos[1] = RandomFloat(-extent, extent) * w;
+    v.pos[2] = RandomFloat(0.0f, 1.0f) * w;
+    v.pos[3] = w;
+    for (int i = 0; i < 4; i++) {
+        v.color[i] = RandomFloat(0.0f, 1.0f);
+    }
+    return v;
+}
+
+/**
+ * Draws the same random triangles with the given code path
+ * @param avx2 Whether to rasterize with AVX2
+ * @param seed Seed of the random triangles
+ * @param size Size of the color buffer in bytes
+ * @return Contents of the color buffer
+ */
+static std::vector<u8> DrawRandomTriangles(bool avx2, unsigned seed, u32 size) {
+    cpu_info.bAVX2 = avx2;
+    memset(GetColorBuffer(), CLEAR_BYTE, size);
+
+    srand(seed);
+    for (int i = 0; i < NUM_TRIANGLES; i++) {
+        // Mostly small triangles, for spans ending anywhere within a group
+        const VertexShader::OutputVertex v0 = RandomVertex();
+        VertexShader::OutputVertex v1 = RandomVertex();
+        VertexShader::OutputVertex v2 = RandomVertex();
+        if (i % 4 != 0) {
+            const float scale = RandomFloat(0.01f, 0.2f);
+            for (int j = 0; j < 2; j++) {
+                v1.pos[j] = v0.pos[j] + (v1.pos[j] - v0.pos[j]) * scale;
+                v2.pos[j] = v0.pos[j] + (v2.pos[j] - v0.pos[j]) * scale;
+            }
+            v1.pos[3] = v2.pos[3] = v0.pos[3];
+        }
+        Rasterizer::AddTriangle(v0, v1, v2);
+    }
+    Rasterizer::Flush();
+
+    return std::vector<u8>(GetColorBuffer(), GetColorBuffer() + size);
+}
+
+/// Draws two triangles covering the viewport in one color
+static std::vector<u8> DrawFullScreen(bool avx2, u32 size) {
+    cpu_info.bAVX2 = avx2;
+    memset(GetColorBuffer(), CLEAR_BYTE, size);
+
+    VertexShader::OutputVertex v[4];
+    memset(v, 0, sizeof(v));
+    for (int i = 0; i < 4; i++) {
+        v[i].pos[0] = (i & 1) ? 1.0f : -1.0f;
+        v[i].pos[1] = (i & 2) ? 1.0f : -1.0f;
+        v[i].pos[3] = 1.0f;
+        v[i].color[0] = v[i].color[1] = v[i].color[2] = v[i].color[3] = 1.0f;
+    }
+    Rasterizer::AddTriangle(v[0], v[1], v[2]);
+    Rasterizer::AddTriangle(v[2], v[1], v[3]);
+    Rasterizer::Flush();
+
+    return std::vector<u8>(GetColorBuffer(), GetColorBuffer() + size);
+}
+
+static void TestFormat(ColorFormat format) {
+    const u32 size = WIDTH * HEIGHT * GetBytesPerPixel(format);
+    WriteRegister(Regs::ColorBufferFormat, (u32)format << 16);
+
+    const bool have_avx2 = cpu_info.bAVX2;
+    for (unsigned seed = 1; seed <= 2; seed++) {
+        const std::vector<u8> sse2 = DrawRandomTriangles(false, seed, size);
+        if (have_avx2) {
+            const std::vector<u8> avx2 = DrawRandomTriangles(true, seed, size);
+            const bool same = (avx2 == sse2);
+            if (!same) {
+                fprintf(stderr, "format %d, seed %u differs\n", (int)format, seed);
+            }
+            CHECK(same);
+        }
+
+        // Something was drawn
+        bool drawn = false;
+        for (u32 i = 0; i < size && !drawn; i++) {
+            drawn = (sse2[i] != CLEAR_BYTE);
+        }
+        CHECK(drawn);
+    }
+
+    // White is all ones in every format, and no pixel must be left uncovered
+    for (int avx2 = have_avx2; avx2 >= 0; avx2--) {
+        const std::vector<u8> full = DrawFullScreen(avx2 != 0, size);
+        bool all_white = true;
+        for (u32 i = 0; i < size; i++) {
+            all_white &= (full[i] == 0xFF);
+        }
+        CHECK(all_white);
+    }
+    cpu_info.bAVX2 = have_avx2;
+}
+
+int main() {
+    Memory::Init();
+    CommandProcessor::Init();
+    VertexShader::Init();
+    Rasterizer::Init();
+    TextureCache::Init();
+
+    WriteRegister(Regs::ViewportSizeX, ToFloat24(WIDTH / 2.0f));
+    WriteRegister(Regs::ViewportSizeY, ToFloat24(HEIGHT / 2.0f));
+    WriteRegister(Regs::ViewportCorner, 0);
+    WriteRegister(Regs::ColorBufferAddress, COLOR_BUFFER_ADDRESS / 8);
+    WriteRegister(Regs::ColorBufferSize, WIDTH | (HEIGHT << 12));
+
+    TestFormat(ColorFormat::RGBA8);
+    TestFormat(ColorFormat::RGB8);
+    TestFormat(ColorFormat::RGB5A1);
+    TestFormat(ColorFormat::RGB565);
+    TestFormat(ColorFormat::RGBA4);
+
+    TextureCache::Shutdown();
+    Rasterizer::Shutdown();
+    VertexShader::Shutdown();
+    CommandProcessor::Shutdown();
+    Memory::Shutdown();
+    return g_failures;
+}
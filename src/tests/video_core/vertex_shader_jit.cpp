@@ -0,0 +1,540 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "common/common.h"
+#include "common/cpu_detect.h"
+#include "common/file_util.h"
+#include "common/hash.h"
+
+#include "video_core/pica.h"
+#include "video_core/vertex_shader.h"
+#include "video_core/vertex_shader_jit.h"
+
+#include "tests/tests.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Runs handwritten and random programs with the interpreter and compiled, from the same random
+// registers and uniforms, and checks that both leave the same registers behind. The handwritten
+// programs cover every arithmetic instruction, indexing by the address registers and aL,
+// conditionals, jumps, calls, nested loops and breaks. Everything runs with and without SSE4.1, and
+// once compiled and once loaded from the disk cache, which is kept in a directory of its own.
+
+using namespace Pica;
+using namespace Pica::VertexShader;
+
+/// Exit code telling CTest that the test was skipped
+static const int SKIP_RETURN_CODE = 77;
+
+/// Number of times each program is run, each time with other registers and uniforms
+static const int NUM_TRIALS = 64;
+
+/// Number of random programs
+static const int NUM_RANDOM_PROGRAMS = 32;
+
+/// Directory the disk cache of the compiled programs is redirected to
+static const std::string DISK_CACHE_DIR = "vertex_shader_jit_cache" DIR_SEP;
+
+/// File of the disk cache in DISK_CACHE_DIR
+static const std::string DISK_CACHE_FILE = "vertex_shaders_x64.cache";
+
+// Component selectors and destination masks
+static const u32 XYZW = 0x1B;
+static const u32 WZYX = 0xE4;
+static const u32 XXXX = 0x00;
+static const u32 YYYY = 0x55;
+static const u32 ZXYW = 0x87;
+static const u32 MASK_XYZW = 0xF;
+static const u32 MASK_X = 0x8;
+static const u32 MASK_XY = 0xC;
+static const u32 MASK_XZ = 0xA;
+static const u32 MASK_YW = 0x5;
+
+static ProgramMemory g_program;
+static u32 g_num_swizzles;
+static u32 g_pc;
+static ShaderUniforms g_uniforms;
+
+/// Input register vn as a source
+static u32 V(u32 n) { return SOURCE_INPUT + n; }
+
+/// Temporary register rn as a source or a destination
+static u32 R(u32 n) { return SOURCE_TEMPORARY + n; }
+
+/// Float uniform cn as a source
+static u32 C(u32 n) { return SOURCE_FLOAT_UNIFORM + n; }
+
+/// Output register on as a destination
+static u32 O(u32 n) { return DEST_OUTPUT + n; }
+
+/// Starts a new program
+static void Clear() {
+    memset(&g_program, 0, sizeof(g_program));
+    g_num_swizzles = 0;
+    g_pc = 0;
+}
+
+/// Adds an operand descriptor to the swizzle memory and returns its index
+static u32 Swizzle(u32 dest_mask, u32 src1_selector, u32 src2_selector = XYZW,
+    bool negate_src1 = false, bool negate_src2 = false, u32 src3_selector = XYZW) {
+
+    SwizzlePattern swizzle;
+    swizzle.hex = 0;
+    swizzle.dest_mask = dest_mask;
+    swizzle.src1_selector = src1_selector;
+    swizzle.src2_selector = src2_selector;
+    swizzle.src3_selector = src3_selector;
+    swizzle.negate_src1 = negate_src1;
+    swizzle.negate_src2 = negate_src2;
+    g_program.swizzle_data[g_num_swizzles] = swizzle.hex;
+    return g_num_swizzles++;
+}
+
+/// Appends an instruction and returns its address
+static u32 Emit(u32 instr_hex) {
+    g_program.code[g_pc] = instr_hex;
+    return g_pc++;
+}
+
+/// Encodes an arithmetic instruction, where src1 of the inverted forms is the short source
+static u32 Arithmetic(u32 op, u32 dest, u32 src1, u32 src2, u32 swizzle,
+    u32 address_register_index = 0) {
+
+    Instruction instr;
+    instr.hex = 0;
+    instr.opcode = op;
+    if (op >= OP_DPHI && op <= OP_SLTI) {
+        instr.common.src1i = src1;
+        instr.common.src2i = src2;
+    } else {
+        instr.common.src1 = src1;
+        instr.common.src2 = src2;
+    }
+    instr.common.dest = dest;
+    instr.common.address_register_index = address_register_index;
+    instr.common.operand_desc_id = swizzle;
+    return instr.hex;
+}
+
+/// Encodes MAD, or MADI if inverted, computing src1 * src2 + src3
+static u32 Mad(bool inverted, u32 dest, u32 src1, u32 src2, u32 src3, u32 swizzle,
+    u32 address_register_index = 0) {
+
+    Instruction instr;
+    instr.hex = 0;
+    instr.opcode = inverted ? OP_MADI : OP_MAD;
+    instr.mad.src1 = src1;
+    if (inverted) {
+        instr.mad.src2i = src2;
+        instr.mad.src3i = src3;
+    } else {
+        instr.mad.src2 = src2;
+        instr.mad.src3 = src3;
+    }
+    instr.mad.dest = dest;
+    instr.mad.address_register_index = address_register_index;
+    instr.mad.operand_desc_id = swizzle;
+    return instr.hex;
+}
+
+/// Encodes a CMP, setting the conditional code from the x and y components of the sources
+static u32 Compare(CompareOp op_x, CompareOp op_y, u32 src1, u32 src2, u32 swizzle,
+    u32 address_register_index = 0) {
+
+    Instruction instr;
+    instr.hex = 0;
+    instr.opcode = OP_CMP;
+    instr.compare.src1 = src1;
+    instr.compare.src2 = src2;
+    instr.compare.address_register_index = address_register_index;
+    instr.compare.operand_desc_id = swizzle;
+    instr.compare.op_x = op_x;
+    instr.compare.op_y = op_y;
+    return instr.hex;
+}
+
+/// Encodes an unconditional flow control instruction
+static u32 FlowControl(u32 op, u32 dest = 0, u32 num_instructions = 0) {
+    Instruction instr;
+    instr.hex = 0;
+    instr.opcode = op;
+    instr.flow_control.dest_offset = dest;
+    instr.flow_control.num_instructions = num_instructions;
+    return instr.hex;
+}
+
+/// Encodes a flow control instruction conditional on the conditional code
+static u32 Conditional(u32 op, u32 dest, u32 num_instructions, FlowControlOp condition, u32 refx,
+    u32 refy) {
+
+    Instruction instr;
+    instr.hex = FlowControl(op, dest, num_instructions);
+    instr.flow_control.op = condition;
+    instr.flow_control.refx = refx;
+    instr.flow_control.refy = refy;
+    return instr.hex;
+}
+
+/// Encodes a flow control instruction conditional on a bool uniform
+static u32 UniformConditional(u32 op, u32 dest, u32 num_instructions, u32 bool_uniform_id) {
+    Instruction instr;
+    instr.hex = FlowControl(op, dest, num_instructions);
+    instr.flow_control.bool_uniform_id = bool_uniform_id;
+    return instr.hex;
+}
+
+/// Encodes a LOOP whose body ends with the instruction at last
+static u32 Loop(u32 int_uniform_id, u32 last) {
+    Instruction instr;
+    instr.hex = FlowControl(OP_LOOP, last);
+    instr.flow_control.int_uniform_id = int_uniform_id;
+    return instr.hex;
+}
+
+/// Random float in [-4, 4], in steps of 1/8 now and then so that comparisons find equal values
+static float RandomFloat() {
+    if (rand() % 4 == 0)
+        return (rand() % 65 - 32) / 8.0f;
+    return (rand() / (float)RAND_MAX) * 8.0f - 4.0f;
+}
+
+/// Fills the registers and the uniforms with random values
+static void Randomize(UnitState& state) {
+    memset(&state, 0, sizeof(state));
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 4; j++) {
+            state.input[i][j] = RandomFloat();
+            state.temporary[i][j] = RandomFloat();
+            state.output[i][j] = RandomFloat();
+        }
+    }
+    // Equal inputs for the EQUAL and NOT_EQUAL comparisons now and then
+    if (rand() % 2) {
+        memcpy(state.input[7], state.input[6], sizeof(state.input[6]));
+    }
+    for (int i = 0; i < 3; i++) {
+        state.address[i] = rand() % 16 - 8;
+    }
+    state.conditional_code[0] = rand() % 2;
+    state.conditional_code[1] = rand() % 2;
+
+    for (int i = 0; i < 128; i++) {
+        for (int j = 0; j < 4; j++) {
+            g_uniforms.f[i][j] = RandomFloat();
+        }
+    }
+    for (int i = 0; i < NUM_BOOL_UNIFORMS; i++) {
+        g_uniforms.b[i] = rand() % 2;
+    }
+    for (int i = 0; i < 4; i++) {
+        Regs::Struct<Regs::VSIntUniform0> loop;
+        loop.hex = 0;
+        loop.count = rand() % 8;
+        loop.start = rand() % 128;
+        loop.increment = rand() % 5;
+        g_uniforms.i[i] = loop.hex;
+    }
+}
+
+/// Whether two floats have the same bits, or are both NaN
+static bool SameFloat(float a, float b) {
+    return memcmp(&a, &b, sizeof(float)) == 0 || (std::isnan(a) && std::isnan(b));
+}
+
+static bool SameState(const UnitState& a, const UnitState& b) {
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 4; j++) {
+            if (!SameFloat(a.input[i][j], b.input[i][j]) ||
+                !SameFloat(a.temporary[i][j], b.temporary[i][j]) ||
+                !SameFloat(a.output[i][j], b.output[i][j]))
+                return false;
+        }
+    }
+    return memcmp(a.address, b.address, sizeof(a.address)) == 0 &&
+        memcmp(a.conditional_code, b.conditional_code, sizeof(a.conditional_code)) == 0;
+}
+
+/**
+ * Compiles the current program and runs it against the interpreter
+ * @param name Name of the program, for the failure messages
+ * @param entry Entry point
+ */
+static void Check(const char* name, u32 entry) {
+    const u64 hash = GetHash64((const u8*)&g_program, sizeof(g_program), 0);
+    VertexShaderJit::CompiledShader shader = VertexShaderJit::GetShader(g_program, entry, hash);
+    CHECK(shader != NULL);
+    if (shader == NULL) {
+        fprintf(stderr, "%s: not compiled\n", name);
+        return;
+    }
+
+    for (int trial = 0; trial < NUM_TRIALS; trial++) {
+        UnitState interpreted, compiled;
+        Randomize(interpreted);
+        memcpy(&compiled, &interpreted, sizeof(compiled));
+
+        RunInterpreter(interpreted, g_uniforms, g_program, entry);
+        shader(&compiled, &g_uniforms);
+
+        // Only the first difference of each program is reported
+        const bool same = SameState(interpreted, compiled);
+        CHECK(same);
+        if (!same) {
+            fprintf(stderr, "%s: trial %d differs%s\n", name, trial,
+                cpu_info.bSSE4_1 ? "" : " without SSE4.1");
+            break;
+        }
+    }
+}
+
+/// Every arithmetic instruction, with swizzles, negation and partial destination masks
+static void TestArithmetic() {
+    Clear();
+    const u32 all = Swizzle(MASK_XYZW, XYZW, XYZW);
+    const u32 negated = Swizzle(MASK_XYZW, WZYX, ZXYW, true, false);
+    const u32 xz = Swizzle(MASK_XZ, XXXX, YYYY, false, true);
+    const u32 yw = Swizzle(MASK_YW, ZXYW, WZYX, true, true);
+    const u32 x = Swizzle(MASK_X, YYYY, XYZW);
+
+    static const u32 binary_ops[] = {
+        OP_ADD, OP_DP3, OP_DP4, OP_DPH, OP_DST, OP_MUL, OP_SGE, OP_SLT, OP_MAX, OP_MIN,
+    };
+    static const u32 unary_ops[] = {
+        OP_EX2, OP_LG2, OP_LIT, OP_FLR, OP_RCP, OP_RSQ, OP_MOV,
+    };
+    static const u32 inverted_ops[] = {
+        OP_DPHI, OP_DSTI, OP_SGEI, OP_SLTI,
+    };
+    const u32 swizzles[] = { all, negated, xz, yw, x };
+
+    for (int i = 0; i < (int)ARRAY_SIZE(binary_ops); i++) {
+        for (int j = 0; j < (int)ARRAY_SIZE(swizzles); j++) {
+            Emit(Arithmetic(binary_ops[i], R(j), C(i * 5 + j), V(j), swizzles[j]));
+        }
+        Emit(Arithmetic(binary_ops[i], O(i), R(i % 5), R((i + 1) % 5), all));
+    }
+    for (int i = 0; i < (int)ARRAY_SIZE(unary_ops); i++) {
+        for (int j = 0; j < (int)ARRAY_SIZE(swizzles); j++) {
+            Emit(Arithmetic(unary_ops[i], R(5 + j), (j % 2) ? V(i) : C(60 + i), 0, swizzles[j]));
+        }
+        Emit(Arithmetic(unary_ops[i], O(10 + i % 6), R(5 + i % 5), 0, all));
+    }
+    for (int i = 0; i < (int)ARRAY_SIZE(inverted_ops); i++) {
+        for (int j = 0; j < (int)ARRAY_SIZE(swizzles); j++) {
+            Emit(Arithmetic(inverted_ops[i], R(10 + i), V(j), C(70 + i * 5 + j), swizzles[j]));
+        }
+    }
+    Emit(Mad(false, O(8), R(0), C(90), R(1), all));
+    Emit(Mad(false, R(14), V(2), R(3), V(4), negated));
+    Emit(Mad(true, O(9), V(5), R(6), C(91), xz));
+    Emit(Mad(true, R(15), R(7), V(8), R(9), yw));
+    Emit(FlowControl(OP_END));
+    Check("arithmetic", 0);
+}
+
+/// Uniforms indexed by a0.x and a0.y, wrapping around the end of the uniforms both ways
+static void TestAddressRegisters() {
+    Clear();
+    const u32 all = Swizzle(MASK_XYZW, XYZW, XYZW);
+    const u32 mova_xy = Swizzle(MASK_XY, XYZW);
+    const u32 mova_x = Swizzle(MASK_X, YYYY);
+    const u32 mova_y = Swizzle(MASK_YW, WZYX);
+
+    Emit(Arithmetic(OP_MOVA, 0, V(0), 0, mova_xy));
+    Emit(Arithmetic(OP_ADD, O(0), C(10), V(1), all, 1));
+    Emit(Arithmetic(OP_MUL, O(1), C(90), R(0), all, 2));
+    Emit(Arithmetic(OP_MOVA, 0, C(5), 0, mova_x));
+    Emit(Arithmetic(OP_DP4, O(2), C(3), V(3), all, 1));
+    Emit(Mad(false, O(3), V(0), C(50), R(1), all, 2));
+    Emit(Mad(true, O(4), V(0), R(2), C(60), all, 1));
+    Emit(Arithmetic(OP_SGEI, O(5), V(1), C(0), all, 1));
+    Emit(Arithmetic(OP_MOVA, 0, V(3), 0, mova_y));
+    Emit(Arithmetic(OP_DPHI, O(6), R(3), C(95), all, 2));
+    Emit(Arithmetic(OP_MOV, O(7), C(1), 0, all, 2));
+    Emit(Compare(COMPARE_LESS_THAN, COMPARE_GREATER_EQUAL, C(20), V(4), all, 1));
+    Emit(FlowControl(OP_END));
+    Check("address registers", 0);
+}
+
+/// IFC and IFU with and without else blocks, JMPC, JMPU, CALLC and CALLU on every condition
+static void TestConditionals() {
+    Clear();
+    const u32 all = Swizzle(MASK_XYZW, XYZW, XYZW);
+    const u32 cmp = Swizzle(MASK_XYZW, XYZW, YYYY);
+
+    Emit(Compare(COMPARE_LESS_THAN, COMPARE_GREATER_EQUAL, V(0), V(1), cmp));   // 0
+    Emit(Conditional(OP_IFC, 4, 2, FLOW_AND, 1, 0));                            // 1
+    Emit(Arithmetic(OP_ADD, O(0), V(0), V(1), all));                            // 2
+    Emit(Arithmetic(OP_MUL, O(1), V(2), V(3), all));                            // 3
+    Emit(Arithmetic(OP_MOV, O(0), V(3), 0, all));                               // 4, else
+    Emit(Arithmetic(OP_MOV, O(2), C(7), 0, all));                               // 5
+    Emit(UniformConditional(OP_IFU, 9, 0, 0));                                  // 6
+    Emit(Arithmetic(OP_ADD, O(3), C(8), V(4), all));                            // 7
+    Emit(Arithmetic(OP_MUL, O(3), C(8), R(3), all));                            // 8
+    Emit(UniformConditional(OP_JMPU, 11, 0, 1));                                // 9
+    Emit(Arithmetic(OP_MOV, O(4), V(5), 0, all));                               // 10
+    Emit(UniformConditional(OP_JMPU, 13, 1, 5));                                // 11
+    Emit(Arithmetic(OP_MOV, O(10), V(9), 0, all));                              // 12
+    Emit(Conditional(OP_JMPC, 15, 0, FLOW_OR, 0, 1));                           // 13
+    Emit(Arithmetic(OP_ADD, O(5), V(5), C(9), all));                            // 14
+    Emit(Conditional(OP_CALLC, 25, 3, FLOW_JUST_X, 1, 0));                      // 15
+    Emit(UniformConditional(OP_CALLU, 28, 2, 2));                               // 16
+    Emit(Compare(COMPARE_EQUAL, COMPARE_NOT_EQUAL, V(6), V(7), all));           // 17
+    Emit(Conditional(OP_IFC, 20, 1, FLOW_JUST_Y, 0, 0));                        // 18
+    Emit(Arithmetic(OP_MOV, O(6), V(8), 0, all));                               // 19
+    Emit(Arithmetic(OP_MOV, O(7), V(9), 0, all));                               // 20, else
+    Emit(Conditional(OP_IFC, 23, 1, FLOW_OR, 1, 1));                            // 21
+    Emit(Conditional(OP_CALLC, 28, 2, FLOW_AND, 1, 1));                         // 22
+    Emit(UniformConditional(OP_CALLU, 25, 3, 3));                               // 23, else
+    Emit(FlowControl(OP_END));                                                  // 24
+    Emit(Arithmetic(OP_ADD, O(8), V(10), C(11), all));                          // 25
+    Emit(Arithmetic(OP_MUL, O(8), V(11), R(8), all));                           // 26
+    Emit(Arithmetic(OP_DP4, R(9), V(12), C(12), all));                          // 27
+    Emit(Arithmetic(OP_MOV, O(9), C(13), 0, all));                              // 28
+    Emit(Arithmetic(OP_ADD, R(4), V(13), R(4), all));                           // 29
+    Check("conditionals", 0);
+}
+
+/// Uniforms indexed by aL, a loop left by BREAKC and by BREAK from within a conditional, and
+/// nested loops, one of them in a subroutine
+static void TestLoops() {
+    Clear();
+    const u32 all = Swizzle(MASK_XYZW, XYZW, XYZW);
+    const u32 cmp = Swizzle(MASK_XYZW, XYZW, XXXX);
+
+    Emit(Arithmetic(OP_MOV, R(0), V(0), 0, all));                               // 0
+    Emit(Loop(0, 3));                                                           // 1
+    Emit(Arithmetic(OP_ADD, R(0), C(0), R(0), all, 3));                         // 2
+    Emit(Arithmetic(OP_MUL, R(1), C(1), V(1), all, 3));                         // 3
+    Emit(Loop(1, 10));                                                          // 4
+    Emit(Arithmetic(OP_ADD, R(2), C(2), R(2), all, 3));                         // 5
+    Emit(Compare(COMPARE_GREATER_THAN, COMPARE_LESS_THAN, C(30), V(2), cmp, 3));// 6
+    Emit(Conditional(OP_BREAKC, 0, 0, FLOW_JUST_X, 1, 0));                      // 7
+    Emit(UniformConditional(OP_IFU, 10, 0, 3));                                 // 8
+    Emit(FlowControl(OP_BREAK));                                                // 9
+    Emit(Mad(false, R(3), R(2), C(40), R(3), all, 3));                          // 10
+    Emit(Loop(2, 15));                                                          // 11
+    Emit(Loop(3, 13));                                                          // 12
+    Emit(Arithmetic(OP_ADD, R(4), C(0), R(4), all, 3));                         // 13
+    Emit(Arithmetic(OP_MUL, R(5), R(4), V(4), all));                            // 14
+    Emit(Arithmetic(OP_ADD, R(6), C(1), R(6), all, 3));                         // 15
+    Emit(Arithmetic(OP_MOV, O(0), R(0), 0, all));                               // 16
+    Emit(FlowControl(OP_CALL, 19, 2));                                          // 17
+    Emit(FlowControl(OP_END));                                                  // 18
+    Emit(Loop(0, 20));                                                          // 19
+    Emit(Arithmetic(OP_ADD, R(7), C(5), R(7), all, 3));                         // 20
+    Check("loops", 0);
+}
+
+/// Nested calls, a call ending where another subroutine starts, an empty call, and an entry point
+/// past the start of the program
+static void TestCalls() {
+    Clear();
+    const u32 all = Swizzle(MASK_XYZW, XYZW, XYZW);
+
+    Emit(Arithmetic(OP_MOV, O(0), V(0), 0, all));                               // 0
+    Emit(FlowControl(OP_END));                                                  // 1
+    Emit(FlowControl(OP_CALL, 8, 3));                                           // 2, entry
+    Emit(Conditional(OP_CALLC, 14, 1, FLOW_OR, 0, 0));                          // 3
+    Emit(Compare(COMPARE_LESS_EQUAL, COMPARE_NOT_EQUAL, V(5), V(6), all));      // 4
+    Emit(UniformConditional(OP_CALLU, 8, 3, 4));                                // 5
+    Emit(FlowControl(OP_CALL, 15, 0));                                          // 6
+    Emit(FlowControl(OP_END));                                                  // 7
+    Emit(Arithmetic(OP_ADD, R(0), V(0), R(0), all));                            // 8
+    Emit(FlowControl(OP_CALL, 12, 2));                                          // 9
+    Emit(Arithmetic(OP_MUL, R(1), R(0), V(1), all));                            // 10
+    Emit(FlowControl(OP_END));                                                  // 11
+    Emit(Arithmetic(OP_DP3, R(2), C(4), R(2), all));                            // 12
+    Emit(Compare(COMPARE_GREATER_EQUAL, COMPARE_EQUAL, R(2), V(3), all));       // 13
+    Emit(Arithmetic(OP_MOV, O(1), R(2), 0, all));                               // 14
+    Emit(FlowControl(OP_END));                                                  // 15
+    Check("calls", 2);
+}
+
+/// Straight-line programs of random arithmetic instructions and operand descriptors
+static void TestRandomPrograms() {
+    static const u32 ops[] = {
+        OP_ADD, OP_DP3, OP_DP4, OP_DPH, OP_DST, OP_EX2, OP_LG2, OP_LIT, OP_MUL, OP_SGE, OP_SLT,
+        OP_FLR, OP_MAX, OP_MIN, OP_RCP, OP_RSQ, OP_MOVA, OP_MOV, OP_DPHI, OP_DSTI, OP_SGEI,
+        OP_SLTI, OP_CMP, OP_MAD, OP_MADI,
+    };
+
+    for (int program = 0; program < NUM_RANDOM_PROGRAMS; program++) {
+        Clear();
+        // MAD can only use the first 32 operand descriptors
+        for (int i = 0; i < 32; i++) {
+            SwizzlePattern swizzle;
+            swizzle.hex = (u32)rand() ^ ((u32)rand() << 16);
+            Swizzle(swizzle.dest_mask, swizzle.src1_selector, swizzle.src2_selector,
+                swizzle.negate_src1 != 0, swizzle.negate_src2 != 0, swizzle.src3_selector);
+        }
+
+        for (int i = 0; i < 64; i++) {
+            const u32 op = ops[rand() % ARRAY_SIZE(ops)];
+            const u32 dest = rand() % 32;
+            const u32 swizzle = rand() % 32;
+            const u32 address_register_index = rand() % 4;
+            const u32 short_src = rand() % 32;
+            const u32 long_src = rand() % 128;
+            const u32 other_src = rand() % 32;
+
+            if (op == OP_MAD || op == OP_MADI) {
+                Emit(Mad(op == OP_MADI, dest, short_src, (op == OP_MADI) ? other_src : long_src,
+                    (op == OP_MADI) ? long_src : other_src, swizzle, address_register_index));
+            } else if (op == OP_CMP) {
+                Emit(Compare((CompareOp)(rand() % 6), (CompareOp)(rand() % 6), long_src,
+                    short_src, swizzle, address_register_index));
+            } else if (op >= OP_DPHI && op <= OP_SLTI) {
+                Emit(Arithmetic(op, dest, short_src, long_src, swizzle, address_register_index));
+            } else {
+                Emit(Arithmetic(op, dest, long_src, short_src, swizzle, address_register_index));
+            }
+        }
+        Emit(FlowControl(OP_END));
+        Check("random", 0);
+    }
+}
+
+/// Runs all the programs, with the same random values every time
+static void TestAll() {
+    srand(1);
+    TestArithmetic();
+    TestAddressRegisters();
+    TestConditionals();
+    TestLoops();
+    TestCalls();
+    TestRandomPrograms();
+}
+
+int main() {
+#ifndef EMU_ARCHITECTURE_X64
+    return SKIP_RETURN_CODE;
+#endif
+
+    File::CreateFullPath(DISK_CACHE_DIR);
+    File::GetUserPath(D_SHADERCACHE_IDX, DISK_CACHE_DIR);
+    File::Delete(DISK_CACHE_DIR + DISK_CACHE_FILE);
+
+    const bool have_sse41 = cpu_info.bSSE4_1;
+    for (int sse41 = have_sse41; sse41 >= 0; sse41--) {
+        cpu_info.bSSE4_1 = (sse41 != 0);
+
+        // Compiled first, then loaded from the disk cache
+        for (int pass = 0; pass < 2; pass++) {
+            VertexShaderJit::Init();
+            TestAll();
+            VertexShaderJit::Shutdown();
+        }
+    }
+    cpu_info.bSSE4_1 = have_sse41;
+
+    File::Delete(DISK_CACHE_DIR + DISK_CACHE_FILE);
+    File::DeleteDir(DISK_CACHE_DIR);
+
+    return g_failures;
+}
@@ -0,0 +1,335 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+
+#include "common/common.h"
+#include "common/log.h"
+
+#include "core/mem_map.h"
+
+#include "video_core/command_processor.h"
+#include "video_core/primitive_assembly.h"
+#include "video_core/rasterizer.h"
+#include "video_core/vertex_shader.h"
+#include "video_core/renderer_opengl/gl_rasterizer.h"
+
+namespace Pica {
+
+u32 g_regs[Regs::NumIds];
+
+namespace CommandProcessor {
+
+static WriteHandler g_write_handlers[Regs::NumIds];  ///< Write handler of each register, or NULL
+
+/// Byte mask of the register bits written for each value of CommandHeader::parameter_mask
+static const u32 g_expanded_masks[16] = {
+    0x00000000, 0x000000FF, 0x0000FF00, 0x0000FFFF,
+    0x00FF0000, 0x00FF00FF, 0x00FFFF00, 0x00FFFFFF,
+    0xFF000000, 0xFF0000FF, 0xFF00FF00, 0xFF00FFFF,
+    0xFFFF0000, 0xFFFF00FF, 0xFFFFFF00, 0xFFFFFFFF,
+};
+
+void SetWriteHandler(Regs::Id id, WriteHandler handler) {
+    _assert_msg_(GPU, id < Regs::NumIds, "invalid PICA register 0x%03X", id);
+    g_write_handlers[id] = handler;
+}
+
+/**
+ * Writes a command parameter to a register
+ * @param id Register to write
+ * @param value Parameter value
+ * @param mask Expanded parameter mask, selecting the bits to write
+ */
+static inline void WriteRegister(u32 id, u32 value, u32 mask) {
+    if (id >= Regs::NumIds) {
+        ERROR_LOG(GPU, "command list writes to unknown PICA register 0x%03X", id);
+        return;
+    }
+
+    const u32 new_value = (g_regs[id] & ~mask) | (value & mask);
+    g_regs[id] = new_value;
+
+    WriteHandler handler = g_write_handlers[id];
+    if (handler) {
+        handler(static_cast<Regs::Id>(id), new_value);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Draw calls
+
+typedef Regs::Struct<Regs::VertexDescriptor> VertexDescriptor;
+
+/// Vertex loader, reading a number of attributes from one interleaved array
+struct VertexLoader {
+    const u8* data;                             ///< Start of the array
+    u32 address;                                ///< Physical address of the array
+    u32 stride;                                 ///< Bytes per vertex
+    u32 vertex_size;                            ///< Bytes read from the array for each vertex
+    int num_components;
+    int attribute[NUM_VERTEX_ATTRIBUTES];       ///< Attribute of each component, or -1 for padding
+    u32 offset[NUM_VERTEX_ATTRIBUTES];          ///< Byte offset of each component in a vertex
+};
+
+/// Size in bytes of each element of a vertex attribute format
+static inline u32 GetElementSize(VertexDescriptor::Format format) {
+    switch (format) {
+    case VertexDescriptor::Format::BYTE:
+    case VertexDescriptor::Format::UBYTE:
+        return 1;
+    case VertexDescriptor::Format::SHORT:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+/**
+ * Sets up a vertex loader from its configuration registers
+ * @param descriptor Formats of all attributes
+ * @param n Index of the loader
+ * @param loader Loader to set up
+ * @return True if the loader reads any components
+ */
+static bool SetupVertexLoader(const VertexDescriptor& descriptor, int n, VertexLoader& loader) {
+    Regs::Struct<Regs::VertexAttributeInfo0> info0;
+    Regs::Struct<Regs::VertexAttributeInfo1> info1;
+    info0.hex = g_regs[VertexAttributeInfo0(n)];
+    info1.hex = g_regs[VertexAttributeInfo1(n)];
+
+    loader.num_components = info1.component_count;
+    if (loader.num_components == 0)
+        return false;
+    if (loader.num_components > NUM_VERTEX_ATTRIBUTES) {
+        // The count field is 4 bits wide, but there are only 12 component slots
+        ERROR_LOG(GPU, "vertex loader %d has %d components", n, loader.num_components);
+        return false;
+    }
+
+    const u32 base = GetRegister<Regs::VertexArrayBaseAddr>().GetPhysicalBaseAddress();
+    loader.address = base + g_regs[VertexAttributeOffset(n)];
+    loader.data = Memory::GetPhysicalPointer(loader.address);
+    loader.stride = info1.byte_count;
+    if (loader.data == NULL) {
+        ERROR_LOG(GPU, "vertex loader %d reads invalid address 0x%08X", n, loader.address);
+        return false;
+    }
+
+    u32 offset = 0;
+    for (int i = 0; i < loader.num_components; i++) {
+        const u32 component = (i < 8) ? info0.GetComponent(i) : info1.GetComponent(i);
+        if (component >= NUM_VERTEX_ATTRIBUTES) {
+            // Padding of 4 to 16 bytes
+            loader.attribute[i] = -1;
+            loader.offset[i] = offset;
+            offset += (component - 11) * 4;
+            continue;
+        }
+
+        // Attributes are aligned to the size of their elements
+        const u32 element_size = GetElementSize(descriptor.GetFormat(component));
+        offset = (offset + element_size - 1) & ~(element_size - 1);
+
+        loader.attribute[i] = component;
+        loader.offset[i] = offset;
+        offset += element_size * descriptor.GetNumElements(component);
+    }
+    loader.vertex_size = offset;
+    return true;
+}
+
+/**
+ * Checks that a vertex loader only reads memory backing its array, up to a given vertex index
+ * @param loader Vertex loader to check
+ * @param max_index Highest index of the vertices the loader will read
+ * @return True if all reads of the loader are within the memory block its array is in
+ */
+static bool ValidateVertexLoader(const VertexLoader& loader, u32 max_index) {
+    const u64 size = (u64)max_index * loader.stride + loader.vertex_size;
+    if (size > 0xFFFFFFFF ||
+        Memory::GetPhysicalBlockPointer(loader.address, (u32)size) != loader.data) {
+
+        ERROR_LOG(GPU, "vertex array at 0x%08X overruns its memory with index %u, stride %u",
+            loader.address, max_index, loader.stride);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Loads the attributes of a vertex
+ * @param descriptor Formats of all attributes
+ * @param loaders Vertex loaders to read with
+ * @param num_loaders Number of vertex loaders
+ * @param index Index of the vertex
+ * @param vertex Vertex to load the attributes into
+ */
+static void LoadVertex(const VertexDescriptor& descriptor, const VertexLoader* loaders,
+    int num_loaders, u32 index, VertexShader::InputVertex& vertex) {
+
+    for (int i = 0; i < num_loaders; i++) {
+        const VertexLoader& loader = loaders[i];
+        const u8* const data = loader.data + index * loader.stride;
+
+        for (int comp = 0; comp < loader.num_components; comp++) {
+            const int attribute = loader.attribute[comp];
+            if (attribute < 0)
+                continue;
+
+            const u8* const src = data + loader.offset[comp];
+            const int num_elements = descriptor.GetNumElements(attribute);
+            float* const dst = vertex.attr[attribute];
+
+            for (int elem = 0; elem < num_elements; elem++) {
+                switch (descriptor.GetFormat(attribute)) {
+                case VertexDescriptor::Format::BYTE:
+                    dst[elem] = ((const s8*)src)[elem];
+                    break;
+                case VertexDescriptor::Format::UBYTE:
+                    dst[elem] = ((const u8*)src)[elem];
+                    break;
+                case VertexDescriptor::Format::SHORT:
+                    dst[elem] = ((const s16*)src)[elem];
+                    break;
+                case VertexDescriptor::Format::FLOAT:
+                    dst[elem] = ((const float*)src)[elem];
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Runs a draw call with the current register state
+ * @param indexed Whether the vertices are read through the index array
+ */
+static void Draw(bool indexed) {
+    VertexDescriptor descriptor;
+    descriptor.hex = g_regs[Regs::VertexDescriptor] |
+        ((u64)g_regs[Regs::VertexDescriptor + 1] << 32);
+    const int num_attributes = (int)descriptor.num_attributes + 1;
+
+    VertexLoader loaders[NUM_VERTEX_ATTRIBUTES];
+    int num_loaders = 0;
+    for (int i = 0; i < NUM_VERTEX_ATTRIBUTES; i++) {
+        if (SetupVertexLoader(descriptor, i, loaders[num_loaders])) {
+            num_loaders++;
+        }
+    }
+
+    const u32 num_vertices = g_regs[Regs::NumVertices];
+    if (num_vertices == 0)
+        return;
+
+    const Regs::Struct<Regs::IndexArrayConfig>& index_config =
+        GetRegister<Regs::IndexArrayConfig>();
+    const bool index_u16 = index_config.format != 0;
+    const u8* index_data = NULL;
+    u32 max_index = num_vertices - 1;
+    if (indexed) {
+        const u32 address = GetRegister<Regs::VertexArrayBaseAddr>().GetPhysicalBaseAddress() +
+            index_config.offset;
+        const u64 size = (u64)num_vertices * (index_u16 ? 2 : 1);
+        if (size <= 0xFFFFFFFF) {
+            index_data = Memory::GetPhysicalBlockPointer(address, (u32)size);
+        }
+        if (index_data == NULL) {
+            ERROR_LOG(GPU, "index array at invalid address 0x%08X, %u vertices", address,
+                num_vertices);
+            return;
+        }
+
+        max_index = 0;
+        for (u32 i = 0; i < num_vertices; i++) {
+            max_index = std::max<u32>(max_index,
+                index_u16 ? ((const u16*)index_data)[i] : index_data[i]);
+        }
+    }
+
+    // Reject the whole draw if any vertex would be read from outside of its array's memory
+    for (int i = 0; i < num_loaders; i++) {
+        if (!ValidateVertexLoader(loaders[i], max_index))
+            return;
+    }
+
+    const bool use_hw_rasterizer = HWRasterizer::IsEnabled();
+    PrimitiveAssembly::Begin(GetRegister<Regs::TriangleTopology>().topology,
+        use_hw_rasterizer ? HWRasterizer::AddTriangle : Rasterizer::AddTriangle);
+
+    VertexShader::Setup();
+
+    for (u32 i = 0; i < num_vertices; i++) {
+        u32 index = i;
+        if (indexed) {
+            index = index_u16 ? ((const u16*)index_data)[i] : index_data[i];
+        }
+
+        // Attributes not loaded from any array default to (0, 0, 0, 1)
+        VertexShader::InputVertex input;
+        for (int attr = 0; attr < NUM_VERTEX_ATTRIBUTES; attr++) {
+            input.attr[attr][0] = input.attr[attr][1] = input.attr[attr][2] = 0.0f;
+            input.attr[attr][3] = 1.0f;
+        }
+        LoadVertex(descriptor, loaders, num_loaders, index, input);
+
+        PrimitiveAssembly::SubmitVertex(VertexShader::RunShader(input, num_attributes));
+    }
+
+    if (use_hw_rasterizer) {
+        HWRasterizer::Flush();
+    } else {
+        Rasterizer::Flush();
+    }
+}
+
+static void DrawHandler(Regs::Id id, u32 value) {
+    Draw(id == Regs::TriggerDrawIndexed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProcessCommandList(const u32* list, u32 size_in_words) {
+    const u32* read_pointer = list;
+    const u32* const end = list + size_in_words;
+
+    // Every command takes at least two words, the first parameter and the header
+    while (read_pointer + 2 <= end) {
+        const CommandHeader header(read_pointer[1]);
+        const u32 id = header.cmd_id;
+        const u32 mask = g_expanded_masks[header.parameter_mask];
+        const u32 num_extra = header.extra_data_length;
+        const u32 increment = header.group_commands;
+
+        // Commands are padded to 8 bytes
+        const u32* const next = read_pointer + 2 + ((num_extra + 1) & ~1u);
+        if (read_pointer + 2 + num_extra > end) {
+            ERROR_LOG(GPU, "command list overruns its end at command 0x%08X", header.hex);
+            break;
+        }
+
+        WriteRegister(id, read_pointer[0], mask);
+        for (u32 i = 0; i < num_extra; i++) {
+            WriteRegister(id + (i + 1) * increment, read_pointer[2 + i], mask);
+        }
+
+        read_pointer = next;
+    }
+}
+
+void Init() {
+    std::fill(g_regs, g_regs + Regs::NumIds, 0);
+    std::fill(g_write_handlers, g_write_handlers + Regs::NumIds, (WriteHandler)NULL);
+
+    SetWriteHandler(Regs::TriggerDraw, DrawHandler);
+    SetWriteHandler(Regs::TriggerDrawIndexed, DrawHandler);
+}
+
+void Shutdown() {
+}
+
+} // namespace
+
+} // namespace
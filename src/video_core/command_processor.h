@@ -0,0 +1,54 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+
+#include "video_core/pica.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// PICA200 command processor
+//
+// A command list is a sequence of 8-byte aligned commands. Each command starts with its first
+// parameter followed by a Pica::CommandHeader, which is in turn followed by extra_data_length
+// further parameters. All parameters are written to the register cmd_id, or to consecutive
+// registers starting at cmd_id if group_commands is set, and only the bytes selected by
+// parameter_mask are modified. Writes are stored in the register file Pica::g_regs and then passed
+// to the write handler of the register, if any.
+
+namespace Pica {
+
+namespace CommandProcessor {
+
+/**
+ * Called after a register has been written by a command
+ * @param id Register that was written
+ * @param value New value of the register, with the parameter mask already applied
+ */
+typedef void (*WriteHandler)(Regs::Id id, u32 value);
+
+/**
+ * Sets the function called on writes to a register, replacing the previous one
+ * @param id Register to handle writes to
+ * @param handler Function to call on writes, or NULL to just store the written values
+ */
+void SetWriteHandler(Regs::Id id, WriteHandler handler);
+
+/**
+ * Executes a command list
+ * @param list Pointer to the first word of the command list
+ * @param size_in_words Size of the command list in 32-bit words
+ */
+void ProcessCommandList(const u32* list, u32 size_in_words);
+
+/// Initialize the command processor, clearing the register file
+void Init();
+
+/// Shutdown the command processor
+void Shutdown();
+
+} // namespace
+
+} // namespace
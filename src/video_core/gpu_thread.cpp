@@ -0,0 +1,172 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+
+#include "common/atomic.h"
+#include "common/common.h"
+#include "common/log.h"
+#include "common/thread.h"
+
+#include "video_core/gpu_thread.h"
+
+namespace GPUThread {
+
+enum {
+    RING_SIZE = 1024,               ///< Number of commands in the ring, must be a power of two
+    RING_MASK = RING_SIZE - 1,
+};
+
+/// Command queued up in the ring
+struct Command {
+    CommandFunc func;
+    u32 params[MAX_COMMAND_PARAMS];
+};
+
+static Command g_ring[RING_SIZE];
+
+// The read and write indices only ever increase, and wrap around at 2^32. Only the video thread
+// writes g_read_index and only the CPU thread writes g_write_index.
+static volatile u32 g_read_index = 0;
+static volatile u32 g_write_index = 0;
+
+static volatile u32 g_sleeping = 0;         ///< Set while the video thread waits for commands
+static Common::Event g_wakeup;              ///< Wakes the video thread up when commands arrive
+
+static u32 g_next_fence = 0;                ///< Last fence handed out by InsertFence
+static volatile u32 g_completed_fence = 0;  ///< Last fence reached by the video thread
+static Common::Event g_fence_reached;       ///< Set whenever the video thread reaches a fence
+
+static std::thread* g_thread = NULL;
+static EmuWindow* g_emu_window = NULL;
+static bool g_running = false;              ///< Cleared by the quit command on the video thread
+
+/// Fence command, params[0] is the fence
+static void FenceCommand(const u32* params) {
+    Common::AtomicStoreRelease(g_completed_fence, params[0]);
+    g_fence_reached.Set();
+}
+
+/// Quit command, makes the video thread exit once it returns
+static void QuitCommand(const u32* params) {
+    g_running = false;
+}
+
+/// Video thread, executes the queued up commands in order
+static void VideoThread() {
+    Common::SetCurrentThreadName("VideoThread");
+    if (g_emu_window) {
+        g_emu_window->MakeCurrent();
+    }
+
+    while (g_running) {
+        const u32 read_index = g_read_index;
+        if (read_index == Common::AtomicLoadAcquire(g_write_index)) {
+            // Announce that we are going to sleep before checking for commands a last time, so
+            // that a command pushed in between either is seen here or wakes us up.
+            // AtomicStoreRelease is a full barrier.
+            Common::AtomicStoreRelease(g_sleeping, 1);
+            if (read_index == Common::AtomicLoadAcquire(g_write_index)) {
+                g_wakeup.Wait();
+            }
+            Common::AtomicStore(g_sleeping, 0);
+            continue;
+        }
+
+        const Command& command = g_ring[read_index & RING_MASK];
+        command.func(command.params);
+        Common::AtomicStoreRelease(g_read_index, read_index + 1);
+    }
+
+    if (g_emu_window) {
+        g_emu_window->DoneCurrent();
+    }
+}
+
+void PushCommand(CommandFunc func, const u32* params, int num_params) {
+    _dbg_assert_msg_(GPU, num_params <= MAX_COMMAND_PARAMS, "too many command parameters");
+
+    if (!g_thread) {
+        func(params);
+        return;
+    }
+
+    const u32 write_index = g_write_index;
+    while (write_index - Common::AtomicLoadAcquire(g_read_index) >= RING_SIZE) {
+        // The ring is full, let the video thread catch up
+        g_wakeup.Set();
+        Common::YieldCPU();
+    }
+
+    Command& command = g_ring[write_index & RING_MASK];
+    command.func = func;
+    if (num_params > 0) {
+        std::copy(params, params + num_params, command.params);
+    }
+
+    // AtomicStoreRelease is a full barrier, so the video thread's sleep flag is read afterwards
+    Common::AtomicStoreRelease(g_write_index, write_index + 1);
+    if (Common::AtomicLoadAcquire(g_sleeping)) {
+        g_wakeup.Set();
+    }
+}
+
+u32 InsertFence() {
+    if (!g_thread)
+        return 0;
+
+    const u32 fence = ++g_next_fence;
+    PushCommand(FenceCommand, &fence, 1);
+    return fence;
+}
+
+void WaitForFence(u32 fence) {
+    if (!g_thread)
+        return;
+
+    while ((s32)(Common::AtomicLoadAcquire(g_completed_fence) - fence) < 0) {
+        g_fence_reached.Wait();
+    }
+}
+
+void Synchronize() {
+    WaitForFence(InsertFence());
+}
+
+void Init(EmuWindow* emu_window, bool use_thread) {
+    g_read_index = g_write_index = 0;
+    g_sleeping = 0;
+    g_next_fence = g_completed_fence = 0;
+
+    if (!use_thread)
+        return;
+
+    // The video thread makes the graphics context current for itself, if there is one
+    g_emu_window = emu_window;
+    if (g_emu_window) {
+        g_emu_window->DoneCurrent();
+    }
+
+    g_running = true;
+    g_thread = new std::thread(VideoThread);
+
+    NOTICE_LOG(GPU, "video thread started");
+}
+
+void Shutdown() {
+    if (!g_thread)
+        return;
+
+    PushCommand(QuitCommand);
+    g_thread->join();
+    delete g_thread;
+    g_thread = NULL;
+
+    // Hand the graphics context back to the caller
+    if (g_emu_window) {
+        g_emu_window->MakeCurrent();
+    }
+}
+
+} // namespace
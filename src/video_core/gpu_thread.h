@@ -0,0 +1,67 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+#include "common/emu_window.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// GPU thread
+//
+// In dual-core mode, GPU work (GX commands, PICA command lists, frame presentation) is queued up
+// by the CPU thread in a fixed-size single-producer single-consumer ring and executed in order on
+// a dedicated video thread that owns the graphics context. The CPU thread only blocks when the
+// ring is full, or when it waits on a fence before reading back state written by the GPU. When
+// dual-core mode is disabled, commands are executed as soon as they are pushed.
+//
+// All pushes must be made from one thread at a time. Within the emulator this is guaranteed by
+// HLE::g_mutex, which is held by the SVC handlers, CoreTiming events and HW register accesses.
+
+namespace GPUThread {
+
+enum {
+    MAX_COMMAND_PARAMS = 8,    ///< Maximum number of parameter words passed with a command
+};
+
+/**
+ * Function executing a queued command on the video thread
+ * @param params Parameter words given when the command was pushed
+ */
+typedef void (*CommandFunc)(const u32* params);
+
+/**
+ * Queues up a command for the video thread, or executes it right away in single-core mode
+ * @param func Function executing the command
+ * @param params Parameter words to pass to the function, copied into the queue
+ * @param num_params Number of parameter words, at most MAX_COMMAND_PARAMS
+ */
+void PushCommand(CommandFunc func, const u32* params = NULL, int num_params = 0);
+
+/**
+ * Queues up a fence, which is signaled once all commands pushed before it have been executed
+ * @return Fence to pass to WaitForFence
+ */
+u32 InsertFence();
+
+/**
+ * Waits until the video thread has executed all commands pushed before a fence
+ * @param fence Fence returned by InsertFence
+ */
+void WaitForFence(u32 fence);
+
+/// Waits until the video thread has executed all commands pushed so far
+void Synchronize();
+
+/**
+ * Initialize the GPU thread
+ * @param emu_window Window whose graphics context is handed over to the video thread
+ * @param use_thread Whether to run GPU commands on a video thread (dual-core mode)
+ */
+void Init(EmuWindow* emu_window, bool use_thread);
+
+/// Shutdown the GPU thread, after executing all commands still queued up
+void Shutdown();
+
+} // namespace
@@ -0,0 +1,199 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <string.h>
+
+#include "common/common.h"
+
+#include "video_core/morton.h"
+
+#ifdef EMU_ARCHITECTURE_X64
+#include <emmintrin.h>
+#endif
+
+namespace VideoCore {
+
+/**
+ * Converts an 8x8 tile between Morton order and linear rows, one horizontal pair of pixels at a
+ * time. Pixel indices 2n and 2n + 1 only differ in bit 0 of x, so each pair is contiguous in both
+ * layouts.
+ * @param tile Pointer to the tile
+ * @param linear Pointer to the first pixel of the tile in the first linear row
+ * @param linear_stride Distance between linear rows in bytes
+ */
+template <bool encode, u32 bytes_per_pixel>
+static void MortonCopyTile(u8* tile, u8* linear, ptrdiff_t linear_stride) {
+    const u32 pair_size = bytes_per_pixel * 2;
+    for (u32 y = 0; y < 8; y++) {
+        u8* row = linear + y * linear_stride;
+        for (u32 x = 0; x < 8; x += 2) {
+            u8* tiled_pair = tile + MortonInterleave(x, y) * bytes_per_pixel;
+            u8* linear_pair = row + x * bytes_per_pixel;
+            if (encode) {
+                memcpy(tiled_pair, linear_pair, pair_size);
+            } else {
+                memcpy(linear_pair, tiled_pair, pair_size);
+            }
+        }
+    }
+}
+
+#ifdef EMU_ARCHITECTURE_X64
+
+// Within a tile of 4-byte pixels, each 16-byte chunk is a 2x2 quad: p(0,0), p(1,0), p(0,1) and
+// p(1,1). The chunk index holds bits 1 and 2 of x and y interleaved, so the quads at x = 0, 2, 4
+// and 6 of a pair of rows are chunks 0, 1, 4 and 5 after its first one. Two quads side by side
+// make half of each row with a 64-bit unpack.
+//
+// Within a tile of 2-byte pixels, each 16-byte chunk is a 4x2 block with its 32-bit pixel pairs
+// ordered (0,0), (0,1), (2,0), (2,1). Swapping the middle pairs makes it two half rows, and the
+// blocks at x = 0 and x = 4 are two chunks apart.
+//
+// There are no AVX2 variants: converting whole rows of a tile per register and two pairs of rows
+// at once was measured no faster, as the conversion is bound by memory bandwidth.
+
+/// Offsets of the first chunk of each pair of rows of a tile of 4-byte pixels, in chunks
+static const u32 quad_row_chunks[4] = { 0, 2, 8, 10 };
+
+/// Offsets of the first chunk of each pair of rows of a tile of 2-byte pixels, in chunks
+static const u32 block_row_chunks[4] = { 0, 1, 4, 5 };
+
+static void DecodeTile32(const u8* tile, u8* linear, ptrdiff_t linear_stride) {
+    const __m128i* chunks = (const __m128i*)tile;
+    for (u32 i = 0; i < 4; i++) {
+        const __m128i* src = chunks + quad_row_chunks[i];
+        const __m128i q0 = _mm_load_si128(src + 0);
+        const __m128i q1 = _mm_load_si128(src + 1);
+        const __m128i q2 = _mm_load_si128(src + 4);
+        const __m128i q3 = _mm_load_si128(src + 5);
+
+        __m128i* row0 = (__m128i*)(linear + 2 * i * linear_stride);
+        __m128i* row1 = (__m128i*)(linear + (2 * i + 1) * linear_stride);
+        _mm_storeu_si128(row0 + 0, _mm_unpacklo_epi64(q0, q1));
+        _mm_storeu_si128(row0 + 1, _mm_unpacklo_epi64(q2, q3));
+        _mm_storeu_si128(row1 + 0, _mm_unpackhi_epi64(q0, q1));
+        _mm_storeu_si128(row1 + 1, _mm_unpackhi_epi64(q2, q3));
+    }
+}
+
+static void EncodeTile32(const u8* linear, ptrdiff_t linear_stride, u8* tile) {
+    __m128i* chunks = (__m128i*)tile;
+    for (u32 i = 0; i < 4; i++) {
+        const __m128i* row0 = (const __m128i*)(linear + 2 * i * linear_stride);
+        const __m128i* row1 = (const __m128i*)(linear + (2 * i + 1) * linear_stride);
+        const __m128i a0 = _mm_loadu_si128(row0 + 0);
+        const __m128i a1 = _mm_loadu_si128(row0 + 1);
+        const __m128i b0 = _mm_loadu_si128(row1 + 0);
+        const __m128i b1 = _mm_loadu_si128(row1 + 1);
+
+        __m128i* dst = chunks + quad_row_chunks[i];
+        _mm_store_si128(dst + 0, _mm_unpacklo_epi64(a0, b0));
+        _mm_store_si128(dst + 1, _mm_unpackhi_epi64(a0, b0));
+        _mm_store_si128(dst + 4, _mm_unpacklo_epi64(a1, b1));
+        _mm_store_si128(dst + 5, _mm_unpackhi_epi64(a1, b1));
+    }
+}
+
+static void DecodeTile16(const u8* tile, u8* linear, ptrdiff_t linear_stride) {
+    const __m128i* chunks = (const __m128i*)tile;
+    for (u32 i = 0; i < 4; i++) {
+        const __m128i* src = chunks + block_row_chunks[i];
+        const __m128i left = _mm_shuffle_epi32(_mm_load_si128(src + 0), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i right = _mm_shuffle_epi32(_mm_load_si128(src + 2), _MM_SHUFFLE(3, 1, 2, 0));
+
+        _mm_storeu_si128((__m128i*)(linear + 2 * i * linear_stride),
+            _mm_unpacklo_epi64(left, right));
+        _mm_storeu_si128((__m128i*)(linear + (2 * i + 1) * linear_stride),
+            _mm_unpackhi_epi64(left, right));
+    }
+}
+
+static void EncodeTile16(const u8* linear, ptrdiff_t linear_stride, u8* tile) {
+    __m128i* chunks = (__m128i*)tile;
+    for (u32 i = 0; i < 4; i++) {
+        const __m128i row0 = _mm_loadu_si128((const __m128i*)(linear + 2 * i * linear_stride));
+        const __m128i row1 =
+            _mm_loadu_si128((const __m128i*)(linear + (2 * i + 1) * linear_stride));
+
+        __m128i* dst = chunks + block_row_chunks[i];
+        _mm_store_si128(dst + 0, _mm_shuffle_epi32(_mm_unpacklo_epi64(row0, row1),
+            _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm_store_si128(dst + 2, _mm_shuffle_epi32(_mm_unpackhi_epi64(row0, row1),
+            _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+}
+
+#endif // EMU_ARCHITECTURE_X64
+
+/**
+ * Converts a surface between Morton order and linear rows, tile by tile
+ * @param tiled Pointer to the tiled surface
+ * @param linear Pointer to the first linear row
+ * @param linear_stride Distance between linear rows in bytes
+ * @param width Width of the surface in pixels
+ * @param height Height of the surface in pixels
+ * @param bytes_per_pixel Size of a pixel in bytes
+ */
+template <bool encode>
+static void MortonCopy(u8* tiled, u8* linear, ptrdiff_t linear_stride, u32 width, u32 height,
+    u32 bytes_per_pixel) {
+
+    _dbg_assert_msg_(GPU, (width % 8) == 0 && (height % 8) == 0,
+        "surface size %ux%u is not a multiple of the tile size", width, height);
+    _dbg_assert_msg_(GPU, bytes_per_pixel >= 1 && bytes_per_pixel <= 4,
+        "invalid pixel size %u", bytes_per_pixel);
+
+    const u32 tile_size = 64 * bytes_per_pixel;
+
+#ifdef EMU_ARCHITECTURE_X64
+    // Tiles are 16-byte aligned whenever the surface is, which it is unless the guest placed it
+    // oddly
+    const bool aligned = ((uintptr_t)tiled & 15) == 0;
+#endif
+
+    for (u32 y = 0; y < height; y += 8) {
+        u8* linear_tile = linear + y * linear_stride;
+        for (u32 x = 0; x < width; x += 8) {
+#ifdef EMU_ARCHITECTURE_X64
+            if (aligned && bytes_per_pixel == 4) {
+                if (encode) {
+                    EncodeTile32(linear_tile, linear_stride, tiled);
+                } else {
+                    DecodeTile32(tiled, linear_tile, linear_stride);
+                }
+            } else if (aligned && bytes_per_pixel == 2) {
+                if (encode) {
+                    EncodeTile16(linear_tile, linear_stride, tiled);
+                } else {
+                    DecodeTile16(tiled, linear_tile, linear_stride);
+                }
+            } else
+#endif
+            {
+                switch (bytes_per_pixel) {
+                case 1: MortonCopyTile<encode, 1>(tiled, linear_tile, linear_stride); break;
+                case 2: MortonCopyTile<encode, 2>(tiled, linear_tile, linear_stride); break;
+                case 3: MortonCopyTile<encode, 3>(tiled, linear_tile, linear_stride); break;
+                case 4: MortonCopyTile<encode, 4>(tiled, linear_tile, linear_stride); break;
+                }
+            }
+            tiled += tile_size;
+            linear_tile += 8 * bytes_per_pixel;
+        }
+    }
+}
+
+void MortonDecode(const u8* tiled, u8* linear, ptrdiff_t linear_stride, u32 width, u32 height,
+    u32 bytes_per_pixel) {
+    MortonCopy<false>(const_cast<u8*>(tiled), linear, linear_stride, width, height,
+        bytes_per_pixel);
+}
+
+void MortonEncode(const u8* linear, ptrdiff_t linear_stride, u8* tiled, u32 width, u32 height,
+    u32 bytes_per_pixel) {
+    MortonCopy<true>(tiled, const_cast<u8*>(linear), linear_stride, width, height,
+        bytes_per_pixel);
+}
+
+} // namespace
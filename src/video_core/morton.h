@@ -0,0 +1,130 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/common_types.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Morton-tiled surface codec
+//
+// The PICA200 stores color buffers, depth buffers and textures as rows of 8x8 tiles, with the
+// pixels of each tile in Morton (Z) order: bit 0 of the pixel index is bit 0 of x, bit 1 is bit 0
+// of y, bit 2 is bit 1 of x and so on. The kernels here convert whole surfaces between that layout
+// and linear rows without converting the pixels themselves. Both layouts keep the row order of
+// the surface in memory, pass a negative stride to flip it.
+
+namespace VideoCore {
+
+/// Pixel formats of PICA200 surfaces, as far as the tiled layout is concerned
+enum SurfaceFormat {
+    SURFACE_FORMAT_RGBA8,
+    SURFACE_FORMAT_RGB8,
+    SURFACE_FORMAT_RGB5A1,
+    SURFACE_FORMAT_RGB565,
+    SURFACE_FORMAT_RGBA4,
+    SURFACE_FORMAT_D16,
+    SURFACE_FORMAT_D24,
+    SURFACE_FORMAT_D24S8,
+};
+
+/**
+ * Gets the size of a pixel of a surface format
+ * @param format Pixel format
+ * @return Size of a pixel in bytes
+ */
+static inline u32 GetSurfaceBytesPerPixel(SurfaceFormat format) {
+    switch (format) {
+    case SURFACE_FORMAT_RGBA8:
+    case SURFACE_FORMAT_D24S8:
+        return 4;
+    case SURFACE_FORMAT_RGB8:
+    case SURFACE_FORMAT_D24:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
+/**
+ * Interleaves the low 3 bits of two coordinates, giving the index of a pixel within its 8x8 tile
+ * in Morton (Z) order
+ * @param x X coordinate of the pixel
+ * @param y Y coordinate of the pixel
+ * @return Index of the pixel within its tile, from 0 to 63
+ */
+static inline u32 MortonInterleave(u32 x, u32 y) {
+    static const u8 xlut[8] = { 0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15 };
+    static const u8 ylut[8] = { 0x00, 0x02, 0x08, 0x0A, 0x20, 0x22, 0x28, 0x2A };
+    return xlut[x & 7] | ylut[y & 7];
+}
+
+/**
+ * Gets the offset of a pixel in a Morton-tiled surface
+ * @param x X coordinate of the pixel
+ * @param y Y coordinate of the pixel
+ * @param width Width of the surface in pixels, a multiple of 8
+ * @param bytes_per_pixel Size of a pixel in bytes
+ * @return Offset of the pixel in bytes
+ */
+static inline u32 GetMortonOffset(u32 x, u32 y, u32 width, u32 bytes_per_pixel) {
+    const u32 tile_offset = (y & ~7) * width + (x & ~7) * 8;
+    return (tile_offset + MortonInterleave(x, y)) * bytes_per_pixel;
+}
+
+/**
+ * Converts a Morton-tiled surface to linear rows
+ * @param tiled Pointer to the tiled surface
+ * @param linear Pointer to the first linear row
+ * @param linear_stride Distance between linear rows in bytes, may be negative
+ * @param width Width of the surface in pixels, a multiple of 8
+ * @param height Height of the surface in pixels, a multiple of 8
+ * @param bytes_per_pixel Size of a pixel in bytes, from 1 to 4
+ */
+void MortonDecode(const u8* tiled, u8* linear, ptrdiff_t linear_stride, u32 width, u32 height,
+    u32 bytes_per_pixel);
+
+/**
+ * Converts linear rows to a Morton-tiled surface
+ * @param linear Pointer to the first linear row
+ * @param linear_stride Distance between linear rows in bytes, may be negative
+ * @param tiled Pointer to the tiled surface
+ * @param width Width of the surface in pixels, a multiple of 8
+ * @param height Height of the surface in pixels, a multiple of 8
+ * @param bytes_per_pixel Size of a pixel in bytes, from 1 to 4
+ */
+void MortonEncode(const u8* linear, ptrdiff_t linear_stride, u8* tiled, u32 width, u32 height,
+    u32 bytes_per_pixel);
+
+/**
+ * Converts a Morton-tiled surface to linear rows
+ * @param tiled Pointer to the tiled surface
+ * @param linear Pointer to the first linear row
+ * @param linear_stride Distance between linear rows in bytes, may be negative
+ * @param width Width of the surface in pixels, a multiple of 8
+ * @param height Height of the surface in pixels, a multiple of 8
+ * @param format Pixel format of the surface
+ */
+static inline void MortonDecode(const u8* tiled, u8* linear, ptrdiff_t linear_stride, u32 width,
+    u32 height, SurfaceFormat format) {
+    MortonDecode(tiled, linear, linear_stride, width, height, GetSurfaceBytesPerPixel(format));
+}
+
+/**
+ * Converts linear rows to a Morton-tiled surface
+ * @param linear Pointer to the first linear row
+ * @param linear_stride Distance between linear rows in bytes, may be negative
+ * @param tiled Pointer to the tiled surface
+ * @param width Width of the surface in pixels, a multiple of 8
+ * @param height Height of the surface in pixels, a multiple of 8
+ * @param format Pixel format of the surface
+ */
+static inline void MortonEncode(const u8* linear, ptrdiff_t linear_stride, u8* tiled, u32 width,
+    u32 height, SurfaceFormat format) {
+    MortonEncode(linear, linear_stride, tiled, width, height, GetSurfaceBytesPerPixel(format));
+}
+
+} // namespace
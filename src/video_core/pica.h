@@ -19,7 +19,28 @@ struct Regs {
         ViewportInvSizeX           =  0x42,
         ViewportSizeY              =  0x43,
         ViewportInvSizeY           =  0x44,
+        ViewportDepthRange         =  0x4D,
+        ViewportDepthNearPlane     =  0x4E,
+        VertexOutputMap            =  0x50, // 0x51,0x52,0x53,0x54,0x55,0x56
         ViewportCorner             =  0x68,
+        TextureUnitsConfig         =  0x80,
+        TextureUnit0Size           =  0x82,
+        TextureUnit0Address        =  0x85,
+        TextureUnit0Type           =  0x8E,
+        TextureUnit1Size           =  0x92,
+        TextureUnit1Address        =  0x95,
+        TextureUnit1Type           =  0x96,
+        TextureUnit2Size           =  0x9A,
+        TextureUnit2Address        =  0x9D,
+        TextureUnit2Type           =  0x9E,
+        TexEnv0Source              =  0xC0, // 0xC8,0xD0,0xD8,0xF0,0xF8
+        TexEnv0Modifier            =  0xC1, // 0xC9,0xD1,0xD9,0xF1,0xF9
+        TexEnv0Operation           =  0xC2, // 0xCA,0xD2,0xDA,0xF2,0xFA
+        TexEnv0Color               =  0xC3, // 0xCB,0xD3,0xDB,0xF3,0xFB
+        TexEnv0Scale               =  0xC4, // 0xCC,0xD4,0xDC,0xF4,0xFC
+        TexEnvBufferInput          =  0xE0,
+        TexEnvBufferColor          =  0xFD,
+        DepthColorMask             = 0x107,
         DepthBufferFormat          = 0x116,
         ColorBufferFormat          = 0x117,
         DepthBufferAddress         = 0x11C,
@@ -31,6 +52,24 @@ struct Regs {
         VertexAttributeOffset      = 0x203, // 0x206,0x209,0x20C,0x20F,0x212,0x215,0x218,0x21B,0x21E,0x221,0x224
         VertexAttributeInfo0       = 0x204, // 0x207,0x20A,0x20D,0x210,0x213,0x216,0x219,0x21C,0x21F,0x222,0x225
         VertexAttributeInfo1       = 0x205, // 0x208,0x20B,0x20E,0x211,0x214,0x217,0x21A,0x21D,0x220,0x223,0x226
+        IndexArrayConfig           = 0x227,
+        NumVertices                = 0x228,
+        TriggerDraw                = 0x22E,
+        TriggerDrawIndexed         = 0x22F,
+
+        TriangleTopology           = 0x25E,
+
+        VSBoolUniforms             = 0x2B0,
+        VSIntUniform0              = 0x2B1, // 0x2B2,0x2B3,0x2B4
+        VSMainOffset               = 0x2BA,
+        VSInputRegisterMap         = 0x2BB, // 0x2BC
+        VSOutputMask               = 0x2BD,
+        VSFloatUniformSetup        = 0x2C0,
+        VSFloatUniformData         = 0x2C1, // 0x2C2-0x2C8
+        VSBeginLoadProgramData     = 0x2CB,
+        VSLoadProgramData          = 0x2CC, // 0x2CD-0x2D3
+        VSBeginLoadSwizzleData     = 0x2D5,
+        VSLoadSwizzleData          = 0x2D6, // 0x2D7-0x2DD
 
         NumIds                     = 0x300,
     };
@@ -39,6 +78,25 @@ struct Regs {
     union Struct;
 };
 
+/// Number of vertex attributes that can be loaded, and of vertex shader output registers mapped
+enum {
+    NUM_VERTEX_ATTRIBUTES      = 12,
+    NUM_VERTEX_OUTPUTS         = 7,
+};
+
+/// PICA200 register file, indexed by Regs::Id and written by the command processor
+extern u32 g_regs[Regs::NumIds];
+
+/**
+ * Gets a register of the register file as its bitfield struct
+ * @return Reference to the register, which may span several consecutive register words
+ */
+template<Regs::Id id>
+inline const Regs::Struct<id>& GetRegister()
+{
+    return *reinterpret_cast<const Regs::Struct<id>*>(&g_regs[id]);
+}
+
 static inline Regs::Id VertexAttributeOffset(int n)
 {
     return static_cast<Regs::Id>(0x203 + 3*n);
@@ -54,6 +112,89 @@ static inline Regs::Id VertexAttributeInfo1(int n)
     return static_cast<Regs::Id>(0x205 + 3*n);
 }
 
+static inline Regs::Id VertexOutputMap(int n)
+{
+    return static_cast<Regs::Id>(0x50 + n);
+}
+
+/// Number of vertex shader integer uniforms, and of the data ports of the shader upload registers
+enum {
+    NUM_VS_INT_UNIFORMS        = 4,
+    NUM_VS_DATA_PORTS          = 8,
+};
+
+static inline Regs::Id VSIntUniform(int n)
+{
+    return static_cast<Regs::Id>(0x2B1 + n);
+}
+
+/// Number of texture units
+enum {
+    NUM_TEXTURE_UNITS          = 3,
+};
+
+static inline Regs::Id TextureUnitSize(int n)
+{
+    static const Regs::Id ids[NUM_TEXTURE_UNITS] = {
+        Regs::TextureUnit0Size, Regs::TextureUnit1Size, Regs::TextureUnit2Size
+    };
+    return ids[n];
+}
+
+static inline Regs::Id TextureUnitAddress(int n)
+{
+    static const Regs::Id ids[NUM_TEXTURE_UNITS] = {
+        Regs::TextureUnit0Address, Regs::TextureUnit1Address, Regs::TextureUnit2Address
+    };
+    return ids[n];
+}
+
+static inline Regs::Id TextureUnitType(int n)
+{
+    static const Regs::Id ids[NUM_TEXTURE_UNITS] = {
+        Regs::TextureUnit0Type, Regs::TextureUnit1Type, Regs::TextureUnit2Type
+    };
+    return ids[n];
+}
+
+/// Number of texture combiner stages, and of the stages that can update the combiner buffer
+enum {
+    NUM_TEV_STAGES             = 6,
+    NUM_TEV_BUFFER_STAGES      = 4,
+};
+
+// The registers of each texture combiner stage are laid out like those of stage 0, but stages 4
+// and 5 come after the combiner buffer registers
+static inline Regs::Id TexEnvRegister(Regs::Id stage0_id, int stage)
+{
+    static const u32 offsets[NUM_TEV_STAGES] = { 0x00, 0x08, 0x10, 0x18, 0x30, 0x38 };
+    return static_cast<Regs::Id>(stage0_id + offsets[stage]);
+}
+
+/**
+ * Converts a PICA 24-bit float (1 sign bit, 7 exponent bits, 16 mantissa bits) to a float
+ * @param value 24-bit float in the low bits
+ * @return Float with the same value
+ */
+static inline float Float24ToFloat(u32 value)
+{
+    union {
+        u32 hex;
+        float f;
+    } result;
+
+    const u32 sign = (value >> 23) & 1;
+    const u32 exponent = (value >> 16) & 0x7F;
+    const u32 mantissa = value & 0xFFFF;
+    if (exponent == 0 && mantissa == 0) {
+        result.hex = sign << 31;
+    } else {
+        // Rebias the exponent from 63 to 127
+        result.hex = (sign << 31) | ((exponent + 64) << 23) | (mantissa << 7);
+    }
+    return result.f;
+}
+
 union CommandHeader {
     CommandHeader(u32 h) : hex(h) {}
 
@@ -70,12 +211,42 @@ static std::map<Regs::Id, const char*> command_names = {
     {Regs::ViewportInvSizeX, "ViewportInvSizeX" },
     {Regs::ViewportSizeY, "ViewportSizeY" },
     {Regs::ViewportInvSizeY, "ViewportInvSizeY" },
+    {Regs::ViewportDepthRange, "ViewportDepthRange" },
+    {Regs::ViewportDepthNearPlane, "ViewportDepthNearPlane" },
     {Regs::ViewportCorner, "ViewportCorner" },
+    {Regs::TextureUnitsConfig, "TextureUnitsConfig" },
+    {Regs::TexEnv0Source, "TexEnv0Source" },
+    {Regs::TexEnv0Modifier, "TexEnv0Modifier" },
+    {Regs::TexEnv0Operation, "TexEnv0Operation" },
+    {Regs::TexEnv0Color, "TexEnv0Color" },
+    {Regs::TexEnv0Scale, "TexEnv0Scale" },
+    {Regs::TexEnvBufferInput, "TexEnvBufferInput" },
+    {Regs::TexEnvBufferColor, "TexEnvBufferColor" },
+    {Regs::DepthColorMask, "DepthColorMask" },
     {Regs::DepthBufferFormat, "DepthBufferFormat" },
     {Regs::ColorBufferFormat, "ColorBufferFormat" },
     {Regs::DepthBufferAddress, "DepthBufferAddress" },
     {Regs::ColorBufferAddress, "ColorBufferAddress" },
     {Regs::ColorBufferSize, "ColorBufferSize" },
+    {Regs::VertexArrayBaseAddr, "VertexArrayBaseAddr" },
+    {Regs::IndexArrayConfig, "IndexArrayConfig" },
+    {Regs::NumVertices, "NumVertices" },
+    {Regs::TriggerDraw, "TriggerDraw" },
+    {Regs::TriggerDrawIndexed, "TriggerDrawIndexed" },
+    {Regs::TriangleTopology, "TriangleTopology" },
+    {Regs::VSBoolUniforms, "VSBoolUniforms" },
+    {Regs::VSMainOffset, "VSMainOffset" },
+    {Regs::VSInputRegisterMap, "VSInputRegisterMap" },
+    {Regs::VSOutputMask, "VSOutputMask" },
+    {Regs::VSFloatUniformSetup, "VSFloatUniformSetup" },
+    {Regs::VSFloatUniformData, "VSFloatUniformData" },
+    {Regs::VSBeginLoadProgramData, "VSBeginLoadProgramData" },
+    {Regs::VSLoadProgramData, "VSLoadProgramData" },
+    {Regs::VSBeginLoadSwizzleData, "VSBeginLoadSwizzleData" },
+    {Regs::VSLoadSwizzleData, "VSLoadSwizzleData" },
+    {Regs::TextureUnit0Size, "TextureUnit0Size" },
+    {Regs::TextureUnit0Address, "TextureUnit0Address" },
+    {Regs::TextureUnit0Type, "TextureUnit0Type" },
 };
 
 template<>
@@ -88,6 +259,493 @@ union Regs::Struct<Regs::ViewportSizeY> {
     BitField<0, 24, u32> value;
 };
 
+template<>
+union Regs::Struct<Regs::ViewportCorner> {
+    u32 hex;
+
+    BitField< 0, 10, s32> x;
+    BitField<16, 10, s32> y;
+};
+
+// Depth is mapped from z/w to near_plane + z/w * range. Both registers hold 24-bit floats.
+template<>
+union Regs::Struct<Regs::ViewportDepthRange> {
+    BitField<0, 24, u32> value;
+};
+
+template<>
+union Regs::Struct<Regs::ViewportDepthNearPlane> {
+    BitField<0, 24, u32> value;
+};
+
+template<>
+union Regs::Struct<Regs::TextureUnitsConfig> {
+    u32 hex;
+
+    BitField<0, 1, u32> texture0_enable;
+    BitField<1, 1, u32> texture1_enable;
+    BitField<2, 1, u32> texture2_enable;
+
+    bool IsTextureEnabled(int unit) const {
+        return ((hex >> unit) & 1) != 0;
+    }
+};
+
+// The registers of texture units 1 and 2 have the same layout as those of texture unit 0
+template<>
+union Regs::Struct<Regs::TextureUnit0Size> {
+    u32 hex;
+
+    BitField< 0, 11, u32> height;
+    BitField<16, 11, u32> width;
+};
+
+template<>
+union Regs::Struct<Regs::TextureUnit0Address> {
+    u32 hex;
+
+    BitField<0, 28, u32> address;   // physical address divided by 8
+
+    u32 GetPhysicalAddress() const {
+        return address * 8;
+    }
+};
+
+template<>
+union Regs::Struct<Regs::TextureUnit0Type> {
+    enum class Format : u32 {
+        RGBA8  =  0,
+        RGB8   =  1,
+        RGB5A1 =  2,
+        RGB565 =  3,
+        RGBA4  =  4,
+        IA8    =  5,
+        HILO8  =  6,
+        I8     =  7,
+        A8     =  8,
+        IA4    =  9,
+        I4     = 10,
+        A4     = 11,
+        ETC1   = 12,
+        ETC1A4 = 13,
+    };
+
+    u32 hex;
+
+    BitField<0, 4, Format> format;
+};
+
+// Each texture combiner stage computes a color and an alpha value from three sources, which
+// stage n + 1 can use as its "previous" source. Units without a texture coordinate semantic of
+// their own (texture 2) sample with texture coordinate 1.
+template<>
+union Regs::Struct<Regs::TexEnv0Source> {
+    enum Source : u32 {
+        PrimaryColor            = 0x0,
+        PrimaryFragmentColor    = 0x1,
+        SecondaryFragmentColor  = 0x2,
+        Texture0                = 0x3,
+        Texture1                = 0x4,
+        Texture2                = 0x5,
+        Texture3                = 0x6,
+        PreviousBuffer          = 0xD,
+        Constant                = 0xE,
+        Previous                = 0xF,
+    };
+
+    u32 hex;
+
+    BitField< 0, 4, Source> color_source1;
+    BitField< 4, 4, Source> color_source2;
+    BitField< 8, 4, Source> color_source3;
+    BitField<16, 4, Source> alpha_source1;
+    BitField<20, 4, Source> alpha_source2;
+    BitField<24, 4, Source> alpha_source3;
+
+    Source GetColorSource(int n) const {
+        return static_cast<Source>((hex >> (n * 4)) & 0xF);
+    }
+
+    Source GetAlphaSource(int n) const {
+        return static_cast<Source>((hex >> (16 + n * 4)) & 0xF);
+    }
+};
+
+template<>
+union Regs::Struct<Regs::TexEnv0Modifier> {
+    enum ColorModifier : u32 {
+        SourceColor             = 0x0,
+        OneMinusSourceColor     = 0x1,
+        SourceAlpha             = 0x2,
+        OneMinusSourceAlpha     = 0x3,
+        SourceRed               = 0x4,
+        OneMinusSourceRed       = 0x5,
+        SourceGreen             = 0x8,
+        OneMinusSourceGreen     = 0x9,
+        SourceBlue              = 0xC,
+        OneMinusSourceBlue      = 0xD,
+    };
+
+    enum AlphaModifier : u32 {
+        AlphaSourceAlpha        = 0x0,
+        AlphaOneMinusSourceAlpha = 0x1,
+        AlphaSourceRed          = 0x2,
+        AlphaOneMinusSourceRed  = 0x3,
+        AlphaSourceGreen        = 0x4,
+        AlphaOneMinusSourceGreen = 0x5,
+        AlphaSourceBlue         = 0x6,
+        AlphaOneMinusSourceBlue = 0x7,
+    };
+
+    u32 hex;
+
+    BitField< 0, 4, ColorModifier> color_modifier1;
+    BitField< 4, 4, ColorModifier> color_modifier2;
+    BitField< 8, 4, ColorModifier> color_modifier3;
+    BitField<12, 3, AlphaModifier> alpha_modifier1;
+    BitField<16, 3, AlphaModifier> alpha_modifier2;
+    BitField<20, 3, AlphaModifier> alpha_modifier3;
+
+    ColorModifier GetColorModifier(int n) const {
+        return static_cast<ColorModifier>((hex >> (n * 4)) & 0xF);
+    }
+
+    AlphaModifier GetAlphaModifier(int n) const {
+        return static_cast<AlphaModifier>((hex >> (12 + n * 4)) & 0x7);
+    }
+};
+
+template<>
+union Regs::Struct<Regs::TexEnv0Operation> {
+    enum Operation : u32 {
+        Replace             = 0,    // a
+        Modulate            = 1,    // a * b
+        Add                 = 2,    // a + b
+        AddSigned           = 3,    // a + b - 0.5
+        Lerp                = 4,    // a * c + b * (1 - c)
+        Subtract            = 5,    // a - b
+        Dot3_RGB            = 6,    // 4 * dot(a - 0.5, b - 0.5), in all components
+        MultiplyThenAdd     = 8,    // a * b + c
+        AddThenMultiply     = 9,    // min(a + b, 1) * c
+    };
+
+    u32 hex;
+
+    BitField< 0, 4, Operation> color_op;
+    BitField<16, 4, Operation> alpha_op;
+};
+
+template<>
+union Regs::Struct<Regs::TexEnv0Color> {
+    u32 hex;
+
+    BitField< 0, 8, u32> r;
+    BitField< 8, 8, u32> g;
+    BitField<16, 8, u32> b;
+    BitField<24, 8, u32> a;
+};
+
+// The result of a stage is multiplied by 1 << scale
+template<>
+union Regs::Struct<Regs::TexEnv0Scale> {
+    u32 hex;
+
+    BitField< 0, 2, u32> color_scale;
+    BitField<16, 2, u32> alpha_scale;
+};
+
+// The combiner buffer starts out as TexEnvBufferColor. After each of the first four stages, it is
+// either updated with the result of the stage or kept, separately for color and alpha.
+template<>
+union Regs::Struct<Regs::TexEnvBufferInput> {
+    u32 hex;
+
+    BitField< 8, 4, u32> update_color;  // one bit per stage
+    BitField<12, 4, u32> update_alpha;
+
+    bool UpdatesColor(int stage) const {
+        return ((hex >> (8 + stage)) & 1) != 0;
+    }
+
+    bool UpdatesAlpha(int stage) const {
+        return ((hex >> (12 + stage)) & 1) != 0;
+    }
+};
+
+template<>
+union Regs::Struct<Regs::TexEnvBufferColor> {
+    u32 hex;
+
+    BitField< 0, 8, u32> r;
+    BitField< 8, 8, u32> g;
+    BitField<16, 8, u32> b;
+    BitField<24, 8, u32> a;
+};
+
+template<>
+union Regs::Struct<Regs::DepthColorMask> {
+    enum class CompareFunc : u32 {
+        Never               = 0,
+        Always              = 1,
+        Equal               = 2,
+        NotEqual            = 3,
+        LessThan            = 4,
+        LessThanOrEqual     = 5,
+        GreaterThan         = 6,
+        GreaterThanOrEqual  = 7,
+    };
+
+    u32 hex;
+
+    BitField< 0, 1, u32> depth_test_enable;
+    BitField< 4, 3, CompareFunc> depth_test_func;
+    BitField< 8, 1, u32> red_enable;
+    BitField< 9, 1, u32> green_enable;
+    BitField<10, 1, u32> blue_enable;
+    BitField<11, 1, u32> alpha_enable;
+    BitField<12, 1, u32> depth_write_enable;
+};
+
+template<>
+union Regs::Struct<Regs::DepthBufferFormat> {
+    enum class Format : u32 {
+        D16    = 0,
+        D24    = 2,
+        D24S8  = 3,
+    };
+
+    u32 hex;
+
+    BitField<0, 2, Format> depth_format;
+};
+
+template<>
+union Regs::Struct<Regs::ColorBufferFormat> {
+    enum class Format : u32 {
+        RGBA8  = 0,
+        RGB8   = 1,
+        RGB5A1 = 2,
+        RGB565 = 3,
+        RGBA4  = 4,
+    };
+
+    u32 hex;
+
+    BitField<16, 3, Format> color_format;
+};
+
+template<>
+union Regs::Struct<Regs::DepthBufferAddress> {
+    u32 hex;
+
+    BitField<0, 28, u32> address;   // physical address divided by 8
+
+    u32 GetPhysicalAddress() const {
+        return address * 8;
+    }
+};
+
+template<>
+union Regs::Struct<Regs::ColorBufferAddress> {
+    u32 hex;
+
+    BitField<0, 28, u32> address;   // physical address divided by 8
+
+    u32 GetPhysicalAddress() const {
+        return address * 8;
+    }
+};
+
+template<>
+union Regs::Struct<Regs::ColorBufferSize> {
+    u32 hex;
+
+    BitField< 0, 11, u32> width;
+    BitField<12, 10, u32> height;
+};
+
+template<>
+union Regs::Struct<Regs::VertexArrayBaseAddr> {
+    u32 hex;
+
+    BitField<0, 29, u32> base_address;  // physical address divided by 8
+
+    u32 GetPhysicalBaseAddress() const {
+        return base_address * 8;
+    }
+};
+
+// Each of the 12 vertex loaders reads consecutive components from one interleaved array. A
+// component is either a vertex attribute or, for values 12 to 15, 4 to 16 bytes of padding.
+template<>
+union Regs::Struct<Regs::VertexAttributeInfo0> {
+    u32 hex;
+
+    BitField< 0, 4, u32> comp0;
+    BitField< 4, 4, u32> comp1;
+    BitField< 8, 4, u32> comp2;
+    BitField<12, 4, u32> comp3;
+    BitField<16, 4, u32> comp4;
+    BitField<20, 4, u32> comp5;
+    BitField<24, 4, u32> comp6;
+    BitField<28, 4, u32> comp7;
+
+    u32 GetComponent(int n) const {
+        return (hex >> (n * 4)) & 0xF;
+    }
+};
+
+template<>
+union Regs::Struct<Regs::VertexAttributeInfo1> {
+    u32 hex;
+
+    BitField< 0, 4, u32> comp8;
+    BitField< 4, 4, u32> comp9;
+    BitField< 8, 4, u32> comp10;
+    BitField<12, 4, u32> comp11;
+    BitField<16, 8, u32> byte_count;        // stride of the array
+    BitField<28, 4, u32> component_count;
+
+    u32 GetComponent(int n) const {
+        return (hex >> ((n - 8) * 4)) & 0xF;
+    }
+};
+
+template<>
+union Regs::Struct<Regs::IndexArrayConfig> {
+    u32 hex;
+
+    BitField< 0, 31, u32> offset;           // relative to the vertex array base address
+    BitField<31,  1, u32> format;           // 0: 8-bit indices, 1: 16-bit indices
+};
+
+template<>
+union Regs::Struct<Regs::TriangleTopology> {
+    enum class Topology : u32 {
+        List        = 0,
+        Strip       = 1,
+        Fan         = 2,
+        ShaderList  = 3,    // list emitted by the geometry shader
+    };
+
+    u32 hex;
+
+    BitField<8, 2, Topology> topology;
+};
+
+// Semantics of the four components of a vertex shader output register
+template<>
+union Regs::Struct<Regs::VertexOutputMap> {
+    enum Semantic : u32 {
+        POSITION_X   =  0,
+        POSITION_Y   =  1,
+        POSITION_Z   =  2,
+        POSITION_W   =  3,
+
+        QUATERNION_X =  4,
+        QUATERNION_Y =  5,
+        QUATERNION_Z =  6,
+        QUATERNION_W =  7,
+
+        COLOR_R      =  8,
+        COLOR_G      =  9,
+        COLOR_B      = 10,
+        COLOR_A      = 11,
+
+        TEXCOORD0_U  = 12,
+        TEXCOORD0_V  = 13,
+        TEXCOORD1_U  = 14,
+        TEXCOORD1_V  = 15,
+
+        INVALID      = 31,
+    };
+
+    u32 hex;
+
+    BitField< 0, 5, Semantic> map_x;
+    BitField< 8, 5, Semantic> map_y;
+    BitField<16, 5, Semantic> map_z;
+    BitField<24, 5, Semantic> map_w;
+
+    Semantic GetSemantic(int component) const {
+        return static_cast<Semantic>((hex >> (component * 8)) & 0x1F);
+    }
+};
+
+// Loop parameters of the LOOP instruction. The loop body runs count + 1 times, with the loop
+// register aL starting at start and increased by increment after each iteration.
+template<>
+union Regs::Struct<Regs::VSIntUniform0> {
+    u32 hex;
+
+    BitField< 0, 8, u32> count;
+    BitField< 8, 8, u32> start;
+    BitField<16, 8, u32> increment;
+};
+
+template<>
+union Regs::Struct<Regs::VSMainOffset> {
+    u32 hex;
+
+    BitField<0, 16, u32> offset;    // entry point, in instructions
+};
+
+// Input register of each vertex attribute
+template<>
+union Regs::Struct<Regs::VSInputRegisterMap> {
+    u64 hex;
+
+    BitField< 0, 4, u64> attribute0_register;
+    BitField< 4, 4, u64> attribute1_register;
+    BitField< 8, 4, u64> attribute2_register;
+    BitField<12, 4, u64> attribute3_register;
+    BitField<16, 4, u64> attribute4_register;
+    BitField<20, 4, u64> attribute5_register;
+    BitField<24, 4, u64> attribute6_register;
+    BitField<28, 4, u64> attribute7_register;
+    BitField<32, 4, u64> attribute8_register;
+    BitField<36, 4, u64> attribute9_register;
+    BitField<40, 4, u64> attribute10_register;
+    BitField<44, 4, u64> attribute11_register;
+
+    int GetRegisterForAttribute(int attribute) const {
+        return (int)((hex >> (attribute * 4)) & 0xF);
+    }
+};
+
+// Output registers written by the shader. The enabled ones are mapped to VertexOutputMap 0, 1, ...
+// in order.
+template<>
+union Regs::Struct<Regs::VSOutputMask> {
+    u32 hex;
+
+    BitField<0, 16, u32> mask;
+};
+
+// Float uniforms are uploaded starting at index, as three words holding four 24-bit floats or as
+// four 32-bit floats, w first in both cases
+template<>
+union Regs::Struct<Regs::VSFloatUniformSetup> {
+    u32 hex;
+
+    BitField< 0, 8, u32> index;
+    BitField<31, 1, u32> float32;
+};
+
+template<>
+union Regs::Struct<Regs::VSBeginLoadProgramData> {
+    u32 hex;
+
+    BitField<0, 12, u32> offset;    // in instructions
+};
+
+template<>
+union Regs::Struct<Regs::VSBeginLoadSwizzleData> {
+    u32 hex;
+
+    BitField<0, 12, u32> offset;    // in swizzle patterns
+};
+
 template<>
 union Regs::Struct<Regs::VertexDescriptor> {
     enum class Format : u64 {
@@ -97,6 +755,8 @@ union Regs::Struct<Regs::VertexDescriptor> {
         FLOAT = 3,
     };
 
+    u64 hex;
+
     BitField< 0,  2, Format> format0;
     BitField< 2,  2, u64> size0;      // number of elements minus 1
     BitField< 4,  2, Format> format1;
@@ -124,6 +784,14 @@ union Regs::Struct<Regs::VertexDescriptor> {
 
     BitField<48, 12, u64> attribute_mask;
     BitField<60,  4, u64> num_attributes; // number of total attributes minus 1
+
+    Format GetFormat(int n) const {
+        return static_cast<Format>((hex >> (n * 4)) & 3);
+    }
+
+    int GetNumElements(int n) const {
+        return (int)((hex >> (n * 4 + 2)) & 3) + 1;
+    }
 };
 
 
@@ -0,0 +1,68 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include "common/common.h"
+#include "common/log.h"
+
+#include "video_core/primitive_assembly.h"
+
+namespace Pica {
+
+namespace PrimitiveAssembly {
+
+typedef Regs::Struct<Regs::TriangleTopology>::Topology Topology;
+
+static Topology g_topology = Topology::List;
+static TriangleHandler g_triangle_handler = NULL;
+
+static VertexShader::OutputVertex g_buffer[2];  ///< Vertices kept for the next triangle
+static int g_buffer_index = 0;                  ///< Number of vertices in g_buffer
+static bool g_strip_odd = false;                ///< Whether the next strip triangle is odd
+
+void Begin(Topology topology, TriangleHandler triangle_handler) {
+    g_topology = topology;
+    g_triangle_handler = triangle_handler;
+    g_buffer_index = 0;
+    g_strip_odd = false;
+}
+
+void SubmitVertex(const VertexShader::OutputVertex& vertex) {
+    if (g_buffer_index < 2) {
+        g_buffer[g_buffer_index++] = vertex;
+        return;
+    }
+
+    switch (g_topology) {
+    case Topology::List:
+    case Topology::ShaderList:
+        g_triangle_handler(g_buffer[0], g_buffer[1], vertex);
+        g_buffer_index = 0;
+        break;
+
+    case Topology::Strip:
+        // Every other triangle of a strip is flipped to keep the winding order
+        if (g_strip_odd) {
+            g_triangle_handler(g_buffer[1], g_buffer[0], vertex);
+        } else {
+            g_triangle_handler(g_buffer[0], g_buffer[1], vertex);
+        }
+        g_strip_odd = !g_strip_odd;
+        g_buffer[0] = g_buffer[1];
+        g_buffer[1] = vertex;
+        break;
+
+    case Topology::Fan:
+        g_triangle_handler(g_buffer[0], g_buffer[1], vertex);
+        g_buffer[1] = vertex;
+        break;
+
+    default:
+        ERROR_LOG(GPU, "unknown triangle topology %d", (int)g_topology);
+        break;
+    }
+}
+
+} // namespace
+
+} // namespace
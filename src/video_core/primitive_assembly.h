@@ -0,0 +1,34 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "video_core/pica.h"
+#include "video_core/vertex_shader.h"
+
+namespace Pica {
+
+namespace PrimitiveAssembly {
+
+/// Called for each triangle assembled
+typedef void (*TriangleHandler)(const VertexShader::OutputVertex& v0,
+    const VertexShader::OutputVertex& v1, const VertexShader::OutputVertex& v2);
+
+/**
+ * Starts assembling a new batch of primitives
+ * @param topology Topology of the primitives
+ * @param triangle_handler Function to pass each triangle to
+ */
+void Begin(Regs::Struct<Regs::TriangleTopology>::Topology topology,
+    TriangleHandler triangle_handler);
+
+/**
+ * Adds a shaded vertex to the current batch, passing any triangle it completes to the handler
+ * @param vertex Vertex to add
+ */
+void SubmitVertex(const VertexShader::OutputVertex& vertex);
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,676 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <vector>
+
+#include "common/common.h"
+#include "common/cpu_detect.h"
+#include "common/log.h"
+#include "common/thread.h"
+
+#include "core/mem_map.h"
+
+#include "video_core/rasterizer.h"
+#include "video_core/texture_cache.h"
+#include "video_core/morton.h"
+
+#ifdef EMU_ARCHITECTURE_X64
+#include <immintrin.h>
+#endif
+
+namespace Pica {
+
+namespace Rasterizer {
+
+typedef VertexShader::OutputVertex OutputVertex;
+typedef Regs::Struct<Regs::ColorBufferFormat>::Format ColorFormat;
+
+enum {
+    SUBPIXEL_BITS           = 4,    ///< Fractional bits of the fixed point screen coordinates
+    SUBPIXEL_ONE            = (1 << SUBPIXEL_BITS),
+
+    TILE_WIDTH              = 32,   ///< Width of the tiles rasterized in parallel, multiple of 8
+    TILE_HEIGHT             = 32,   ///< Height of the tiles rasterized in parallel, multiple of 8
+
+    MAX_WORKERS             = 7,    ///< Maximum number of worker threads
+    MIN_PARALLEL_TRIANGLES  = 8,    ///< Smaller batches are rasterized on the calling thread
+    MAX_BATCH_TRIANGLES     = 8192, ///< Batches are flushed once they reach this size
+
+    MAX_CLIPPED_VERTICES    = 16,
+};
+
+/**
+ * Triangles are clipped to this many times the viewport size around its center. This keeps all
+ * edge function values within 32 bits, even for triangles spanning the whole guard band.
+ */
+static const float GUARD_BAND = 2.0f;
+
+/// Minimum w of clipped vertices, avoids dividing by zero in the perspective divide
+static const float MIN_W = 1.0e-5f;
+
+/// Triangle set up for rasterization
+struct Triangle {
+    s32 x[3], y[3];             ///< Screen positions, fixed point with SUBPIXEL_BITS
+    s32 min_x, min_y;           ///< First pixel of the bounding box
+    s32 max_x, max_y;           ///< Last pixel of the bounding box (inclusive)
+    float inv_area;             ///< Reciprocal of twice the area, in fixed point units
+    float inv_w[3];             ///< 1/w of each vertex
+    float color_w[4][3];        ///< color/w of each vertex, component-major
+};
+
+/// Color buffer the current batch is rasterized into
+struct RenderTarget {
+    u32 address;            ///< Physical address of the color buffer
+    u8* color_buffer;
+    u32 width;
+    u32 height;
+    ColorFormat format;
+    u32 bytes_per_pixel;
+};
+
+static std::vector<Triangle> g_triangles;       ///< Triangles of the current batch
+static RenderTarget g_target;
+
+// Worker pool
+static std::vector<std::thread*> g_workers;
+static Common::Event g_work_start[MAX_WORKERS]; ///< Wakes up each worker for a new batch
+static Common::Event g_work_done[MAX_WORKERS];  ///< Set by each worker when it runs out of tiles
+static volatile bool g_workers_quit = false;
+static std::mutex g_tile_mutex;
+static int g_next_tile = 0;                     ///< Next tile to hand out, guarded by g_tile_mutex
+static int g_num_tiles = 0;
+static int g_num_tiles_x = 0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Clipping and setup
+
+/**
+ * Linearly interpolates all attributes of two vertices
+ * @param a First vertex
+ * @param b Second vertex
+ * @param t Interpolation factor, 0 gives a and 1 gives b
+ * @return Interpolated vertex
+ */
+static OutputVertex Lerp(const OutputVertex& a, const OutputVertex& b, float t) {
+    const int num_floats = sizeof(OutputVertex) / sizeof(float);
+    const float* fa = &a.pos[0];
+    const float* fb = &b.pos[0];
+
+    OutputVertex result;
+    float* fr = &result.pos[0];
+    for (int i = 0; i < num_floats; i++) {
+        fr[i] = fa[i] + (fb[i] - fa[i]) * t;
+    }
+    return result;
+}
+
+/// Distance of a vertex to a clipping plane, the vertex is inside if it is not negative
+static inline float PlaneDistance(const OutputVertex& v, int plane) {
+    switch (plane) {
+    case 0:  return v.pos[3] - MIN_W;
+    case 1:  return GUARD_BAND * v.pos[3] - v.pos[0];
+    case 2:  return GUARD_BAND * v.pos[3] + v.pos[0];
+    case 3:  return GUARD_BAND * v.pos[3] - v.pos[1];
+    default: return GUARD_BAND * v.pos[3] + v.pos[1];
+    }
+}
+static const int NUM_CLIP_PLANES = 5;
+
+/**
+ * Sets up a triangle in screen space and queues it up, unless it has no area
+ * @param v Vertices of the triangle, with w > 0
+ */
+static void SetupTriangle(const OutputVertex* v[3]) {
+    const float viewport_x = Float24ToFloat(g_regs[Regs::ViewportSizeX]);
+    const float viewport_y = Float24ToFloat(g_regs[Regs::ViewportSizeY]);
+    const Regs::Struct<Regs::ViewportCorner>& corner = GetRegister<Regs::ViewportCorner>();
+
+    Triangle tri;
+    for (int i = 0; i < 3; i++) {
+        const float inv_w = 1.0f / v[i]->pos[3];
+        const float screen_x = (v[i]->pos[0] * inv_w + 1.0f) * viewport_x + corner.x;
+        const float screen_y = (v[i]->pos[1] * inv_w + 1.0f) * viewport_y + corner.y;
+
+        tri.x[i] = (s32)(screen_x * SUBPIXEL_ONE + 0.5f);
+        tri.y[i] = (s32)(screen_y * SUBPIXEL_ONE + 0.5f);
+        tri.inv_w[i] = inv_w;
+        for (int comp = 0; comp < 4; comp++) {
+            tri.color_w[comp][i] = v[i]->color[comp] * inv_w;
+        }
+    }
+
+    // Make the winding counter-clockwise, so that the area and all edge functions are positive
+    s32 area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) -
+        (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+    if (area == 0)
+        return;
+    if (area < 0) {
+        std::swap(tri.x[1], tri.x[2]);
+        std::swap(tri.y[1], tri.y[2]);
+        std::swap(tri.inv_w[1], tri.inv_w[2]);
+        for (int comp = 0; comp < 4; comp++) {
+            std::swap(tri.color_w[comp][1], tri.color_w[comp][2]);
+        }
+        area = -area;
+    }
+    tri.inv_area = 1.0f / area;
+
+    // Pixels are sampled at their centers
+    const s32 half = SUBPIXEL_ONE / 2;
+    tri.min_x = (std::min(tri.x[0], std::min(tri.x[1], tri.x[2])) - half + SUBPIXEL_ONE - 1)
+        >> SUBPIXEL_BITS;
+    tri.min_y = (std::min(tri.y[0], std::min(tri.y[1], tri.y[2])) - half + SUBPIXEL_ONE - 1)
+        >> SUBPIXEL_BITS;
+    tri.max_x = (std::max(tri.x[0], std::max(tri.x[1], tri.x[2])) - half) >> SUBPIXEL_BITS;
+    tri.max_y = (std::max(tri.y[0], std::max(tri.y[1], tri.y[2])) - half) >> SUBPIXEL_BITS;
+    if (tri.min_x > tri.max_x || tri.min_y > tri.max_y)
+        return;
+
+    if (g_triangles.size() >= MAX_BATCH_TRIANGLES) {
+        Flush();
+    }
+    g_triangles.push_back(tri);
+}
+
+void AddTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2) {
+    // Sutherland-Hodgman clipping against w > 0 and the guard band
+    OutputVertex buffers[2][MAX_CLIPPED_VERTICES];
+    OutputVertex* in = buffers[0];
+    OutputVertex* out = buffers[1];
+    int num_in = 3;
+    in[0] = v0;
+    in[1] = v1;
+    in[2] = v2;
+
+    for (int plane = 0; plane < NUM_CLIP_PLANES; plane++) {
+        int num_out = 0;
+        for (int i = 0; i < num_in; i++) {
+            const OutputVertex& cur = in[i];
+            const OutputVertex& next = in[(i + 1) % num_in];
+            const float d_cur = PlaneDistance(cur, plane);
+            const float d_next = PlaneDistance(next, plane);
+
+            if (d_cur >= 0.0f) {
+                out[num_out++] = cur;
+            }
+            if ((d_cur >= 0.0f) != (d_next >= 0.0f)) {
+                out[num_out++] = Lerp(cur, next, d_cur / (d_cur - d_next));
+            }
+        }
+        if (num_out < 3)
+            return;
+
+        std::swap(in, out);
+        num_in = num_out;
+    }
+
+    // Triangulate the clipped polygon as a fan
+    for (int i = 1; i + 1 < num_in; i++) {
+        const OutputVertex* triangle[3] = { &in[0], &in[i], &in[i + 1] };
+        SetupTriangle(triangle);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rasterization
+
+/**
+ * Writes a pixel to the color buffer
+ * @param x X coordinate of the pixel, counted from the left
+ * @param y Y coordinate of the pixel, counted from the bottom
+ * @param color RGBA color of the pixel
+ */
+static inline void WritePixel(int x, int y, const u8 color[4]) {
+    // Framebuffers are stored top-down
+    u8* dst = g_target.color_buffer + VideoCore::GetMortonOffset(x, g_target.height - 1 - y,
+        g_target.width, g_target.bytes_per_pixel);
+    const u32 r = color[0], g = color[1], b = color[2], a = color[3];
+
+    switch (g_target.format) {
+    case ColorFormat::RGBA8:
+        *(u32*)dst = (r << 24) | (g << 16) | (b << 8) | a;
+        break;
+
+    case ColorFormat::RGB8:
+        dst[0] = b;
+        dst[1] = g;
+        dst[2] = r;
+        break;
+
+    case ColorFormat::RGB5A1:
+        *(u16*)dst = (u16)(((r >> 3) << 11) | ((g >> 3) << 6) | ((b >> 3) << 1) | (a >> 7));
+        break;
+
+    case ColorFormat::RGB565:
+        *(u16*)dst = (u16)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+        break;
+
+    case ColorFormat::RGBA4:
+        *(u16*)dst = (u16)(((r >> 4) << 12) | ((g >> 4) << 8) | ((b >> 4) << 4) | (a >> 4));
+        break;
+    }
+}
+
+/// Edge functions of a triangle, evaluated at the center of a pixel
+struct EdgeSetup {
+    s32 value[3];   ///< Values at the first pixel, with the fill rule bias applied
+    s32 step_x[3];  ///< Increment per pixel to the right
+    s32 step_y[3];  ///< Increment per pixel upwards
+};
+
+/**
+ * Sets up the edge functions of a triangle. Edge function i is positive inside the triangle and
+ * proportional to the barycentric weight of vertex i.
+ * @param tri Triangle to set up
+ * @param x X coordinate of the first pixel
+ * @param y Y coordinate of the first pixel
+ * @param edges Edge functions to set up
+ */
+static void SetupEdges(const Triangle& tri, int x, int y, EdgeSetup& edges) {
+    const s32 px = (x << SUBPIXEL_BITS) + SUBPIXEL_ONE / 2;
+    const s32 py = (y << SUBPIXEL_BITS) + SUBPIXEL_ONE / 2;
+
+    for (int i = 0; i < 3; i++) {
+        const int a = (i + 1) % 3;
+        const int b = (i + 2) % 3;
+        const s32 dx = tri.x[b] - tri.x[a];
+        const s32 dy = tri.y[b] - tri.y[a];
+
+        // Pixel centers exactly on an edge shared by two triangles must be drawn by only one of
+        // them. The edge runs in opposite directions in the two triangles, so including centers on
+        // edges running in one half of the directions only is enough.
+        const bool include_edge = (dy > 0) || (dy == 0 && dx < 0);
+
+        edges.value[i] = dx * (py - tri.y[a]) - dy * (px - tri.x[a]) - (include_edge ? 0 : 1);
+        edges.step_x[i] = -dy * SUBPIXEL_ONE;
+        edges.step_y[i] = dx * SUBPIXEL_ONE;
+    }
+}
+
+#ifdef EMU_ARCHITECTURE_X64
+
+/**
+ * Rasterizes a triangle within a rectangle, four pixels at a time with SSE2
+ * @param tri Triangle to rasterize
+ * @param x0 First column, y0 First row, x1 Last column, y1 Last row of the rectangle
+ */
+static void RasterizeTriangleSSE2(const Triangle& tri, int x0, int y0, int x1, int y1) {
+    EdgeSetup edges;
+    SetupEdges(tri, x0, y0, edges);
+
+    // Each lane handles every fourth pixel of a row, starting at x0 + lane
+    __m128i row[3], step_x4[3];
+    for (int i = 0; i < 3; i++) {
+        const s32 s = edges.step_x[i];
+        row[i] = _mm_set_epi32(edges.value[i] + 3 * s, edges.value[i] + 2 * s,
+            edges.value[i] + s, edges.value[i]);
+        step_x4[i] = _mm_set1_epi32(4 * s);
+    }
+
+    const __m128 inv_area = _mm_set1_ps(tri.inv_area);
+
+    for (int y = y0; y <= y1; y++) {
+        __m128i e0 = row[0], e1 = row[1], e2 = row[2];
+        for (int x = x0; x <= x1; x += 4) {
+            // A pixel is covered if none of its edge function values is negative
+            const __m128i any = _mm_or_si128(_mm_or_si128(e0, e1), e2);
+            int mask = ~_mm_movemask_ps(_mm_castsi128_ps(any)) & 0xF;
+            if (x1 - x < 3) {
+                mask &= (1 << (x1 - x + 1)) - 1;
+            }
+
+            if (mask) {
+                const __m128 w0 = _mm_mul_ps(_mm_cvtepi32_ps(e0), inv_area);
+                const __m128 w1 = _mm_mul_ps(_mm_cvtepi32_ps(e1), inv_area);
+                const __m128 w2 = _mm_mul_ps(_mm_cvtepi32_ps(e2), inv_area);
+                const __m128 inv_w = _mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(w0, _mm_set1_ps(tri.inv_w[0])),
+                    _mm_mul_ps(w1, _mm_set1_ps(tri.inv_w[1]))),
+                    _mm_mul_ps(w2, _mm_set1_ps(tri.inv_w[2])));
+                const __m128 w = _mm_div_ps(_mm_set1_ps(255.0f), inv_w);
+
+                MEMORY_ALIGNED16(s32 channels[4][4]);
+                for (int comp = 0; comp < 4; comp++) {
+                    __m128 value = _mm_add_ps(_mm_add_ps(
+                        _mm_mul_ps(w0, _mm_set1_ps(tri.color_w[comp][0])),
+                        _mm_mul_ps(w1, _mm_set1_ps(tri.color_w[comp][1]))),
+                        _mm_mul_ps(w2, _mm_set1_ps(tri.color_w[comp][2])));
+                    value = _mm_mul_ps(value, w);
+                    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()),
+                        _mm_set1_ps(255.0f));
+                    _mm_store_si128((__m128i*)channels[comp],
+                        _mm_cvtps_epi32(value));
+                }
+
+                for (int lane = 0; lane < 4; lane++) {
+                    if (mask & (1 << lane)) {
+                        const u8 color[4] = {
+                            (u8)channels[0][lane], (u8)channels[1][lane],
+                            (u8)channels[2][lane], (u8)channels[3][lane]
+                        };
+                        WritePixel(x + lane, y, color);
+                    }
+                }
+            }
+
+            e0 = _mm_add_epi32(e0, step_x4[0]);
+            e1 = _mm_add_epi32(e1, step_x4[1]);
+            e2 = _mm_add_epi32(e2, step_x4[2]);
+        }
+
+        row[0] = _mm_add_epi32(row[0], _mm_set1_epi32(edges.step_y[0]));
+        row[1] = _mm_add_epi32(row[1], _mm_set1_epi32(edges.step_y[1]));
+        row[2] = _mm_add_epi32(row[2], _mm_set1_epi32(edges.step_y[2]));
+    }
+}
+
+/**
+ * Rasterizes a triangle within a rectangle, eight pixels at a time with AVX2. Each lane computes
+ * the same as in RasterizeTriangleSSE2, so both give the same pixels.
+ * @param tri Triangle to rasterize
+ * @param x0 First column, y0 First row, x1 Last column, y1 Last row of the rectangle
+ */
+TARGET_AVX2
+static void RasterizeTriangleAVX2(const Triangle& tri, int x0, int y0, int x1, int y1) {
+    EdgeSetup edges;
+    SetupEdges(tri, x0, y0, edges);
+
+    // Each lane handles every eighth pixel of a row, starting at x0 + lane
+    const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    __m256i row[3], step_x8[3];
+    for (int i = 0; i < 3; i++) {
+        row[i] = _mm256_add_epi32(_mm256_set1_epi32(edges.value[i]),
+            _mm256_mullo_epi32(lanes, _mm256_set1_epi32(edges.step_x[i])));
+        step_x8[i] = _mm256_set1_epi32(8 * edges.step_x[i]);
+    }
+
+    const __m256 inv_area = _mm256_set1_ps(tri.inv_area);
+
+    for (int y = y0; y <= y1; y++) {
+        __m256i e0 = row[0], e1 = row[1], e2 = row[2];
+        for (int x = x0; x <= x1; x += 8) {
+            const __m256i any = _mm256_or_si256(_mm256_or_si256(e0, e1), e2);
+            int mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(any)) & 0xFF;
+            if (x1 - x < 7) {
+                mask &= (1 << (x1 - x + 1)) - 1;
+            }
+
+            if (mask) {
+                const __m256 w0 = _mm256_mul_ps(_mm256_cvtepi32_ps(e0), inv_area);
+                const __m256 w1 = _mm256_mul_ps(_mm256_cvtepi32_ps(e1), inv_area);
+                const __m256 w2 = _mm256_mul_ps(_mm256_cvtepi32_ps(e2), inv_area);
+                const __m256 inv_w = _mm256_add_ps(_mm256_add_ps(
+                    _mm256_mul_ps(w0, _mm256_set1_ps(tri.inv_w[0])),
+                    _mm256_mul_ps(w1, _mm256_set1_ps(tri.inv_w[1]))),
+                    _mm256_mul_ps(w2, _mm256_set1_ps(tri.inv_w[2])));
+                const __m256 w = _mm256_div_ps(_mm256_set1_ps(255.0f), inv_w);
+
+                MEMORY_ALIGNED32(s32 channels[4][8]);
+                for (int comp = 0; comp < 4; comp++) {
+                    __m256 value = _mm256_add_ps(_mm256_add_ps(
+                        _mm256_mul_ps(w0, _mm256_set1_ps(tri.color_w[comp][0])),
+                        _mm256_mul_ps(w1, _mm256_set1_ps(tri.color_w[comp][1]))),
+                        _mm256_mul_ps(w2, _mm256_set1_ps(tri.color_w[comp][2])));
+                    value = _mm256_mul_ps(value, w);
+                    value = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()),
+                        _mm256_set1_ps(255.0f));
+                    _mm256_store_si256((__m256i*)channels[comp],
+                        _mm256_cvtps_epi32(value));
+                }
+
+                for (int lane = 0; lane < 8; lane++) {
+                    if (mask & (1 << lane)) {
+                        const u8 color[4] = {
+                            (u8)channels[0][lane], (u8)channels[1][lane],
+                            (u8)channels[2][lane], (u8)channels[3][lane]
+                        };
+                        WritePixel(x + lane, y, color);
+                    }
+                }
+            }
+
+            e0 = _mm256_add_epi32(e0, step_x8[0]);
+            e1 = _mm256_add_epi32(e1, step_x8[1]);
+            e2 = _mm256_add_epi32(e2, step_x8[2]);
+        }
+
+        row[0] = _mm256_add_epi32(row[0], _mm256_set1_epi32(edges.step_y[0]));
+        row[1] = _mm256_add_epi32(row[1], _mm256_set1_epi32(edges.step_y[1]));
+        row[2] = _mm256_add_epi32(row[2], _mm256_set1_epi32(edges.step_y[2]));
+    }
+}
+
+/**
+ * Rasterizes a triangle within a rectangle, with AVX2 if the host has it
+ * @param tri Triangle to rasterize
+ * @param x0 First column, y0 First row, x1 Last column, y1 Last row of the rectangle
+ */
+static void RasterizeTriangle(const Triangle& tri, int x0, int y0, int x1, int y1) {
+    if (cpu_info.bAVX2) {
+        RasterizeTriangleAVX2(tri, x0, y0, x1, y1);
+    } else {
+        RasterizeTriangleSSE2(tri, x0, y0, x1, y1);
+    }
+}
+
+#else
+
+/**
+ * Interpolates the color of a pixel from its edge function values and writes it
+ * @param tri Triangle being rasterized
+ * @param e Edge function values at the pixel
+ * @param x X coordinate of the pixel
+ * @param y Y coordinate of the pixel
+ */
+static inline void ShadePixel(const Triangle& tri, const s32 e[3], int x, int y) {
+    const float w0 = e[0] * tri.inv_area;
+    const float w1 = e[1] * tri.inv_area;
+    const float w2 = e[2] * tri.inv_area;
+    const float w = 1.0f / (w0 * tri.inv_w[0] + w1 * tri.inv_w[1] + w2 * tri.inv_w[2]);
+
+    u8 color[4];
+    for (int comp = 0; comp < 4; comp++) {
+        const float value = (w0 * tri.color_w[comp][0] + w1 * tri.color_w[comp][1] +
+            w2 * tri.color_w[comp][2]) * w;
+        color[comp] = (u8)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+    WritePixel(x, y, color);
+}
+
+/**
+ * Rasterizes a triangle within a rectangle, one pixel at a time
+ * @param tri Triangle to rasterize
+ * @param x0 First column, y0 First row, x1 Last column, y1 Last row of the rectangle
+ */
+static void RasterizeTriangle(const Triangle& tri, int x0, int y0, int x1, int y1) {
+    EdgeSetup edges;
+    SetupEdges(tri, x0, y0, edges);
+
+    s32 row[3] = { edges.value[0], edges.value[1], edges.value[2] };
+    for (int y = y0; y <= y1; y++) {
+        s32 e[3] = { row[0], row[1], row[2] };
+        for (int x = x0; x <= x1; x++) {
+            if ((e[0] | e[1] | e[2]) >= 0) {
+                ShadePixel(tri, e, x, y);
+            }
+            for (int i = 0; i < 3; i++) {
+                e[i] += edges.step_x[i];
+            }
+        }
+        for (int i = 0; i < 3; i++) {
+            row[i] += edges.step_y[i];
+        }
+    }
+}
+
+#endif
+
+/**
+ * Checks whether a rectangle lies entirely outside of a triangle, by testing its corners against
+ * each edge. This rejects most of the bounding box of long, thin triangles without visiting it.
+ * @param tri Triangle to test
+ * @param x0 First column, y0 First row, x1 Last column, y1 Last row of the rectangle
+ * @return True if no pixel of the rectangle is covered
+ */
+static bool IsRectOutside(const Triangle& tri, int x0, int y0, int x1, int y1) {
+    EdgeSetup edges;
+    SetupEdges(tri, x0, y0, edges);
+
+    for (int i = 0; i < 3; i++) {
+        const s32 right = edges.step_x[i] * (x1 - x0);
+        const s32 up = edges.step_y[i] * (y1 - y0);
+        const s32 max_value = edges.value[i] + std::max(right, 0) + std::max(up, 0);
+        if (max_value < 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Rasterizes all triangles of the batch overlapping a tile
+ * @param tile Index of the tile, in row-major order
+ */
+static void RasterizeTile(int tile) {
+    const int tile_x0 = (tile % g_num_tiles_x) * TILE_WIDTH;
+    const int tile_y0 = (tile / g_num_tiles_x) * TILE_HEIGHT;
+    const int tile_x1 = std::min(tile_x0 + TILE_WIDTH, (int)g_target.width) - 1;
+    const int tile_y1 = std::min(tile_y0 + TILE_HEIGHT, (int)g_target.height) - 1;
+
+    for (size_t i = 0; i < g_triangles.size(); i++) {
+        const Triangle& tri = g_triangles[i];
+        const int x0 = std::max(tri.min_x, tile_x0);
+        const int y0 = std::max(tri.min_y, tile_y0);
+        const int x1 = std::min(tri.max_x, tile_x1);
+        const int y1 = std::min(tri.max_y, tile_y1);
+        if (x0 <= x1 && y0 <= y1 && !IsRectOutside(tri, x0, y0, x1, y1)) {
+            RasterizeTriangle(tri, x0, y0, x1, y1);
+        }
+    }
+}
+
+/// Rasterizes tiles of the current batch until there are none left
+static void ProcessTiles() {
+    for (;;) {
+        int tile;
+        {
+            std::lock_guard<std::mutex> lock(g_tile_mutex);
+            tile = g_next_tile++;
+        }
+        if (tile >= g_num_tiles)
+            break;
+        RasterizeTile(tile);
+    }
+}
+
+/// Worker thread, rasterizes tiles whenever a batch is flushed
+static void WorkerThread(int index) {
+    Common::SetCurrentThreadName("RasterizerWorker");
+
+    for (;;) {
+        g_work_start[index].Wait();
+        if (g_workers_quit)
+            break;
+        ProcessTiles();
+        g_work_done[index].Set();
+    }
+}
+
+/**
+ * Sets up the color buffer the current batch is rasterized into
+ * @return True if the color buffer is valid
+ */
+static bool SetupRenderTarget() {
+    const Regs::Struct<Regs::ColorBufferSize>& size = GetRegister<Regs::ColorBufferSize>();
+    const u32 address = GetRegister<Regs::ColorBufferAddress>().GetPhysicalAddress();
+
+    g_target.address = address;
+    g_target.width = size.width;
+    g_target.height = size.height;
+    g_target.format = GetRegister<Regs::ColorBufferFormat>().color_format;
+    g_target.color_buffer = Memory::GetPhysicalPointer(address);
+
+    switch (g_target.format) {
+    case ColorFormat::RGBA8:
+        g_target.bytes_per_pixel = 4;
+        break;
+    case ColorFormat::RGB8:
+        g_target.bytes_per_pixel = 3;
+        break;
+    case ColorFormat::RGB5A1:
+    case ColorFormat::RGB565:
+    case ColorFormat::RGBA4:
+        g_target.bytes_per_pixel = 2;
+        break;
+    default:
+        ERROR_LOG(GPU, "unknown color buffer format %d", (int)g_target.format);
+        return false;
+    }
+
+    if (!g_target.color_buffer || g_target.width == 0 || g_target.height == 0) {
+        ERROR_LOG(GPU, "invalid color buffer at 0x%08X (%ux%u)", address, g_target.width,
+            g_target.height);
+        return false;
+    }
+    return true;
+}
+
+void Flush() {
+    if (g_triangles.empty())
+        return;
+
+    if (SetupRenderTarget()) {
+        g_num_tiles_x = (g_target.width + TILE_WIDTH - 1) / TILE_WIDTH;
+        g_num_tiles = g_num_tiles_x * ((g_target.height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+        g_next_tile = 0;
+
+        if (g_workers.empty() || g_triangles.size() < MIN_PARALLEL_TRIANGLES) {
+            ProcessTiles();
+        } else {
+            for (size_t i = 0; i < g_workers.size(); i++) {
+                g_work_start[i].Set();
+            }
+            ProcessTiles();
+            for (size_t i = 0; i < g_workers.size(); i++) {
+                g_work_done[i].Wait();
+            }
+        }
+
+        // The color buffer may be used as a texture later on
+        TextureCache::InvalidateRange(g_target.address,
+            g_target.width * g_target.height * g_target.bytes_per_pixel);
+    }
+
+    g_triangles.clear();
+}
+
+void Init() {
+    g_triangles.reserve(MAX_BATCH_TRIANGLES);
+
+    // Leave one host thread for the rest of the emulator, which also rasterizes while it waits
+    const int num_threads = (int)std::thread::hardware_concurrency();
+    const int num_workers = std::min(std::max(num_threads - 1, 0), (int)MAX_WORKERS);
+
+    g_workers_quit = false;
+    for (int i = 0; i < num_workers; i++) {
+        g_workers.push_back(new std::thread(WorkerThread, i));
+    }
+
+    NOTICE_LOG(GPU, "software rasterizer initialized with %d worker threads", num_workers);
+}
+
+void Shutdown() {
+    g_workers_quit = true;
+    for (size_t i = 0; i < g_workers.size(); i++) {
+        g_work_start[i].Set();
+        g_workers[i]->join();
+        delete g_workers[i];
+    }
+    g_workers.clear();
+    g_triangles.clear();
+}
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,42 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "video_core/vertex_shader.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// PICA200 software rasterizer
+//
+// Triangles are clipped, set up and queued as they are assembled, and rasterized into the current
+// color buffer when the draw call is flushed. The color buffer is split into tiles that are
+// rasterized in parallel by a pool of worker threads, each tile drawing all triangles that
+// overlap it in submission order. Within a tile, edge functions and attribute interpolation are
+// evaluated for eight pixels at a time using AVX2, or four using SSE2, on x86-64 hosts.
+
+namespace Pica {
+
+namespace Rasterizer {
+
+/**
+ * Queues up a triangle for rasterization, clipping it against the view volume first
+ * @param v0 First vertex
+ * @param v1 Second vertex
+ * @param v2 Third vertex
+ */
+void AddTriangle(const VertexShader::OutputVertex& v0, const VertexShader::OutputVertex& v1,
+    const VertexShader::OutputVertex& v2);
+
+/// Rasterizes all queued up triangles into the current color buffer
+void Flush();
+
+/// Initialize the rasterizer, starting its worker threads
+void Init();
+
+/// Shutdown the rasterizer, stopping its worker threads
+void Shutdown();
+
+} // namespace
+
+} // namespace
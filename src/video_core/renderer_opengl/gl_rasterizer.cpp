@@ -0,0 +1,993 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "common/common.h"
+#include "common/file_util.h"
+#include "common/hash.h"
+#include "common/linear_disk_cache.h"
+#include "common/log.h"
+
+#include "core/mem_map.h"
+#include "core/hle/hle.h"
+
+#include "video_core/gpu_thread.h"
+#include "video_core/morton.h"
+#include "video_core/texture_cache.h"
+#include "video_core/renderer_opengl/gl_rasterizer.h"
+#include "video_core/renderer_opengl/gl_shader_gen.h"
+
+namespace Pica {
+
+namespace HWRasterizer {
+
+typedef VertexShader::OutputVertex OutputVertex;
+typedef Regs::Struct<Regs::ColorBufferFormat>::Format ColorFormat;
+typedef Regs::Struct<Regs::DepthBufferFormat>::Format DepthFormat;
+typedef Regs::Struct<Regs::DepthColorMask> DepthColorMask;
+typedef VideoCore::SurfaceFormat SurfaceFormat;
+
+enum {
+    MAX_BATCH_VERTICES      = 3 * 8192, ///< Batches are flushed once they reach this size
+    MAX_CACHED_TEXTURES     = 256,      ///< The texture uploads are dropped beyond this many
+};
+
+/// Vertex attribute locations of the generated programs
+enum {
+    ATTRIBUTE_POSITION      = 0,
+    ATTRIBUTE_COLOR         = 1,
+    ATTRIBUTE_TEXCOORD0     = 2,
+    ATTRIBUTE_TEXCOORD1     = 3,
+};
+
+/// Color or depth buffer cached in a host texture
+struct Surface {
+    u32 address;                            ///< Physical address
+    u32 width;
+    u32 height;
+    SurfaceFormat format;
+    u32 size;                               ///< Size of the buffer in bytes
+    GLuint texture;
+    u32 watch_address;                      ///< Guest virtual address the buffer is watched at
+    bool watched;                           ///< Whether the pages of the buffer are watched
+    bool read_watched;                      ///< Whether the reads from the pages are watched,
+                                            ///< which they are while the buffer is dirty
+    bool loaded;                            ///< Whether the texture holds the buffer contents
+    bool dirty;                             ///< Whether the texture was drawn to since the buffer
+                                            ///< was last written back
+};
+
+/// Texture of a texture unit uploaded to the host
+struct HostTexture {
+    GLuint texture;
+    u64 hash;                               ///< Hash of the encoded texture last uploaded
+};
+
+/// Linked program of a fragment configuration
+struct Program {
+    GLuint program;
+    GLint depth_params_location;
+    GLint const_color_location;
+    GLint tev_buffer_color_location;
+};
+
+/// Key of the program disk cache, the hash of the shader sources
+typedef u64 ProgramCacheKey;
+
+static bool g_enabled = false;
+
+static std::vector<OutputVertex> g_vertices;                ///< Vertices of the current batch
+static std::map<u64, Surface*> g_surfaces;                  ///< Cached buffers, keyed by MakeKey
+static std::map<u64, HostTexture> g_textures;               ///< Uploaded textures, keyed by MakeKey
+static std::map<GLShaderGen::FragmentConfig, Program> g_programs;
+
+static GLuint g_vertex_shader = 0;
+static GLuint g_vertex_array = 0;
+static GLuint g_vertex_buffer = 0;
+static GLuint g_draw_framebuffer = 0;
+static GLuint g_read_framebuffer = 0;
+
+static std::vector<u8> g_linear_buffer;                     ///< Scratch buffer for linear rows
+static std::vector<u32> g_pixel_buffer;                     ///< Scratch buffer for GL pixels
+
+/// Guest pages written to since they were last checked, queued up by OnWatchedWrite
+static Memory::WrittenPageQueue g_written_pages;
+
+static LinearDiskCache<ProgramCacheKey, u8> g_program_cache;
+static std::map<ProgramCacheKey, std::vector<u8> > g_program_binaries;  ///< Format, then binary
+
+// Statistics, logged at shutdown
+static u64 g_num_draws = 0;
+static u64 g_num_loads = 0;                 ///< Buffers loaded from memory
+static u64 g_num_write_backs = 0;           ///< Buffers written back to memory
+
+/// Packs the properties identifying a buffer or texture into a key
+static inline u64 MakeKey(u32 address, u32 width, u32 height, u32 format) {
+    return (u64)address | ((u64)width << 32) | ((u64)height << 43) | ((u64)format << 54);
+}
+
+static inline bool IsDepthFormat(SurfaceFormat format) {
+    return format >= VideoCore::SURFACE_FORMAT_D16;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pixel conversion
+//
+// Color buffers are kept as GL_RGBA8 textures and depth buffers as GL_DEPTH24_STENCIL8 textures,
+// and converted from and to the buffer formats when they are loaded and written back. Pixels are
+// passed to GL as R, G, B, A bytes, or as depth << 8 | stencil.
+
+static inline u32 Convert4To8(u32 value) {
+    return (value << 4) | value;
+}
+
+static inline u32 Convert5To8(u32 value) {
+    return (value << 3) | (value >> 2);
+}
+
+static inline u32 Convert6To8(u32 value) {
+    return (value << 2) | (value >> 4);
+}
+
+/**
+ * Converts a pixel of a buffer to its GL representation
+ * @param src Pointer to the pixel
+ * @param format Format of the buffer
+ * @return GL pixel
+ */
+static inline u32 DecodePixel(const u8* src, SurfaceFormat format) {
+    switch (format) {
+    case VideoCore::SURFACE_FORMAT_RGBA8:
+        return src[3] | (src[2] << 8) | (src[1] << 16) | ((u32)src[0] << 24);
+
+    case VideoCore::SURFACE_FORMAT_RGB8:
+        return src[2] | (src[1] << 8) | (src[0] << 16) | 0xFF000000;
+
+    case VideoCore::SURFACE_FORMAT_RGB5A1:
+    {
+        const u32 pixel = src[0] | (src[1] << 8);
+        return Convert5To8(pixel >> 11) | (Convert5To8((pixel >> 6) & 0x1F) << 8) |
+            (Convert5To8((pixel >> 1) & 0x1F) << 16) | ((pixel & 1) ? 0xFF000000 : 0);
+    }
+
+    case VideoCore::SURFACE_FORMAT_RGB565:
+    {
+        const u32 pixel = src[0] | (src[1] << 8);
+        return Convert5To8(pixel >> 11) | (Convert6To8((pixel >> 5) & 0x3F) << 8) |
+            (Convert5To8(pixel & 0x1F) << 16) | 0xFF000000;
+    }
+
+    case VideoCore::SURFACE_FORMAT_RGBA4:
+    {
+        const u32 pixel = src[0] | (src[1] << 8);
+        return Convert4To8(pixel >> 12) | (Convert4To8((pixel >> 8) & 0xF) << 8) |
+            (Convert4To8((pixel >> 4) & 0xF) << 16) | (Convert4To8(pixel & 0xF) << 24);
+    }
+
+    case VideoCore::SURFACE_FORMAT_D16:
+    {
+        const u32 depth = src[0] | (src[1] << 8);
+        return ((depth << 8) | (depth >> 8)) << 8;
+    }
+
+    case VideoCore::SURFACE_FORMAT_D24:
+        return (src[0] | (src[1] << 8) | (src[2] << 16)) << 8;
+
+    default: // SURFACE_FORMAT_D24S8
+        return ((src[0] | (src[1] << 8) | (src[2] << 16)) << 8) | src[3];
+    }
+}
+
+/**
+ * Converts a GL pixel to its representation in a buffer
+ * @param pixel GL pixel
+ * @param dst Pointer to the pixel in the buffer
+ * @param format Format of the buffer
+ */
+static inline void EncodePixel(u32 pixel, u8* dst, SurfaceFormat format) {
+    const u32 r = pixel & 0xFF, g = (pixel >> 8) & 0xFF, b = (pixel >> 16) & 0xFF, a = pixel >> 24;
+
+    switch (format) {
+    case VideoCore::SURFACE_FORMAT_RGBA8:
+        dst[0] = a;
+        dst[1] = b;
+        dst[2] = g;
+        dst[3] = r;
+        break;
+
+    case VideoCore::SURFACE_FORMAT_RGB8:
+        dst[0] = b;
+        dst[1] = g;
+        dst[2] = r;
+        break;
+
+    case VideoCore::SURFACE_FORMAT_RGB5A1:
+    {
+        const u32 value = ((r >> 3) << 11) | ((g >> 3) << 6) | ((b >> 3) << 1) | (a >> 7);
+        dst[0] = (u8)value;
+        dst[1] = (u8)(value >> 8);
+        break;
+    }
+
+    case VideoCore::SURFACE_FORMAT_RGB565:
+    {
+        const u32 value = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+        dst[0] = (u8)value;
+        dst[1] = (u8)(value >> 8);
+        break;
+    }
+
+    case VideoCore::SURFACE_FORMAT_RGBA4:
+    {
+        const u32 value = ((r >> 4) << 12) | ((g >> 4) << 8) | ((b >> 4) << 4) | (a >> 4);
+        dst[0] = (u8)value;
+        dst[1] = (u8)(value >> 8);
+        break;
+    }
+
+    case VideoCore::SURFACE_FORMAT_D16:
+        dst[0] = (u8)(pixel >> 16);
+        dst[1] = (u8)(pixel >> 24);
+        break;
+
+    case VideoCore::SURFACE_FORMAT_D24:
+        dst[0] = (u8)(pixel >> 8);
+        dst[1] = (u8)(pixel >> 16);
+        dst[2] = (u8)(pixel >> 24);
+        break;
+
+    default: // SURFACE_FORMAT_D24S8
+        dst[0] = (u8)(pixel >> 8);
+        dst[1] = (u8)(pixel >> 16);
+        dst[2] = (u8)(pixel >> 24);
+        dst[3] = (u8)pixel;
+        break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Surface cache
+
+/**
+ * Gets the guest virtual address the guest writes a physical address through
+ * @param address Physical address
+ * @return Virtual address, or 0 if the address is not in VRAM or FCRAM
+ */
+static u32 GetWatchAddress(u32 address) {
+    if (address >= Memory::VRAM_PADDR && address < Memory::VRAM_PADDR_END) {
+        return Memory::VirtualAddressFromPhysical_VRAM(address);
+    } else if (address >= Memory::FCRAM_PADDR && address < Memory::FCRAM_PADDR_END) {
+        return Memory::VirtualAddressFromPhysical_FCRAM(address);
+    }
+    return 0;
+}
+
+/// Starts or stops watching the pages of a cached buffer
+static void SetWatched(Surface* surface, bool watched) {
+    if (surface->watched == watched || surface->watch_address == 0)
+        return;
+
+    const u32 end = surface->watch_address + surface->size;
+    for (u32 page = surface->watch_address & ~Memory::PAGE_MASK; page < end;
+        page += Memory::PAGE_SIZE) {
+
+        if (watched) {
+            Memory::WatchPageWrites(page);
+        } else {
+            Memory::UnwatchPageWrites(page);
+        }
+    }
+    surface->watched = watched;
+}
+
+/// Starts or stops watching the reads from the pages of a cached buffer
+static void SetReadWatched(Surface* surface, bool read_watched) {
+    if (surface->read_watched == read_watched || surface->watch_address == 0)
+        return;
+
+    const u32 end = surface->watch_address + surface->size;
+    for (u32 page = surface->watch_address & ~Memory::PAGE_MASK; page < end;
+        page += Memory::PAGE_SIZE) {
+
+        if (read_watched) {
+            Memory::WatchPageReads(page);
+        } else {
+            Memory::UnwatchPageReads(page);
+        }
+    }
+    surface->read_watched = read_watched;
+}
+
+/// Binds the texture of a buffer to the read framebuffer, as its only attachment
+static void BindReadSurface(Surface* surface) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, g_read_framebuffer);
+    if (IsDepthFormat(surface->format)) {
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D,
+            surface->texture, 0);
+        glReadBuffer(GL_NONE);
+    } else {
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0,
+            0);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+            surface->texture, 0);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+    }
+}
+
+/// Loads the contents of a buffer from memory into its texture
+static void LoadSurface(Surface* surface) {
+    const u32 bytes_per_pixel = VideoCore::GetSurfaceBytesPerPixel(surface->format);
+    const u32 num_pixels = surface->width * surface->height;
+    const ptrdiff_t stride = surface->width * bytes_per_pixel;
+    g_linear_buffer.resize(num_pixels * bytes_per_pixel);
+    g_pixel_buffer.resize(num_pixels);
+
+    // Buffers are stored top-down, GL textures bottom-up
+    SetWatched(surface, true);
+    const u8* src = Memory::GetPhysicalPointer(surface->address);
+    VideoCore::MortonDecode(src, &g_linear_buffer[(surface->height - 1) * stride], -stride,
+        surface->width, surface->height, surface->format);
+    for (u32 i = 0; i < num_pixels; i++) {
+        g_pixel_buffer[i] = DecodePixel(&g_linear_buffer[i * bytes_per_pixel], surface->format);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, surface->texture);
+    if (IsDepthFormat(surface->format)) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, surface->width, surface->height,
+            GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, &g_pixel_buffer[0]);
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, surface->width, surface->height, GL_RGBA,
+            GL_UNSIGNED_BYTE, &g_pixel_buffer[0]);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    surface->loaded = true;
+    surface->dirty = false;
+    g_num_loads++;
+}
+
+/// Writes the contents of the texture of a buffer back to memory, if it was drawn to
+static void WriteBackSurface(Surface* surface) {
+    if (!surface->loaded || !surface->dirty)
+        return;
+
+    const u32 bytes_per_pixel = VideoCore::GetSurfaceBytesPerPixel(surface->format);
+    const u32 num_pixels = surface->width * surface->height;
+    const ptrdiff_t stride = surface->width * bytes_per_pixel;
+    g_linear_buffer.resize(num_pixels * bytes_per_pixel);
+    g_pixel_buffer.resize(num_pixels);
+
+    BindReadSurface(surface);
+    if (IsDepthFormat(surface->format)) {
+        glReadPixels(0, 0, surface->width, surface->height, GL_DEPTH_STENCIL,
+            GL_UNSIGNED_INT_24_8, &g_pixel_buffer[0]);
+    } else {
+        glReadPixels(0, 0, surface->width, surface->height, GL_RGBA, GL_UNSIGNED_BYTE,
+            &g_pixel_buffer[0]);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    for (u32 i = 0; i < num_pixels; i++) {
+        EncodePixel(g_pixel_buffer[i], &g_linear_buffer[i * bytes_per_pixel], surface->format);
+    }
+    u8* dst = Memory::GetPhysicalPointer(surface->address);
+    VideoCore::MortonEncode(&g_linear_buffer[(surface->height - 1) * stride], -stride, dst,
+        surface->width, surface->height, surface->format);
+
+    // The buffer may have been decoded as a texture before
+    TextureCache::InvalidateRange(surface->address, surface->size);
+
+    SetReadWatched(surface, false);
+    surface->dirty = false;
+    g_num_write_backs++;
+}
+
+/// Makes a buffer reload from memory before it is next drawn to, discarding its texture contents
+static void UnloadSurface(Surface* surface) {
+    SetWatched(surface, false);
+    SetReadWatched(surface, false);
+    surface->loaded = false;
+    surface->dirty = false;
+}
+
+static void FreeSurface(Surface* surface) {
+    SetWatched(surface, false);
+    SetReadWatched(surface, false);
+    glDeleteTextures(1, &surface->texture);
+    delete surface;
+}
+
+/// Write watch callback, queues up the written page. Called on the thread that wrote.
+static void OnWatchedWrite(u32 addr, u32 size) {
+    g_written_pages.Push(addr, size);
+}
+
+/**
+ * Writes back the buffers on a page the guest reads from
+ * @param params Physical address of the page
+ */
+static void FlushPageCommand(const u32* params) {
+    FlushRegion(params[0], Memory::PAGE_SIZE);
+}
+
+/**
+ * Read watch callback, writes back the buffers drawn to on the page before the guest reads it.
+ * Called on the thread that reads, which waits for the GPU thread to do the write-back.
+ */
+static void OnWatchedRead(u32 addr, u32 size) {
+    // The read is reported at every alias of the page, buffers are watched at their virtual one
+    const u32 physical_address = Memory::PhysicalAddressFromVirtual(addr & ~Memory::PAGE_MASK);
+    if (physical_address == 0)
+        return;
+
+    // Pushes must come from one thread at a time
+    std::lock_guard<std::recursive_mutex> lock(HLE::g_mutex);
+    GPUThread::PushCommand(FlushPageCommand, &physical_address, 1);
+    GPUThread::Synchronize();
+}
+
+/// Unloads the buffers on the pages written since the last call
+static void ProcessWrittenPages() {
+    std::set<u32> pages;
+    if (!g_written_pages.Take(pages))
+        return;
+
+    for (std::map<u64, Surface*>::iterator it = g_surfaces.begin(); it != g_surfaces.end(); ++it) {
+        Surface* const surface = it->second;
+        if (!surface->watched)
+            continue;
+
+        const u32 first_page = surface->watch_address & ~Memory::PAGE_MASK;
+        std::set<u32>::const_iterator page = pages.lower_bound(first_page);
+        if (page != pages.end() && *page < surface->watch_address + surface->size) {
+            UnloadSurface(surface);
+        }
+    }
+}
+
+/**
+ * Gets a buffer to draw to, creating it and loading it from memory as needed. Other buffers
+ * overlapping its memory are written back and unloaded.
+ * @param address Physical address of the buffer
+ * @param width Width of the buffer in pixels
+ * @param height Height of the buffer in pixels
+ * @param format Format of the buffer
+ * @return Loaded buffer, or NULL if the buffer is invalid
+ */
+static Surface* GetSurface(u32 address, u32 width, u32 height, SurfaceFormat format) {
+    const u32 size = width * height * VideoCore::GetSurfaceBytesPerPixel(format);
+    if (width == 0 || height == 0 || (width % 8) != 0 || (height % 8) != 0 ||
+        Memory::GetPhysicalPointer(address) == NULL ||
+        Memory::GetPhysicalPointer(address + size - 1) == NULL) {
+
+        ERROR_LOG(GPU, "invalid %s buffer at 0x%08X (%ux%u)",
+            IsDepthFormat(format) ? "depth" : "color", address, width, height);
+        return NULL;
+    }
+
+    const u64 key = MakeKey(address, width, height, format);
+    Surface*& surface = g_surfaces[key];
+    if (surface == NULL) {
+        surface = new Surface;
+        surface->address = address;
+        surface->width = width;
+        surface->height = height;
+        surface->format = format;
+        surface->size = size;
+        surface->watch_address = GetWatchAddress(address);
+        surface->watched = false;
+        surface->read_watched = false;
+        surface->loaded = false;
+        surface->dirty = false;
+
+        glGenTextures(1, &surface->texture);
+        glBindTexture(GL_TEXTURE_2D, surface->texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        if (IsDepthFormat(format)) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0,
+                GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                NULL);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    for (std::map<u64, Surface*>::iterator it = g_surfaces.begin(); it != g_surfaces.end(); ++it) {
+        Surface* const other = it->second;
+        if (other != surface && other->loaded && other->address < address + size &&
+            address < other->address + other->size) {
+
+            WriteBackSurface(other);
+            UnloadSurface(other);
+        }
+    }
+
+    if (!surface->loaded) {
+        LoadSurface(surface);
+    }
+    return surface;
+}
+
+void FlushRegion(u32 address, u32 size) {
+    if (!g_enabled)
+        return;
+
+    ProcessWrittenPages();
+
+    const u64 end = (u64)address + size;
+    for (std::map<u64, Surface*>::iterator it = g_surfaces.begin(); it != g_surfaces.end(); ++it) {
+        Surface* const surface = it->second;
+        if (surface->address < end && address < surface->address + surface->size) {
+            WriteBackSurface(surface);
+        }
+    }
+}
+
+void InvalidateRegion(u32 address, u32 size) {
+    if (!g_enabled)
+        return;
+
+    ProcessWrittenPages();
+
+    const u64 end = (u64)address + size;
+    for (std::map<u64, Surface*>::iterator it = g_surfaces.begin(); it != g_surfaces.end(); ++it) {
+        Surface* const surface = it->second;
+        if (surface->address < end && address < surface->address + surface->size) {
+            // Keep what is drawn to the parts of the buffer that are not overwritten
+            if (surface->address < address || surface->address + surface->size > end) {
+                WriteBackSurface(surface);
+            }
+            UnloadSurface(surface);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Programs
+
+/// Disk cache reader, collecting the saved program binaries
+class ProgramCacheReader : public LinearDiskCacheReader<ProgramCacheKey, u8> {
+public:
+    void Read(const ProgramCacheKey& key, const u8* value, u32 value_size) {
+        if (value_size > sizeof(GLenum)) {
+            g_program_binaries[key].assign(value, value + value_size);
+        }
+    }
+};
+
+/**
+ * Compiles a shader
+ * @param type Type of the shader
+ * @param source GLSL source of the shader
+ * @return Compiled shader, or 0 if it failed to compile
+ */
+static GLuint CompileShader(GLenum type, const std::string& source) {
+    const GLuint shader = glCreateShader(type);
+    const GLchar* source_ptr = source.c_str();
+    glShaderSource(shader, 1, &source_ptr, NULL);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLchar log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        ERROR_LOG(RENDER, "failed to compile shader: %s\n%s", log, source.c_str());
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+/// Whether a program has been linked successfully
+static bool IsProgramLinked(GLuint program) {
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    return status == GL_TRUE;
+}
+
+/**
+ * Links a program from a generated fragment shader, saving its binary to the disk cache
+ * @param program Program to link
+ * @param fragment_source GLSL source of the fragment shader
+ * @param key Key of the program in the disk cache
+ * @return True if the program was linked
+ */
+static bool LinkProgram(GLuint program, const std::string& fragment_source, ProgramCacheKey key) {
+    const GLuint fragment_shader = CompileShader(GL_FRAGMENT_SHADER, fragment_source);
+    if (fragment_shader == 0 || g_vertex_shader == 0)
+        return false;
+
+    glAttachShader(program, g_vertex_shader);
+    glAttachShader(program, fragment_shader);
+    glBindAttribLocation(program, ATTRIBUTE_POSITION, "vert_position");
+    glBindAttribLocation(program, ATTRIBUTE_COLOR, "vert_color");
+    glBindAttribLocation(program, ATTRIBUTE_TEXCOORD0, "vert_texcoord0");
+    glBindAttribLocation(program, ATTRIBUTE_TEXCOORD1, "vert_texcoord1");
+    glBindFragDataLocation(program, 0, "color");
+    if (GLEW_ARB_get_program_binary) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+    glDetachShader(program, g_vertex_shader);
+    glDetachShader(program, fragment_shader);
+    glDeleteShader(fragment_shader);
+
+    if (!IsProgramLinked(program)) {
+        GLchar log[1024];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        ERROR_LOG(RENDER, "failed to link program: %s", log);
+        return false;
+    }
+
+    if (GLEW_ARB_get_program_binary) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length > 0) {
+            std::vector<u8>& binary = g_program_binaries[key];
+            binary.resize(sizeof(GLenum) + length);
+            GLenum format = 0;
+            glGetProgramBinary(program, length, NULL, &format, &binary[sizeof(GLenum)]);
+            memcpy(&binary[0], &format, sizeof(GLenum));
+            g_program_cache.Append(key, &binary[0], (u32)binary.size());
+        }
+    }
+    return true;
+}
+
+/**
+ * Gets the program implementing a fragment configuration, loading it from the disk cache or
+ * generating it if it is not cached yet
+ * @param config Fragment configuration
+ * @return Program, whose program is 0 if it could not be built
+ */
+static const Program& GetProgram(const GLShaderGen::FragmentConfig& config) {
+    std::map<GLShaderGen::FragmentConfig, Program>::iterator it = g_programs.find(config);
+    if (it != g_programs.end())
+        return it->second;
+
+    const std::string vertex_source = GLShaderGen::GenerateVertexShader();
+    const std::string fragment_source = GLShaderGen::GenerateFragmentShader(config);
+    const std::string sources = vertex_source + fragment_source;
+    const ProgramCacheKey key = GetHash64((const u8*)sources.data(), (int)sources.size(), 0);
+
+    Program& program = g_programs[config];
+    program.program = glCreateProgram();
+
+    // Binaries are rejected when the driver changed, the program is generated again then
+    bool linked = false;
+    std::map<ProgramCacheKey, std::vector<u8> >::const_iterator binary =
+        g_program_binaries.find(key);
+    if (binary != g_program_binaries.end() && GLEW_ARB_get_program_binary) {
+        GLenum format;
+        memcpy(&format, &binary->second[0], sizeof(GLenum));
+        glProgramBinary(program.program, format, &binary->second[sizeof(GLenum)],
+            (GLsizei)(binary->second.size() - sizeof(GLenum)));
+        linked = IsProgramLinked(program.program);
+    }
+    if (!linked) {
+        linked = LinkProgram(program.program, fragment_source, key);
+    }
+    if (!linked) {
+        glDeleteProgram(program.program);
+        program.program = 0;
+        return program;
+    }
+
+    program.depth_params_location = glGetUniformLocation(program.program, "depth_params");
+    program.const_color_location = glGetUniformLocation(program.program, "const_color");
+    program.tev_buffer_color_location = glGetUniformLocation(program.program,
+        "tev_buffer_color");
+
+    static const GLint texture_units[NUM_TEXTURE_UNITS] = { 0, 1, 2 };
+    glUseProgram(program.program);
+    glUniform1iv(glGetUniformLocation(program.program, "tex"), NUM_TEXTURE_UNITS, texture_units);
+    glUseProgram(0);
+    return program;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Drawing
+
+/// Unpacks an RGBA8 color register into floats
+static inline void UnpackColor(u32 value, GLfloat* color) {
+    for (int comp = 0; comp < 4; comp++) {
+        color[comp] = ((value >> (comp * 8)) & 0xFF) / 255.0f;
+    }
+}
+
+/**
+ * Uploads the texture of a texture unit, unless it was uploaded before and did not change
+ * @param unit Index of the texture unit
+ * @return Host texture, or 0 if the texture could not be decoded
+ */
+static GLuint UploadTexture(int unit) {
+    const TextureCache::TextureInfo info = TextureCache::TextureInfo::FromUnit(unit);
+
+    // The texture may have been drawn to
+    FlushRegion(info.address, info.GetSize());
+
+    const TextureCache::Texture* texture = TextureCache::Lookup(info);
+    if (texture == NULL)
+        return 0;
+
+    const u64 key = MakeKey(info.address, info.width, info.height, (u32)info.format);
+    std::map<u64, HostTexture>::iterator it = g_textures.find(key);
+    if (it != g_textures.end() && it->second.hash == texture->hash)
+        return it->second.texture;
+
+    if (it == g_textures.end()) {
+        if (g_textures.size() >= MAX_CACHED_TEXTURES) {
+            for (it = g_textures.begin(); it != g_textures.end(); ++it) {
+                glDeleteTextures(1, &it->second.texture);
+            }
+            g_textures.clear();
+        }
+
+        HostTexture host_texture;
+        glGenTextures(1, &host_texture.texture);
+        glBindTexture(GL_TEXTURE_2D, host_texture.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        it = g_textures.insert(std::make_pair(key, host_texture)).first;
+    } else {
+        glBindTexture(GL_TEXTURE_2D, it->second.texture);
+    }
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, info.width, info.height, 0, GL_RGBA,
+        GL_UNSIGNED_BYTE, &texture->data[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    it->second.hash = texture->hash;
+    return it->second.texture;
+}
+
+/// Gets the GL depth function of a PICA depth test
+static GLenum GetDepthFunc(DepthColorMask::CompareFunc func) {
+    switch (func) {
+    case DepthColorMask::CompareFunc::Never:              return GL_NEVER;
+    case DepthColorMask::CompareFunc::Always:             return GL_ALWAYS;
+    case DepthColorMask::CompareFunc::Equal:              return GL_EQUAL;
+    case DepthColorMask::CompareFunc::NotEqual:           return GL_NOTEQUAL;
+    case DepthColorMask::CompareFunc::LessThan:           return GL_LESS;
+    case DepthColorMask::CompareFunc::LessThanOrEqual:    return GL_LEQUAL;
+    case DepthColorMask::CompareFunc::GreaterThan:        return GL_GREATER;
+    default:                                              return GL_GEQUAL;
+    }
+}
+
+void AddTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2) {
+    if (g_vertices.size() + 3 > MAX_BATCH_VERTICES) {
+        Flush();
+    }
+    g_vertices.push_back(v0);
+    g_vertices.push_back(v1);
+    g_vertices.push_back(v2);
+}
+
+void Flush() {
+    if (g_vertices.empty())
+        return;
+
+    ProcessWrittenPages();
+
+    const GLShaderGen::FragmentConfig config = GLShaderGen::FragmentConfig::FromRegisters();
+    const Program& program = GetProgram(config);
+
+    // Textures are uploaded first, as they may alias the buffers drawn to
+    GLuint textures[NUM_TEXTURE_UNITS];
+    for (int unit = 0; unit < NUM_TEXTURE_UNITS; unit++) {
+        textures[unit] = (config.texture_enable & (1 << unit)) ? UploadTexture(unit) : 0;
+    }
+
+    const Regs::Struct<Regs::ColorBufferSize>& size = GetRegister<Regs::ColorBufferSize>();
+    const ColorFormat color_format = GetRegister<Regs::ColorBufferFormat>().color_format;
+    Surface* color_surface = NULL;
+    if ((u32)color_format <= (u32)ColorFormat::RGBA4) {
+        color_surface = GetSurface(GetRegister<Regs::ColorBufferAddress>().GetPhysicalAddress(),
+            size.width, size.height, static_cast<SurfaceFormat>((u32)color_format));
+    } else {
+        ERROR_LOG(GPU, "unknown color buffer format %d", (int)color_format);
+    }
+
+    const DepthColorMask& mask = GetRegister<Regs::DepthColorMask>();
+    const bool use_depth = mask.depth_test_enable || mask.depth_write_enable;
+    Surface* depth_surface = NULL;
+    if (use_depth && color_surface) {
+        SurfaceFormat depth_format;
+        switch (GetRegister<Regs::DepthBufferFormat>().depth_format) {
+        case DepthFormat::D16:  depth_format = VideoCore::SURFACE_FORMAT_D16; break;
+        case DepthFormat::D24:  depth_format = VideoCore::SURFACE_FORMAT_D24; break;
+        default:                depth_format = VideoCore::SURFACE_FORMAT_D24S8; break;
+        }
+        depth_surface = GetSurface(GetRegister<Regs::DepthBufferAddress>().GetPhysicalAddress(),
+            size.width, size.height, depth_format);
+    }
+
+    if (color_surface == NULL || program.program == 0 || (use_depth && depth_surface == NULL)) {
+        g_vertices.clear();
+        return;
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, g_draw_framebuffer);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+        color_surface->texture, 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D,
+        depth_surface ? depth_surface->texture : 0, 0);
+
+    // The viewport size registers hold half the size of the viewport
+    const Regs::Struct<Regs::ViewportCorner>& corner = GetRegister<Regs::ViewportCorner>();
+    glViewport(corner.x, corner.y, (GLsizei)(Float24ToFloat(g_regs[Regs::ViewportSizeX]) * 2.0f),
+        (GLsizei)(Float24ToFloat(g_regs[Regs::ViewportSizeY]) * 2.0f));
+
+    const GLboolean scissor_enabled = glIsEnabled(GL_SCISSOR_TEST);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_CLAMP);
+    glColorMask(mask.red_enable != 0, mask.green_enable != 0, mask.blue_enable != 0,
+        mask.alpha_enable != 0);
+    if (use_depth) {
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(mask.depth_test_enable ? GetDepthFunc(mask.depth_test_func) : GL_ALWAYS);
+        glDepthMask(mask.depth_write_enable != 0);
+    } else {
+        glDisable(GL_DEPTH_TEST);
+    }
+
+    glUseProgram(program.program);
+    glUniform2f(program.depth_params_location,
+        Float24ToFloat(g_regs[Regs::ViewportDepthRange]),
+        Float24ToFloat(g_regs[Regs::ViewportDepthNearPlane]));
+    GLfloat const_colors[NUM_TEV_STAGES][4];
+    for (int stage = 0; stage < NUM_TEV_STAGES; stage++) {
+        UnpackColor(g_regs[TexEnvRegister(Regs::TexEnv0Color, stage)], const_colors[stage]);
+    }
+    glUniform4fv(program.const_color_location, NUM_TEV_STAGES, &const_colors[0][0]);
+    GLfloat buffer_color[4];
+    UnpackColor(g_regs[Regs::TexEnvBufferColor], buffer_color);
+    glUniform4fv(program.tev_buffer_color_location, 1, buffer_color);
+
+    for (int unit = 0; unit < NUM_TEXTURE_UNITS; unit++) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, textures[unit]);
+    }
+
+    glBindVertexArray(g_vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, g_vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, g_vertices.size() * sizeof(OutputVertex), &g_vertices[0],
+        GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)g_vertices.size());
+
+    // Restore the state the renderer relies on
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    for (int unit = NUM_TEXTURE_UNITS - 1; unit >= 0; unit--) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_DEPTH_CLAMP);
+    if (scissor_enabled) {
+        glEnable(GL_SCISSOR_TEST);
+    }
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+    // Guest reads of the buffers must now see the drawing, so they have to write them back
+    color_surface->dirty = true;
+    SetReadWatched(color_surface, true);
+    if (depth_surface && mask.depth_write_enable) {
+        depth_surface->dirty = true;
+        SetReadWatched(depth_surface, true);
+    }
+
+    g_vertices.clear();
+    g_num_draws++;
+}
+
+bool IsEnabled() {
+    return g_enabled;
+}
+
+void Init() {
+    g_vertices.reserve(MAX_BATCH_VERTICES);
+    g_num_draws = g_num_loads = g_num_write_backs = 0;
+
+    g_vertex_shader = CompileShader(GL_VERTEX_SHADER, GLShaderGen::GenerateVertexShader());
+
+    glGenFramebuffers(1, &g_draw_framebuffer);
+    glGenFramebuffers(1, &g_read_framebuffer);
+
+    // Vertices are uploaded as they come out of the vertex shader
+    glGenVertexArrays(1, &g_vertex_array);
+    glGenBuffers(1, &g_vertex_buffer);
+    glBindVertexArray(g_vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, g_vertex_buffer);
+    glVertexAttribPointer(ATTRIBUTE_POSITION, 4, GL_FLOAT, GL_FALSE, sizeof(OutputVertex),
+        (const GLvoid*)offsetof(OutputVertex, pos));
+    glVertexAttribPointer(ATTRIBUTE_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(OutputVertex),
+        (const GLvoid*)offsetof(OutputVertex, color));
+    glVertexAttribPointer(ATTRIBUTE_TEXCOORD0, 2, GL_FLOAT, GL_FALSE, sizeof(OutputVertex),
+        (const GLvoid*)offsetof(OutputVertex, tc0));
+    glVertexAttribPointer(ATTRIBUTE_TEXCOORD1, 2, GL_FLOAT, GL_FALSE, sizeof(OutputVertex),
+        (const GLvoid*)offsetof(OutputVertex, tc1));
+    glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+    glEnableVertexAttribArray(ATTRIBUTE_COLOR);
+    glEnableVertexAttribArray(ATTRIBUTE_TEXCOORD0);
+    glEnableVertexAttribArray(ATTRIBUTE_TEXCOORD1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    if (GLEW_ARB_get_program_binary) {
+        const std::string cache_dir = File::GetUserPath(D_SHADERCACHE_IDX);
+        File::CreateFullPath(cache_dir);
+        ProgramCacheReader reader;
+        g_program_cache.OpenAndRead((cache_dir + "gl_programs.cache").c_str(), reader);
+    }
+
+    Memory::RegisterWriteWatchCallback(OnWatchedWrite);
+    Memory::RegisterReadWatchCallback(OnWatchedRead);
+    g_enabled = true;
+
+    NOTICE_LOG(GPU, "hardware rasterizer initialized, %u cached program binaries",
+        (unsigned)g_program_binaries.size());
+}
+
+void Shutdown() {
+    if (!g_enabled)
+        return;
+    g_enabled = false;
+
+    Memory::UnregisterWriteWatchCallback(OnWatchedWrite);
+    Memory::UnregisterReadWatchCallback(OnWatchedRead);
+    g_written_pages.Clear();
+
+    for (std::map<u64, Surface*>::iterator it = g_surfaces.begin(); it != g_surfaces.end(); ++it) {
+        FreeSurface(it->second);
+    }
+    g_surfaces.clear();
+    for (std::map<u64, HostTexture>::iterator it = g_textures.begin(); it != g_textures.end();
+        ++it) {
+        glDeleteTextures(1, &it->second.texture);
+    }
+    g_textures.clear();
+    for (std::map<GLShaderGen::FragmentConfig, Program>::iterator it = g_programs.begin();
+        it != g_programs.end(); ++it) {
+        glDeleteProgram(it->second.program);
+    }
+    g_programs.clear();
+
+    glDeleteShader(g_vertex_shader);
+    glDeleteBuffers(1, &g_vertex_buffer);
+    glDeleteVertexArrays(1, &g_vertex_array);
+    glDeleteFramebuffers(1, &g_draw_framebuffer);
+    glDeleteFramebuffers(1, &g_read_framebuffer);
+    g_vertex_shader = g_vertex_buffer = g_vertex_array = 0;
+    g_draw_framebuffer = g_read_framebuffer = 0;
+    g_vertices.clear();
+
+    g_program_cache.Sync();
+    g_program_cache.Close();
+    g_program_binaries.clear();
+
+    NOTICE_LOG(GPU, "hardware rasterizer: %llu draws, %llu buffer loads, %llu write-backs",
+        (unsigned long long)g_num_draws, (unsigned long long)g_num_loads,
+        (unsigned long long)g_num_write_backs);
+}
+
+} // namespace
+
+} // namespace
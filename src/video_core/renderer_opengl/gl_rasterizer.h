@@ -0,0 +1,70 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+
+#include "video_core/vertex_shader.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// PICA200 hardware rasterizer
+//
+// Draw calls are translated to OpenGL draws: shaded vertices are batched up in a vertex buffer,
+// and the texture combiner stages are implemented by fragment shaders generated by GLShaderGen.
+// Linked programs are saved to a disk cache where the driver supports program binaries.
+//
+// Color and depth buffers are kept in host textures, cached by address, size and format, and only
+// written back to emulated memory when the GPU emulation reads them: GX transfers, texture units
+// and the display. The guest pages of loaded buffers are write-watched, a guest write makes the
+// buffer reload from memory before it is next drawn to, discarding anything drawn to it that was
+// not written back. The pages of buffers drawn to since their last write-back are read-watched as
+// well, a guest read writes the buffer back first. HLE code reading memory through
+// Memory::GetPointer is not trapped and sees it as of the last write-back.
+//
+// All functions must be called on the thread owning the GL context.
+
+namespace Pica {
+
+namespace HWRasterizer {
+
+/**
+ * Queues up a triangle for drawing, clipping is left to OpenGL
+ * @param v0 First vertex
+ * @param v1 Second vertex
+ * @param v2 Third vertex
+ */
+void AddTriangle(const VertexShader::OutputVertex& v0, const VertexShader::OutputVertex& v1,
+    const VertexShader::OutputVertex& v2);
+
+/// Draws all queued up triangles into the current color and depth buffers
+void Flush();
+
+/**
+ * Writes back the cached buffers overlapping a range of memory that is about to be read
+ * @param address Physical address of the range
+ * @param size Size of the range in bytes
+ */
+void FlushRegion(u32 address, u32 size);
+
+/**
+ * Makes the cached buffers overlapping a range of memory that is about to be overwritten reload
+ * from memory. Buffers only partly covered by the range are written back first.
+ * @param address Physical address of the range
+ * @param size Size of the range in bytes
+ */
+void InvalidateRegion(u32 address, u32 size);
+
+/// Whether draws are rasterized with OpenGL, that is whether the rasterizer was initialized
+bool IsEnabled();
+
+/// Initialize the hardware rasterizer, after the OpenGL renderer
+void Init();
+
+/// Shutdown the hardware rasterizer, freeing all GL objects
+void Shutdown();
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,245 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <cstring>
+
+#include "common/common.h"
+#include "common/string_util.h"
+
+#include "video_core/renderer_opengl/gl_shader_gen.h"
+
+namespace Pica {
+
+namespace GLShaderGen {
+
+typedef Regs::Struct<Regs::TexEnv0Source> TevSource;
+typedef Regs::Struct<Regs::TexEnv0Modifier> TevModifier;
+typedef Regs::Struct<Regs::TexEnv0Operation> TevOperation;
+typedef Regs::Struct<Regs::TexEnv0Scale> TevScale;
+
+FragmentConfig FragmentConfig::FromRegisters() {
+    FragmentConfig config;
+
+    // Only the bits that affect the generated code are kept, so that equal shaders compare equal
+    config.texture_enable = g_regs[Regs::TextureUnitsConfig] & 0x7;
+    config.buffer_update = g_regs[Regs::TexEnvBufferInput] & 0xFF00;
+    for (int stage = 0; stage < NUM_TEV_STAGES; stage++) {
+        config.sources[stage] = g_regs[TexEnvRegister(Regs::TexEnv0Source, stage)] & 0x0FFF0FFF;
+        config.modifiers[stage] = g_regs[TexEnvRegister(Regs::TexEnv0Modifier, stage)] & 0x777FFF;
+        config.operations[stage] = g_regs[TexEnvRegister(Regs::TexEnv0Operation, stage)] &
+            0x000F000F;
+        config.scales[stage] = g_regs[TexEnvRegister(Regs::TexEnv0Scale, stage)] & 0x00030003;
+    }
+    return config;
+}
+
+bool FragmentConfig::operator<(const FragmentConfig& other) const {
+    return memcmp(this, &other, sizeof(FragmentConfig)) < 0;
+}
+
+std::string GenerateVertexShader() {
+    // The PICA maps z/w rather than z to the depth range. The depth is written through z instead
+    // of gl_FragDepth, clipping is avoided by clamping it instead (GL_DEPTH_CLAMP).
+    return
+        "#version 150\n"
+        "in vec4 vert_position;\n"
+        "in vec4 vert_color;\n"
+        "in vec2 vert_texcoord0;\n"
+        "in vec2 vert_texcoord1;\n"
+        "out vec4 primary_color;\n"
+        "out vec2 texcoord0;\n"
+        "out vec2 texcoord1;\n"
+        "uniform vec2 depth_params;\n"
+        "void main() {\n"
+        "    primary_color = vert_color;\n"
+        "    texcoord0 = vert_texcoord0;\n"
+        "    texcoord1 = vert_texcoord1;\n"
+        "    float depth = depth_params.y * vert_position.w + depth_params.x * vert_position.z;\n"
+        "    gl_Position = vec4(vert_position.xy, 2.0 * depth - vert_position.w, "
+            "vert_position.w);\n"
+        "}\n";
+}
+
+/**
+ * Gets the GLSL expression of a combiner source
+ * @param config Configuration being generated
+ * @param stage Index of the stage
+ * @param source Source to get
+ * @return vec4 expression of the source
+ */
+static std::string GetSourceExpression(const FragmentConfig& config, int stage,
+    TevSource::Source source) {
+
+    switch (source) {
+    case TevSource::PrimaryColor:
+        return "primary_color";
+    case TevSource::Texture0:
+        return (config.texture_enable & 1) ? "texcolor0" : "vec4(0.0)";
+    case TevSource::Texture1:
+        return (config.texture_enable & 2) ? "texcolor1" : "vec4(0.0)";
+    case TevSource::Texture2:
+        return (config.texture_enable & 4) ? "texcolor2" : "vec4(0.0)";
+    case TevSource::PreviousBuffer:
+        return "combiner_buffer";
+    case TevSource::Constant:
+        return StringFromFormat("const_color[%d]", stage);
+    case TevSource::Previous:
+        return "last";
+    default:
+        // Fragment lighting and procedural textures (texture 3) are not emulated
+        return "vec4(0.0)";
+    }
+}
+
+/**
+ * Gets the GLSL expression of a modified color input of a stage
+ * @param source Expression of the source
+ * @param modifier Modifier applied to the source
+ * @return vec3 expression of the input
+ */
+static std::string GetColorInput(const std::string& source, TevModifier::ColorModifier modifier) {
+    switch (modifier) {
+    case TevModifier::SourceColor:          return source + ".rgb";
+    case TevModifier::OneMinusSourceColor:  return "(vec3(1.0) - " + source + ".rgb)";
+    case TevModifier::SourceAlpha:          return source + ".aaa";
+    case TevModifier::OneMinusSourceAlpha:  return "(vec3(1.0) - " + source + ".aaa)";
+    case TevModifier::SourceRed:            return source + ".rrr";
+    case TevModifier::OneMinusSourceRed:    return "(vec3(1.0) - " + source + ".rrr)";
+    case TevModifier::SourceGreen:          return source + ".ggg";
+    case TevModifier::OneMinusSourceGreen:  return "(vec3(1.0) - " + source + ".ggg)";
+    case TevModifier::SourceBlue:           return source + ".bbb";
+    case TevModifier::OneMinusSourceBlue:   return "(vec3(1.0) - " + source + ".bbb)";
+    default:
+        return source + ".rgb";
+    }
+}
+
+/**
+ * Gets the GLSL expression of a modified alpha input of a stage
+ * @param source Expression of the source
+ * @param modifier Modifier applied to the source
+ * @return float expression of the input
+ */
+static std::string GetAlphaInput(const std::string& source, TevModifier::AlphaModifier modifier) {
+    switch (modifier) {
+    case TevModifier::AlphaSourceAlpha:         return source + ".a";
+    case TevModifier::AlphaOneMinusSourceAlpha: return "(1.0 - " + source + ".a)";
+    case TevModifier::AlphaSourceRed:           return source + ".r";
+    case TevModifier::AlphaOneMinusSourceRed:   return "(1.0 - " + source + ".r)";
+    case TevModifier::AlphaSourceGreen:         return source + ".g";
+    case TevModifier::AlphaOneMinusSourceGreen: return "(1.0 - " + source + ".g)";
+    case TevModifier::AlphaSourceBlue:          return source + ".b";
+    default:                                    return "(1.0 - " + source + ".b)";
+    }
+}
+
+/**
+ * Gets the GLSL expression of a combiner operation, clamped to [0, 1]
+ * @param op Operation
+ * @param type GLSL type of the operands, "vec3" or "float"
+ * @param a Expression of the first input
+ * @param b Expression of the second input
+ * @param c Expression of the third input
+ * @return Expression of the result
+ */
+static std::string GetOperation(TevOperation::Operation op, const char* type, const std::string& a,
+    const std::string& b, const std::string& c) {
+
+    const std::string one = std::string(type) + "(1.0)";
+    switch (op) {
+    case TevOperation::Replace:
+        return a;
+    case TevOperation::Modulate:
+        return a + " * " + b;
+    case TevOperation::Add:
+        return "min(" + a + " + " + b + ", " + one + ")";
+    case TevOperation::AddSigned:
+        return "clamp(" + a + " + " + b + " - " + type + "(0.5), " + type + "(0.0), " + one + ")";
+    case TevOperation::Lerp:
+        return "mix(" + b + ", " + a + ", " + c + ")";
+    case TevOperation::Subtract:
+        return "max(" + a + " - " + b + ", " + type + "(0.0))";
+    case TevOperation::Dot3_RGB:
+        return std::string(type) + "(clamp(4.0 * dot(" + a + " - vec3(0.5), " + b +
+            " - vec3(0.5)), 0.0, 1.0))";
+    case TevOperation::MultiplyThenAdd:
+        return "min(" + a + " * " + b + " + " + c + ", " + one + ")";
+    case TevOperation::AddThenMultiply:
+        return "min(" + a + " + " + b + ", " + one + ") * " + c;
+    default:
+        return a;
+    }
+}
+
+std::string GenerateFragmentShader(const FragmentConfig& config) {
+    std::string out =
+        "#version 150\n"
+        "in vec4 primary_color;\n"
+        "in vec2 texcoord0;\n"
+        "in vec2 texcoord1;\n"
+        "out vec4 color;\n"
+        "uniform sampler2D tex[3];\n"
+        "uniform vec4 const_color[6];\n"
+        "uniform vec4 tev_buffer_color;\n"
+        "void main() {\n";
+
+    // Texture 2 has no coordinate semantic of its own
+    if (config.texture_enable & 1)
+        out += "    vec4 texcolor0 = texture(tex[0], texcoord0);\n";
+    if (config.texture_enable & 2)
+        out += "    vec4 texcolor1 = texture(tex[1], texcoord1);\n";
+    if (config.texture_enable & 4)
+        out += "    vec4 texcolor2 = texture(tex[2], texcoord1);\n";
+
+    // The buffer read by a stage is the one written by the stages before it
+    out += "    vec4 last = vec4(0.0);\n";
+    out += "    vec4 combiner_buffer = vec4(0.0);\n";
+    out += "    vec4 next_combiner_buffer = tev_buffer_color;\n";
+
+    for (int stage = 0; stage < NUM_TEV_STAGES; stage++) {
+        TevSource sources;
+        TevModifier modifiers;
+        TevOperation operations;
+        TevScale scales;
+        sources.hex = config.sources[stage];
+        modifiers.hex = config.modifiers[stage];
+        operations.hex = config.operations[stage];
+        scales.hex = config.scales[stage];
+
+        std::string color_in[3], alpha_in[3];
+        for (int i = 0; i < 3; i++) {
+            color_in[i] = GetColorInput(GetSourceExpression(config, stage,
+                sources.GetColorSource(i)), modifiers.GetColorModifier(i));
+            alpha_in[i] = GetAlphaInput(GetSourceExpression(config, stage,
+                sources.GetAlphaSource(i)), modifiers.GetAlphaModifier(i));
+        }
+
+        out += StringFromFormat("    // Stage %d\n", stage);
+        out += "    combiner_buffer = next_combiner_buffer;\n";
+        out += "    {\n";
+        out += "        vec3 color_result = " + GetOperation(operations.color_op, "vec3",
+            color_in[0], color_in[1], color_in[2]) + ";\n";
+        out += "        float alpha_result = " + GetOperation(operations.alpha_op, "float",
+            alpha_in[0], alpha_in[1], alpha_in[2]) + ";\n";
+        out += StringFromFormat("        last = min(vec4(color_result * %d.0, "
+            "alpha_result * %d.0), vec4(1.0));\n", 1 << scales.color_scale,
+            1 << scales.alpha_scale);
+        out += "    }\n";
+
+        if (stage < NUM_TEV_BUFFER_STAGES) {
+            if (config.buffer_update & (0x100 << stage))
+                out += "    next_combiner_buffer.rgb = last.rgb;\n";
+            if (config.buffer_update & (0x1000 << stage))
+                out += "    next_combiner_buffer.a = last.a;\n";
+        }
+    }
+
+    out += "    color = last;\n";
+    out += "}\n";
+    return out;
+}
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,65 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+
+#include "common/common_types.h"
+
+#include "video_core/pica.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// GLSL generation for the hardware rasterizer
+//
+// The fixed-function texture combiner (TEV) stages are translated into a GLSL fragment shader per
+// combination of sources, modifiers, operations and scales. Constant colors are uniforms, so that
+// changing them does not require a new program. Generation only depends on the register state and
+// does not need a GL context.
+//
+// Interface of the generated shaders:
+//  - vertex attributes vert_position, vert_color, vert_texcoord0 and vert_texcoord1, laid out as in
+//    VertexShader::OutputVertex
+//  - uniform vec2 depth_params, the depth range and near plane (ViewportDepthRange,
+//    ViewportDepthNearPlane)
+//  - uniform sampler2D tex[3], one per texture unit
+//  - uniform vec4 const_color[6], the constant color of each stage (TexEnv0Color)
+//  - uniform vec4 tev_buffer_color, the initial combiner buffer (TexEnvBufferColor)
+
+namespace Pica {
+
+namespace GLShaderGen {
+
+/// Register state that a generated fragment shader depends on
+struct FragmentConfig {
+    u32 texture_enable;                     ///< Texture unit enable bits of TextureUnitsConfig
+    u32 buffer_update;                      ///< Update bits of TexEnvBufferInput
+    u32 sources[NUM_TEV_STAGES];            ///< TexEnv0Source of each stage
+    u32 modifiers[NUM_TEV_STAGES];          ///< TexEnv0Modifier of each stage
+    u32 operations[NUM_TEV_STAGES];         ///< TexEnv0Operation of each stage
+    u32 scales[NUM_TEV_STAGES];             ///< TexEnv0Scale of each stage
+
+    /// Gets the configuration of the current register state
+    static FragmentConfig FromRegisters();
+
+    bool operator<(const FragmentConfig& other) const;
+};
+
+/**
+ * Generates the vertex shader, which passes the shaded vertex attributes through and maps z/w to
+ * the configured depth range
+ * @return GLSL source of the vertex shader
+ */
+std::string GenerateVertexShader();
+
+/**
+ * Generates the fragment shader implementing the texture combiner stages of a configuration
+ * @param config Configuration to implement
+ * @return GLSL source of the fragment shader
+ */
+std::string GenerateFragmentShader(const FragmentConfig& config);
+
+} // namespace
+
+} // namespace
@@ -4,7 +4,10 @@
 
 #include "core/hw/gpu.h"
 
+#include "video_core/transfer.h"
+#include "video_core/utils.h"
 #include "video_core/video_core.h"
+#include "video_core/renderer_opengl/gl_rasterizer.h"
 #include "video_core/renderer_opengl/renderer_opengl.h"
 
 #include "core/mem_map.h"
@@ -24,6 +27,11 @@ RendererOpenGL::RendererOpenGL() {
 
     m_xfb_top = 0;
     m_xfb_bottom = 0;
+
+    m_xfb_pbo = 0;
+    m_xfb_pbo_map = NULL;
+    memset(m_xfb_pbo_fences, 0, sizeof(m_xfb_pbo_fences));
+    m_xfb_pbo_frame = 0;
 }
 
 /// RendererOpenGL destructor
@@ -52,43 +60,125 @@ void RendererOpenGL::SwapBuffers() {
 }
 
 /**
- * Helper function to flip framebuffer from left-to-right to top-to-bottom
- * @param in Pointer to input raw framebuffer in V/RAM
- * @param out Pointer to output buffer with flipped framebuffer
- * @todo Early on hack... I'd like to find a more efficient way of doing this /bunnei
+ * Gets the pixel transfer format and type to upload a flipped framebuffer with
+ * @param format Pixel format of the framebuffer
+ * @param gl_format Receives the pixel transfer format
+ * @param gl_type Receives the pixel transfer type
  */
-void RendererOpenGL::FlipFramebuffer(const u8* in, u8* out) {
-    int in_coord = 0;
-    for (int x = 0; x < VideoCore::kScreenTopWidth; x++) {
-        for (int y = VideoCore::kScreenTopHeight-1; y >= 0; y--) {
-            int out_coord = (x + y * VideoCore::kScreenTopWidth) * 3;
-            out[out_coord] = in[in_coord];
-            out[out_coord + 1] = in[in_coord + 1];
-            out[out_coord + 2] = in[in_coord + 2];
-            in_coord+=3;
-        }
+static void GetUploadFormat(GPU::FramebufferFormat format, GLenum* gl_format, GLenum* gl_type) {
+    switch (format) {
+    case GPU::FRAMEBUFFER_FORMAT_RGBA8:
+        *gl_format = GL_RGBA;
+        *gl_type = GL_UNSIGNED_INT_8_8_8_8;
+        break;
+
+    case GPU::FRAMEBUFFER_FORMAT_RGB565:
+        *gl_format = GL_RGB;
+        *gl_type = GL_UNSIGNED_SHORT_5_6_5;
+        break;
+
+    case GPU::FRAMEBUFFER_FORMAT_RGB5A1:
+        *gl_format = GL_RGBA;
+        *gl_type = GL_UNSIGNED_SHORT_5_5_5_1;
+        break;
+
+    case GPU::FRAMEBUFFER_FORMAT_RGBA4:
+        *gl_format = GL_RGBA;
+        *gl_type = GL_UNSIGNED_SHORT_4_4_4_4;
+        break;
+
+    default:
+        // RGB8 is padded to B, G, R, 0xFF by FlipFramebuffer
+        *gl_format = GL_BGRA;
+        *gl_type = GL_UNSIGNED_BYTE;
+        break;
     }
 }
 
+/**
+ * Flips a framebuffer into the mapped pixel buffer and uploads it to a texture. The pixel buffer
+ * must be bound to GL_PIXEL_UNPACK_BUFFER.
+ * @param texture Texture to upload to
+ * @param address Physical address of the framebuffer
+ * @param format_register Value of the framebuffer format register
+ * @param width Width of the screen
+ * @param height Height of the screen
+ * @param map Pointer to the mapped region of the pixel buffer to flip the framebuffer into
+ * @param offset Offset of the region in the pixel buffer
+ */
+void RendererOpenGL::UploadScreen(GLuint texture, u32 address, u32 format_register, int width,
+    int height, u8* map, size_t offset) {
+
+    const u8* framebuffer = GPU::GetFramebufferPointer(address);
+    if (framebuffer == NULL)
+        return;
+
+    // The framebuffer may have been drawn to by the hardware rasterizer
+    const GPU::FramebufferFormat format = GPU::GetFramebufferFormat(format_register);
+    Pica::HWRasterizer::FlushRegion(address,
+        width * height * VideoCore::GetFramebufferBytesPerPixel(format));
+    VideoCore::FlipFramebuffer(framebuffer, map, width, height, format);
+
+    GLenum gl_format, gl_type;
+    GetUploadFormat(format, &gl_format, &gl_type);
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, gl_format, gl_type,
+        reinterpret_cast<const GLvoid*>(offset));
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 /** 
  * Renders external framebuffer (XFB)
  * @param src_rect Source rectangle in XFB to copy
  * @param dst_rect Destination rectangle in output framebuffer to copy to
  */
 void RendererOpenGL::RenderXFB(const common::Rect& src_rect, const common::Rect& dst_rect) {
+    // Update textures with contents of XFB in RAM. The framebuffers are flipped straight into a
+    // pixel buffer, so that the uploads are asynchronous.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_xfb_pbo);
+
+    u8* map;
+    size_t pbo_offset;
+    if (m_xfb_pbo_map) {
+        // Persistently mapped: wait until the GPU is done with the copies from two frames ago
+        pbo_offset = m_xfb_pbo_frame * kPixelBufferFrameSize;
+        map = m_xfb_pbo_map + pbo_offset;
+        if (m_xfb_pbo_fences[m_xfb_pbo_frame]) {
+            glClientWaitSync(m_xfb_pbo_fences[m_xfb_pbo_frame], GL_SYNC_FLUSH_COMMANDS_BIT,
+                GL_TIMEOUT_IGNORED);
+            glDeleteSync(m_xfb_pbo_fences[m_xfb_pbo_frame]);
+            m_xfb_pbo_fences[m_xfb_pbo_frame] = 0;
+        }
+    } else {
+        // Orphan the previous storage, which the GPU may still be copying from
+        pbo_offset = 0;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, kPixelBufferFrameSize, NULL, GL_STREAM_DRAW);
+        map = (u8*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, kPixelBufferFrameSize,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    }
+
+    if (map) {
+        UploadScreen(m_xfb_texture_top, GPU::g_regs.framebuffer_top_left_1,
+            GPU::g_regs.framebuffer_top_format, VideoCore::kScreenTopWidth,
+            VideoCore::kScreenTopHeight, map, pbo_offset);
+        UploadScreen(m_xfb_texture_bottom, GPU::g_regs.framebuffer_sub_left_1,
+            GPU::g_regs.framebuffer_sub_format, VideoCore::kScreenBottomWidth,
+            VideoCore::kScreenBottomHeight, map + kPixelBufferScreenSize,
+            pbo_offset + kPixelBufferScreenSize);
+    }
 
-    FlipFramebuffer(GPU::GetFramebufferPointer(GPU::g_regs.framebuffer_top_left_1), m_xfb_top_flipped);
-    FlipFramebuffer(GPU::GetFramebufferPointer(GPU::g_regs.framebuffer_sub_left_1), m_xfb_bottom_flipped);
+    if (m_xfb_pbo_map) {
+        m_xfb_pbo_fences[m_xfb_pbo_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_xfb_pbo_frame = (m_xfb_pbo_frame + 1) % kNumPixelBufferFrames;
+    } else if (map) {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
     // Blit the top framebuffer
     // ------------------------
 
-    // Update textures with contents of XFB in RAM - top
-    glBindTexture(GL_TEXTURE_2D, m_xfb_texture_top);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, VideoCore::kScreenTopWidth, VideoCore::kScreenTopHeight,
-        GL_BGR, GL_UNSIGNED_BYTE, m_xfb_top_flipped);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
     // Render target is destination framebuffer
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo[kFramebuffer_VirtualXFB]);
     glViewport(0, 0, VideoCore::kScreenTopWidth, VideoCore::kScreenTopHeight);
@@ -107,12 +197,6 @@ void RendererOpenGL::RenderXFB(const common::Rect& src_rect, const common::Rect&
     // Blit the bottom framebuffer
     // ---------------------------
 
-    // Update textures with contents of XFB in RAM - bottom
-    glBindTexture(GL_TEXTURE_2D, m_xfb_texture_bottom);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, VideoCore::kScreenTopWidth, VideoCore::kScreenTopHeight,
-        GL_RGB, GL_UNSIGNED_BYTE, m_xfb_bottom_flipped);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
     // Render target is destination framebuffer
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo[kFramebuffer_VirtualXFB]);
     glViewport(0, 0,
@@ -201,6 +285,25 @@ void RendererOpenGL::InitFramebuffer() {
     glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 
         m_xfb_texture_bottom, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Create the pixel buffer the XFBs are uploaded from
+    // --------------------------------------------------
+
+    glGenBuffers(1, &m_xfb_pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_xfb_pbo);
+    if (GLEW_ARB_buffer_storage) {
+        // Map the buffer once, and cycle through a region per frame in flight
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr size = kPixelBufferFrameSize * kNumPixelBufferFrames;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+        m_xfb_pbo_map = (u8*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+    }
+    if (m_xfb_pbo_map) {
+        NOTICE_LOG(RENDER, "using a persistently mapped pixel buffer");
+    } else {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, kPixelBufferFrameSize, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 }
 
 /// Blit the FBO to the OpenGL default framebuffer
@@ -279,4 +382,18 @@ void RendererOpenGL::Init() {
 
 /// Shutdown the renderer
 void RendererOpenGL::ShutDown() {
+    for (int i = 0; i < kNumPixelBufferFrames; i++) {
+        if (m_xfb_pbo_fences[i]) {
+            glDeleteSync(m_xfb_pbo_fences[i]);
+            m_xfb_pbo_fences[i] = 0;
+        }
+    }
+    if (m_xfb_pbo_map) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_xfb_pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        m_xfb_pbo_map = NULL;
+    }
+    glDeleteBuffers(1, &m_xfb_pbo);
+    m_xfb_pbo = 0;
 }
@@ -10,6 +10,7 @@
 #include "common/emu_window.h"
 
 #include "video_core/renderer_base.h"
+#include "video_core/video_core.h"
 
 
 class RendererOpenGL : virtual public RendererBase {
@@ -17,6 +18,16 @@ public:
 
     static const int kMaxFramebuffers = 2;  ///< Maximum number of framebuffers
 
+    /// Size of a screen in the XFB pixel buffer, large enough for any framebuffer format
+    static const int kPixelBufferScreenSize = VideoCore::kScreenTopWidth *
+        VideoCore::kScreenTopHeight * 4;
+
+    /// Size of the XFB pixel buffer used per frame, for the top and bottom screens
+    static const int kPixelBufferFrameSize = kPixelBufferScreenSize * 2;
+
+    /// Number of frames the persistently mapped XFB pixel buffer holds
+    static const int kNumPixelBufferFrames = 2;
+
     RendererOpenGL();
     ~RendererOpenGL();
 
@@ -54,12 +65,17 @@ private:
     void UpdateFramerate();
 
     /**
-     * Helper function to flip framebuffer from left-to-right to top-to-bottom
-     * @param in Pointer to input raw framebuffer in V/RAM
-     * @param out Pointer to output buffer with flipped framebuffer
-     * @todo Early on hack... I'd like to find a more efficient way of doing this /bunnei
+     * Flips a framebuffer into the mapped pixel buffer and uploads it to a texture
+     * @param texture Texture to upload to
+     * @param address Physical address of the framebuffer
+     * @param format_register Value of the framebuffer format register
+     * @param width Width of the screen
+     * @param height Height of the screen
+     * @param map Pointer to the mapped region of the pixel buffer to flip the framebuffer into
+     * @param offset Offset of the region in the pixel buffer
      */
-    void FlipFramebuffer(const u8* in, u8* out);
+    void UploadScreen(GLuint texture, u32 address, u32 format_register, int width, int height,
+        u8* map, size_t offset);
 
 
     EmuWindow*  m_render_window;                    ///< Handle to render window
@@ -81,10 +97,12 @@ private:
     GLuint m_xfb_top;                               ///< GL handle to top framebuffer
     GLuint m_xfb_bottom;                            ///< GL handle to bottom framebuffer
 
-    // "Flipped" framebuffers translate scanlines from native 3DS left-to-right to top-to-bottom
-    // as OpenGL expects them in a texture. There probably is a more efficient way of doing this:
+    // The framebuffers are flipped from native 3DS left-to-right to top-to-bottom scanlines, as
+    // OpenGL expects them in a texture, straight into a pixel buffer to upload them from:
 
-    u8 m_xfb_top_flipped[VideoCore::kScreenTopWidth * VideoCore::kScreenTopWidth * 4]; 
-    u8 m_xfb_bottom_flipped[VideoCore::kScreenTopWidth * VideoCore::kScreenTopWidth * 4];   
+    GLuint m_xfb_pbo;                               ///< GL handle to XFB pixel buffer
+    u8*    m_xfb_pbo_map;                           ///< Persistent mapping of m_xfb_pbo, or NULL
+    GLsync m_xfb_pbo_fences[kNumPixelBufferFrames]; ///< Fences of the uploads from each region
+    int    m_xfb_pbo_frame;                         ///< Region of m_xfb_pbo used for next frame
 
 };
\ No newline at end of file
@@ -0,0 +1,145 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include "common/file_util.h"
+#include "common/string_util.h"
+
+#include "core/hw/gpu.h"
+
+#include "video_core/utils.h"
+#include "video_core/video_core.h"
+#include "video_core/renderer_software/renderer_software.h"
+
+/// Width and height of the frame image, with the bottom screen centered below the top screen
+static const int kFrameWidth    = VideoCore::kScreenTopWidth;
+static const int kFrameHeight   = VideoCore::kScreenTopHeight + VideoCore::kScreenBottomHeight;
+
+static inline u8 Convert4To8(u32 value) {
+    return (u8)((value << 4) | value);
+}
+
+static inline u8 Convert5To8(u32 value) {
+    return (u8)((value << 3) | (value >> 2));
+}
+
+static inline u8 Convert6To8(u32 value) {
+    return (u8)((value << 2) | (value >> 4));
+}
+
+/// RendererSoftware constructor
+RendererSoftware::RendererSoftware() : m_render_window(NULL) {
+}
+
+/// RendererSoftware destructor
+RendererSoftware::~RendererSoftware() {
+}
+
+/// Swap buffers (render frame)
+void RendererSoftware::SwapBuffers() {
+    if (!VideoCore::g_frame_dump_path.empty()) {
+        CopyScreen(GPU::g_regs.framebuffer_top_left_1, GPU::g_regs.framebuffer_top_format,
+            VideoCore::kScreenTopWidth, VideoCore::kScreenTopHeight, 0, 0);
+        CopyScreen(GPU::g_regs.framebuffer_sub_left_1, GPU::g_regs.framebuffer_sub_format,
+            VideoCore::kScreenBottomWidth, VideoCore::kScreenBottomHeight,
+            (kFrameWidth - VideoCore::kScreenBottomWidth) / 2, VideoCore::kScreenTopHeight);
+        DumpFrame();
+    }
+
+    if (m_render_window) {
+        m_render_window->PollEvents();
+    }
+
+    m_current_frame++;
+}
+
+void RendererSoftware::CopyScreen(u32 address, u32 format_register, int width, int height,
+    int x, int y) {
+
+    const u8* in = GPU::GetFramebufferPointer(address);
+    if (in == NULL)
+        return;
+
+    const GPU::FramebufferFormat format = GPU::GetFramebufferFormat(format_register);
+    VideoCore::FlipFramebuffer(in, &m_flipped[0], width, height, format);
+
+    const int pixel_size = VideoCore::GetFlippedPixelSize(format);
+    for (int row = 0; row < height; row++) {
+        const u8* src = &m_flipped[row * width * pixel_size];
+        u8* out = &m_frame[((y + row) * kFrameWidth + x) * 3];
+
+        for (int column = 0; column < width; column++, src += pixel_size, out += 3) {
+            const u32 pixel = (pixel_size == 4) ? *(const u32*)src : *(const u16*)src;
+            switch (format) {
+            case GPU::FRAMEBUFFER_FORMAT_RGBA8:
+                out[0] = pixel >> 24;
+                out[1] = pixel >> 16;
+                out[2] = pixel >> 8;
+                break;
+
+            case GPU::FRAMEBUFFER_FORMAT_RGB565:
+                out[0] = Convert5To8(pixel >> 11);
+                out[1] = Convert6To8((pixel >> 5) & 0x3F);
+                out[2] = Convert5To8(pixel & 0x1F);
+                break;
+
+            case GPU::FRAMEBUFFER_FORMAT_RGB5A1:
+                out[0] = Convert5To8(pixel >> 11);
+                out[1] = Convert5To8((pixel >> 6) & 0x1F);
+                out[2] = Convert5To8((pixel >> 1) & 0x1F);
+                break;
+
+            case GPU::FRAMEBUFFER_FORMAT_RGBA4:
+                out[0] = Convert4To8(pixel >> 12);
+                out[1] = Convert4To8((pixel >> 8) & 0xF);
+                out[2] = Convert4To8((pixel >> 4) & 0xF);
+                break;
+
+            default:
+                // RGB8, padded to B, G, R, 0xFF
+                out[0] = pixel >> 16;
+                out[1] = pixel >> 8;
+                out[2] = pixel;
+                break;
+            }
+        }
+    }
+}
+
+void RendererSoftware::DumpFrame() {
+    const std::string filename = StringFromFormat("%s/frame_%06d.ppm",
+        VideoCore::g_frame_dump_path.c_str(), m_current_frame);
+    File::IOFile file(filename, "wb");
+    if (!file.IsOpen()) {
+        ERROR_LOG(RENDER, "Failed to open %s for the frame dump", filename.c_str());
+        return;
+    }
+
+    const std::string header = StringFromFormat("P6\n%d %d\n255\n", kFrameWidth, kFrameHeight);
+    file.WriteBytes(header.c_str(), header.size());
+    file.WriteBytes(&m_frame[0], m_frame.size());
+}
+
+/** 
+ * Set the emulator window to use for renderer
+ * @param window EmuWindow handle to emulator window to use for rendering, may be NULL
+ */
+void RendererSoftware::SetWindow(EmuWindow* window) {
+    m_render_window = window;
+}
+
+/// Initialize the renderer
+void RendererSoftware::Init() {
+    m_frame.assign(kFrameWidth * kFrameHeight * 3, 0);
+    m_flipped.resize(VideoCore::kScreenTopWidth * VideoCore::kScreenTopHeight * 4);
+
+    if (!VideoCore::g_frame_dump_path.empty()) {
+        File::CreateFullPath(VideoCore::g_frame_dump_path + "/");
+    }
+
+    NOTICE_LOG(RENDER, "initialized software renderer OK");
+}
+
+/// Shutdown the renderer
+void RendererSoftware::ShutDown() {
+}
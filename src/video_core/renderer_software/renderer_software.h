@@ -0,0 +1,61 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/common.h"
+#include "common/emu_window.h"
+
+#include "video_core/renderer_base.h"
+
+/**
+ * Headless renderer for hosts without a GPU. Draw calls are rasterized into emulated memory by the
+ * software rasterizer either way, so this renderer only has to present the LCD framebuffers, which
+ * it optionally does by dumping each frame to an image file.
+ */
+class RendererSoftware : virtual public RendererBase {
+public:
+
+    RendererSoftware();
+    ~RendererSoftware();
+
+    /// Swap buffers (render frame)
+    void SwapBuffers();
+
+    /** 
+     * Set the emulator window to use for renderer
+     * @param window EmuWindow handle to emulator window to use for rendering, may be NULL
+     */
+    void SetWindow(EmuWindow* window);
+
+    /// Initialize the renderer
+    void Init();
+
+    /// Shutdown the renderer
+    void ShutDown();
+
+private:
+
+    /**
+     * Copies an LCD framebuffer into the frame image, rotating it from the native column order
+     * @param address Physical address of the framebuffer
+     * @param format_register Value of the framebuffer format register
+     * @param width Width of the screen
+     * @param height Height of the screen
+     * @param x Column of the frame image to place the screen at
+     * @param y Row of the frame image to place the screen at
+     */
+    void CopyScreen(u32 address, u32 format_register, int width, int height, int x, int y);
+
+    /// Writes the frame image to the dump directory as a binary PPM file
+    void DumpFrame();
+
+    EmuWindow*      m_render_window;                ///< Handle to render window, or NULL
+    std::vector<u8> m_frame;                        ///< Both screens as RGB, top to bottom
+    std::vector<u8> m_flipped;                      ///< Scratch buffer for a flipped screen
+
+};
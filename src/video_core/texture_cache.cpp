@@ -0,0 +1,487 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <set>
+
+#include "common/common.h"
+#include "common/hash.h"
+#include "common/log.h"
+
+#include "core/mem_map.h"
+
+#include "video_core/texture_cache.h"
+#include "video_core/morton.h"
+
+namespace Pica {
+
+namespace TextureCache {
+
+/// Cached texture
+struct Entry {
+    Texture texture;
+    u32 size;                               ///< Size of the encoded texture in bytes
+    u32 watch_address;                      ///< Guest virtual address the texture is watched at
+    bool watched;                           ///< Whether the pages of the texture are watched
+    bool dirty;                             ///< Whether the texture may have changed
+    std::list<Entry*>::iterator lru_it;     ///< Position in g_lru
+};
+
+static std::map<u64, Entry*> g_entries;     ///< All cached textures, keyed by MakeKey
+static std::list<Entry*> g_lru;             ///< Cached textures, most recently used first
+static size_t g_memory_used = 0;            ///< Size of all decoded textures in bytes
+static size_t g_memory_budget = DEFAULT_MEMORY_BUDGET;
+
+/// Guest pages written to since they were last checked, queued up by OnWatchedWrite
+static Memory::WrittenPageQueue g_written_pages;
+
+// Statistics, logged at shutdown
+static u64 g_num_hits = 0;                  ///< Lookups of clean cached textures
+static u64 g_num_revalidations = 0;         ///< Lookups of dirty textures that had not changed
+static u64 g_num_decodes = 0;               ///< Lookups that decoded a texture
+
+TextureInfo TextureInfo::FromUnit(int unit) {
+    Regs::Struct<Regs::TextureUnit0Size> size;
+    Regs::Struct<Regs::TextureUnit0Address> address;
+    Regs::Struct<Regs::TextureUnit0Type> type;
+    size.hex = g_regs[TextureUnitSize(unit)];
+    address.hex = g_regs[TextureUnitAddress(unit)];
+    type.hex = g_regs[TextureUnitType(unit)];
+
+    TextureInfo info;
+    info.address = address.GetPhysicalAddress();
+    info.width = size.width;
+    info.height = size.height;
+    info.format = type.format;
+    return info;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Decoding
+
+/// Gets the number of bits per texel of a texture format, or 0 if the format is unknown
+static u32 GetBitsPerTexel(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::RGBA8:
+        return 32;
+    case TextureFormat::RGB8:
+        return 24;
+    case TextureFormat::RGB5A1:
+    case TextureFormat::RGB565:
+    case TextureFormat::RGBA4:
+    case TextureFormat::IA8:
+    case TextureFormat::HILO8:
+        return 16;
+    case TextureFormat::I8:
+    case TextureFormat::A8:
+    case TextureFormat::IA4:
+    case TextureFormat::ETC1A4:
+        return 8;
+    case TextureFormat::I4:
+    case TextureFormat::A4:
+    case TextureFormat::ETC1:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+u32 TextureInfo::GetSize() const {
+    return width * height * GetBitsPerTexel(format) / 8;
+}
+
+static inline u32 MakeRGBA(u32 r, u32 g, u32 b, u32 a) {
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+static inline u32 Convert4To8(u32 value) {
+    return (value << 4) | value;
+}
+
+static inline u32 Convert5To8(u32 value) {
+    return (value << 3) | (value >> 2);
+}
+
+static inline u32 Convert6To8(u32 value) {
+    return (value << 2) | (value >> 4);
+}
+
+/**
+ * Decodes a texel of an uncompressed format
+ * @param src Pointer to the texels, either an 8x8 tile in Morton order or linear rows
+ * @param index Index of the texel in src
+ * @param format Format of the texture
+ * @return RGBA8 texel
+ */
+static inline u32 DecodeTexel(const u8* src, u32 index, TextureFormat format) {
+    switch (format) {
+    case TextureFormat::RGBA8:
+    {
+        const u8* texel = src + index * 4;
+        return MakeRGBA(texel[3], texel[2], texel[1], texel[0]);
+    }
+    case TextureFormat::RGB8:
+    {
+        const u8* texel = src + index * 3;
+        return MakeRGBA(texel[2], texel[1], texel[0], 255);
+    }
+    case TextureFormat::RGB5A1:
+    {
+        const u32 texel = src[index * 2] | (src[index * 2 + 1] << 8);
+        return MakeRGBA(Convert5To8(texel >> 11), Convert5To8((texel >> 6) & 0x1F),
+            Convert5To8((texel >> 1) & 0x1F), (texel & 1) ? 255 : 0);
+    }
+    case TextureFormat::RGB565:
+    {
+        const u32 texel = src[index * 2] | (src[index * 2 + 1] << 8);
+        return MakeRGBA(Convert5To8(texel >> 11), Convert6To8((texel >> 5) & 0x3F),
+            Convert5To8(texel & 0x1F), 255);
+    }
+    case TextureFormat::RGBA4:
+    {
+        const u32 texel = src[index * 2] | (src[index * 2 + 1] << 8);
+        return MakeRGBA(Convert4To8(texel >> 12), Convert4To8((texel >> 8) & 0xF),
+            Convert4To8((texel >> 4) & 0xF), Convert4To8(texel & 0xF));
+    }
+    case TextureFormat::IA8:
+    {
+        const u8* texel = src + index * 2;
+        return MakeRGBA(texel[1], texel[1], texel[1], texel[0]);
+    }
+    case TextureFormat::HILO8:
+    {
+        const u8* texel = src + index * 2;
+        return MakeRGBA(texel[1], texel[0], 0, 255);
+    }
+    case TextureFormat::I8:
+        return MakeRGBA(src[index], src[index], src[index], 255);
+
+    case TextureFormat::A8:
+        return MakeRGBA(0, 0, 0, src[index]);
+
+    case TextureFormat::IA4:
+    {
+        const u32 intensity = Convert4To8(src[index] >> 4);
+        return MakeRGBA(intensity, intensity, intensity, Convert4To8(src[index] & 0xF));
+    }
+    case TextureFormat::I4:
+    {
+        const u32 intensity = Convert4To8((src[index / 2] >> ((index & 1) * 4)) & 0xF);
+        return MakeRGBA(intensity, intensity, intensity, 255);
+    }
+    case TextureFormat::A4:
+        return MakeRGBA(0, 0, 0, Convert4To8((src[index / 2] >> ((index & 1) * 4)) & 0xF));
+
+    default:
+        return 0;
+    }
+}
+
+/// Intensity modifiers of ETC1, indexed by table codeword and the low bit of the texel index
+static const int etc1_modifiers[8][2] = {
+    {  2,   8 }, {  5,  17 }, {  9,  29 }, { 13,  42 },
+    { 18,  60 }, { 24,  80 }, { 33, 106 }, { 47, 183 },
+};
+
+/**
+ * Decodes a 4x4 block of an ETC1 or ETC1A4 texture
+ * @param block ETC1 block, stored as a little endian 64-bit value
+ * @param alpha 4-bit alpha of each texel of an ETC1A4 block, or ~0 for ETC1
+ * @param dst Pointer to the top-left texel of the block in the decoded texture
+ * @param stride Distance between rows of the decoded texture in texels
+ */
+static void DecodeETC1Block(u64 block, u64 alpha, u32* dst, u32 stride) {
+    const bool flip = (block >> 32) & 1;
+    const bool differential = (block >> 33) & 1;
+
+    int base[2][3];
+    for (int channel = 0; channel < 3; channel++) {
+        const int shift = 59 - channel * 8;
+        if (differential) {
+            const int value = (block >> shift) & 0x1F;
+            int delta = (block >> (shift - 3)) & 0x7;
+            delta = (delta ^ 4) - 4;
+            base[0][channel] = (value << 3) | (value >> 2);
+            const int value2 = (value + delta) & 0x1F;
+            base[1][channel] = (value2 << 3) | (value2 >> 2);
+        } else {
+            const int value = (block >> (shift + 1)) & 0xF;
+            const int value2 = (block >> (shift - 3)) & 0xF;
+            base[0][channel] = (value << 4) | value;
+            base[1][channel] = (value2 << 4) | value2;
+        }
+    }
+    const int tables[2] = { (int)((block >> 37) & 7), (int)((block >> 34) & 7) };
+
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            const int index = x * 4 + y;
+            const int subblock = flip ? (y >= 2) : (x >= 2);
+            const int lsb = (block >> index) & 1;
+            const int msb = (block >> (index + 16)) & 1;
+
+            int modifier = etc1_modifiers[tables[subblock]][lsb];
+            if (msb) {
+                modifier = -modifier;
+            }
+
+            int color[3];
+            for (int channel = 0; channel < 3; channel++) {
+                color[channel] = std::min(std::max(base[subblock][channel] + modifier, 0), 255);
+            }
+            dst[y * stride + x] = MakeRGBA(color[0], color[1], color[2],
+                Convert4To8((alpha >> (index * 4)) & 0xF));
+        }
+    }
+}
+
+static inline u64 ReadU64(const u8* src) {
+    u64 value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+/**
+ * Decodes a texture into linear RGBA8 texels
+ * @param info Texture to decode
+ * @param src Pointer to the encoded texture
+ * @param dst Pointer to the decoded texture, with room for info.width * info.height texels
+ */
+static void DecodeTexture(const TextureInfo& info, const u8* src, u32* dst) {
+    const u32 bits_per_texel = GetBitsPerTexel(info.format);
+
+    if (bits_per_texel >= 8 && info.format != TextureFormat::ETC1A4) {
+        // Untile the whole texture at once, then convert its texels in linear order
+        const u32 bytes_per_texel = bits_per_texel / 8;
+        std::vector<u8> linear(info.width * info.height * bytes_per_texel);
+        VideoCore::MortonDecode(src, &linear[0], info.width * bytes_per_texel, info.width,
+            info.height, bytes_per_texel);
+        for (u32 i = 0; i < info.width * info.height; i++) {
+            dst[i] = DecodeTexel(&linear[0], i, info.format);
+        }
+        return;
+    }
+
+    const u32 tile_size = bits_per_texel * 64 / 8;
+
+    for (u32 tile_y = 0; tile_y < info.height; tile_y += 8) {
+        for (u32 tile_x = 0; tile_x < info.width; tile_x += 8, src += tile_size) {
+            u32* const tile_dst = dst + tile_y * info.width + tile_x;
+
+            if (info.format == TextureFormat::ETC1 || info.format == TextureFormat::ETC1A4) {
+                // Each tile holds four 4x4 blocks in Z order, each ETC1A4 block preceded by its
+                // alpha values
+                const u32 block_size = (info.format == TextureFormat::ETC1A4) ? 16 : 8;
+                for (u32 block = 0; block < 4; block++) {
+                    const u8* block_src = src + block * block_size;
+                    u64 alpha = ~0ULL;
+                    if (info.format == TextureFormat::ETC1A4) {
+                        alpha = ReadU64(block_src);
+                        block_src += 8;
+                    }
+                    DecodeETC1Block(ReadU64(block_src), alpha,
+                        tile_dst + (block / 2) * 4 * info.width + (block % 2) * 4, info.width);
+                }
+                continue;
+            }
+
+            for (u32 y = 0; y < 8; y++) {
+                for (u32 x = 0; x < 8; x++) {
+                    tile_dst[y * info.width + x] = DecodeTexel(src,
+                        VideoCore::MortonInterleave(x, y), info.format);
+                }
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Cache
+
+/// Packs the properties identifying a texture into a key
+static inline u64 MakeKey(const TextureInfo& info) {
+    return (u64)info.address | ((u64)info.width << 32) | ((u64)info.height << 43) |
+        ((u64)info.format << 54);
+}
+
+/**
+ * Gets the guest virtual address the guest writes a physical address through
+ * @param address Physical address
+ * @return Virtual address, or 0 if the address is not in VRAM or FCRAM
+ */
+static u32 GetWatchAddress(u32 address) {
+    if (address >= Memory::VRAM_PADDR && address < Memory::VRAM_PADDR_END) {
+        return Memory::VirtualAddressFromPhysical_VRAM(address);
+    } else if (address >= Memory::FCRAM_PADDR && address < Memory::FCRAM_PADDR_END) {
+        return Memory::VirtualAddressFromPhysical_FCRAM(address);
+    }
+    return 0;
+}
+
+/// Starts or stops watching the pages of a cached texture
+static void SetWatched(Entry* entry, bool watched) {
+    if (entry->watched == watched || entry->watch_address == 0)
+        return;
+
+    const u32 end = entry->watch_address + entry->size;
+    for (u32 page = entry->watch_address & ~Memory::PAGE_MASK; page < end;
+        page += Memory::PAGE_SIZE) {
+
+        if (watched) {
+            Memory::WatchPageWrites(page);
+        } else {
+            Memory::UnwatchPageWrites(page);
+        }
+    }
+    entry->watched = watched;
+}
+
+static void FreeEntry(Entry* entry) {
+    SetWatched(entry, false);
+    g_lru.erase(entry->lru_it);
+    g_memory_used -= entry->texture.data.size() * sizeof(u32);
+    delete entry;
+}
+
+/// Evicts least recently used textures until the decoded textures fit the memory budget
+static void EvictToBudget(size_t bytes_needed) {
+    while (!g_lru.empty() && g_memory_used + bytes_needed > g_memory_budget) {
+        Entry* const entry = g_lru.back();
+        g_entries.erase(MakeKey(entry->texture.info));
+        FreeEntry(entry);
+    }
+}
+
+/// Write watch callback, queues up the written page. Called on the thread that wrote.
+static void OnWatchedWrite(u32 addr, u32 size) {
+    g_written_pages.Push(addr, size);
+}
+
+/// Marks the textures on the pages written since the last call dirty
+static void ProcessWrittenPages() {
+    std::set<u32> pages;
+    if (!g_written_pages.Take(pages))
+        return;
+
+    for (std::map<u64, Entry*>::iterator it = g_entries.begin(); it != g_entries.end(); ++it) {
+        Entry* const entry = it->second;
+        if (!entry->watched)
+            continue;
+
+        const u32 first_page = entry->watch_address & ~Memory::PAGE_MASK;
+        std::set<u32>::const_iterator page = pages.lower_bound(first_page);
+        if (page != pages.end() && *page < entry->watch_address + entry->size) {
+            // Further writes don't need to be seen until the texture is hashed again
+            entry->dirty = true;
+            SetWatched(entry, false);
+        }
+    }
+}
+
+const Texture* Lookup(const TextureInfo& info) {
+    const u32 bits_per_texel = GetBitsPerTexel(info.format);
+    if (bits_per_texel == 0 || info.width == 0 || info.height == 0 || (info.width % 8) != 0 ||
+        (info.height % 8) != 0) {
+        ERROR_LOG(GPU, "invalid texture %ux%u, format %d", info.width, info.height,
+            (int)info.format);
+        return NULL;
+    }
+
+    const u32 size = info.width * info.height * bits_per_texel / 8;
+    const u8* const src = Memory::GetPhysicalPointer(info.address);
+    if (src == NULL || Memory::GetPhysicalPointer(info.address + size - 1) == NULL) {
+        ERROR_LOG(GPU, "texture at invalid address 0x%08X", info.address);
+        return NULL;
+    }
+
+    ProcessWrittenPages();
+
+    const u64 key = MakeKey(info);
+    std::map<u64, Entry*>::iterator it = g_entries.find(key);
+    Entry* entry = (it != g_entries.end()) ? it->second : NULL;
+
+    if (entry && !entry->dirty) {
+        g_num_hits++;
+    } else {
+        // Watch before hashing, so that writes made from now on are seen
+        if (entry) {
+            SetWatched(entry, true);
+        }
+        const u64 hash = GetHash64(src, size, 0);
+
+        if (entry && entry->texture.hash == hash) {
+            g_num_revalidations++;
+        } else {
+            if (entry == NULL) {
+                const size_t decoded_size = info.width * info.height * sizeof(u32);
+                EvictToBudget(decoded_size);
+
+                entry = new Entry;
+                entry->texture.info = info;
+                entry->texture.data.resize(info.width * info.height);
+                entry->size = size;
+                entry->watch_address = GetWatchAddress(info.address);
+                entry->watched = false;
+                g_lru.push_front(entry);
+                entry->lru_it = g_lru.begin();
+                g_entries[key] = entry;
+                g_memory_used += decoded_size;
+
+                SetWatched(entry, true);
+            }
+
+            DecodeTexture(info, src, &entry->texture.data[0]);
+            entry->texture.hash = hash;
+            g_num_decodes++;
+        }
+        entry->dirty = false;
+    }
+
+    // Move to the front of the LRU list
+    g_lru.splice(g_lru.begin(), g_lru, entry->lru_it);
+    return &entry->texture;
+}
+
+void InvalidateRange(u32 address, u32 size) {
+    const u64 end = (u64)address + size;
+    for (std::map<u64, Entry*>::iterator it = g_entries.begin(); it != g_entries.end(); ++it) {
+        Entry* const entry = it->second;
+        const u32 start = entry->texture.info.address;
+        if (start < end && address < start + entry->size) {
+            entry->dirty = true;
+            SetWatched(entry, false);
+        }
+    }
+}
+
+void Clear() {
+    for (std::map<u64, Entry*>::iterator it = g_entries.begin(); it != g_entries.end(); ++it) {
+        FreeEntry(it->second);
+    }
+    g_entries.clear();
+}
+
+void Init(size_t memory_budget) {
+    g_memory_budget = memory_budget;
+    g_num_hits = g_num_revalidations = g_num_decodes = 0;
+    Memory::RegisterWriteWatchCallback(OnWatchedWrite);
+}
+
+void Shutdown() {
+    Memory::UnregisterWriteWatchCallback(OnWatchedWrite);
+    Clear();
+    g_written_pages.Clear();
+
+    NOTICE_LOG(GPU, "texture cache: %llu hits, %llu unchanged after writes, %llu decodes",
+        (unsigned long long)g_num_hits, (unsigned long long)g_num_revalidations,
+        (unsigned long long)g_num_decodes);
+}
+
+} // namespace
+
+} // namespace
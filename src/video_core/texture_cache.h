@@ -0,0 +1,86 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <vector>
+
+#include "common/common_types.h"
+
+#include "video_core/pica.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// PICA200 texture cache
+//
+// Textures are decoded from their tiled formats to linear RGBA8 once, and kept until the memory
+// they were decoded from changes. The guest pages backing each cached texture are write-watched:
+// the first write to one marks the textures on it dirty and stops watching it. A dirty texture is
+// hashed again when it is next looked up, and only decoded again if its contents really changed.
+// Least recently used textures are evicted once the decoded textures exceed a memory budget.
+
+namespace Pica {
+
+namespace TextureCache {
+
+typedef Regs::Struct<Regs::TextureUnit0Type>::Format TextureFormat;
+
+/// Location and format of a texture in emulated memory
+struct TextureInfo {
+    u32 address;            ///< Physical address
+    u32 width;
+    u32 height;
+    TextureFormat format;
+
+    /**
+     * Gets the texture currently configured for a texture unit
+     * @param unit Index of the texture unit
+     * @return Texture of the unit
+     */
+    static TextureInfo FromUnit(int unit);
+
+    /// Gets the size of the encoded texture in bytes, or 0 if its format is unknown
+    u32 GetSize() const;
+};
+
+/// Decoded texture
+struct Texture {
+    TextureInfo info;
+    u64 hash;               ///< Hash of the encoded texture
+    std::vector<u32> data;  ///< RGBA8 texels, R in the lowest byte, rows in the order of
+                            ///< increasing t as OpenGL expects them
+};
+
+/// Default budget for the memory used by decoded textures, in bytes
+const size_t DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+/**
+ * Gets a texture, decoding it unless it is cached and unchanged
+ * @param info Texture to get
+ * @return Decoded texture, valid until the next call to Lookup, or NULL if it could not be decoded
+ */
+const Texture* Lookup(const TextureInfo& info);
+
+/**
+ * Marks the textures overlapping a range of memory dirty. Writes made by the guest are detected
+ * automatically, so this is only needed for writes made by the GPU emulation.
+ * @param address Physical address of the range
+ * @param size Size of the range in bytes
+ */
+void InvalidateRange(u32 address, u32 size);
+
+/// Evicts all textures
+void Clear();
+
+/**
+ * Initialize the texture cache
+ * @param memory_budget Maximum memory used by decoded textures, in bytes
+ */
+void Init(size_t memory_budget = DEFAULT_MEMORY_BUDGET);
+
+/// Shutdown the texture cache
+void Shutdown();
+
+} // namespace
+
+} // namespace
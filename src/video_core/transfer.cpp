@@ -0,0 +1,536 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "common/common.h"
+#include "common/log.h"
+
+#include "video_core/morton.h"
+#include "video_core/transfer.h"
+
+#ifdef EMU_ARCHITECTURE_X64
+#include <emmintrin.h>
+#endif
+
+namespace VideoCore {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory fill
+
+void MemoryFill(u8* start, u8* end, u32 value, u32 value_size) {
+    _dbg_assert_msg_(GPU, value_size >= 2 && value_size <= 4, "invalid fill size %u", value_size);
+    if (end <= start)
+        return;
+
+    // 48 bytes hold a whole number of values of any size, as well as three 16-byte vectors. The
+    // pattern is long enough to start it at any byte of a value.
+    static const size_t BLOCK_SIZE = 48;
+    u8 pattern[BLOCK_SIZE + 4];
+    for (size_t i = 0; i < sizeof(pattern); i++) {
+        pattern[i] = (u8)(value >> (8 * (i % value_size)));
+    }
+
+    // Fill single bytes up to the first 16-byte boundary
+    const size_t head = std::min<size_t>((0 - (uintptr_t)start) & 15, end - start);
+    for (size_t i = 0; i < head; i++) {
+        start[i] = pattern[i];
+    }
+
+    u8* dst = start + head;
+    const u8* const block = pattern + head % value_size;
+    const size_t length = end - dst;
+    u8* const blocks_end = dst + length - length % BLOCK_SIZE;
+
+#ifdef EMU_ARCHITECTURE_X64
+    const __m128i block0 = _mm_loadu_si128((const __m128i*)(block + 0));
+    const __m128i block1 = _mm_loadu_si128((const __m128i*)(block + 16));
+    const __m128i block2 = _mm_loadu_si128((const __m128i*)(block + 32));
+    for (; dst != blocks_end; dst += BLOCK_SIZE) {
+        _mm_store_si128((__m128i*)(dst + 0), block0);
+        _mm_store_si128((__m128i*)(dst + 16), block1);
+        _mm_store_si128((__m128i*)(dst + 32), block2);
+    }
+#else
+    for (; dst != blocks_end; dst += BLOCK_SIZE) {
+        memcpy(dst, block, BLOCK_SIZE);
+    }
+#endif
+
+    for (size_t i = 0; dst + i != end; i++) {
+        dst[i] = block[i];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pixel conversion
+//
+// Display transfers convert pixels through RGBA8 in the layout of the RGBA8 framebuffer format,
+// 0xRRGGBBAA, so that RGBA8 pixels are copied unchanged. Narrower channels are expanded by
+// replicating their high bits and truncated when narrowing them again.
+
+/**
+ * Converts a pixel to RGBA8
+ * @param src Pointer to the pixel
+ * @param format Pixel format of the pixel
+ * @return RGBA8 pixel
+ */
+static inline u32 DecodePixel(const u8* src, GPU::FramebufferFormat format) {
+    switch (format) {
+    case GPU::FRAMEBUFFER_FORMAT_RGBA8:
+        return src[0] | (src[1] << 8) | (src[2] << 16) | ((u32)src[3] << 24);
+
+    case GPU::FRAMEBUFFER_FORMAT_RGB8:
+        return 0xFF | (src[0] << 8) | (src[1] << 16) | ((u32)src[2] << 24);
+
+    case GPU::FRAMEBUFFER_FORMAT_RGB565:
+    {
+        const u32 p = src[0] | (src[1] << 8);
+        const u32 r = ((p >> 8) & 0xF8) | (p >> 13);
+        const u32 g = ((p >> 3) & 0xFC) | ((p >> 9) & 0x3);
+        const u32 b = ((p << 3) & 0xF8) | ((p >> 2) & 0x7);
+        return (r << 24) | (g << 16) | (b << 8) | 0xFF;
+    }
+
+    case GPU::FRAMEBUFFER_FORMAT_RGB5A1:
+    {
+        const u32 p = src[0] | (src[1] << 8);
+        const u32 r = ((p >> 8) & 0xF8) | (p >> 13);
+        const u32 g = ((p >> 3) & 0xF8) | ((p >> 8) & 0x7);
+        const u32 b = ((p << 2) & 0xF8) | ((p >> 3) & 0x7);
+        const u32 a = (p & 1) ? 0xFF : 0;
+        return (r << 24) | (g << 16) | (b << 8) | a;
+    }
+
+    case GPU::FRAMEBUFFER_FORMAT_RGBA4:
+    {
+        const u32 p = src[0] | (src[1] << 8);
+        const u32 rgba = ((p & 0xF000) << 12) | ((p & 0x0F00) << 8) | ((p & 0x00F0) << 4) |
+            (p & 0x000F);
+        return rgba | (rgba << 4);
+    }
+
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Converts an RGBA8 pixel to another format
+ * @param color RGBA8 pixel
+ * @param dst Pointer to the converted pixel
+ * @param format Pixel format to convert to
+ */
+static inline void EncodePixel(u32 color, u8* dst, GPU::FramebufferFormat format) {
+    const u32 r = color >> 24;
+    const u32 g = (color >> 16) & 0xFF;
+    const u32 b = (color >> 8) & 0xFF;
+    const u32 a = color & 0xFF;
+    u32 p;
+
+    switch (format) {
+    case GPU::FRAMEBUFFER_FORMAT_RGBA8:
+        dst[0] = a;
+        dst[1] = b;
+        dst[2] = g;
+        dst[3] = r;
+        return;
+
+    case GPU::FRAMEBUFFER_FORMAT_RGB8:
+        dst[0] = b;
+        dst[1] = g;
+        dst[2] = r;
+        return;
+
+    case GPU::FRAMEBUFFER_FORMAT_RGB565:
+        p = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+        break;
+
+    case GPU::FRAMEBUFFER_FORMAT_RGB5A1:
+        p = ((r >> 3) << 11) | ((g >> 3) << 6) | ((b >> 3) << 1) | (a >> 7);
+        break;
+
+    case GPU::FRAMEBUFFER_FORMAT_RGBA4:
+        p = ((r >> 4) << 12) | ((g >> 4) << 8) | ((b >> 4) << 4) | (a >> 4);
+        break;
+
+    default:
+        return;
+    }
+
+    dst[0] = p & 0xFF;
+    dst[1] = p >> 8;
+}
+
+#ifdef EMU_ARCHITECTURE_X64
+
+/**
+ * Converts eight 16-bit pixels to RGBA8, as DecodePixel does
+ * @param p Pixels
+ * @param format Pixel format of the pixels, a 16-bit one
+ * @param dst Pointer to the eight RGBA8 pixels
+ */
+static inline void Decode16BitPixels(__m128i p, GPU::FramebufferFormat format, u32* dst) {
+    // Build each pixel from two 16-bit halves, R and G in the high one, B and A in the low one
+    __m128i high, low;
+
+    switch (format) {
+    case GPU::FRAMEBUFFER_FORMAT_RGB565:
+    {
+        const __m128i r = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 8), _mm_set1_epi16(0xF8)),
+            _mm_srli_epi16(p, 13));
+        const __m128i g = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 3), _mm_set1_epi16(0xFC)),
+            _mm_and_si128(_mm_srli_epi16(p, 9), _mm_set1_epi16(0x3)));
+        const __m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(p, 3), _mm_set1_epi16(0xF8)),
+            _mm_and_si128(_mm_srli_epi16(p, 2), _mm_set1_epi16(0x7)));
+        high = _mm_or_si128(_mm_slli_epi16(r, 8), g);
+        low = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_set1_epi16(0xFF));
+        break;
+    }
+
+    case GPU::FRAMEBUFFER_FORMAT_RGB5A1:
+    {
+        const __m128i r = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 8), _mm_set1_epi16(0xF8)),
+            _mm_srli_epi16(p, 13));
+        const __m128i g = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 3), _mm_set1_epi16(0xF8)),
+            _mm_and_si128(_mm_srli_epi16(p, 8), _mm_set1_epi16(0x7)));
+        const __m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(p, 2), _mm_set1_epi16(0xF8)),
+            _mm_and_si128(_mm_srli_epi16(p, 3), _mm_set1_epi16(0x7)));
+        const __m128i a = _mm_and_si128(
+            _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(p, _mm_set1_epi16(1))),
+            _mm_set1_epi16(0xFF));
+        high = _mm_or_si128(_mm_slli_epi16(r, 8), g);
+        low = _mm_or_si128(_mm_slli_epi16(b, 8), a);
+        break;
+    }
+
+    default: // RGBA4
+    {
+        const __m128i high4 = _mm_or_si128(
+            _mm_and_si128(_mm_srli_epi16(p, 4), _mm_set1_epi16(0x0F00)),
+            _mm_and_si128(_mm_srli_epi16(p, 8), _mm_set1_epi16(0x000F)));
+        const __m128i low4 = _mm_or_si128(
+            _mm_and_si128(_mm_slli_epi16(p, 4), _mm_set1_epi16(0x0F00)),
+            _mm_and_si128(p, _mm_set1_epi16(0x000F)));
+        high = _mm_or_si128(high4, _mm_slli_epi16(high4, 4));
+        low = _mm_or_si128(low4, _mm_slli_epi16(low4, 4));
+        break;
+    }
+    }
+
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi16(low, high));
+    _mm_storeu_si128((__m128i*)(dst + 4), _mm_unpackhi_epi16(low, high));
+}
+
+/**
+ * Converts eight RGBA8 pixels to a 16-bit format, as EncodePixel does
+ * @param src Pointer to the eight RGBA8 pixels
+ * @param format Pixel format to convert to, a 16-bit one
+ * @return Converted pixels
+ */
+static inline __m128i Encode16BitPixels(const u32* src, GPU::FramebufferFormat format) {
+    const __m128i c0 = _mm_loadu_si128((const __m128i*)src);
+    const __m128i c1 = _mm_loadu_si128((const __m128i*)(src + 4));
+
+    // Sign extending the halves first keeps the signed saturation of the packs from clamping them
+    const __m128i high = _mm_packs_epi32(_mm_srai_epi32(c0, 16), _mm_srai_epi32(c1, 16));
+    const __m128i low = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(c0, 16), 16),
+        _mm_srai_epi32(_mm_slli_epi32(c1, 16), 16));
+
+    switch (format) {
+    case GPU::FRAMEBUFFER_FORMAT_RGB565:
+        return _mm_or_si128(_mm_or_si128(
+            _mm_and_si128(high, _mm_set1_epi16((s16)0xF800)),
+            _mm_slli_epi16(_mm_and_si128(high, _mm_set1_epi16(0xFC)), 3)),
+            _mm_srli_epi16(low, 11));
+
+    case GPU::FRAMEBUFFER_FORMAT_RGB5A1:
+        return _mm_or_si128(_mm_or_si128(
+            _mm_and_si128(high, _mm_set1_epi16((s16)0xF800)),
+            _mm_slli_epi16(_mm_and_si128(high, _mm_set1_epi16(0xF8)), 3)), _mm_or_si128(
+            _mm_and_si128(_mm_srli_epi16(low, 10), _mm_set1_epi16(0x3E)),
+            _mm_and_si128(_mm_srli_epi16(low, 7), _mm_set1_epi16(0x1))));
+
+    default: // RGBA4
+        return _mm_or_si128(_mm_or_si128(
+            _mm_and_si128(high, _mm_set1_epi16((s16)0xF000)),
+            _mm_slli_epi16(_mm_and_si128(high, _mm_set1_epi16(0xF0)), 4)), _mm_or_si128(
+            _mm_and_si128(_mm_srli_epi16(low, 8), _mm_set1_epi16(0xF0)),
+            _mm_and_si128(_mm_srli_epi16(low, 4), _mm_set1_epi16(0xF))));
+    }
+}
+
+#endif // EMU_ARCHITECTURE_X64
+
+/**
+ * Converts a row of pixels to RGBA8
+ * @param src Pointer to the pixels
+ * @param dst Pointer to the RGBA8 pixels
+ * @param count Number of pixels
+ * @param format Pixel format of the pixels
+ */
+static void DecodeRow(const u8* src, u32* dst, u32 count, GPU::FramebufferFormat format) {
+    u32 x = 0;
+
+    if (format == GPU::FRAMEBUFFER_FORMAT_RGBA8) {
+        memcpy(dst, src, count * 4);
+        return;
+    }
+
+    if (format == GPU::FRAMEBUFFER_FORMAT_RGB8) {
+        // Unpack four pixels from three words at a time
+        for (; x + 4 <= count; x += 4) {
+            u32 word0, word1, word2;
+            memcpy(&word0, src + x * 3 + 0, 4);
+            memcpy(&word1, src + x * 3 + 4, 4);
+            memcpy(&word2, src + x * 3 + 8, 4);
+            dst[x + 0] = (word0 << 8) | 0xFF;
+            dst[x + 1] = (word0 >> 16) | (word1 << 16) | 0xFF;
+            dst[x + 2] = (word1 >> 8) | (word2 << 24) | 0xFF;
+            dst[x + 3] = word2 | 0xFF;
+        }
+    }
+
+#ifdef EMU_ARCHITECTURE_X64
+    if (GetFramebufferBytesPerPixel(format) == 2) {
+        for (; x + 8 <= count; x += 8) {
+            Decode16BitPixels(_mm_loadu_si128((const __m128i*)(src + x * 2)), format, dst + x);
+        }
+    }
+#endif
+
+    const u32 bytes_per_pixel = GetFramebufferBytesPerPixel(format);
+    for (; x < count; x++) {
+        dst[x] = DecodePixel(src + x * bytes_per_pixel, format);
+    }
+}
+
+/**
+ * Converts a row of RGBA8 pixels to another format
+ * @param src Pointer to the RGBA8 pixels
+ * @param dst Pointer to the converted pixels
+ * @param count Number of pixels
+ * @param format Pixel format to convert to
+ */
+static void EncodeRow(const u32* src, u8* dst, u32 count, GPU::FramebufferFormat format) {
+    u32 x = 0;
+
+    if (format == GPU::FRAMEBUFFER_FORMAT_RGBA8) {
+        memcpy(dst, src, count * 4);
+        return;
+    }
+
+    if (format == GPU::FRAMEBUFFER_FORMAT_RGB8) {
+        // Pack four pixels into three words at a time
+        for (; x + 4 <= count; x += 4) {
+            const u32 word0 = (src[x + 0] >> 8) | ((src[x + 1] >> 8) << 24);
+            const u32 word1 = (src[x + 1] >> 16) | ((src[x + 2] >> 8) << 16);
+            const u32 word2 = (src[x + 2] >> 24) | ((src[x + 3] >> 8) << 8);
+            memcpy(dst + x * 3 + 0, &word0, 4);
+            memcpy(dst + x * 3 + 4, &word1, 4);
+            memcpy(dst + x * 3 + 8, &word2, 4);
+        }
+    }
+
+#ifdef EMU_ARCHITECTURE_X64
+    if (GetFramebufferBytesPerPixel(format) == 2) {
+        for (; x + 8 <= count; x += 8) {
+            _mm_storeu_si128((__m128i*)(dst + x * 2), Encode16BitPixels(src + x, format));
+        }
+    }
+#endif
+
+    const u32 bytes_per_pixel = GetFramebufferBytesPerPixel(format);
+    for (; x < count; x++) {
+        EncodePixel(src[x], dst + x * bytes_per_pixel, format);
+    }
+}
+
+/// Averages the bytes of two RGBA8 pixels, rounding up like the SSE2 average instructions
+static inline u32 AveragePixels(u32 a, u32 b) {
+    return (a | b) - (((a ^ b) >> 1) & 0x7F7F7F7F);
+}
+
+/**
+ * Averages two rows of RGBA8 pixels
+ * @param a Pointer to the first row, which receives the averages
+ * @param b Pointer to the second row
+ * @param count Number of pixels
+ */
+static void AverageRows(u32* a, const u32* b, u32 count) {
+    u32 x = 0;
+
+#ifdef EMU_ARCHITECTURE_X64
+    for (; x + 4 <= count; x += 4) {
+        const __m128i row0 = _mm_loadu_si128((const __m128i*)(a + x));
+        const __m128i row1 = _mm_loadu_si128((const __m128i*)(b + x));
+        _mm_storeu_si128((__m128i*)(a + x), _mm_avg_epu8(row0, row1));
+    }
+#endif
+
+    for (; x < count; x++) {
+        a[x] = AveragePixels(a[x], b[x]);
+    }
+}
+
+/**
+ * Averages horizontal pairs of RGBA8 pixels in place
+ * @param row Pointer to the row, of 2 * count pixels, which receives count averages
+ * @param count Number of pairs
+ */
+static void AveragePairs(u32* row, u32 count) {
+    u32 x = 0;
+
+#ifdef EMU_ARCHITECTURE_X64
+    // Each average is stored behind the pairs it was computed from, so the row can be reused
+    for (; x + 4 <= count; x += 4) {
+        const __m128i a = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(row + 2 * x)),
+            _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i b = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(row + 2 * x + 4)),
+            _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128((__m128i*)(row + x),
+            _mm_avg_epu8(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b)));
+    }
+#endif
+
+    for (; x < count; x++) {
+        row[x] = AveragePixels(row[2 * x], row[2 * x + 1]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Display transfer
+
+void DisplayTransfer(const u8* in, u8* out, const DisplayTransferConfig& config) {
+    const u32 in_bytes_per_pixel = GetFramebufferBytesPerPixel(config.input_format);
+    const u32 out_bytes_per_pixel = GetFramebufferBytesPerPixel(config.output_format);
+    const ptrdiff_t in_stride = config.input_width * in_bytes_per_pixel;
+    const ptrdiff_t out_stride = config.output_width * out_bytes_per_pixel;
+
+    const u32 scale_x = (config.scaling != TRANSFER_SCALING_NONE) ? 2 : 1;
+    const u32 scale_y = (config.scaling == TRANSFER_SCALING_XY) ? 2 : 1;
+
+    // Size of the transferred area in output pixels
+    const u32 width = std::min(config.output_width, config.input_width / scale_x);
+    const u32 height = std::min(config.output_height, config.input_height / scale_y);
+
+    const u32 tiled_width = config.output_tiled ? config.output_width : config.input_width;
+    const u32 tiled_height = config.output_tiled ? config.output_height : config.input_height;
+    if ((tiled_width % 8) != 0 || (tiled_height % 8) != 0) {
+        ERROR_LOG(GPU, "tiled buffer size %ux%u is not a multiple of the tile size",
+            tiled_width, tiled_height);
+        return;
+    }
+
+    // Flipping is done by walking the linear side of the transfer bottom up
+    const bool same_size = (config.input_width == config.output_width &&
+        config.input_height == config.output_height);
+    if (config.scaling == TRANSFER_SCALING_NONE && same_size &&
+        config.input_format == config.output_format) {
+
+        if (config.output_tiled) {
+            const u8* linear = config.flip_vertically ? in + (height - 1) * in_stride : in;
+            MortonEncode(linear, config.flip_vertically ? -in_stride : in_stride, out, width,
+                height, in_bytes_per_pixel);
+        } else {
+            u8* linear = config.flip_vertically ? out + (height - 1) * out_stride : out;
+            MortonDecode(in, linear, config.flip_vertically ? -out_stride : out_stride, width,
+                height, in_bytes_per_pixel);
+        }
+        return;
+    }
+
+    // Otherwise convert row by row through RGBA8. The tiled side is untiled to or tiled from a
+    // band of eight linear rows, one row of tiles, at a time to stay in the cache.
+    std::vector<u8> band((config.output_tiled ? out_stride : in_stride) * 8);
+    u32 decoded_band = ~0u;
+
+    std::vector<u32> row(width * scale_x);
+    std::vector<u32> second_row(scale_y > 1 ? width * scale_x : 0);
+
+    for (u32 out_y = 0; out_y < height; out_y++) {
+        const u32 in_y = (config.flip_vertically ? height - 1 - out_y : out_y) * scale_y;
+
+        // Both rows averaged by TRANSFER_SCALING_XY are in the same band
+        const u8* in_row = in + in_y * in_stride;
+        if (!config.output_tiled) {
+            if (in_y / 8 != decoded_band) {
+                decoded_band = in_y / 8;
+                MortonDecode(in + decoded_band * 8 * in_stride, &band[0], in_stride,
+                    config.input_width, 8, in_bytes_per_pixel);
+            }
+            in_row = &band[(in_y % 8) * in_stride];
+        }
+
+        DecodeRow(in_row, &row[0], width * scale_x, config.input_format);
+        if (scale_y > 1) {
+            DecodeRow(in_row + in_stride, &second_row[0], width * 2, config.input_format);
+            AverageRows(&row[0], &second_row[0], width * 2);
+        }
+        if (scale_x > 1) {
+            AveragePairs(&row[0], width);
+        }
+
+        if (!config.output_tiled) {
+            EncodeRow(&row[0], out + out_y * out_stride, width, config.output_format);
+            continue;
+        }
+
+        u8* const out_band = out + (out_y & ~7) * out_stride;
+        if ((out_y % 8) == 0 && (width != config.output_width || out_y + 8 > height)) {
+            // Keep the pixels outside of the transferred area
+            MortonDecode(out_band, &band[0], out_stride, config.output_width, 8,
+                out_bytes_per_pixel);
+        }
+        EncodeRow(&row[0], &band[(out_y % 8) * out_stride], width, config.output_format);
+        if ((out_y % 8) == 7 || out_y + 1 == height) {
+            MortonEncode(&band[0], out_stride, out_band, config.output_width, 8,
+                out_bytes_per_pixel);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Texture copy
+
+void TextureCopy(const u8* in, u32 in_width, u32 in_gap, u8* out, u32 out_width, u32 out_gap,
+    u32 size) {
+
+    if (in_gap == 0 && out_gap == 0) {
+        memcpy(out, in, size);
+        return;
+    }
+
+    if (in_width == 0 || out_width == 0) {
+        ERROR_LOG(GPU, "texture copy with empty lines");
+        return;
+    }
+
+    // Copy the longest runs that neither cross an input nor an output gap
+    u32 in_remaining = in_width;
+    u32 out_remaining = out_width;
+    while (size > 0) {
+        const u32 length = std::min(std::min(in_remaining, out_remaining), size);
+        memcpy(out, in, length);
+        in += length;
+        out += length;
+        size -= length;
+
+        in_remaining -= length;
+        if (in_remaining == 0) {
+            in += in_gap;
+            in_remaining = in_width;
+        }
+        out_remaining -= length;
+        if (out_remaining == 0) {
+            out += out_gap;
+            out_remaining = out_width;
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,90 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+
+#include "core/hw/gpu.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// GPU memory transfer engines
+//
+// Bulk memory operations the GSP module issues outside of command lists: memory fills (typically
+// clearing color and depth buffers), display transfers (copying rendered color buffers to the LCD
+// framebuffers) and texture copies. They run directly on the host memory backing the buffers.
+
+namespace VideoCore {
+
+/// Downscaling applied by a display transfer
+enum TransferScaling {
+    TRANSFER_SCALING_NONE   = 0,
+    TRANSFER_SCALING_X      = 1,    ///< Averages horizontal pairs of pixels
+    TRANSFER_SCALING_XY     = 2,    ///< Averages 2x2 blocks of pixels
+};
+
+/// Parameters of a display transfer
+struct DisplayTransferConfig {
+    u32 input_width;                        ///< Width of the input in pixels
+    u32 input_height;                       ///< Height of the input in pixels
+    GPU::FramebufferFormat input_format;
+
+    u32 output_width;                       ///< Width of the output in pixels
+    u32 output_height;                      ///< Height of the output in pixels
+    GPU::FramebufferFormat output_format;
+
+    bool flip_vertically;                   ///< Whether the output rows are stored bottom up
+    bool output_tiled;                      ///< Converts linear input to tiled output if set,
+                                            ///< tiled input to linear output otherwise
+    TransferScaling scaling;
+};
+
+/**
+ * Gets the size of a pixel of a framebuffer format
+ * @param format Pixel format
+ * @return Size of a pixel in bytes
+ */
+static inline u32 GetFramebufferBytesPerPixel(GPU::FramebufferFormat format) {
+    switch (format) {
+    case GPU::FRAMEBUFFER_FORMAT_RGBA8:
+        return 4;
+    case GPU::FRAMEBUFFER_FORMAT_RGB8:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
+/**
+ * Fills memory with a repeated 16-, 24- or 32-bit value
+ * @param start Pointer to the first byte to fill
+ * @param end Pointer past the last byte to fill
+ * @param value Value to fill with, stored little endian
+ * @param value_size Size of the value in bytes, 2, 3 or 4
+ */
+void MemoryFill(u8* start, u8* end, u32 value, u32 value_size);
+
+/**
+ * Copies a color buffer between tiled and linear layouts, converting its pixel format and
+ * downscaling it on the way
+ * @param in Pointer to the input buffer
+ * @param out Pointer to the output buffer, which must not overlap the input
+ * @param config Parameters of the transfer
+ */
+void DisplayTransfer(const u8* in, u8* out, const DisplayTransferConfig& config);
+
+/**
+ * Copies bytes between two buffers made of lines separated by gaps, which are skipped
+ * @param in Pointer to the input buffer
+ * @param in_width Size of the input lines in bytes
+ * @param in_gap Size of the gaps between input lines in bytes
+ * @param out Pointer to the output buffer
+ * @param out_width Size of the output lines in bytes
+ * @param out_gap Size of the gaps between output lines in bytes
+ * @param size Number of bytes to copy, not counting the gaps
+ */
+void TextureCopy(const u8* in, u32 in_width, u32 in_gap, u8* out, u32 out_width, u32 out_gap,
+    u32 size);
+
+} // namespace
@@ -5,9 +5,307 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "common/common.h"
+#include "common/cpu_detect.h"
+
 #include "video_core/utils.h"
 
+#ifdef EMU_ARCHITECTURE_X64
+#include <immintrin.h>
+#endif
+
 namespace VideoCore {
+
+/**
+ * Reads a framebuffer pixel, padding RGB8 pixels to four bytes
+ * @param in Pointer to the pixel
+ * @param format Pixel format of the framebuffer
+ * @return Pixel in the format written by FlipFramebuffer
+ */
+static inline u32 ReadFramebufferPixel(const u8* in, GPU::FramebufferFormat format) {
+    switch (format) {
+    case GPU::FRAMEBUFFER_FORMAT_RGBA8:
+        return *(const u32*)in;
+    case GPU::FRAMEBUFFER_FORMAT_RGB8:
+        return in[0] | (in[1] << 8) | (in[2] << 16) | 0xFF000000;
+    default:
+        return *(const u16*)in;
+    }
+}
+
+/**
+ * Rotates a framebuffer one pixel at a time, for any size
+ * @see FlipFramebuffer
+ */
+static void FlipFramebufferGeneric(const u8* in, u8* out, int width, int height,
+    GPU::FramebufferFormat format) {
+
+    const int in_size = (format == GPU::FRAMEBUFFER_FORMAT_RGB8) ? 3 :
+        GetFlippedPixelSize(format);
+    const int out_size = GetFlippedPixelSize(format);
+
+    for (int x = 0; x < width; x++) {
+        for (int y = height - 1; y >= 0; y--) {
+            const u32 pixel = ReadFramebufferPixel(in, format);
+            u8* dst = out + (y * width + x) * out_size;
+            if (out_size == 4) {
+                *(u32*)dst = pixel;
+            } else {
+                *(u16*)dst = (u16)pixel;
+            }
+            in += in_size;
+        }
+    }
+}
+
+#ifdef EMU_ARCHITECTURE_X64
+
+/**
+ * Rotates a framebuffer of 4 byte pixels in blocks of 16 columns, using 4x4 transposes. Each block
+ * writes whole cache lines of the output, and reads its columns sequentially.
+ * @see FlipFramebuffer
+ */
+static void FlipFramebuffer32(const u8* in, u8* out, int width, int height,
+    GPU::FramebufferFormat format) {
+
+    const int in_size = (format == GPU::FRAMEBUFFER_FORMAT_RGB8) ? 3 : 4;
+    const int out_stride = width * 4;
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+    for (int x0 = 0; x0 < width; x0 += 16) {
+        for (int pos = 0; pos < height; pos += 4) {
+            // Output row of the pixels at column position pos + n
+            u8* const out_row = out + (height - 1 - pos) * out_stride;
+
+            for (int x = x0; x < x0 + 16; x += 4) {
+                __m128i cols[4];
+                for (int i = 0; i < 4; i++) {
+                    const u8* src = in + ((x + i) * height + pos) * in_size;
+                    if (in_size == 4) {
+                        cols[i] = _mm_loadu_si128((const __m128i*)src);
+                    } else if (x + i < width - 1 || pos + 4 < height) {
+                        // Pad four RGB8 pixels from a 16 byte load. The load reads 4 bytes
+                        // past them, so the end of the framebuffer is handled below.
+                        const __m128i v = _mm_loadu_si128((const __m128i*)src);
+                        const __m128i p01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+                        const __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6),
+                            _mm_srli_si128(v, 9));
+                        cols[i] = _mm_or_si128(_mm_unpacklo_epi64(p01, p23), alpha);
+                    } else {
+                        cols[i] = _mm_set_epi32(ReadFramebufferPixel(src + 9, format),
+                            ReadFramebufferPixel(src + 6, format),
+                            ReadFramebufferPixel(src + 3, format),
+                            ReadFramebufferPixel(src, format));
+                    }
+                }
+
+                const __m128i t0 = _mm_unpacklo_epi32(cols[0], cols[1]);
+                const __m128i t1 = _mm_unpacklo_epi32(cols[2], cols[3]);
+                const __m128i t2 = _mm_unpackhi_epi32(cols[0], cols[1]);
+                const __m128i t3 = _mm_unpackhi_epi32(cols[2], cols[3]);
+
+                _mm_storeu_si128((__m128i*)(out_row - 0 * out_stride + x * 4),
+                    _mm_unpacklo_epi64(t0, t1));
+                _mm_storeu_si128((__m128i*)(out_row - 1 * out_stride + x * 4),
+                    _mm_unpackhi_epi64(t0, t1));
+                _mm_storeu_si128((__m128i*)(out_row - 2 * out_stride + x * 4),
+                    _mm_unpacklo_epi64(t2, t3));
+                _mm_storeu_si128((__m128i*)(out_row - 3 * out_stride + x * 4),
+                    _mm_unpackhi_epi64(t2, t3));
+            }
+        }
+    }
+}
+
+/**
+ * Rotates a framebuffer of 2 byte pixels in blocks of 16 columns, using 8x8 transposes
+ * @see FlipFramebuffer
+ */
+static void FlipFramebuffer16(const u8* in, u8* out, int width, int height) {
+    const int out_stride = width * 2;
+
+    for (int x0 = 0; x0 < width; x0 += 16) {
+        for (int pos = 0; pos < height; pos += 8) {
+            u8* const out_row = out + (height - 1 - pos) * out_stride;
+
+            for (int x = x0; x < x0 + 16; x += 8) {
+                __m128i a[8];
+                for (int i = 0; i < 8; i++) {
+                    a[i] = _mm_loadu_si128((const __m128i*)(in + ((x + i) * height + pos) * 2));
+                }
+
+                __m128i b[8];
+                for (int i = 0; i < 4; i++) {
+                    b[i * 2 + 0] = _mm_unpacklo_epi16(a[i * 2], a[i * 2 + 1]);
+                    b[i * 2 + 1] = _mm_unpackhi_epi16(a[i * 2], a[i * 2 + 1]);
+                }
+
+                __m128i c[8];
+                for (int i = 0; i < 2; i++) {
+                    c[i * 4 + 0] = _mm_unpacklo_epi32(b[i * 4 + 0], b[i * 4 + 2]);
+                    c[i * 4 + 1] = _mm_unpackhi_epi32(b[i * 4 + 0], b[i * 4 + 2]);
+                    c[i * 4 + 2] = _mm_unpacklo_epi32(b[i * 4 + 1], b[i * 4 + 3]);
+                    c[i * 4 + 3] = _mm_unpackhi_epi32(b[i * 4 + 1], b[i * 4 + 3]);
+                }
+
+                for (int i = 0; i < 4; i++) {
+                    _mm_storeu_si128((__m128i*)(out_row - (i * 2 + 0) * out_stride + x * 2),
+                        _mm_unpacklo_epi64(c[i], c[i + 4]));
+                    _mm_storeu_si128((__m128i*)(out_row - (i * 2 + 1) * out_stride + x * 2),
+                        _mm_unpackhi_epi64(c[i], c[i + 4]));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Rotates a framebuffer of 4 byte pixels like FlipFramebuffer32, using 8x8 transposes with AVX2
+ * @see FlipFramebuffer
+ */
+TARGET_AVX2
+static void FlipFramebuffer32AVX2(const u8* in, u8* out, int width, int height,
+    GPU::FramebufferFormat format) {
+
+    const int in_size = (format == GPU::FRAMEBUFFER_FORMAT_RGB8) ? 3 : 4;
+    const int out_stride = width * 4;
+    const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+
+    // Moves the 24 bytes of eight RGB8 pixels to the low 12 bytes of each lane, then pads them
+    const __m256i rgb8_dwords = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+    const __m256i rgb8_bytes = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+    for (int x0 = 0; x0 < width; x0 += 16) {
+        for (int pos = 0; pos < height; pos += 8) {
+            u8* const out_row = out + (height - 1 - pos) * out_stride;
+
+            for (int x = x0; x < x0 + 16; x += 8) {
+                __m256i cols[8];
+                for (int i = 0; i < 8; i++) {
+                    const u8* src = in + ((x + i) * height + pos) * in_size;
+                    if (in_size == 4) {
+                        cols[i] = _mm256_loadu_si256((const __m256i*)src);
+                    } else if (x + i < width - 1 || pos + 8 < height) {
+                        // The 32 byte load reads 8 bytes past the pixels
+                        const __m256i v = _mm256_permutevar8x32_epi32(
+                            _mm256_loadu_si256((const __m256i*)src), rgb8_dwords);
+                        cols[i] = _mm256_or_si256(_mm256_shuffle_epi8(v, rgb8_bytes), alpha);
+                    } else {
+                        MEMORY_ALIGNED32(u32 pixels[8]);
+                        for (int n = 0; n < 8; n++) {
+                            pixels[n] = ReadFramebufferPixel(src + n * 3, format);
+                        }
+                        cols[i] = _mm256_load_si256((const __m256i*)pixels);
+                    }
+                }
+
+                __m256i t[8];
+                for (int i = 0; i < 8; i += 4) {
+                    const __m256i a0 = _mm256_unpacklo_epi32(cols[i + 0], cols[i + 1]);
+                    const __m256i a1 = _mm256_unpackhi_epi32(cols[i + 0], cols[i + 1]);
+                    const __m256i a2 = _mm256_unpacklo_epi32(cols[i + 2], cols[i + 3]);
+                    const __m256i a3 = _mm256_unpackhi_epi32(cols[i + 2], cols[i + 3]);
+                    t[i + 0] = _mm256_unpacklo_epi64(a0, a2);
+                    t[i + 1] = _mm256_unpackhi_epi64(a0, a2);
+                    t[i + 2] = _mm256_unpacklo_epi64(a1, a3);
+                    t[i + 3] = _mm256_unpackhi_epi64(a1, a3);
+                }
+
+                // The low lanes hold positions pos to pos + 3, the high lanes the next four
+                for (int i = 0; i < 4; i++) {
+                    _mm256_storeu_si256((__m256i*)(out_row - i * out_stride + x * 4),
+                        _mm256_permute2x128_si256(t[i], t[i + 4], 0x20));
+                    _mm256_storeu_si256((__m256i*)(out_row - (i + 4) * out_stride + x * 4),
+                        _mm256_permute2x128_si256(t[i], t[i + 4], 0x31));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Rotates a framebuffer of 2 byte pixels like FlipFramebuffer16, doing the 8x8 transposes of two
+ * groups of 8 column positions at once with AVX2. The height must be a multiple of 16.
+ * @see FlipFramebuffer
+ */
+TARGET_AVX2
+static void FlipFramebuffer16AVX2(const u8* in, u8* out, int width, int height) {
+    const int out_stride = width * 2;
+
+    for (int x0 = 0; x0 < width; x0 += 16) {
+        for (int pos = 0; pos < height; pos += 16) {
+            u8* const out_row = out + (height - 1 - pos) * out_stride;
+
+            for (int x = x0; x < x0 + 16; x += 8) {
+                __m256i a[8];
+                for (int i = 0; i < 8; i++) {
+                    a[i] = _mm256_loadu_si256(
+                        (const __m256i*)(in + ((x + i) * height + pos) * 2));
+                }
+
+                __m256i b[8];
+                for (int i = 0; i < 4; i++) {
+                    b[i * 2 + 0] = _mm256_unpacklo_epi16(a[i * 2], a[i * 2 + 1]);
+                    b[i * 2 + 1] = _mm256_unpackhi_epi16(a[i * 2], a[i * 2 + 1]);
+                }
+
+                __m256i c[8];
+                for (int i = 0; i < 2; i++) {
+                    c[i * 4 + 0] = _mm256_unpacklo_epi32(b[i * 4 + 0], b[i * 4 + 2]);
+                    c[i * 4 + 1] = _mm256_unpackhi_epi32(b[i * 4 + 0], b[i * 4 + 2]);
+                    c[i * 4 + 2] = _mm256_unpacklo_epi32(b[i * 4 + 1], b[i * 4 + 3]);
+                    c[i * 4 + 3] = _mm256_unpackhi_epi32(b[i * 4 + 1], b[i * 4 + 3]);
+                }
+
+                // The low lanes hold the rows of positions pos to pos + 7, the high lanes the
+                // rows of the next eight
+                for (int i = 0; i < 4; i++) {
+                    const __m256i rows[2] = {
+                        _mm256_unpacklo_epi64(c[i], c[i + 4]),
+                        _mm256_unpackhi_epi64(c[i], c[i + 4])
+                    };
+                    for (int j = 0; j < 2; j++) {
+                        const int n = i * 2 + j;
+                        _mm_storeu_si128((__m128i*)(out_row - n * out_stride + x * 2),
+                            _mm256_castsi256_si128(rows[j]));
+                        _mm_storeu_si128((__m128i*)(out_row - (n + 8) * out_stride + x * 2),
+                            _mm256_extracti128_si256(rows[j], 1));
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif
+
+void FlipFramebuffer(const u8* in, u8* out, int width, int height,
+    GPU::FramebufferFormat format) {
+
+#ifdef EMU_ARCHITECTURE_X64
+    if (width % 16 == 0 && height % 8 == 0) {
+        if (GetFlippedPixelSize(format) == 4) {
+            if (cpu_info.bAVX2) {
+                FlipFramebuffer32AVX2(in, out, width, height, format);
+            } else {
+                FlipFramebuffer32(in, out, width, height, format);
+            }
+        } else {
+            if (cpu_info.bAVX2 && height % 16 == 0) {
+                FlipFramebuffer16AVX2(in, out, width, height);
+            } else {
+                FlipFramebuffer16(in, out, width, height);
+            }
+        }
+        return;
+    }
+#endif
+
+    FlipFramebufferGeneric(in, out, width, height, format);
+}
+
 /**
  * Dumps a texture to TGA
  * @param filename String filename to dump texture to
@@ -8,6 +8,8 @@
 
 #include "common/common_types.h"
 
+#include "core/hw/gpu.h"
+
 namespace FormatPrecision {
 
 /// Adjust RGBA8 color with RGBA6 precision
@@ -36,6 +38,36 @@ static inline u32 z24_with_z16(u32 src) {
 
 namespace VideoCore {
 
+/**
+ * Gets the size of the pixels FlipFramebuffer writes for a framebuffer format. RGB8 pixels are
+ * padded to four bytes, all other formats keep their size.
+ * @param format Pixel format of the framebuffer
+ * @return Size of an output pixel in bytes
+ */
+static inline int GetFlippedPixelSize(GPU::FramebufferFormat format) {
+    switch (format) {
+    case GPU::FRAMEBUFFER_FORMAT_RGB565:
+    case GPU::FRAMEBUFFER_FORMAT_RGB5A1:
+    case GPU::FRAMEBUFFER_FORMAT_RGBA4:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+/**
+ * Rotates an LCD framebuffer from its native layout, columns stored from the bottom of the screen
+ * to the top, to rows stored from the top to the bottom. Pixels are not converted, except that RGB8
+ * pixels are padded to B, G, R, 0xFF to keep them aligned.
+ * @param in Pointer to the framebuffer in V/RAM
+ * @param out Pointer to the output rows, of width * GetFlippedPixelSize(format) bytes each
+ * @param width Width of the screen in pixels
+ * @param height Height of the screen in pixels
+ * @param format Pixel format of the framebuffer
+ */
+void FlipFramebuffer(const u8* in, u8* out, int width, int height,
+    GPU::FramebufferFormat format);
+
 /// Structure for the TGA texture format (for dumping)
 struct TGAHeader {
     char  idlength;
@@ -0,0 +1,660 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "common/common.h"
+#include "common/hash.h"
+#include "common/log.h"
+
+#include "video_core/command_processor.h"
+#include "video_core/vertex_shader.h"
+#include "video_core/vertex_shader_jit.h"
+#include "video_core/video_core.h"
+
+namespace Pica {
+
+namespace VertexShader {
+
+static ProgramMemory g_program;
+static u32 g_program_write_offset = 0;          ///< Next instruction written by VSLoadProgramData
+static u32 g_swizzle_write_offset = 0;          ///< Next pattern written by VSLoadSwizzleData
+static bool g_program_dirty = true;             ///< Whether g_program changed since it was hashed
+static u64 g_program_hash = 0;
+
+static ShaderUniforms g_uniforms;
+static u32 g_float_uniform_index = 0;           ///< Next uniform written by VSFloatUniformData
+static u32 g_float_uniform_words[4];            ///< Words of the uniform being uploaded
+static u32 g_num_float_uniform_words = 0;
+
+// Configuration of the current draw, set up by Setup
+static UnitState g_state;
+static u32 g_entry = 0;
+static VertexShaderJit::CompiledShader g_compiled = NULL;   ///< NULL to use the interpreter
+static int g_attribute_registers[NUM_VERTEX_ATTRIBUTES];    ///< Input register of each attribute
+static int g_output_registers[NUM_VERTEX_OUTPUTS];          ///< Output register of each output
+static int g_num_outputs = 0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Interpreter
+
+/// Kind of region tracked on the call stack
+enum FrameType {
+    FRAME_CALL,
+    FRAME_IF,
+    FRAME_LOOP,
+};
+
+/// Region of code being executed by a call, a conditional or a loop
+struct CallStackFrame {
+    FrameType type;
+    u32 final_address;      ///< Address after the last instruction of the region
+    u32 return_address;     ///< Address execution continues at once the region is done
+    u32 loop_address;       ///< First instruction of the loop body
+    u32 repeat_counter;     ///< Iterations left after the current one
+    u32 loop_increment;     ///< Added to aL after each iteration
+};
+
+/**
+ * Converts a float to an integer with truncation. Like CVTTSS2SI, NaN and values out of range
+ * give the smallest integer.
+ */
+static inline s32 FloatToS32(float value) {
+    if (!(value > -2147483904.0f && value < 2147483648.0f))
+        return (s32)0x80000000;
+    return (s32)value;
+}
+
+/**
+ * Gets the operand descriptor of an arithmetic instruction
+ * @param program Program and swizzle memory
+ * @param instr Instruction
+ * @return Operand descriptor
+ */
+static inline SwizzlePattern GetSwizzlePattern(const ProgramMemory& program, Instruction instr) {
+    const u32 op = instr.GetOpCode();
+    const u32 id = (op == OP_MAD || op == OP_MADI) ? instr.mad.operand_desc_id :
+        instr.common.operand_desc_id;
+
+    SwizzlePattern swizzle;
+    swizzle.hex = program.swizzle_data[id];
+    return swizzle;
+}
+
+/**
+ * Reads a source register with the swizzle and negation of the operand descriptor applied
+ * @param state Registers
+ * @param uniforms Uniforms
+ * @param index Source register index
+ * @param address_offset Offset applied to uniform indices
+ * @param selector Component selector of the source
+ * @param negate Whether to negate the source
+ * @param value Components read
+ */
+static inline void ReadSource(const UnitState& state, const ShaderUniforms& uniforms, u32 index,
+    s32 address_offset, u32 selector, bool negate, float value[4]) {
+
+    const float* reg;
+    if (index < SOURCE_TEMPORARY) {
+        reg = state.input[index - SOURCE_INPUT];
+    } else if (index < SOURCE_FLOAT_UNIFORM) {
+        reg = state.temporary[index - SOURCE_TEMPORARY];
+    } else {
+        reg = uniforms.f[(index - SOURCE_FLOAT_UNIFORM + address_offset) & 0x7F];
+    }
+
+    for (int i = 0; i < 4; i++) {
+        const float component = reg[SwizzlePattern::GetSelectorComponent(selector, i)];
+        value[i] = negate ? -component : component;
+    }
+}
+
+/**
+ * Writes the components of a destination register enabled by an operand descriptor
+ * @param state Registers
+ * @param index Destination register index
+ * @param swizzle Operand descriptor
+ * @param value Components to write
+ */
+static inline void WriteDest(UnitState& state, u32 index, SwizzlePattern swizzle,
+    const float value[4]) {
+
+    float* const reg = (index < DEST_TEMPORARY) ? state.output[index - DEST_OUTPUT] :
+        state.temporary[index - DEST_TEMPORARY];
+    for (int i = 0; i < 4; i++) {
+        if (swizzle.DestComponentEnabled(i)) {
+            reg[i] = value[i];
+        }
+    }
+}
+
+/// Gets the value of the address register selected by an address_register_index field
+static inline s32 GetAddressOffset(const UnitState& state, u32 address_register_index) {
+    return (address_register_index == 0) ? 0 : state.address[address_register_index - 1];
+}
+
+static bool Compare(CompareOp op, float a, float b) {
+    switch (op) {
+    case COMPARE_EQUAL:         return a == b;
+    case COMPARE_NOT_EQUAL:     return a != b;
+    case COMPARE_LESS_THAN:     return a < b;
+    case COMPARE_LESS_EQUAL:    return a <= b;
+    case COMPARE_GREATER_THAN:  return a > b;
+    case COMPARE_GREATER_EQUAL: return a >= b;
+    default:                    return false;
+    }
+}
+
+void EvaluateArithmetic(UnitState& state, const ShaderUniforms& uniforms, Instruction instr,
+    SwizzlePattern swizzle) {
+
+    const u32 op = instr.GetOpCode();
+    float src1[4], src2[4], result[4];
+
+    if (op == OP_MAD || op == OP_MADI) {
+        const bool inverted = (op == OP_MADI);
+        const s32 offset = GetAddressOffset(state, instr.mad.address_register_index);
+        float src3[4];
+        ReadSource(state, uniforms, instr.mad.src1, 0, swizzle.src1_selector,
+            swizzle.negate_src1, src1);
+        ReadSource(state, uniforms, inverted ? instr.mad.src2i : instr.mad.src2,
+            inverted ? 0 : offset, swizzle.src2_selector, swizzle.negate_src2, src2);
+        ReadSource(state, uniforms, inverted ? instr.mad.src3i : instr.mad.src3,
+            inverted ? offset : 0, swizzle.src3_selector, swizzle.negate_src3, src3);
+
+        for (int i = 0; i < 4; i++) {
+            result[i] = src1[i] * src2[i] + src3[i];
+        }
+        WriteDest(state, instr.mad.dest, swizzle, result);
+        return;
+    }
+
+    const bool inverted = (op >= OP_DPHI && op <= OP_SLTI);
+    const s32 offset = GetAddressOffset(state, instr.common.address_register_index);
+    ReadSource(state, uniforms, inverted ? instr.common.src1i : instr.common.src1,
+        inverted ? 0 : offset, swizzle.src1_selector, swizzle.negate_src1, src1);
+    ReadSource(state, uniforms, inverted ? instr.common.src2i : instr.common.src2,
+        inverted ? offset : 0, swizzle.src2_selector, swizzle.negate_src2, src2);
+
+    switch (op) {
+    case OP_ADD:
+        for (int i = 0; i < 4; i++) {
+            result[i] = src1[i] + src2[i];
+        }
+        break;
+
+    case OP_MUL:
+        for (int i = 0; i < 4; i++) {
+            result[i] = src1[i] * src2[i];
+        }
+        break;
+
+    case OP_DP3:
+    case OP_DP4:
+    case OP_DPH:
+    case OP_DPHI:
+    {
+        if (op == OP_DPH || op == OP_DPHI) {
+            src1[3] = 1.0f;
+        }
+        float products[4];
+        for (int i = 0; i < 4; i++) {
+            products[i] = src1[i] * src2[i];
+        }
+        if (op == OP_DP3) {
+            products[3] = 0.0f;
+        }
+        // Same summation order as DPPS
+        const float dot = (products[0] + products[1]) + (products[2] + products[3]);
+        result[0] = result[1] = result[2] = result[3] = dot;
+        break;
+    }
+
+    case OP_DST:
+    case OP_DSTI:
+        result[0] = 1.0f;
+        result[1] = src1[1] * src2[1];
+        result[2] = src1[2];
+        result[3] = src2[3];
+        break;
+
+    case OP_EX2:
+        result[0] = result[1] = result[2] = result[3] = exp2f(src1[0]);
+        break;
+
+    case OP_LG2:
+        result[0] = result[1] = result[2] = result[3] = log2f(src1[0]);
+        break;
+
+    case OP_LIT:
+    {
+        const float diffuse = (src1[0] > 0.0f) ? src1[0] : 0.0f;
+        const float base = (src1[1] > 0.0f) ? src1[1] : 0.0f;
+        const float power = std::min(std::max(src1[3], -127.9961f), 127.9961f);
+        result[0] = 1.0f;
+        result[1] = diffuse;
+        result[2] = (src1[0] > 0.0f) ? exp2f(power * log2f(base)) : 0.0f;
+        result[3] = 1.0f;
+        break;
+    }
+
+    case OP_SGE:
+    case OP_SGEI:
+        for (int i = 0; i < 4; i++) {
+            result[i] = (src1[i] >= src2[i]) ? 1.0f : 0.0f;
+        }
+        break;
+
+    case OP_SLT:
+    case OP_SLTI:
+        for (int i = 0; i < 4; i++) {
+            result[i] = (src1[i] < src2[i]) ? 1.0f : 0.0f;
+        }
+        break;
+
+    case OP_FLR:
+        for (int i = 0; i < 4; i++) {
+            result[i] = floorf(src1[i]);
+        }
+        break;
+
+    case OP_MAX:
+        for (int i = 0; i < 4; i++) {
+            result[i] = (src1[i] > src2[i]) ? src1[i] : src2[i];
+        }
+        break;
+
+    case OP_MIN:
+        for (int i = 0; i < 4; i++) {
+            result[i] = (src1[i] < src2[i]) ? src1[i] : src2[i];
+        }
+        break;
+
+    case OP_RCP:
+        result[0] = result[1] = result[2] = result[3] = 1.0f / src1[0];
+        break;
+
+    case OP_RSQ:
+        result[0] = result[1] = result[2] = result[3] = 1.0f / sqrtf(src1[0]);
+        break;
+
+    case OP_MOV:
+        for (int i = 0; i < 4; i++) {
+            result[i] = src1[i];
+        }
+        break;
+
+    case OP_MOVA:
+        for (int i = 0; i < 2; i++) {
+            if (swizzle.DestComponentEnabled(i)) {
+                state.address[i] = FloatToS32(src1[i]);
+            }
+        }
+        return;
+
+    case OP_CMP:
+        state.conditional_code[0] = Compare(instr.compare.op_x, src1[0], src2[0]);
+        state.conditional_code[1] = Compare(instr.compare.op_y, src1[1], src2[1]);
+        return;
+
+    default:
+        DEBUG_LOG(GPU, "unknown vertex shader opcode 0x%02X", op);
+        return;
+    }
+
+    WriteDest(state, instr.common.dest, swizzle, result);
+}
+
+/// Evaluates the condition of a flow control instruction against the conditional code
+static bool EvaluateCondition(const UnitState& state, Instruction instr) {
+    const bool x = (state.conditional_code[0] == instr.flow_control.refx);
+    const bool y = (state.conditional_code[1] == instr.flow_control.refy);
+
+    switch (instr.flow_control.op) {
+    case FLOW_OR:       return x || y;
+    case FLOW_AND:      return x && y;
+    case FLOW_JUST_X:   return x;
+    default:            return y;
+    }
+}
+
+void RunInterpreter(UnitState& state, const ShaderUniforms& uniforms, const ProgramMemory& program,
+    u32 entry) {
+
+    CallStackFrame stack[MAX_CALL_STACK_DEPTH];
+    int depth = 0;
+    u32 pc = entry;
+
+    for (;;) {
+        // Leave the regions ending here, innermost first
+        while (depth > 0 && pc == stack[depth - 1].final_address) {
+            CallStackFrame& top = stack[depth - 1];
+            if (top.type == FRAME_LOOP) {
+                state.address[2] += top.loop_increment;
+                if (top.repeat_counter > 0) {
+                    // An empty loop body ends where it starts
+                    top.repeat_counter--;
+                    pc = top.loop_address;
+                    continue;
+                }
+            }
+            pc = top.return_address;
+            depth--;
+        }
+
+        if (pc >= MAX_PROGRAM_CODE_LENGTH)
+            return;
+
+        Instruction instr;
+        instr.hex = program.code[pc++];
+        const u32 op = instr.GetOpCode();
+
+        if (op < OP_BREAK || op >= OP_CMP) {
+            EvaluateArithmetic(state, uniforms, instr, GetSwizzlePattern(program, instr));
+            continue;
+        }
+
+        const u32 dest = instr.flow_control.dest_offset;
+        const u32 num_instructions = instr.flow_control.num_instructions;
+
+        bool taken;
+        switch (op) {
+        case OP_BREAKC:
+        case OP_CALLC:
+        case OP_IFC:
+        case OP_JMPC:
+            taken = EvaluateCondition(state, instr);
+            break;
+        case OP_CALLU:
+        case OP_IFU:
+            taken = uniforms.b[instr.flow_control.bool_uniform_id] != 0;
+            break;
+        case OP_JMPU:
+            taken = uniforms.b[instr.flow_control.bool_uniform_id] == !(num_instructions & 1);
+            break;
+        default:
+            taken = true;
+            break;
+        }
+        if (!taken) {
+            // The else block of a conditional directly follows its if block
+            if (op == OP_IFU || op == OP_IFC)
+                pc = dest;
+            continue;
+        }
+
+        // Regions entered at the nesting limit are executed as plain code
+        const bool stack_full = (depth == MAX_CALL_STACK_DEPTH);
+        if (stack_full && (op == OP_CALL || op == OP_CALLC || op == OP_CALLU || op == OP_IFU ||
+            op == OP_IFC || op == OP_LOOP)) {
+            DEBUG_LOG(GPU, "vertex shader call stack overflow at 0x%03X", pc - 1);
+        }
+
+        switch (op) {
+        case OP_END:
+            return;
+
+        case OP_BREAK:
+        case OP_BREAKC:
+            // Leaves the innermost loop, unless a call was made from within it
+            for (int i = depth - 1; i >= 0 && stack[i].type != FRAME_CALL; i--) {
+                if (stack[i].type == FRAME_LOOP) {
+                    pc = stack[i].return_address;
+                    depth = i;
+                    break;
+                }
+            }
+            break;
+
+        case OP_CALL:
+        case OP_CALLC:
+        case OP_CALLU:
+            if (!stack_full) {
+                CallStackFrame& frame = stack[depth++];
+                frame.type = FRAME_CALL;
+                frame.final_address = dest + num_instructions;
+                frame.return_address = pc;
+            }
+            pc = dest;
+            break;
+
+        case OP_IFU:
+        case OP_IFC:
+            if (!stack_full) {
+                CallStackFrame& frame = stack[depth++];
+                frame.type = FRAME_IF;
+                frame.final_address = dest;
+                frame.return_address = dest + num_instructions;
+            }
+            break;
+
+        case OP_LOOP:
+        {
+            Regs::Struct<Regs::VSIntUniform0> loop;
+            loop.hex = uniforms.i[instr.flow_control.int_uniform_id];
+            state.address[2] = loop.start;
+            if (!stack_full) {
+                CallStackFrame& frame = stack[depth++];
+                frame.type = FRAME_LOOP;
+                frame.final_address = dest + 1;
+                frame.return_address = dest + 1;
+                frame.loop_address = pc;
+                frame.repeat_counter = loop.count;
+                frame.loop_increment = loop.increment;
+            }
+            break;
+        }
+
+        case OP_JMPC:
+        case OP_JMPU:
+            pc = dest;
+            break;
+
+        default:
+            // NOP, and EMIT and SETEMIT, which only do something in geometry shaders
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Uploads
+
+static void BoolUniformsHandler(Regs::Id id, u32 value) {
+    for (int i = 0; i < NUM_BOOL_UNIFORMS; i++) {
+        g_uniforms.b[i] = (value >> i) & 1;
+    }
+}
+
+static void IntUniformHandler(Regs::Id id, u32 value) {
+    g_uniforms.i[id - Regs::VSIntUniform0] = value;
+}
+
+static void FloatUniformSetupHandler(Regs::Id id, u32 value) {
+    Regs::Struct<Regs::VSFloatUniformSetup> setup;
+    setup.hex = value;
+    g_float_uniform_index = setup.index;
+    g_num_float_uniform_words = 0;
+}
+
+static void FloatUniformDataHandler(Regs::Id id, u32 value) {
+    const bool float32 = GetRegister<Regs::VSFloatUniformSetup>().float32 != 0;
+    g_float_uniform_words[g_num_float_uniform_words++] = value;
+    if (g_num_float_uniform_words < (float32 ? 4u : 3u))
+        return;
+    g_num_float_uniform_words = 0;
+
+    if (g_float_uniform_index >= NUM_FLOAT_UNIFORMS) {
+        ERROR_LOG(GPU, "vertex shader float uniform %u out of range", g_float_uniform_index);
+        return;
+    }
+
+    float* const uniform = g_uniforms.f[g_float_uniform_index++];
+    const u32* const words = g_float_uniform_words;
+    if (float32) {
+        for (int i = 0; i < 4; i++) {
+            memcpy(&uniform[3 - i], &words[i], sizeof(float));
+        }
+    } else {
+        uniform[3] = Float24ToFloat(words[0] >> 8);
+        uniform[2] = Float24ToFloat(((words[0] & 0xFF) << 16) | (words[1] >> 16));
+        uniform[1] = Float24ToFloat(((words[1] & 0xFFFF) << 8) | (words[2] >> 24));
+        uniform[0] = Float24ToFloat(words[2] & 0xFFFFFF);
+    }
+}
+
+static void ProgramOffsetHandler(Regs::Id id, u32 value) {
+    Regs::Struct<Regs::VSBeginLoadProgramData> offset;
+    offset.hex = value;
+    g_program_write_offset = offset.offset;
+}
+
+static void ProgramDataHandler(Regs::Id id, u32 value) {
+    if (g_program_write_offset >= MAX_PROGRAM_CODE_LENGTH) {
+        ERROR_LOG(GPU, "vertex shader program upload overruns the program memory");
+        return;
+    }
+
+    // Games upload the same programs over and over, which must not trigger a rehash
+    u32& word = g_program.code[g_program_write_offset++];
+    if (word != value) {
+        word = value;
+        g_program_dirty = true;
+    }
+}
+
+static void SwizzleOffsetHandler(Regs::Id id, u32 value) {
+    Regs::Struct<Regs::VSBeginLoadSwizzleData> offset;
+    offset.hex = value;
+    g_swizzle_write_offset = offset.offset;
+}
+
+static void SwizzleDataHandler(Regs::Id id, u32 value) {
+    if (g_swizzle_write_offset >= MAX_SWIZZLE_DATA_LENGTH) {
+        ERROR_LOG(GPU, "vertex shader swizzle upload overruns the swizzle memory");
+        return;
+    }
+
+    u32& word = g_program.swizzle_data[g_swizzle_write_offset++];
+    if (word != value) {
+        word = value;
+        g_program_dirty = true;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Places the shader output registers in a vertex according to the output map registers
+ * @param outputs Values of the output registers
+ * @param vertex Vertex to write
+ */
+static void MapOutputs(const float (*outputs)[4], OutputVertex& vertex) {
+    float* const semantics = &vertex.pos[0];
+    const int num_semantics = sizeof(OutputVertex) / sizeof(float);
+
+    for (int i = 0; i < NUM_VERTEX_OUTPUTS; i++) {
+        Regs::Struct<Regs::VertexOutputMap> map;
+        map.hex = g_regs[VertexOutputMap(i)];
+        for (int comp = 0; comp < 4; comp++) {
+            const int semantic = map.GetSemantic(comp);
+            if (semantic < num_semantics) {
+                semantics[semantic] = outputs[i][comp];
+            }
+        }
+    }
+}
+
+void Setup() {
+    g_entry = GetRegister<Regs::VSMainOffset>().offset;
+
+    Regs::Struct<Regs::VSInputRegisterMap> input_map;
+    input_map.hex = g_regs[Regs::VSInputRegisterMap] |
+        ((u64)g_regs[Regs::VSInputRegisterMap + 1] << 32);
+    for (int i = 0; i < NUM_VERTEX_ATTRIBUTES; i++) {
+        g_attribute_registers[i] = input_map.GetRegisterForAttribute(i);
+    }
+
+    const u32 output_mask = GetRegister<Regs::VSOutputMask>().mask;
+    g_num_outputs = 0;
+    for (int i = 0; i < NUM_OUTPUT_REGISTERS && g_num_outputs < NUM_VERTEX_OUTPUTS; i++) {
+        if (output_mask & (1 << i)) {
+            g_output_registers[g_num_outputs++] = i;
+        }
+    }
+
+    g_compiled = NULL;
+    if (VideoCore::g_use_shader_jit) {
+        if (g_program_dirty) {
+            g_program_hash = GetHash64((const u8*)&g_program, sizeof(g_program), 0);
+            g_program_dirty = false;
+        }
+        g_compiled = VertexShaderJit::GetShader(g_program, g_entry, g_program_hash);
+    }
+}
+
+OutputVertex RunShader(const InputVertex& input, int num_attributes) {
+    UnitState& state = g_state;
+    for (int i = 0; i < num_attributes; i++) {
+        memcpy(state.input[g_attribute_registers[i]], input.attr[i], sizeof(input.attr[i]));
+    }
+
+    if (g_compiled) {
+        g_compiled(&state, &g_uniforms);
+    } else {
+        RunInterpreter(state, g_uniforms, g_program, g_entry);
+    }
+
+    float outputs[NUM_VERTEX_OUTPUTS][4];
+    for (int i = 0; i < NUM_VERTEX_OUTPUTS; i++) {
+        if (i < g_num_outputs) {
+            memcpy(outputs[i], state.output[g_output_registers[i]], sizeof(outputs[i]));
+        } else {
+            outputs[i][0] = outputs[i][1] = outputs[i][2] = outputs[i][3] = 0.0f;
+        }
+    }
+
+    OutputVertex vertex;
+    memset(&vertex, 0, sizeof(vertex));
+    MapOutputs(outputs, vertex);
+    return vertex;
+}
+
+void Init() {
+    memset(&g_program, 0, sizeof(g_program));
+    memset(&g_uniforms, 0, sizeof(g_uniforms));
+    memset(&g_state, 0, sizeof(g_state));
+    g_program_write_offset = g_swizzle_write_offset = 0;
+    g_program_dirty = true;
+    g_float_uniform_index = g_num_float_uniform_words = 0;
+    g_compiled = NULL;
+
+    using CommandProcessor::SetWriteHandler;
+    SetWriteHandler(Regs::VSBoolUniforms, BoolUniformsHandler);
+    for (int i = 0; i < NUM_VS_INT_UNIFORMS; i++) {
+        SetWriteHandler(VSIntUniform(i), IntUniformHandler);
+    }
+    SetWriteHandler(Regs::VSFloatUniformSetup, FloatUniformSetupHandler);
+    SetWriteHandler(Regs::VSBeginLoadProgramData, ProgramOffsetHandler);
+    SetWriteHandler(Regs::VSBeginLoadSwizzleData, SwizzleOffsetHandler);
+    for (int i = 0; i < NUM_VS_DATA_PORTS; i++) {
+        SetWriteHandler(static_cast<Regs::Id>(Regs::VSFloatUniformData + i),
+            FloatUniformDataHandler);
+        SetWriteHandler(static_cast<Regs::Id>(Regs::VSLoadProgramData + i), ProgramDataHandler);
+        SetWriteHandler(static_cast<Regs::Id>(Regs::VSLoadSwizzleData + i), SwizzleDataHandler);
+    }
+
+    VertexShaderJit::Init();
+}
+
+void Shutdown() {
+    VertexShaderJit::Shutdown();
+    g_compiled = NULL;
+}
+
+} // namespace
+
+} // namespace
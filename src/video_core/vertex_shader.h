@@ -0,0 +1,104 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common.h"
+
+#include "video_core/pica.h"
+#include "video_core/vertex_shader_bytecode.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// PICA200 vertex shader unit
+//
+// Programs, swizzle patterns and uniforms are uploaded through the shader registers and kept here.
+// Each vertex is processed by compiled code from VertexShaderJit where the host supports it and the
+// program could be compiled, and by the reference interpreter otherwise.
+
+namespace Pica {
+
+namespace VertexShader {
+
+/// Vertex attributes as loaded from the vertex arrays, each with four components
+struct InputVertex {
+    float attr[NUM_VERTEX_ATTRIBUTES][4];
+};
+
+/**
+ * Vertex as passed on to primitive assembly. The members are laid out so that the float at index
+ * n is the one written by Regs::Struct<Regs::VertexOutputMap>::Semantic n.
+ */
+struct OutputVertex {
+    float pos[4];
+    float quat[4];
+    float color[4];
+    float tc0[2];
+    float tc1[2];
+};
+
+/// Program and swizzle memory, hashed as a whole to look up compiled programs
+struct ProgramMemory {
+    u32 code[MAX_PROGRAM_CODE_LENGTH];
+    u32 swizzle_data[MAX_SWIZZLE_DATA_LENGTH];
+};
+
+/**
+ * Uniforms as read by the shader. Relative uniform addressing wraps around at 128 entries, the
+ * ones past the last uniform read as zero.
+ */
+struct ShaderUniforms {
+    MEMORY_ALIGNED16(float f[128][4]);
+    u8 b[NUM_BOOL_UNIFORMS];                        ///< Bool uniforms, 0 or 1
+    u32 i[NUM_VS_INT_UNIFORMS];                     ///< Int uniforms, as their registers
+};
+
+/// Registers of a shader unit
+struct UnitState {
+    MEMORY_ALIGNED16(float input[NUM_INPUT_REGISTERS][4]);
+    MEMORY_ALIGNED16(float temporary[NUM_TEMPORARY_REGISTERS][4]);
+    MEMORY_ALIGNED16(float output[NUM_OUTPUT_REGISTERS][4]);
+    s32 address[3];                                 ///< a0.x, a0.y and the loop register aL
+    u8 conditional_code[2];                         ///< Results of CMP for x and y, 0 or 1
+};
+
+/**
+ * Runs a program with the reference interpreter
+ * @param state Registers, with the inputs loaded
+ * @param uniforms Uniforms to read
+ * @param program Program and swizzle memory
+ * @param entry Offset of the first instruction to execute
+ */
+void RunInterpreter(UnitState& state, const ShaderUniforms& uniforms, const ProgramMemory& program,
+    u32 entry);
+
+/**
+ * Executes a single arithmetic instruction (anything but flow control) with the interpreter
+ * @param state Registers
+ * @param uniforms Uniforms to read
+ * @param instr Instruction to execute
+ * @param swizzle Operand descriptor of the instruction
+ */
+void EvaluateArithmetic(UnitState& state, const ShaderUniforms& uniforms, Instruction instr,
+    SwizzlePattern swizzle);
+
+/// Looks up or compiles the uploaded program, to be called before the vertices of a draw are run
+void Setup();
+
+/**
+ * Runs the vertex shader on a vertex
+ * @param input Attributes of the vertex
+ * @param num_attributes Number of attributes loaded
+ * @return Shaded vertex, with the shader outputs placed according to the output map registers
+ */
+OutputVertex RunShader(const InputVertex& input, int num_attributes);
+
+/// Initialize the vertex shader unit, after the command processor
+void Init();
+
+/// Shutdown the vertex shader unit
+void Shutdown();
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,201 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/bit_field.h"
+#include "common/common_types.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// PICA200 vertex shader instruction set
+//
+// Shader programs are made of 32-bit instructions. Arithmetic instructions refer to an operand
+// descriptor, a swizzle pattern held in a separate swizzle memory, for the component selection and
+// negation of their sources and for the components they write.
+//
+// Source registers 0x00-0x0F are the inputs v0-v15, 0x10-0x1F the temporaries r0-r15 and
+// 0x20-0x7F the float uniforms c0-c95. Destination registers 0x00-0x0F are the outputs o0-o15 and
+// 0x10-0x1F the temporaries. Only 7-bit source fields can address uniforms, and those can be
+// offset by one of the address registers a0.x and a0.y or the loop register aL.
+
+namespace Pica {
+
+namespace VertexShader {
+
+enum {
+    MAX_PROGRAM_CODE_LENGTH     = 1024,     ///< Size of the program memory in instructions
+    MAX_SWIZZLE_DATA_LENGTH     = 128,      ///< Size of the swizzle memory in patterns
+
+    NUM_INPUT_REGISTERS         = 16,
+    NUM_TEMPORARY_REGISTERS     = 16,
+    NUM_OUTPUT_REGISTERS        = 16,
+    NUM_FLOAT_UNIFORMS          = 96,
+    NUM_BOOL_UNIFORMS           = 16,
+    MAX_CALL_STACK_DEPTH        = 16,       ///< Nesting depth of calls, conditionals and loops
+
+    SOURCE_INPUT                = 0x00,     ///< First source register index of the inputs
+    SOURCE_TEMPORARY            = 0x10,     ///< First source register index of the temporaries
+    SOURCE_FLOAT_UNIFORM        = 0x20,     ///< First source register index of the float uniforms
+    DEST_OUTPUT                 = 0x00,     ///< First destination register index of the outputs
+    DEST_TEMPORARY              = 0x10,     ///< First destination register index of the temporaries
+};
+
+/// Instruction opcodes, the top 6 bits of an instruction
+enum OpCode {
+    OP_ADD      = 0x00,
+    OP_DP3      = 0x01,
+    OP_DP4      = 0x02,
+    OP_DPH      = 0x03,
+    OP_DST      = 0x04,
+    OP_EX2      = 0x05,
+    OP_LG2      = 0x06,
+    OP_LIT      = 0x07,
+    OP_MUL      = 0x08,
+    OP_SGE      = 0x09,
+    OP_SLT      = 0x0A,
+    OP_FLR      = 0x0B,
+    OP_MAX      = 0x0C,
+    OP_MIN      = 0x0D,
+    OP_RCP      = 0x0E,
+    OP_RSQ      = 0x0F,
+    OP_MOVA     = 0x12,
+    OP_MOV      = 0x13,
+    OP_DPHI     = 0x18,
+    OP_DSTI     = 0x19,
+    OP_SGEI     = 0x1A,
+    OP_SLTI     = 0x1B,
+
+    OP_BREAK    = 0x20,
+    OP_NOP      = 0x21,
+    OP_END      = 0x22,
+    OP_BREAKC   = 0x23,
+    OP_CALL     = 0x24,
+    OP_CALLC    = 0x25,
+    OP_CALLU    = 0x26,
+    OP_IFU      = 0x27,
+    OP_IFC      = 0x28,
+    OP_LOOP     = 0x29,
+    OP_EMIT     = 0x2A,     // geometry shader only
+    OP_SETEMIT  = 0x2B,     // geometry shader only
+    OP_JMPC     = 0x2C,
+    OP_JMPU     = 0x2D,
+    OP_CMP      = 0x2E,     // 0x2F, the top bit of compare_op_x overlaps the opcode
+
+    OP_MADI     = 0x30,     // 0x30-0x37, the opcode overlaps the operand descriptor of MAD
+    OP_MAD      = 0x38,     // 0x38-0x3F
+};
+
+/// Condition of the flow control instructions, combining the conditional code with refx and refy
+enum FlowControlOp : u32 {
+    FLOW_OR         = 0,
+    FLOW_AND        = 1,
+    FLOW_JUST_X     = 2,
+    FLOW_JUST_Y     = 3,
+};
+
+/// Comparisons of the CMP instruction
+enum CompareOp : u32 {
+    COMPARE_EQUAL           = 0,
+    COMPARE_NOT_EQUAL       = 1,
+    COMPARE_LESS_THAN       = 2,
+    COMPARE_LESS_EQUAL      = 3,
+    COMPARE_GREATER_THAN    = 4,
+    COMPARE_GREATER_EQUAL   = 5,
+};
+
+union Instruction {
+    u32 hex;
+
+    BitField<26, 6, u32> opcode;
+
+    // Arithmetic instructions. The inverted forms (DPHI, DSTI, SGEI, SLTI) swap the sizes of the
+    // two source fields, so that their second source is the one that can address uniforms.
+    union {
+        BitField< 0, 7, u32> operand_desc_id;
+        BitField< 7, 5, u32> src2;
+        BitField<12, 7, u32> src1;
+        BitField< 7, 7, u32> src2i;
+        BitField<14, 5, u32> src1i;
+        BitField<19, 2, u32> address_register_index;    // 0: none, 1: a0.x, 2: a0.y, 3: aL
+        BitField<21, 5, u32> dest;
+    } common;
+
+    // MAD computes src1 * src2 + src3. MADI swaps the sizes of src2 and src3.
+    union {
+        BitField< 0, 5, u32> operand_desc_id;
+        BitField< 5, 5, u32> src3;
+        BitField<10, 7, u32> src2;
+        BitField< 5, 7, u32> src3i;
+        BitField<12, 5, u32> src2i;
+        BitField<17, 5, u32> src1;
+        BitField<22, 2, u32> address_register_index;
+        BitField<24, 5, u32> dest;
+    } mad;
+
+    union {
+        BitField< 0, 7, u32> operand_desc_id;
+        BitField< 7, 5, u32> src2;
+        BitField<12, 7, u32> src1;
+        BitField<19, 2, u32> address_register_index;
+        BitField<21, 3, CompareOp> op_y;
+        BitField<24, 3, CompareOp> op_x;
+    } compare;
+
+    union {
+        BitField< 0, 8, u32> num_instructions;
+        BitField<10, 12, u32> dest_offset;
+        BitField<22, 2, FlowControlOp> op;
+        BitField<22, 4, u32> bool_uniform_id;
+        BitField<22, 2, u32> int_uniform_id;
+        BitField<24, 1, u32> refy;
+        BitField<25, 1, u32> refx;
+    } flow_control;
+
+    /// Gets the opcode with the operand descriptor bits of MAD, MADI and CMP cleared
+    u32 GetOpCode() const {
+        const u32 op = opcode;
+        if (op >= OP_MAD)
+            return OP_MAD;
+        if (op >= OP_MADI)
+            return OP_MADI;
+        if (op == OP_CMP + 1)
+            return OP_CMP;
+        return op;
+    }
+};
+
+/**
+ * Operand descriptor. Selector n of a source picks the source component written to component n,
+ * with x in the top two bits. Bit 3 of the destination mask enables x, bit 0 enables w.
+ */
+union SwizzlePattern {
+    u32 hex;
+
+    BitField< 0, 4, u32> dest_mask;
+    BitField< 4, 1, u32> negate_src1;
+    BitField< 5, 8, u32> src1_selector;
+    BitField<13, 1, u32> negate_src2;
+    BitField<14, 8, u32> src2_selector;
+    BitField<22, 1, u32> negate_src3;
+    BitField<23, 8, u32> src3_selector;
+
+    /// Whether component 0 (x) to 3 (w) of the destination is written
+    bool DestComponentEnabled(int component) const {
+        return (dest_mask & (8 >> component)) != 0;
+    }
+
+    /**
+     * Gets the source component selected for a component
+     * @param selector One of the selector fields
+     * @param component Component 0 (x) to 3 (w)
+     * @return Source component, 0 (x) to 3 (w)
+     */
+    static int GetSelectorComponent(u32 selector, int component) {
+        return (selector >> (2 * (3 - component))) & 3;
+    }
+};
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,1079 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common/common.h"
+#include "common/cpu_detect.h"
+#include "common/file_util.h"
+#include "common/linear_disk_cache.h"
+#include "common/log.h"
+#include "common/memory_util.h"
+
+#include "video_core/vertex_shader_jit.h"
+
+#ifdef EMU_ARCHITECTURE_X64
+
+#include "core/arm/jit/x64_emitter.h"
+
+using namespace Gen;
+using namespace Pica::VertexShader;
+
+namespace Pica {
+
+namespace VertexShaderJit {
+
+enum {
+    CODE_CACHE_SIZE         = 4 * 1024 * 1024,  ///< Size of the executable memory for programs
+    MAX_SHADER_CODE_SIZE    = 256 * 1024,       ///< Upper bound on the code size of a program
+};
+
+typedef void (*FallbackFunction)(UnitState* state, const ShaderUniforms* uniforms, u32 instr_hex,
+    u32 swizzle_hex);
+
+/**
+ * Constants the compiled code reads through CONSTANTS. Each program starts with a copy of them, so
+ * that it can be saved to the disk cache and loaded anywhere in the code space.
+ */
+struct Constants {
+    MEMORY_ALIGNED16(u32 sign_mask[4]);
+    MEMORY_ALIGNED16(float one[4]);
+    MEMORY_ALIGNED16(float w_one[4]);               ///< (0, 0, 0, 1)
+    MEMORY_ALIGNED16(u32 lane_masks[16][4]);        ///< All ones in the lanes set in the index
+    FallbackFunction fallback;                      ///< Interpreter entry of uncompiled instructions
+};
+
+/// Key of the programs in the disk cache
+struct DiskCacheKey {
+    u64 hash;                                       ///< Hash of the program and swizzle memory
+    u32 entry;                                      ///< Entry point
+    u32 features;                                   ///< Host features the code was compiled for
+};
+
+/// Host features of the compiled code
+enum {
+    FEATURE_SSE41   = 1 << 0,
+};
+
+static Constants g_constants;
+static u8* g_code_space = NULL;                     ///< Executable memory holding all programs
+static u8* g_code_ptr = NULL;                       ///< Where the next program will be compiled to
+static std::map<u64, CompiledShader> g_shaders;     ///< Compiled programs, NULL if interpreted
+static bool g_have_sse41 = false;
+
+static LinearDiskCache<DiskCacheKey, u8> g_disk_cache;
+static std::set<u64> g_disk_cache_keys;             ///< Programs already saved to the disk cache
+
+// Host registers of the compiled code, all callee-saved. PICA registers live in the UnitState.
+static const X64Reg STATE = R15;            ///< UnitState of the vertex
+static const X64Reg UNIFORMS = R12;         ///< ShaderUniforms
+static const X64Reg CONSTANTS = RBP;        ///< g_constants
+static const X64Reg CALL_END = R13;         ///< Address the innermost call returns at, or -1
+static const X64Reg STACK_BASE = R14;       ///< Stack pointer after the prologue
+static const X64Reg LOOP_COUNTER = RBX;     ///< Iterations left in the innermost loop
+
+/// Called by compiled code for the instructions that are not worth compiling
+static void FallbackArithmetic(UnitState* state, const ShaderUniforms* uniforms, u32 instr_hex,
+    u32 swizzle_hex) {
+
+    Instruction instr;
+    SwizzlePattern swizzle;
+    instr.hex = instr_hex;
+    swizzle.hex = swizzle_hex;
+    EvaluateArithmetic(*state, *uniforms, instr, swizzle);
+}
+
+static inline CCFlags InvertCondition(CCFlags cc) {
+    return static_cast<CCFlags>(cc ^ 1);
+}
+
+static inline u32 GetHostFeatures() {
+    return g_have_sse41 ? FEATURE_SSE41 : 0;
+}
+
+/// Key of a program in g_shaders
+static inline u64 GetShaderKey(u64 hash, u32 entry) {
+    return hash ^ ((u64)entry << 32);
+}
+
+/// Operand of the input, temporary or output register with the given index
+static inline MemArg RegisterArg(size_t array_offset, u32 index) {
+    return MDisp(STATE, (s32)(array_offset + index * 16));
+}
+
+/// Compiles one program, starting at a given code pointer
+class ShaderCompiler : public XEmitter {
+public:
+    ShaderCompiler(u8* code_ptr, const ProgramMemory& program, u32 entry) :
+        program(program), entry(entry), failed(false), pc(0) {
+        SetCodePtr(code_ptr);
+    }
+
+    /**
+     * Compiles the program
+     * @return Entry point of the compiled program, or NULL if the program can not be compiled
+     */
+    CompiledShader Compile();
+
+private:
+    /// Nesting level of compiled code
+    struct Region {
+        int depth;                      ///< Number of call stack frames the interpreter would use
+        u32 end_address;                ///< Address the region ends at
+        u8* end;                        ///< Code run at the end of the region
+    };
+
+    /// A jump or call to an instruction, patched once everything is compiled
+    struct Branch {
+        u8* patch;                      ///< Pointer returned by J_CC, J or CALL
+        u32 source;                     ///< Address of the branch instruction
+        u32 target;                     ///< Address of the instruction branched to
+    };
+
+    /// A loop being compiled
+    struct Loop {
+        u32 address;                    ///< Address of the LOOP instruction
+        std::vector<u8*> breaks;        ///< Jumps of the BREAK instructions of the loop
+    };
+
+    u32 FindProgramEnd() const;
+    int NewRegion(int parent, int frames, u32 end_address);
+    u8* GetJumpTarget(const Branch& jump) const;
+    int GetCost(u32 address);
+    int GetCallDepth(u32 address);
+    bool Validate(u32 end);
+
+    void CompileBlock(u32 end, int region);
+    void CompileInstruction(int region);
+    void CompileReturnCheck(u32 address);
+    CCFlags CompileCondition(Instruction instr);
+    void CompileArithmetic(Instruction instr);
+    void CompileCompare(CompareOp op, int component);
+    void CompileFallback(Instruction instr, SwizzlePattern swizzle);
+    void LoadSource(X64Reg dst, u32 index, u32 address_register_index, u32 selector, bool negate);
+    void StoreDest(u32 index, u32 dest_mask, X64Reg src);
+
+    const ProgramMemory& program;
+    const u32 entry;
+    bool failed;                        ///< Set when the program turns out not to be compilable
+    u32 pc;                             ///< Address of the next instruction to compile
+
+    u8* labels[MAX_PROGRAM_CODE_LENGTH + 1];        ///< Code of each address, NULL if not compiled
+    int region_of[MAX_PROGRAM_CODE_LENGTH + 1];     ///< Region of each compiled address
+    bool return_points[MAX_PROGRAM_CODE_LENGTH + 1];///< Whether a call ends at each address
+
+    std::vector<Region> regions;
+    std::vector<Branch> jumps;
+    std::vector<Branch> calls;
+    std::vector<std::pair<u32, u32> > breaks;       ///< Address of each BREAK and of its LOOP
+    std::vector<Loop> loops;
+    std::vector<u8*> exits;
+    std::map<u32, int> call_depths;                 ///< GetCallDepth results, -2 while computing
+};
+
+/**
+ * Finds the end of the code reachable from the entry point. Every region end and branch target
+ * counts as reachable, so that all code the compiled program may run is below it.
+ * @return Address after the last reachable instruction
+ */
+u32 ShaderCompiler::FindProgramEnd() const {
+    std::vector<bool> reachable(MAX_PROGRAM_CODE_LENGTH, false);
+    std::vector<u32> worklist(1, entry);
+    u32 end = entry + 1;
+
+    while (!worklist.empty()) {
+        const u32 address = worklist.back();
+        worklist.pop_back();
+        if (address >= MAX_PROGRAM_CODE_LENGTH || reachable[address])
+            continue;
+        reachable[address] = true;
+        end = std::max(end, address + 1);
+
+        Instruction instr;
+        instr.hex = program.code[address];
+        const u32 dest = instr.flow_control.dest_offset;
+        const u32 num_instructions = instr.flow_control.num_instructions;
+
+        switch (instr.GetOpCode()) {
+        case OP_END:
+            break;
+        case OP_JMPC:
+        case OP_JMPU:
+            worklist.push_back(dest);
+            worklist.push_back(address + 1);
+            break;
+        case OP_CALL:
+        case OP_CALLC:
+        case OP_CALLU:
+        case OP_IFU:
+        case OP_IFC:
+            worklist.push_back(dest);
+            worklist.push_back(dest + num_instructions);
+            worklist.push_back(address + 1);
+            break;
+        case OP_LOOP:
+            worklist.push_back(dest + 1);
+            worklist.push_back(address + 1);
+            break;
+        default:
+            worklist.push_back(address + 1);
+            break;
+        }
+    }
+    return std::min<u32>(end, MAX_PROGRAM_CODE_LENGTH);
+}
+
+/**
+ * Adds a region
+ * @param parent Enclosing region
+ * @param frames Number of call stack frames the interpreter pushes to enter the region
+ * @param end_address Address the region ends at
+ * @return Index of the new region
+ */
+int ShaderCompiler::NewRegion(int parent, int frames, u32 end_address) {
+    Region region;
+    region.depth = regions[parent].depth + frames;
+    region.end_address = end_address;
+    region.end = NULL;
+    regions.push_back(region);
+    return (int)regions.size() - 1;
+}
+
+/**
+ * Gets the code a jump lands on. Jumps may go to the end of their region, which leaves it like
+ * the interpreter does, or anywhere within it.
+ * @return Code to jump to, or NULL if the jump leaves its region
+ */
+u8* ShaderCompiler::GetJumpTarget(const Branch& jump) const {
+    const Region& region = regions[region_of[jump.source]];
+    if (jump.target == region.end_address)
+        return region.end;
+    if (labels[jump.target] == NULL || region_of[jump.target] != region_of[jump.source])
+        return NULL;
+    return labels[jump.target];
+}
+
+/**
+ * Gets the number of call stack frames an instruction pushes on top of the ones of its region
+ * @return Number of frames, or -1 if the instruction recurses
+ */
+int ShaderCompiler::GetCost(u32 address) {
+    Instruction instr;
+    instr.hex = program.code[address];
+    switch (instr.GetOpCode()) {
+    case OP_IFU:
+    case OP_IFC:
+    case OP_LOOP:
+        return 1;
+    case OP_CALL:
+    case OP_CALLC:
+    case OP_CALLU:
+        return (instr.flow_control.num_instructions != 0) ? GetCallDepth(address) : 0;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Gets the number of call stack frames a call pushes at most, including its own
+ * @param address Address of the call instruction
+ * @return Number of frames, or -1 if the call recurses
+ */
+int ShaderCompiler::GetCallDepth(u32 address) {
+    Instruction instr;
+    instr.hex = program.code[address];
+    const u32 dest = instr.flow_control.dest_offset;
+    const u32 end = dest + instr.flow_control.num_instructions;
+    const u32 key = (dest << 16) | end;
+
+    std::map<u32, int>::iterator it = call_depths.find(key);
+    if (it != call_depths.end())
+        return (it->second == -2) ? -1 : it->second;
+    call_depths[key] = -2;
+
+    const int base = regions[region_of[dest]].depth;
+    int depth = 1;
+    for (u32 i = dest; i < end; i++) {
+        const int cost = GetCost(i);
+        if (cost < 0)
+            return -1;
+        depth = std::max(depth, 1 + regions[region_of[i]].depth - base + cost);
+    }
+
+    call_depths[key] = depth;
+    return depth;
+}
+
+/**
+ * Checks that the compiled code behaves like the interpreter: branches must not cross region
+ * boundaries, calls must cover whole regions, break out of loops within them and not recurse, and
+ * no nesting may exceed the call stack of the interpreter.
+ * @param end Address after the last compiled instruction
+ * @return True if the program can run compiled
+ */
+bool ShaderCompiler::Validate(u32 end) {
+    if (entry >= end || region_of[entry] != 0)
+        return false;
+
+    for (size_t i = 0; i < jumps.size(); i++) {
+        if (jumps[i].target > end || GetJumpTarget(jumps[i]) == NULL)
+            return false;
+    }
+
+    for (size_t i = 0; i < calls.size(); i++) {
+        Instruction instr;
+        instr.hex = program.code[calls[i].source];
+        const u32 dest = instr.flow_control.dest_offset;
+        const u32 call_end = dest + instr.flow_control.num_instructions;
+        if (call_end > end || labels[dest] == NULL || region_of[dest] != region_of[call_end])
+            return false;
+
+        for (size_t j = 0; j < breaks.size(); j++) {
+            if (breaks[j].first >= dest && breaks[j].first < call_end && breaks[j].second < dest)
+                return false;
+        }
+    }
+
+    for (u32 address = 0; address < end; address++) {
+        const int cost = GetCost(address);
+        if (cost < 0 || regions[region_of[address]].depth + cost > MAX_CALL_STACK_DEPTH)
+            return false;
+    }
+    return true;
+}
+
+/// Compiles the instructions up to an address, which must end a region
+void ShaderCompiler::CompileBlock(u32 end, int region) {
+    while (pc < end && !failed) {
+        CompileInstruction(region);
+    }
+    if (pc != end) {
+        failed = true;
+    }
+    regions[region].end = GetCodePtr();
+}
+
+/// Returns from the current call if it ends at an address
+void ShaderCompiler::CompileReturnCheck(u32 address) {
+    ALU_RI(ALU_CMP, CALL_END, address);
+    u8* not_end = J_CC(CC_NE);
+    RET();
+    SetJumpTarget(not_end);
+}
+
+/**
+ * Evaluates the condition of a flow control instruction
+ * @return Condition code the flags satisfy if the condition is true
+ */
+CCFlags ShaderCompiler::CompileCondition(Instruction instr) {
+    const s32 bool_offset = (s32)(offsetof(ShaderUniforms, b) + instr.flow_control.bool_uniform_id);
+    const s32 cond_offset = (s32)offsetof(UnitState, conditional_code);
+
+    switch (instr.GetOpCode()) {
+    case OP_CALLU:
+    case OP_IFU:
+        MOVZX8_RM(RAX, MDisp(UNIFORMS, bool_offset));
+        TEST_R(RAX, RAX);
+        return CC_NZ;
+
+    case OP_JMPU:
+        MOVZX8_RM(RAX, MDisp(UNIFORMS, bool_offset));
+        TEST_R(RAX, RAX);
+        return (instr.flow_control.num_instructions & 1) ? CC_Z : CC_NZ;
+
+    default:
+        break;
+    }
+
+    const u32 refx = instr.flow_control.refx;
+    const u32 refy = instr.flow_control.refy;
+    switch (instr.flow_control.op) {
+    case FLOW_JUST_X:
+        MOVZX8_RM(RAX, MDisp(STATE, cond_offset));
+        ALU_RI(ALU_CMP, RAX, refx);
+        return CC_E;
+
+    case FLOW_JUST_Y:
+        MOVZX8_RM(RAX, MDisp(STATE, cond_offset + 1));
+        ALU_RI(ALU_CMP, RAX, refy);
+        return CC_E;
+
+    default:
+        // Each side is 1 if its component matches
+        MOVZX8_RM(RAX, MDisp(STATE, cond_offset));
+        ALU_RI(ALU_XOR, RAX, refx ^ 1);
+        MOVZX8_RM(RCX, MDisp(STATE, cond_offset + 1));
+        ALU_RI(ALU_XOR, RCX, refy ^ 1);
+        ALU_R((instr.flow_control.op == FLOW_OR) ? ALU_OR : ALU_AND, RAX, RCX);
+        return CC_NZ;
+    }
+}
+
+void ShaderCompiler::CompileInstruction(int region) {
+    const u32 address = pc++;
+    labels[address] = GetCodePtr();
+    region_of[address] = region;
+    if (return_points[address]) {
+        CompileReturnCheck(address);
+    }
+
+    Instruction instr;
+    instr.hex = program.code[address];
+    const u32 op = instr.GetOpCode();
+    const u32 dest = instr.flow_control.dest_offset;
+    const u32 num_instructions = instr.flow_control.num_instructions;
+
+    switch (op) {
+    case OP_END:
+        exits.push_back(J());
+        break;
+
+    case OP_NOP:
+    case OP_EMIT:
+    case OP_SETEMIT:
+        break;
+
+    case OP_BREAK:
+    case OP_BREAKC:
+        // Outside of loops, breaks do nothing
+        if (!loops.empty()) {
+            Loop& loop = loops.back();
+            loop.breaks.push_back((op == OP_BREAKC) ? J_CC(CompileCondition(instr)) : J());
+            breaks.push_back(std::make_pair(address, loop.address));
+        }
+        break;
+
+    case OP_JMPC:
+    case OP_JMPU:
+    {
+        if (dest >= MAX_PROGRAM_CODE_LENGTH) {
+            failed = true;
+            break;
+        }
+        Branch jump = { J_CC(CompileCondition(instr)), address, dest };
+        jumps.push_back(jump);
+        break;
+    }
+
+    case OP_CALL:
+    case OP_CALLC:
+    case OP_CALLU:
+    {
+        if (num_instructions == 0)
+            break;
+        if (dest + num_instructions > MAX_PROGRAM_CODE_LENGTH) {
+            failed = true;
+            break;
+        }
+
+        u8* skip = NULL;
+        if (op != OP_CALL) {
+            skip = J_CC(InvertCondition(CompileCondition(instr)));
+        }
+        // The pushed CALL_END and the return address keep the stack aligned
+        PUSH(CALL_END);
+        MOV_RI(CALL_END, dest + num_instructions);
+        Branch call = { CALL(), address, dest };
+        calls.push_back(call);
+        POP(CALL_END);
+        if (skip) {
+            SetJumpTarget(skip);
+        }
+        break;
+    }
+
+    case OP_IFU:
+    case OP_IFC:
+    {
+        if (dest < pc || dest + num_instructions > MAX_PROGRAM_CODE_LENGTH) {
+            failed = true;
+            break;
+        }
+
+        u8* to_else = J_CC(InvertCondition(CompileCondition(instr)));
+        CompileBlock(dest, NewRegion(region, 1, dest));
+        if (num_instructions > 0) {
+            u8* to_end = J();
+            SetJumpTarget(to_else);
+            CompileBlock(dest + num_instructions, NewRegion(region, 0, dest + num_instructions));
+            SetJumpTarget(to_end);
+        } else {
+            SetJumpTarget(to_else);
+        }
+        break;
+    }
+
+    case OP_LOOP:
+    {
+        if (dest < address || dest >= MAX_PROGRAM_CODE_LENGTH) {
+            failed = true;
+            break;
+        }
+
+        const s32 loop_offset = (s32)(offsetof(ShaderUniforms, i) +
+            instr.flow_control.int_uniform_id * sizeof(u32));
+        const MemArg loop_register = MDisp(STATE, offsetof(UnitState, address) + 2 * sizeof(s32));
+
+        // Pushed twice to keep the stack aligned
+        PUSH(LOOP_COUNTER);
+        PUSH(LOOP_COUNTER);
+        MOVZX8_RM(LOOP_COUNTER, MDisp(UNIFORMS, loop_offset));
+        ALU_RI(ALU_ADD, LOOP_COUNTER, 1);
+        MOVZX8_RM(RAX, MDisp(UNIFORMS, loop_offset + 1));
+        MOV_MR(loop_register, RAX);
+
+        const u8* loop_start = GetCodePtr();
+        Loop loop;
+        loop.address = address;
+        loops.push_back(loop);
+        CompileBlock(dest + 1, NewRegion(region, 1, dest + 1));
+
+        MOVZX8_RM(RAX, MDisp(UNIFORMS, loop_offset + 2));
+        ALU_RM(ALU_ADD, RAX, loop_register);
+        MOV_MR(loop_register, RAX);
+        ALU_RI(ALU_SUB, LOOP_COUNTER, 1);
+        SetJumpTarget(J_CC(CC_NZ), loop_start);
+
+        const std::vector<u8*>& loop_breaks = loops.back().breaks;
+        for (size_t i = 0; i < loop_breaks.size(); i++) {
+            SetJumpTarget(loop_breaks[i]);
+        }
+        loops.pop_back();
+        POP(LOOP_COUNTER);
+        POP(LOOP_COUNTER);
+        break;
+    }
+
+    default:
+        CompileArithmetic(instr);
+        break;
+    }
+}
+
+/**
+ * Loads a source register with the swizzle and negation of the operand descriptor applied
+ * @param dst Register to load to
+ * @param index Source register index
+ * @param address_register_index Address register offsetting uniform indices, 0 for none
+ * @param selector Component selector of the source
+ * @param negate Whether to negate the source
+ */
+void ShaderCompiler::LoadSource(X64Reg dst, u32 index, u32 address_register_index, u32 selector,
+    bool negate) {
+
+    if (index < SOURCE_TEMPORARY) {
+        MOVAPS_RM(dst, RegisterArg(offsetof(UnitState, input), index - SOURCE_INPUT));
+    } else if (index < SOURCE_FLOAT_UNIFORM) {
+        MOVAPS_RM(dst, RegisterArg(offsetof(UnitState, temporary), index - SOURCE_TEMPORARY));
+    } else if (address_register_index == 0) {
+        MOVAPS_RM(dst, MDisp(UNIFORMS, (s32)(offsetof(ShaderUniforms, f) +
+            (index - SOURCE_FLOAT_UNIFORM) * 16)));
+    } else {
+        MOV_RM(RAX, MDisp(STATE, (s32)(offsetof(UnitState, address) +
+            (address_register_index - 1) * sizeof(s32))));
+        ALU_RI(ALU_ADD, RAX, index - SOURCE_FLOAT_UNIFORM);
+        ALU_RI(ALU_AND, RAX, 0x7F);
+        SHIFT_RI(SHIFT_SHL, RAX, 4);
+        MemArg uniform = MIndex(UNIFORMS, RAX, 1);
+        uniform.disp = (s32)offsetof(ShaderUniforms, f);
+        MOVAPS_RM(dst, uniform);
+    }
+
+    // SHUFPS takes the selector of x in its low bits
+    u8 shuffle = 0;
+    for (int i = 0; i < 4; i++) {
+        shuffle |= SwizzlePattern::GetSelectorComponent(selector, i) << (2 * i);
+    }
+    if (shuffle != 0xE4) {
+        SHUFPS_R(dst, dst, shuffle);
+    }
+
+    if (negate) {
+        PS_RM(SSE_XOR, dst, MDisp(CONSTANTS, offsetof(Constants, sign_mask)));
+    }
+}
+
+/**
+ * Writes the components of a destination register enabled by an operand descriptor
+ * @param index Destination register index
+ * @param dest_mask Destination component mask of the operand descriptor
+ * @param src Register holding the values to write, which is clobbered
+ */
+void ShaderCompiler::StoreDest(u32 index, u32 dest_mask, X64Reg src) {
+    const MemArg dest = (index < DEST_TEMPORARY) ?
+        RegisterArg(offsetof(UnitState, output), index - DEST_OUTPUT) :
+        RegisterArg(offsetof(UnitState, temporary), index - DEST_TEMPORARY);
+
+    u8 lanes = 0;
+    for (int i = 0; i < 4; i++) {
+        if (dest_mask & (8 >> i)) {
+            lanes |= 1 << i;
+        }
+    }
+
+    if (lanes == 0xF) {
+        MOVAPS_MR(dest, src);
+    } else if (lanes != 0) {
+        MOVAPS_RM(XMM4, dest);
+        if (g_have_sse41) {
+            BLENDPS_R(XMM4, src, lanes);
+        } else {
+            const MemArg mask = MDisp(CONSTANTS, offsetof(Constants, lane_masks) + lanes * 16);
+            PS_RM(SSE_AND, src, mask);
+            MOVAPS_RM(XMM5, mask);
+            PS_R(SSE_ANDN, XMM5, XMM4);
+            PS_R(SSE_OR, src, XMM5);
+            MOVAPS_R(XMM4, src);
+        }
+        MOVAPS_MR(dest, XMM4);
+    }
+}
+
+/// Calls the interpreter to execute an instruction
+void ShaderCompiler::CompileFallback(Instruction instr, SwizzlePattern swizzle) {
+    MOV64_R(ABI_PARAM1, STATE);
+    MOV64_R(ABI_PARAM2, UNIFORMS);
+    MOV_RI(ABI_PARAM3, instr.hex);
+    MOV_RI(ABI_PARAM4, swizzle.hex);
+    if (ABI_SHADOW_SPACE) {
+        ALU64_RI(ALU_SUB, RSP, ABI_SHADOW_SPACE);
+    }
+    MOV64_RM(RAX, MDisp(CONSTANTS, offsetof(Constants, fallback)));
+    CALL_R(RAX);
+    if (ABI_SHADOW_SPACE) {
+        ALU64_RI(ALU_ADD, RSP, ABI_SHADOW_SPACE);
+    }
+}
+
+/**
+ * Sets a component of the conditional code by comparing XMM1 with XMM2
+ * @param op Comparison
+ * @param component Component to compare and set, 0 (x) or 1 (y)
+ */
+void ShaderCompiler::CompileCompare(CompareOp op, int component) {
+    switch (op) {
+    case COMPARE_EQUAL:
+    case COMPARE_NOT_EQUAL:
+    case COMPARE_LESS_THAN:
+    case COMPARE_LESS_EQUAL:
+    {
+        static const SSECompare predicates[4] = {
+            SSE_CMP_EQ, SSE_CMP_NEQ, SSE_CMP_LT, SSE_CMP_LE,
+        };
+        MOVAPS_R(XMM0, XMM1);
+        CMPPS_R(XMM0, XMM2, predicates[op]);
+        break;
+    }
+    case COMPARE_GREATER_THAN:
+        MOVAPS_R(XMM0, XMM2);
+        CMPPS_R(XMM0, XMM1, SSE_CMP_LT);
+        break;
+    case COMPARE_GREATER_EQUAL:
+        MOVAPS_R(XMM0, XMM2);
+        CMPPS_R(XMM0, XMM1, SSE_CMP_LE);
+        break;
+    default:
+        PS_R(SSE_XOR, XMM0, XMM0);
+        break;
+    }
+
+    MOVMSKPS_R(RAX, XMM0);
+    if (component) {
+        SHIFT_RI(SHIFT_SHR, RAX, component);
+    }
+    ALU_RI(ALU_AND, RAX, 1);
+    MOV8_MR(MDisp(STATE, (s32)(offsetof(UnitState, conditional_code) + component)), RAX);
+}
+
+void ShaderCompiler::CompileArithmetic(Instruction instr) {
+    const u32 op = instr.GetOpCode();
+    const bool mad = (op == OP_MAD || op == OP_MADI);
+
+    SwizzlePattern swizzle;
+    swizzle.hex = program.swizzle_data[mad ? instr.mad.operand_desc_id :
+        instr.common.operand_desc_id];
+
+    switch (op) {
+    case OP_ADD: case OP_DP3: case OP_DP4: case OP_DPH: case OP_MUL: case OP_SGE: case OP_SLT:
+    case OP_MAX: case OP_MIN: case OP_RCP: case OP_RSQ: case OP_MOVA: case OP_MOV: case OP_DPHI:
+    case OP_SGEI: case OP_SLTI: case OP_CMP: case OP_MAD: case OP_MADI:
+        break;
+
+    case OP_FLR:
+        if (g_have_sse41)
+            break;
+        CompileFallback(instr, swizzle);
+        return;
+
+    case OP_DST: case OP_DSTI: case OP_EX2: case OP_LG2: case OP_LIT:
+        CompileFallback(instr, swizzle);
+        return;
+
+    default:
+        // Unknown instructions do nothing, like in the interpreter
+        return;
+    }
+
+    if (mad) {
+        const bool inverted = (op == OP_MADI);
+        const u32 address_register_index = instr.mad.address_register_index;
+        LoadSource(XMM1, instr.mad.src1, 0, swizzle.src1_selector, swizzle.negate_src1 != 0);
+        LoadSource(XMM2, inverted ? instr.mad.src2i : instr.mad.src2,
+            inverted ? 0 : address_register_index, swizzle.src2_selector,
+            swizzle.negate_src2 != 0);
+        LoadSource(XMM3, inverted ? instr.mad.src3i : instr.mad.src3,
+            inverted ? address_register_index : 0, swizzle.src3_selector,
+            swizzle.negate_src3 != 0);
+        PS_R(SSE_MUL, XMM1, XMM2);
+        PS_R(SSE_ADD, XMM1, XMM3);
+        StoreDest(instr.mad.dest, swizzle.dest_mask, XMM1);
+        return;
+    }
+
+    const bool inverted = (op >= OP_DPHI && op <= OP_SLTI);
+    const u32 address_register_index = instr.common.address_register_index;
+    LoadSource(XMM1, inverted ? instr.common.src1i : instr.common.src1,
+        inverted ? 0 : address_register_index, swizzle.src1_selector,
+        swizzle.negate_src1 != 0);
+    if (op != OP_MOV && op != OP_MOVA && op != OP_RCP && op != OP_RSQ && op != OP_FLR) {
+        LoadSource(XMM2, inverted ? instr.common.src2i : instr.common.src2,
+            inverted ? address_register_index : 0, swizzle.src2_selector,
+            swizzle.negate_src2 != 0);
+    }
+
+    const u32 dest = instr.common.dest;
+    const MemArg one = MDisp(CONSTANTS, offsetof(Constants, one));
+
+    switch (op) {
+    case OP_ADD:
+        PS_R(SSE_ADD, XMM1, XMM2);
+        StoreDest(dest, swizzle.dest_mask, XMM1);
+        break;
+
+    case OP_MUL:
+        PS_R(SSE_MUL, XMM1, XMM2);
+        StoreDest(dest, swizzle.dest_mask, XMM1);
+        break;
+
+    case OP_MAX:
+        PS_R(SSE_MAX, XMM1, XMM2);
+        StoreDest(dest, swizzle.dest_mask, XMM1);
+        break;
+
+    case OP_MIN:
+        PS_R(SSE_MIN, XMM1, XMM2);
+        StoreDest(dest, swizzle.dest_mask, XMM1);
+        break;
+
+    case OP_DP3:
+    case OP_DP4:
+    case OP_DPH:
+    case OP_DPHI:
+    {
+        const MemArg xyz_mask = MDisp(CONSTANTS, offsetof(Constants, lane_masks) + 7 * 16);
+        if (op == OP_DPH || op == OP_DPHI) {
+            PS_RM(SSE_AND, XMM1, xyz_mask);
+            PS_RM(SSE_OR, XMM1, MDisp(CONSTANTS, offsetof(Constants, w_one)));
+        }
+        if (g_have_sse41) {
+            DPPS_R(XMM1, XMM2, (op == OP_DP3) ? 0x7F : 0xFF);
+        } else {
+            // Sums the products as (x + y) + (z + w) in all lanes, like DPPS
+            PS_R(SSE_MUL, XMM1, XMM2);
+            if (op == OP_DP3) {
+                PS_RM(SSE_AND, XMM1, xyz_mask);
+            }
+            MOVAPS_R(XMM4, XMM1);
+            SHUFPS_R(XMM4, XMM4, 0xB1);
+            PS_R(SSE_ADD, XMM1, XMM4);
+            MOVAPS_R(XMM4, XMM1);
+            SHUFPS_R(XMM4, XMM4, 0x4E);
+            PS_R(SSE_ADD, XMM1, XMM4);
+        }
+        StoreDest(dest, swizzle.dest_mask, XMM1);
+        break;
+    }
+
+    case OP_SGE:
+    case OP_SGEI:
+        CMPPS_R(XMM2, XMM1, SSE_CMP_LE);
+        PS_RM(SSE_AND, XMM2, one);
+        StoreDest(dest, swizzle.dest_mask, XMM2);
+        break;
+
+    case OP_SLT:
+    case OP_SLTI:
+        CMPPS_R(XMM1, XMM2, SSE_CMP_LT);
+        PS_RM(SSE_AND, XMM1, one);
+        StoreDest(dest, swizzle.dest_mask, XMM1);
+        break;
+
+    case OP_FLR:
+        ROUNDPS_R(XMM1, XMM1, 1);
+        StoreDest(dest, swizzle.dest_mask, XMM1);
+        break;
+
+    case OP_RCP:
+    case OP_RSQ:
+        if (op == OP_RSQ) {
+            SS_R(SSE_SQRT, XMM1, XMM1);
+        }
+        MOVSS_RM(XMM0, one);
+        SS_R(SSE_DIV, XMM0, XMM1);
+        SHUFPS_R(XMM0, XMM0, 0);
+        StoreDest(dest, swizzle.dest_mask, XMM0);
+        break;
+
+    case OP_MOV:
+        StoreDest(dest, swizzle.dest_mask, XMM1);
+        break;
+
+    case OP_MOVA:
+    {
+        const s32 address_offset = (s32)offsetof(UnitState, address);
+        if (swizzle.DestComponentEnabled(0)) {
+            CVTTSS2SI_R(RAX, XMM1);
+            MOV_MR(MDisp(STATE, address_offset), RAX);
+        }
+        if (swizzle.DestComponentEnabled(1)) {
+            SHUFPS_R(XMM1, XMM1, 0x55);
+            CVTTSS2SI_R(RAX, XMM1);
+            MOV_MR(MDisp(STATE, address_offset + sizeof(s32)), RAX);
+        }
+        break;
+    }
+
+    case OP_CMP:
+        CompileCompare(instr.compare.op_x, 0);
+        CompileCompare(instr.compare.op_y, 1);
+        break;
+    }
+}
+
+CompiledShader ShaderCompiler::Compile() {
+    for (u32 i = 0; i <= MAX_PROGRAM_CODE_LENGTH; i++) {
+        labels[i] = NULL;
+        region_of[i] = -1;
+        return_points[i] = false;
+    }
+    for (u32 i = 0; i < MAX_PROGRAM_CODE_LENGTH; i++) {
+        Instruction instr;
+        instr.hex = program.code[i];
+        const u32 op = instr.GetOpCode();
+        const u32 call_end = instr.flow_control.dest_offset + instr.flow_control.num_instructions;
+        if ((op == OP_CALL || op == OP_CALLC || op == OP_CALLU) && call_end <= MAX_PROGRAM_CODE_LENGTH)
+            return_points[call_end] = true;
+    }
+
+    // The code pointer is 16-byte aligned, the constants are accessed relative to the code
+    const u8* constants = GetCodePtr();
+    memcpy(GetCodePtr(), &g_constants, sizeof(Constants));
+    SetCodePtr(GetCodePtr() + sizeof(Constants));
+
+    const CompiledShader entry_point = (CompiledShader)GetCodePtr();
+
+    PUSH(RBX);
+    PUSH(RBP);
+    PUSH(R12);
+    PUSH(R13);
+    PUSH(R14);
+    PUSH(R15);
+    ALU64_RI(ALU_SUB, RSP, 8);
+    MOV64_R(STATE, ABI_PARAM1);
+    MOV64_R(UNIFORMS, ABI_PARAM2);
+    LEA64_RIP(CONSTANTS, constants);
+    MOV64_R(STACK_BASE, RSP);
+    MOV_RI(CALL_END, 0xFFFFFFFF);
+    u8* to_entry = J();
+
+    // Everything is compiled in program order, the top level up to the end of the reachable code
+    const u32 program_end = FindProgramEnd();
+    Region top_level;
+    top_level.depth = 0;
+    top_level.end_address = MAX_PROGRAM_CODE_LENGTH + 1;
+    top_level.end = NULL;
+    regions.push_back(top_level);
+
+    while (pc < program_end && !failed) {
+        CompileInstruction(0);
+    }
+    const u32 end = pc;
+
+    labels[end] = GetCodePtr();
+    region_of[end] = 0;
+    if (return_points[end]) {
+        CompileReturnCheck(end);
+    }
+    exits.push_back(J());
+
+    for (size_t i = 0; i < exits.size(); i++) {
+        SetJumpTarget(exits[i]);
+    }
+    MOV64_R(RSP, STACK_BASE);
+    ALU64_RI(ALU_ADD, RSP, 8);
+    POP(R15);
+    POP(R14);
+    POP(R13);
+    POP(R12);
+    POP(RBP);
+    POP(RBX);
+    RET();
+
+    if (failed || !Validate(end))
+        return NULL;
+
+    SetJumpTarget(to_entry, labels[entry]);
+    for (size_t i = 0; i < jumps.size(); i++) {
+        SetJumpTarget(jumps[i].patch, GetJumpTarget(jumps[i]));
+    }
+    for (size_t i = 0; i < calls.size(); i++) {
+        SetJumpTarget(calls[i].patch, labels[calls[i].target]);
+    }
+    return entry_point;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Finds room for a program at the end of the code space, clearing the code space if it is full
+ * @param size Size of the program
+ * @return 16-byte aligned start of the program
+ */
+static u8* AllocateProgram(size_t size) {
+    u8* start = (u8*)(((uintptr_t)g_code_ptr + 15) & ~(uintptr_t)15);
+    if (start + size > g_code_space + CODE_CACHE_SIZE) {
+        INFO_LOG(GPU, "Vertex shader code cache full, clearing");
+        g_shaders.clear();
+        start = g_code_space;
+    }
+    return start;
+}
+
+/// Copies a program saved to the disk cache to the code space
+static CompiledShader LoadProgram(const u8* code, u32 size) {
+    u8* start = AllocateProgram(size);
+    memcpy(start, code, size);
+    memcpy(start, &g_constants, sizeof(Constants));
+    g_code_ptr = start + size;
+    return (CompiledShader)(start + sizeof(Constants));
+}
+
+/// Preloads the programs of the disk cache compiled for this host
+class DiskCacheInserter : public LinearDiskCacheReader<DiskCacheKey, u8> {
+public:
+    DiskCacheInserter() : num_loaded(0) {
+    }
+
+    void Read(const DiskCacheKey& key, const u8* value, u32 value_size) {
+        if (key.features != GetHostFeatures() || value_size > MAX_SHADER_CODE_SIZE ||
+            (value_size != 0 && value_size <= sizeof(Constants)))
+            return;
+
+        const u64 shader_key = GetShaderKey(key.hash, key.entry);
+        g_disk_cache_keys.insert(shader_key);
+
+        // Half of the code space is left for the programs compiled while running
+        if (g_code_ptr + value_size + 16 > g_code_space + CODE_CACHE_SIZE / 2)
+            return;
+        g_shaders[shader_key] = (value_size != 0) ? LoadProgram(value, value_size) : NULL;
+        num_loaded++;
+    }
+
+    u32 num_loaded;
+};
+
+CompiledShader GetShader(const ProgramMemory& program, u32 entry, u64 hash) {
+    const u64 key = GetShaderKey(hash, entry);
+    std::map<u64, CompiledShader>::iterator it = g_shaders.find(key);
+    if (it != g_shaders.end())
+        return it->second;
+
+    u8* start = AllocateProgram(MAX_SHADER_CODE_SIZE);
+    ShaderCompiler* compiler = new ShaderCompiler(start, program, entry);
+    const CompiledShader shader = compiler->Compile();
+    u32 size = 0;
+    if (shader) {
+        _assert_msg_(GPU, compiler->GetCodePtr() <= start + MAX_SHADER_CODE_SIZE,
+            "vertex shader overflowed its code size");
+        size = (u32)(compiler->GetCodePtr() - start);
+        g_code_ptr = compiler->GetCodePtr();
+    } else {
+        INFO_LOG(GPU, "Vertex shader with entry point 0x%03X is not compilable, interpreting it",
+            entry);
+    }
+    delete compiler;
+
+    // Programs that are not compilable are saved without code, to skip compiling them next time
+    if (g_disk_cache_keys.insert(key).second) {
+        DiskCacheKey disk_key = { hash, entry, GetHostFeatures() };
+        g_disk_cache.Append(disk_key, start, size);
+    }
+
+    g_shaders[key] = shader;
+    return shader;
+}
+
+void Init() {
+    g_have_sse41 = cpu_info.bSSE4_1;
+
+    for (int i = 0; i < 4; i++) {
+        g_constants.sign_mask[i] = 0x80000000;
+        g_constants.one[i] = 1.0f;
+        g_constants.w_one[i] = (i == 3) ? 1.0f : 0.0f;
+        for (int lanes = 0; lanes < 16; lanes++) {
+            g_constants.lane_masks[lanes][i] = (lanes & (1 << i)) ? 0xFFFFFFFF : 0;
+        }
+    }
+
+    g_constants.fallback = FallbackArithmetic;
+
+    g_code_space = (u8*)AllocateExecutableMemory(CODE_CACHE_SIZE);
+    g_code_ptr = g_code_space;
+
+    const std::string cache_dir = File::GetUserPath(D_SHADERCACHE_IDX);
+    File::CreateFullPath(cache_dir);
+    DiskCacheInserter inserter;
+    g_disk_cache.OpenAndRead((cache_dir + "vertex_shaders_x64.cache").c_str(), inserter);
+    INFO_LOG(GPU, "Loaded %u vertex shaders from the disk cache", inserter.num_loaded);
+}
+
+void Shutdown() {
+    g_disk_cache.Sync();
+    g_disk_cache.Close();
+    g_disk_cache_keys.clear();
+    g_shaders.clear();
+    FreeMemoryPages(g_code_space, CODE_CACHE_SIZE);
+    g_code_space = g_code_ptr = NULL;
+}
+
+} // namespace
+
+} // namespace
+
+#else // EMU_ARCHITECTURE_X64
+
+namespace Pica {
+
+namespace VertexShaderJit {
+
+CompiledShader GetShader(const VertexShader::ProgramMemory& program, u32 entry, u64 hash) {
+    return NULL;
+}
+
+void Init() {
+}
+
+void Shutdown() {
+}
+
+} // namespace
+
+} // namespace
+
+#endif // EMU_ARCHITECTURE_X64
@@ -0,0 +1,49 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+
+#include "video_core/vertex_shader.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// x86-64 vertex shader compiler
+//
+// Compiles whole shader programs to code running one vertex per call, with the shader registers
+// kept in the UnitState and each instruction compiled to a handful of SSE instructions. Calls,
+// conditionals and loops are laid out as structured native code, programs that are not properly
+// nested are left to the interpreter. Compiled programs are cached by the hash of the program and
+// swizzle memory and their entry point, and saved to a disk cache that is preloaded at startup.
+
+namespace Pica {
+
+namespace VertexShaderJit {
+
+/**
+ * Compiled program
+ * @param state Registers, with the inputs loaded
+ * @param uniforms Uniforms to read
+ */
+typedef void (*CompiledShader)(VertexShader::UnitState* state,
+    const VertexShader::ShaderUniforms* uniforms);
+
+/**
+ * Gets the compiled code of a program, compiling it if it is not cached yet
+ * @param program Program and swizzle memory
+ * @param entry Offset of the first instruction to execute
+ * @param hash Hash of the program and swizzle memory
+ * @return Compiled program, valid until the next call, or NULL if it has to be interpreted
+ */
+CompiledShader GetShader(const VertexShader::ProgramMemory& program, u32 entry, u64 hash);
+
+/// Initialize the vertex shader compiler
+void Init();
+
+/// Shutdown the vertex shader compiler, freeing all compiled programs
+void Shutdown();
+
+} // namespace
+
+} // namespace
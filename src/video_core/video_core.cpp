@@ -8,9 +8,16 @@
 
 #include "core/core.h"
 
+#include "video_core/command_processor.h"
+#include "video_core/gpu_thread.h"
+#include "video_core/rasterizer.h"
+#include "video_core/texture_cache.h"
+#include "video_core/vertex_shader.h"
 #include "video_core/video_core.h"
 #include "video_core/renderer_base.h"
+#include "video_core/renderer_opengl/gl_rasterizer.h"
 #include "video_core/renderer_opengl/renderer_opengl.h"
+#include "video_core/renderer_software/renderer_software.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Video Core namespace
@@ -20,33 +27,58 @@ namespace VideoCore {
 EmuWindow*      g_emu_window    = NULL;     ///< Frontend emulator window
 RendererBase*   g_renderer      = NULL;     ///< Renderer plugin
 int             g_current_frame = 0;
+bool            g_use_gpu_thread = false;
+bool            g_use_shader_jit = true;
+bool            g_use_hw_rasterizer = true;
+std::string     g_frame_dump_path;
 
 /// Start the video core
 void Start() {
-    if (g_emu_window == NULL) {
+    if (g_renderer == NULL) {
         ERROR_LOG(VIDEO, "VideoCore::Start called without calling Init()!");
     }
 }
 
 /// Initialize the video core
 void Init(EmuWindow* emu_window) {
-    // Known problem with GLEW prevents contexts above 2.x on OSX unless glewExperimental is enabled.
-    glewExperimental = GL_TRUE;
+    Pica::CommandProcessor::Init();
+    Pica::VertexShader::Init();
+    Pica::Rasterizer::Init();
+    Pica::TextureCache::Init();
 
     g_emu_window = emu_window;
-    g_emu_window->MakeCurrent();
-    g_renderer = new RendererOpenGL();
+    if (g_emu_window) {
+        // Known problem with GLEW prevents contexts above 2.x on OSX unless glewExperimental is
+        // enabled.
+        glewExperimental = GL_TRUE;
+
+        g_emu_window->MakeCurrent();
+        g_renderer = new RendererOpenGL();
+    } else {
+        g_renderer = new RendererSoftware();
+    }
     g_renderer->SetWindow(g_emu_window);
     g_renderer->Init();
+    if (g_emu_window && g_use_hw_rasterizer) {
+        Pica::HWRasterizer::Init();
+    }
 
     g_current_frame = 0;
 
+    GPUThread::Init(g_emu_window, g_use_gpu_thread);
+
     NOTICE_LOG(VIDEO, "initialized OK");
 }
 
 /// Shutdown the video core
 void Shutdown() {
+    GPUThread::Shutdown();
+    Pica::HWRasterizer::Shutdown();
     delete g_renderer;
+    Pica::TextureCache::Shutdown();
+    Pica::Rasterizer::Shutdown();
+    Pica::VertexShader::Shutdown();
+    Pica::CommandProcessor::Shutdown();
     NOTICE_LOG(VIDEO, "shutdown OK");
 }
 
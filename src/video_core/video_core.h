@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <string>
+
 #include "common/common.h"
 #include "common/emu_window.h"
 
@@ -27,11 +29,23 @@ static const int kScreenBottomHeight    = 240;  ///< 3DS bottom screen height
 
 extern RendererBase*   g_renderer;              ///< Renderer plugin
 extern int             g_current_frame;         ///< Current frame
+extern bool            g_use_gpu_thread;        ///< Whether to render on a separate video thread,
+                                                ///< set by the frontend before Init
+extern bool            g_use_shader_jit;        ///< Whether to compile vertex shaders to host code
+                                                ///< where supported, set by the frontend
+extern bool            g_use_hw_rasterizer;     ///< Whether to rasterize with OpenGL when rendering
+                                                ///< to a window, set by the frontend before Init
+extern std::string     g_frame_dump_path;       ///< Directory the software renderer dumps frames
+                                                ///< to, or empty to not dump them
 
 /// Start the video core
 void Start();
 
-/// Initialize the video core
+/**
+ * Initialize the video core
+ * @param emu_window Emulator window to render to, or NULL to run headless with the software
+ *                   renderer
+ */
 void Init(EmuWindow* emu_window);
 
 /// Shutdown the video core